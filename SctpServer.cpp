@@ -9,14 +9,17 @@
 */
 
 /* System includes */
-#include <iostream>
 #include <string>
+#include <time.h>
+#include <unistd.h>
 #include <boost/bind.hpp>
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
 
 /* Project / bespoke includes */
 #include "SctpServer.h"
+#include <boost/asio_sctp/latency_histogram.hpp>
+#include <boost/asio_sctp/log.hpp>
 
 /* Macros / defines */
 #define SCTP_MIN_LENGTH	4
@@ -24,24 +27,125 @@
 #define TIME_TO_LIVE_MS		100
 #define DEFAULT_CONTEXT		0
 
+#define SEND_HIGH_WATERMARK	(256 * 1024)	// refuse further sends once this much is queued
+#define SEND_LOW_WATERMARK	(64 * 1024)		// resume sending once the queue drains to this
+#define SEND_STREAM_HIGH_WATERMARK	(64 * 1024)	// likewise for each stream...
+#define SEND_STREAM_LOW_WATERMARK	(16 * 1024)	// ...so that one backed-up stream holds up only itself
+#define SEND_HOLD_LIMIT		(1024 * 1024)	// messages refused meanwhile are held up to this, then Send fails
+
+#define TX_RING_SIZE		(1024 * 1024)	// per sending thread, for messages encoded in place
+
+#define RX_MAX_MESSAGE_SIZE	(16 * 1024 * 1024)	// larger incoming messages are discarded
+#define RX_BATCH_SIZE		64					// most messages handled per pass of the receive loop
+#define RX_STREAM_QUEUE_SIZE	256					// messages waiting per stream for a worker before the receive loop waits
+
+#define TIMER_TICK_MS			100		// resolution of the connection timers
+#define KEEPALIVE_INTERVAL_MS	10000	// application keepalive after this long without traffic
+#define IDLE_TIMEOUT_MS			60000	// disconnect after this long without traffic
+#define TUNE_INTERVAL_MS		5000	// re-measure the path and adjust the association settings
+
+#define KEEPALIVE_VERSION		1		// application keepalive: a bare message header...
+#define KEEPALIVE_CLASS			0
+#define KEEPALIVE_TYPE			0
+#define KEEPALIVE_STREAM		0		// ...on this stream...
+#define KEEPALIVE_PPID			0		// ...with this payload protocol ID
+
+#define ACCEPT_BACKLOG			4096	// associations the kernel may hold waiting to be accepted
+#define ACCEPT_BATCH_SIZE		64		// accepted per pass before other handlers get a turn
+#define ACCEPT_RETRY_MS			100		// pause after an accept error, e.g. out of descriptors
+#define ADMISSION_RATE			1.0		// new connections per second from one address, after...
+#define ADMISSION_BURST			4		// ...this many at once
+#define MAX_CONNECTIONS			10000	// further connections are aborted
+
+#define STATS_INTERVAL_MS		60000	// how often the receive delay is reported
+
+#define DRAIN_SPREAD_MS			20000	// after a handover, connections start draining spread over this long...
+#define DRAIN_LIMIT_MS			10000	// ...and are closed regardless once they have been draining this long
+
+/* Static data */
+static boost::asio_sctp::latency_histogram g_ReceiveDelay;  // kernel receive to OnReceive, all connections
+static boost::asio_sctp::sctp_receive_buffer_pool g_RxBuffers(RX_BUFFER_SIZE);  // lent to connections only while they handle a batch
+static boost::thread_specific_ptr<boost::asio_sctp::sctp_send_ring> g_pTxRing(&boost::asio_sctp::sctp_send_ring::retire);  // this thread's, once it has reserved
+
+/**
+ * Current time on the clock used for kernel receive timestamps
+ *
+ * @return nanoseconds since the epoch
+ */
+static boost::uint64_t RealTimeNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (boost::uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Records how long a message waited between the kernel receiving it and its handler being
+ * called, in this process's queues and the stream executor's. Called as the handler is
+ * entered, so the clock is read after any wait for a worker
+ *
+ * @param msg the message about to be handled
+ */
+static void RecordReceiveDelay(const boost::asio_sctp::sctp_message& msg)
+{
+	if(msg.timestamp_ns != 0)
+	{
+		boost::uint64_t nowNs = RealTimeNs();
+		g_ReceiveDelay.record(nowNs > msg.timestamp_ns ? nowNs - msg.timestamp_ns : 0);
+	}
+}
+
 /**
  * CSctpConnection factory function
  *
  * @param IO_Service reference to the global Boost ASIO service
+ * @param rTimerWheel the timer wheel, run by IO_Service, which drives the connection's timers
+ * @param pTrace trace file to record the connection's traffic into, or NULL
+ * @param pTuner tuner to fit the association settings to the measured path, or NULL
+ * @param pAdmission admission control which admitted the connection, released when it closes, or NULL
  *
  * @return a new SCTP connection object
  */
-CSctpConnection* CSctpConnection::Create(boost::asio::io_service& IO_Service)
+CSctpConnection* CSctpConnection::Create(boost::asio::io_service& IO_Service, boost::asio_sctp::timer_wheel& rTimerWheel,
+		boost::asio_sctp::trace_writer* pTrace, const CTunerPtr& pTuner,
+		boost::asio_sctp::sctp_admission_control* pAdmission)
 {
-	return new CSctpConnection(IO_Service);
+	return new CSctpConnection(IO_Service, rTimerWheel, pTrace, pTuner, pAdmission);
 }
 
 /**
  * Private constructor
  */
-CSctpConnection::CSctpConnection(boost::asio::io_service& IO_Service)
+CSctpConnection::CSctpConnection(boost::asio::io_service& IO_Service, boost::asio_sctp::timer_wheel& rTimerWheel,
+		boost::asio_sctp::trace_writer* pTrace, const CTunerPtr& pTuner,
+		boost::asio_sctp::sctp_admission_control* pAdmission)
 	: m_Socket(IO_Service)
+	, m_SendQueue(m_Socket)
+	, m_TimerWheel(rTimerWheel)
+	, m_KeepaliveTimer(boost::bind(&CSctpConnection::OnKeepaliveTimer, this))
+	, m_IdleTimer(boost::bind(&CSctpConnection::OnIdleTimer, this))
+	, m_TuneTimer(boost::bind(&CSctpConnection::OnTuneTimer, this))
+	, m_DrainTimer(boost::bind(&CSctpConnection::OnDrainTimer, this))
+	, m_Draining(false)
+	, m_LastActivityTick(0)
+	, m_RxBatch(RX_BATCH_SIZE, g_RxBuffers, RX_MAX_MESSAGE_SIZE)
+	, m_pTrace(pTrace)
+	, m_pTuner(pTuner)
+	, m_pAdmission(pAdmission)
+	, m_pAddressWatcher(NULL)
+	, m_pStreamExecutor(NULL)
+	, m_HeldBytes(0)
+	, m_NumHeld(0)
 {
+	m_SendQueue.set_time_to_live(TIME_TO_LIVE_MS);
+	m_SendQueue.set_default_lifetime(TIME_TO_LIVE_MS);  // also drop messages still queued here after this long
+	m_SendQueue.set_watermarks(SEND_HIGH_WATERMARK, SEND_LOW_WATERMARK);
+	m_SendQueue.set_high_watermark_handler(boost::bind(&CSctpConnection::OnSendQueueFull, this));
+	m_SendQueue.set_low_watermark_handler(boost::bind(&CSctpConnection::OnSendQueueReady, this));
+	m_SendQueue.set_stream_watermarks(SEND_STREAM_HIGH_WATERMARK, SEND_STREAM_LOW_WATERMARK);
+	m_SendQueue.set_stream_high_watermark_handler(boost::bind(&CSctpConnection::OnStreamSendQueueFull, this, _1));
+	m_SendQueue.set_stream_low_watermark_handler(boost::bind(&CSctpConnection::OnStreamSendQueueReady, this, _1));
+	m_SendQueue.set_error_handler(boost::bind(&CSctpConnection::OnSendError, this, boost::asio::placeholders::error));
 }
 
 /**
@@ -49,9 +153,7 @@ CSctpConnection::CSctpConnection(boost::asio::io_service& IO_Service)
  */
 CSctpConnection::~CSctpConnection(void)
 {
-#ifdef _DEBUG
-	std::cout << "CSctpConnection destructor called" << std::endl;
-#endif
+	BOOST_ASIO_SCTP_LOG(debug, ("CSctpConnection destructor called"));
 }
 
 void CSctpConnection::StartReceiving(void)
@@ -73,48 +175,477 @@ void CSctpConnection::StartReceiving(void)
 }
 
 /**
- * Main (synchronous) receive loop
+ * Main (synchronous) receive loop. Each pass takes every message waiting on the socket, up
+ * to RX_BATCH_SIZE, so the yield is paid once per burst rather than per message.
  */
 void CSctpConnection::ReceiveLoop(void)
 {
 	while(m_Socket.is_open())
 	{
-		socklen_t len = sizeof(struct sockaddr_in);
-		int msgFlags;
-		int numBytes = sctp_recvmsg(m_Socket.native_handle(), (char*)RxBuffer, sizeof(RxBuffer), &m_PeerAddr, &len, &m_RxSRI, &msgFlags);
 		boost::system::error_code ec;
-		if(m_RxSRI.sinfo_flags & SCTP_EOF)
+		size_t numMessages = m_RxBatch.fill(m_Socket, ec);
+		if((ec == boost::asio::error::would_block) || (ec == boost::asio::error::try_again))
 		{
-			ec = boost::asio::error::eof;
+			// nothing complete was waiting; not an error, so the connection stays open
 		}
-		else if(m_RxSRI.sinfo_flags & SCTP_ABORT)
+		else if(ec)
 		{
-			ec = boost::asio::error::connection_reset;
+			if(m_pStreamExecutor)
+			{
+				// the messages read ahead of the shutdown are handled before the connection closes
+				m_pStreamExecutor->wait_idle(StreamKey(this, 0), StreamKey(this, 0xFFFF));
+			}
+			this->OnReceive(ec, boost::asio_sctp::sctp_message());
 		}
-		UINT16 streamNum = ntohs(m_RxSRI.sinfo_stream);
-		UINT32 payloadProtocolID = ntohl(m_RxSRI.sinfo_ppid);
-		if(numBytes >= 0)
+		else
 		{
-			this->OnReceive(ec, numBytes, streamNum, payloadProtocolID);
+			bool bData = false;
+			for(size_t i = 0; (i < numMessages) && m_Socket.is_open(); i++)
+			{
+				boost::asio_sctp::sctp_message msg = m_RxBatch[i];
+				if(m_RxBatch.info(i).msg_flags & MSG_NOTIFICATION)
+				{
+					const union sctp_notification* pNotification = reinterpret_cast<const union sctp_notification*>(msg.data);
+					if((msg.size >= sizeof(pNotification->sn_header)) && (pNotification->sn_header.sn_type == SCTP_SENDER_DRY_EVENT))
+					{
+						m_Socket.get_io_service().post(m_HandlerMemory.wrap(boost::bind(&CSctpConnection::OnSenderDry, this)));
+					}
+					continue;
+				}
+				bData = true;
+				msg.stream = ntohs(msg.stream);
+				msg.ppid = ntohl(msg.ppid);
+				if(m_pTrace)
+				{
+					m_pTrace->record(msg);
+				}
+				if(m_pStreamExecutor)
+				{
+					m_pStreamExecutor->post_wait(StreamKey(this, msg.stream), msg);  // waits while the stream's queue is full
+				}
+				else
+				{
+					RecordReceiveDelay(msg);
+					this->OnReceive(ec, msg);
+				}
+			}
+			if(bData)
+			{
+				NoteActivity();
+			}
 		}
 		boost::this_thread::yield();
 	}
 }
 
+/**
+ * Called on a receive worker thread for each message of a connection's stream, in the order
+ * the stream delivered them; other streams of the same connection may be processed at the
+ * same time on other workers
+ *
+ * @param key the connection and stream the message arrived on
+ * @param msg the complete received message, valid only for the duration of the call
+ */
+void CSctpConnection::OnStreamMessage(const StreamKey& key, const boost::asio_sctp::sctp_message& msg)
+{
+	RecordReceiveDelay(msg);
+	key.first->OnReceive(boost::system::error_code(), msg);
+}
+
 /**
  * Sends a raw byte sequence in an SCTP packet, with defined stream number and payload protocol ID.
+ * May be called from any thread without locking; the IO service thread sends everything
+ * submitted since its last pass in one batch, keeping each stream's messages in order.
+ * While the peer is not keeping up with a stream, its messages are held here and sent
+ * once the send queue has drained (OnSendQueueReady, OnStreamSendQueueReady)
+ *
+ * @return FALSE if the connection is closed, or SEND_HOLD_LIMIT bytes are already held and
+ * the message was dropped
+ */
+bool CSctpConnection::Send(const BYTE* pData, size_t numBytes, UINT16 streamNum, UINT32 payloadProtocolID)
+{
+	if(!m_Socket.is_open())
+	{
+		return false;
+	}
+	NoteActivity();
+	if(m_pTrace)
+	{
+		m_pTrace->record(pData, numBytes, streamNum, payloadProtocolID, 0, boost::asio_sctp::trace_record_header::outbound);
+	}
+	if((boost::asio_sctp::detail::atomic::load_acquire(m_NumHeld) == 0)
+		&& m_SendQueue.push(pData, numBytes, htons(streamNum), htonl(payloadProtocolID)))
+	{
+		return true;
+	}
+	return Hold(pData, numBytes, streamNum, payloadProtocolID);
+}
+
+/**
+ * Reserves space, in the calling thread's send ring, for a message to be encoded in place
+ * and then passed to Send without being copied. The message may be shortened with
+ * rMessage.truncate once its length is known; a reservation which is not sent is given
+ * back when rMessage is destroyed.
+ *
+ * @param numBytes the most the message may take
+ * @param rMessage receives the reservation
+ *
+ * @return where the message is to be encoded
+ */
+BYTE* CSctpConnection::Reserve(size_t numBytes, boost::asio_sctp::sctp_send_ring::region& rMessage)
+{
+	if(g_pTxRing.get() == NULL)
+	{
+		g_pTxRing.reset(boost::asio_sctp::sctp_send_ring::create(TX_RING_SIZE));
+	}
+	g_pTxRing->reserve(numBytes, rMessage);
+	return rMessage.data();
+}
+
+/**
+ * Sends a message encoded in place after Reserve, with defined stream number and payload
+ * protocol ID. The message is passed to the kernel from where it was encoded, unless it
+ * has to be held, when it is copied.
+ *
+ * @return FALSE if the connection is closed, or SEND_HOLD_LIMIT bytes are already held and
+ * the message was dropped
+ */
+bool CSctpConnection::Send(boost::asio_sctp::sctp_send_ring::region& rMessage, UINT16 streamNum, UINT32 payloadProtocolID)
+{
+	if(!m_Socket.is_open())
+	{
+		rMessage.reset();
+		return false;
+	}
+	NoteActivity();
+	if(m_pTrace)
+	{
+		m_pTrace->record(rMessage.data(), rMessage.size(), streamNum, payloadProtocolID, 0, boost::asio_sctp::trace_record_header::outbound);
+	}
+	if((boost::asio_sctp::detail::atomic::load_acquire(m_NumHeld) == 0)
+		&& m_SendQueue.commit(rMessage, htons(streamNum), htonl(payloadProtocolID)))
+	{
+		return true;
+	}
+	bool bHeld = Hold(rMessage.data(), rMessage.size(), streamNum, payloadProtocolID);
+	rMessage.reset();
+	return bHeld;
+}
+
+/**
+ * Sends a message refused by the send queue as soon as it drains, or at once if it has
+ * drained already.  Called from any thread
+ *
+ * @return FALSE if SEND_HOLD_LIMIT bytes are already held and the message was dropped
+ */
+bool CSctpConnection::Hold(const BYTE* pData, size_t numBytes, UINT16 streamNum, UINT32 payloadProtocolID)
+{
+	boost::mutex::scoped_lock lock(m_HeldMutex);
+	if((m_HeldPerStream.find(streamNum) == m_HeldPerStream.end())
+		&& m_SendQueue.push(pData, numBytes, htons(streamNum), htonl(payloadProtocolID)))
+	{
+		return true;  // the queue drained meanwhile, and nothing of this stream is held ahead of it
+	}
+	if(m_HeldBytes + numBytes > SEND_HOLD_LIMIT)
+	{
+		BOOST_ASIO_SCTP_LOG(warning, ("CSctpConnection::Hold - {} bytes held, message on stream {} dropped",
+				m_HeldBytes, streamNum));
+		return false;
+	}
+
+	m_HeldMessages.push_back(SHeldMessage());
+	SHeldMessage& rHeld = m_HeldMessages.back();
+	rHeld.data.assign(pData, pData + numBytes);
+	rHeld.streamNum = streamNum;
+	rHeld.payloadProtocolID = payloadProtocolID;
+	rHeld.deadlineMs = m_SendQueue.now_ms() + TIME_TO_LIVE_MS;  // as if it had been queued
+	m_HeldBytes += numBytes;
+	++m_HeldPerStream[streamNum];
+	boost::asio_sctp::detail::atomic::store_release(m_NumHeld, m_HeldMessages.size());
+	return true;
+}
+
+/**
+ * Passes held messages back to the send queue, in the order they were sent, until it
+ * refuses one; later messages of that stream stay held, those of other streams carry on.
+ * Held messages which have outlived TIME_TO_LIVE_MS are dropped
+ */
+void CSctpConnection::ResumeHeld(void)
+{
+	boost::mutex::scoped_lock lock(m_HeldMutex);
+	boost::uint64_t nowMs = m_SendQueue.now_ms();
+	std::set<UINT16> blockedStreams;
+	size_t numExpired = 0;
+	for(std::list<SHeldMessage>::iterator it = m_HeldMessages.begin(); it != m_HeldMessages.end(); )
+	{
+		if(blockedStreams.count(it->streamNum) != 0)
+		{
+			++it;
+			continue;
+		}
+		if(it->deadlineMs <= nowMs)
+		{
+			++numExpired;
+		}
+		else if(!m_SendQueue.push_until(it->deadlineMs, it->data.empty() ? NULL : &it->data[0], it->data.size(),
+				htons(it->streamNum), htonl(it->payloadProtocolID)))
+		{
+			blockedStreams.insert(it->streamNum);
+			++it;
+			continue;
+		}
+		m_HeldBytes -= it->data.size();
+		if(--m_HeldPerStream[it->streamNum] == 0)
+		{
+			m_HeldPerStream.erase(it->streamNum);
+		}
+		it = m_HeldMessages.erase(it);
+	}
+	boost::asio_sctp::detail::atomic::store_release(m_NumHeld, m_HeldMessages.size());
+	if(numExpired != 0)
+	{
+		BOOST_ASIO_SCTP_LOG(debug, ("CSctpConnection::ResumeHeld - {} held messages expired", numExpired));
+	}
+}
+
+/**
+ * Called on the IO service thread when the send queue cannot pass its messages to the
+ * kernel; the rest of that batch has been discarded, so the connection is closed
+ *
+ * @param Error the socket error condition
  */
-void CSctpConnection::Send(const BYTE* pData, size_t numBytes, UINT16 streamNum, UINT32 payloadProtocolID)
+void CSctpConnection::OnSendError(const boost::system::error_code& Error)
 {
 	if(m_Socket.is_open())
 	{
-		socklen_t len = sizeof(struct sockaddr);
-		UINT32 txFlags = 0;
-		sctp_sendmsg(m_Socket.native_handle(), pData, numBytes, &m_PeerAddr, len, htonl(payloadProtocolID), txFlags, htons(streamNum),
-				TIME_TO_LIVE_MS, DEFAULT_CONTEXT);
+		BOOST_ASIO_SCTP_LOG(error, ("CSctpConnection::OnSendError - error {}", Error.message()));
+		Close();
 	}
 }
 
+/**
+ * Called when the send queue reaches SEND_HIGH_WATERMARK
+ */
+void CSctpConnection::OnSendQueueFull(void)
+{
+	boost::system::error_code ec;
+	size_t numChunks = m_SendQueue.kernel_queued_chunks(ec);
+	BOOST_ASIO_SCTP_LOG(warning, ("CSctpConnection::OnSendQueueFull - {} bytes queued, {} chunks unsent or unacknowledged in the kernel, {} messages expired so far",
+			m_SendQueue.queued_bytes(), numChunks, m_SendQueue.expired()));
+}
+
+/**
+ * Called on the IO service thread when the send queue has drained to SEND_LOW_WATERMARK;
+ * sends the messages held meanwhile
+ */
+void CSctpConnection::OnSendQueueReady(void)
+{
+	BOOST_ASIO_SCTP_LOG(debug, ("CSctpConnection::OnSendQueueReady - {} bytes queued, {} messages held",
+			m_SendQueue.queued_bytes(), boost::asio_sctp::detail::atomic::load_acquire(m_NumHeld)));
+	ResumeHeld();
+}
+
+/**
+ * Called when a stream's part of the send queue reaches SEND_STREAM_HIGH_WATERMARK
+ *
+ * @param netStreamNum the stream, in network byte order as passed to the send queue
+ */
+void CSctpConnection::OnStreamSendQueueFull(UINT16 netStreamNum)
+{
+	BOOST_ASIO_SCTP_LOG(debug, ("CSctpConnection::OnStreamSendQueueFull - stream {}, {} bytes queued",
+			ntohs(netStreamNum), m_SendQueue.queued_bytes(netStreamNum)));
+}
+
+/**
+ * Called on the IO service thread when a stream's part of the send queue has drained to
+ * SEND_STREAM_LOW_WATERMARK; sends the messages held meanwhile
+ *
+ * @param netStreamNum the stream, in network byte order as passed to the send queue
+ */
+void CSctpConnection::OnStreamSendQueueReady(UINT16 netStreamNum)
+{
+	if(boost::asio_sctp::detail::atomic::load_acquire(m_NumHeld) != 0)
+	{
+		ResumeHeld();
+	}
+}
+
+/**
+ * Arms the keepalive, idle and tuning timers.  Must be called on the IO service thread.
+ */
+void CSctpConnection::StartTimers(void)
+{
+	NoteActivity();
+	m_TimerWheel.arm(m_KeepaliveTimer, boost::posix_time::milliseconds(KEEPALIVE_INTERVAL_MS));
+	m_TimerWheel.arm(m_IdleTimer, boost::posix_time::milliseconds(IDLE_TIMEOUT_MS));
+	if(m_pTuner)
+	{
+		m_TimerWheel.arm(m_TuneTimer, boost::posix_time::milliseconds(TUNE_INTERVAL_MS));
+	}
+}
+
+/**
+ * Records that traffic has been seen.  Called from any thread; the timers pick this up
+ * when they next expire, so traffic never touches the timer wheel itself.
+ */
+void CSctpConnection::NoteActivity(void)
+{
+	boost::asio_sctp::detail::atomic::store_release(m_LastActivityTick, m_TimerWheel.now());
+}
+
+/**
+ * Called on the IO service thread when the keepalive timer expires; sends the client a
+ * keepalive message if there has been no traffic for KEEPALIVE_INTERVAL_MS, so that it
+ * can tell an idle server from a dead one.  A full send queue means traffic is already
+ * waiting to go, so no keepalive is needed then
+ */
+void CSctpConnection::OnKeepaliveTimer(void)
+{
+	if(!m_Socket.is_open())
+	{
+		return;
+	}
+
+	boost::uint64_t intervalTicks = m_TimerWheel.to_ticks(boost::posix_time::milliseconds(KEEPALIVE_INTERVAL_MS));
+	boost::uint64_t quietTicks = m_TimerWheel.now() - boost::asio_sctp::detail::atomic::load_acquire(m_LastActivityTick);
+	if(quietTicks < intervalTicks)
+	{
+		m_TimerWheel.arm(m_KeepaliveTimer, intervalTicks - quietTicks);
+		return;
+	}
+
+	// Sent without NoteActivity, so that only traffic from the client holds off the idle timer
+	const SMessageHeader keepalive = {KEEPALIVE_VERSION, 0, KEEPALIVE_CLASS, KEEPALIVE_TYPE};
+	if(m_pTrace)
+	{
+		m_pTrace->record(&keepalive, sizeof(keepalive), KEEPALIVE_STREAM, KEEPALIVE_PPID, 0, boost::asio_sctp::trace_record_header::outbound);
+	}
+	bool bQueued = m_SendQueue.push(&keepalive, sizeof(keepalive), htons(KEEPALIVE_STREAM), htonl(KEEPALIVE_PPID));
+	BOOST_ASIO_SCTP_LOG(debug, ("CSctpConnection::OnKeepaliveTimer - no traffic for {} ms, keepalive {}",
+			quietTicks * TIMER_TICK_MS, bQueued ? "sent" : "not sent, send queue full"));
+	m_TimerWheel.arm(m_KeepaliveTimer, intervalTicks);
+}
+
+/**
+ * Called on the IO service thread when the idle timer expires; closes the connection
+ * if there has been no traffic for IDLE_TIMEOUT_MS
+ */
+void CSctpConnection::OnIdleTimer(void)
+{
+	if(!m_Socket.is_open())
+	{
+		return;
+	}
+
+	boost::uint64_t timeoutTicks = m_TimerWheel.to_ticks(boost::posix_time::milliseconds(IDLE_TIMEOUT_MS));
+	boost::uint64_t idleTicks = m_TimerWheel.now() - boost::asio_sctp::detail::atomic::load_acquire(m_LastActivityTick);
+	if(idleTicks < timeoutTicks)
+	{
+		m_TimerWheel.arm(m_IdleTimer, timeoutTicks - idleTicks);
+		return;
+	}
+
+	BOOST_ASIO_SCTP_LOG(info, ("CSctpConnection::OnIdleTimer - idle for {} ms, closing", idleTicks * TIMER_TICK_MS));
+	Close();
+}
+
+/**
+ * Called on the IO service thread every TUNE_INTERVAL_MS; fits the RTO, retransmission
+ * limit and socket buffers to the round trip time, throughput and loss measured since
+ * the last call
+ */
+void CSctpConnection::OnTuneTimer(void)
+{
+	if(!m_Socket.is_open())
+	{
+		return;
+	}
+
+	boost::system::error_code ec;
+	if(m_pTuner->tune(m_Socket, m_TuningState, ec))
+	{
+		BOOST_ASIO_SCTP_LOG(debug, ("CSctpConnection::OnTuneTimer - srtt {} ms, rto {}..{} ms, buffers {}",
+				m_TuningState.srtt_ms, m_TuningState.rto_min_ms, m_TuningState.rto_max_ms, m_TuningState.buffer_size));
+	}
+	else if(ec)
+	{
+		BOOST_ASIO_SCTP_LOG(warning, ("CSctpConnection::OnTuneTimer - error {}", ec.message()));
+	}
+	m_TimerWheel.arm(m_TuneTimer, boost::posix_time::milliseconds(TUNE_INTERVAL_MS));
+}
+
+/**
+ * Closes the connection without losing data, e.g. when another process is taking over:
+ * after delay, waits for the peer to acknowledge everything sent (SCTP_SENDER_DRY_EVENT)
+ * and then closes, or closes regardless once limit has passed.  Must be called on the IO
+ * service thread.
+ *
+ * @param delay how long to carry on as normal first
+ * @param limit how long to wait for the peer's acknowledgements
+ */
+void CSctpConnection::Drain(const boost::posix_time::time_duration& delay, const boost::posix_time::time_duration& limit)
+{
+	m_DrainLimit = limit;
+	m_TimerWheel.arm(m_DrainTimer, delay);
+}
+
+/**
+ * Called on the IO service thread when draining is due to start, and again when it has
+ * taken too long
+ */
+void CSctpConnection::OnDrainTimer(void)
+{
+	if(!m_Socket.is_open())
+	{
+		return;
+	}
+
+	if(m_Draining)
+	{
+		BOOST_ASIO_SCTP_LOG(warning, ("CSctpConnection::OnDrainTimer - not acknowledged after {} ms, {} bytes still queued, closing",
+				m_DrainLimit.total_milliseconds(), m_SendQueue.queued_bytes()));
+		Close();
+		return;
+	}
+
+	// The kernel reports the sender dry at once if nothing is outstanding, and
+	// otherwise as soon as the last of it is acknowledged.
+	m_Draining = true;
+	m_TimerWheel.arm(m_DrainTimer, m_DrainLimit);
+	struct sctp_event_subscribe subs;
+	memset((char*)&subs, 0, sizeof(subs));
+	subs.sctp_data_io_event = 1;
+	subs.sctp_sender_dry_event = 1;
+	boost::system::error_code ec;
+	m_Socket.set_option(boost::asio_sctp::socket_option::sctp_event_subscribe(subs), ec);
+	if(ec)
+	{
+		BOOST_ASIO_SCTP_LOG(warning, ("CSctpConnection::OnDrainTimer - no sender dry events: {}", ec.message()));
+		Close();
+	}
+}
+
+/**
+ * Called on the IO service thread when the peer has acknowledged everything handed to
+ * the kernel; closes the connection if it is draining and nothing more is queued here
+ */
+void CSctpConnection::OnSenderDry(void)
+{
+	if(m_Draining && m_Socket.is_open() && (m_SendQueue.queued_bytes() == 0))
+	{
+		BOOST_ASIO_SCTP_LOG(debug, ("CSctpConnection::OnSenderDry - drained"));
+		Close();
+	}
+}
+
+/**
+ * Whether the connection is still open
+ */
+bool CSctpConnection::IsOpen(void)
+{
+	return m_Socket.is_open();
+}
+
 /**
  * Closes the socket associated with this connection and notifies the PicoMaster thread
  * that the connection has closed
@@ -123,9 +654,24 @@ void CSctpConnection::Close(void)
 {
 	if(m_Socket.is_open())
 	{
+		if(m_pAddressWatcher)
+		{
+			m_pAddressWatcher->remove(m_Socket);  // before the descriptor can be reused
+		}
 		m_Socket.shutdown(boost::asio::socket_base::shutdown_both);
 		m_Socket.close();
-		std::cout << "Connection closed" << std::endl;
+		if(m_pAdmission)
+		{
+			m_pAdmission->release();
+		}
+		{
+			boost::mutex::scoped_lock lock(m_HeldMutex);
+			m_HeldMessages.clear();
+			m_HeldPerStream.clear();
+			m_HeldBytes = 0;
+			boost::asio_sctp::detail::atomic::store_release(m_NumHeld, size_t(0));
+		}
+		BOOST_ASIO_SCTP_LOG(info, ("Connection closed"));
 	}
 }
 
@@ -153,54 +699,188 @@ bool CSctpConnection::GetPeerIpAddr(boost::asio::ip::address& rPeerAddress)
  * the received packet and initiates the corresponding action and response
  *
  * @param Error the socket error condition - e.g. EOF for orderly disconnection
- * @param numBytes the number of bytes received
+ * @param msg the complete received message, valid only for the duration of the call
  */
-void CSctpConnection::OnReceive(const boost::system::error_code& Error, size_t numBytes, UINT16 streamNum, UINT32 payloadProtocolID)
+void CSctpConnection::OnReceive(const boost::system::error_code& Error, const boost::asio_sctp::sctp_message& msg)
 {
 	if((Error == boost::asio::error::eof)  // received FIN (orderly closure) from client
 		|| (Error == boost::asio::error::connection_reset))  // connection reset
 	{
-		std::cout << "CSctpConnection::OnReceive - connection closed by client" << std::endl;
+		BOOST_ASIO_SCTP_LOG(info, ("CSctpConnection::OnReceive - connection closed by client"));
 		Close();
 		return;
 	}
 	else if(Error.value() == ECANCELED)
 	{
-		std::cout << "CSctpConnection::OnReceive - Operation Aborted " << std::endl;
+		BOOST_ASIO_SCTP_LOG(info, ("CSctpConnection::OnReceive - Operation Aborted"));
 		Close();
 		return;
 	}
 	else if(Error != 0)
 	{
-		std::cout << "CSctpConnection::OnReceive - error " << std::dec << Error.value() << std::endl;
+		BOOST_ASIO_SCTP_LOG(error, ("CSctpConnection::OnReceive - error {}", Error.value()));
 		return;
 	}
 
-	std::cout << "CSctpConnection::OnReceive - numBytes = " << std::dec << numBytes << std::endl;
-	BYTE version = RxBuffer[0];
-	BYTE messageClass = RxBuffer[2];
-	BYTE messageType = RxBuffer[3];
-	// etc. - application-specific processing of received packet and formulation of response
+	BOOST_ASIO_SCTP_LOG(debug, ("CSctpConnection::OnReceive - numBytes = {}", msg.size));
+	CMessageDispatcher::dispatch(*this, msg);  // application-specific processing of received packet and formulation of response
+}
+
+/**
+ * Called for received messages which match none of the registered MessageHandlers
+ *
+ * @param rConnection the connection the message arrived on
+ * @param msg the received message
+ */
+void CUnhandledMessage::handle(CSctpConnection& rConnection, const boost::asio_sctp::sctp_message& msg)
+{
+	boost::asio_sctp::message_view<SMessageHeader> view(msg);
+	if(view.valid())
+	{
+		BOOST_ASIO_SCTP_LOG(warning, ("CSctpConnection::OnReceive - unhandled message class {} type {}",
+				view.header().messageClass, view.header().messageType));
+	}
+	else
+	{
+		BOOST_ASIO_SCTP_LOG(warning, ("CSctpConnection::OnReceive - short message, numBytes = {}", msg.size));
+	}
 }
 
 /**
  * Constructor
+ *
+ * @param IO_Service reference to the global Boost ASIO service
+ * @param addr the address to listen on
+ * @param pHandoverPath unix socket of a running server to take the listening socket over
+ * from, or NULL; without a server there, a new listening socket is opened
  */
-CSctpServer::CSctpServer(boost::asio::io_service& IO_Service, boost::asio::ip::address addr)
-: m_Acceptor(IO_Service, boost::asio_sctp::ip::sctp::endpoint(addr, SERVER_PORT), true)
+CSctpServer::CSctpServer(boost::asio::io_service& IO_Service, boost::asio::ip::address addr, const char* pHandoverPath)
+: m_Acceptor(IO_Service)
+, m_Admission(ADMISSION_RATE, ADMISSION_BURST, MAX_CONNECTIONS)
+, m_AcceptRetryTimer(boost::bind(&CSctpServer::OnAcceptReady, this, boost::system::error_code()))
+, m_StatsTimer(boost::bind(&CSctpServer::OnStatsTimer, this))
+, m_TimerWheel(IO_Service, boost::posix_time::milliseconds(TIMER_TICK_MS))
+, m_AddressWatcher(IO_Service)
+, m_WatchingAddresses(false)
+, m_HandoverAcceptor(IO_Service)
+, m_HandoverSocket(IO_Service)
+, m_HandedOver(false)
 {
+	boost::asio_sctp::ip::sctp::endpoint endpoint(addr, SERVER_PORT);
+	if(!pHandoverPath || !TakeOver(pHandoverPath, endpoint))
+	{
+		m_Acceptor.open(endpoint.protocol());
+		m_Acceptor.set_option(boost::asio_sctp::ip::sctp::acceptor::reuse_address(true));
+		m_Acceptor.bind(endpoint);
+		m_Acceptor.listen();
+	}
+
+	// Let small messages overtake large ones on other streams (I-DATA, RFC 8260), where the
+	// kernel supports it.  Accepted associations inherit these settings from the listener.
+	boost::system::error_code interleaveEc;
+	m_Acceptor.set_option(boost::asio_sctp::ip::sctp::fragment_interleave(2), interleaveEc);
+	if(interleaveEc)
+	{
+		BOOST_ASIO_SCTP_LOG(info, ("CSctpServer - fragment interleaving not available: {}", interleaveEc.message()));
+	}
+#if defined(SCTP_INTERLEAVING_SUPPORTED)
+	boost::system::error_code idataEc;
+	m_Acceptor.set_option(boost::asio_sctp::socket_option::sctp_interleaving_supported(true), idataEc);
+	if(idataEc)
+	{
+		BOOST_ASIO_SCTP_LOG(info, ("CSctpServer - I-DATA not available: {}", idataEc.message()));
+	}
+#endif
+
+	m_TimerWheel.start();
+	IO_Service.post(boost::bind(&CSctpServer::OnStatsTimer, this));  // the wheel may only be used on the IO service thread
 }
 
 /**
- * Starts the server - creates a new unassigned connection and waits for a client to connect
+ * Starts the server - waits for clients to connect
  */
 void CSctpServer::StartAccept(void)
 {
-	CSctpConnection* new_connection = CSctpConnection::Create(m_Acceptor.get_io_service());
-	m_Acceptor.async_accept(new_connection->m_Socket,
-		boost::bind(&CSctpServer::OnAccept, this, new_connection,
-		boost::asio::placeholders::error));
-	m_Acceptor.listen();  // bomb-out occurs even without this listen() being executed
+	m_Acceptor.listen(ACCEPT_BACKLOG);
+	WaitForAccept();
+}
+
+/**
+ * Waits until associations are queued on the acceptor
+ */
+void CSctpServer::WaitForAccept(void)
+{
+	m_Acceptor.async_wait_pending(m_AcceptMemory.wrap(boost::bind(&CSctpServer::OnAcceptReady, this,
+		boost::asio::placeholders::error)));
+}
+
+/**
+ * Called when associations are queued on the acceptor.  Accepts up to ACCEPT_BATCH_SIZE
+ * of them, aborting those refused by admission control before any connection object is
+ * created for them
+ *
+ * @param error the acceptor-socket's error condition
+ */
+void CSctpServer::OnAcceptReady(const boost::system::error_code& error)
+{
+	if(error || !m_Acceptor.is_open())
+	{
+		if(error && (error != boost::asio::error::operation_aborted))  // aborted by Stop
+		{
+			BOOST_ASIO_SCTP_LOG(error, ("CSctpServer::OnAcceptReady - error {}", error.message()));
+		}
+		return;
+	}
+
+	for(int numAccepted = 0; numAccepted < ACCEPT_BATCH_SIZE; ++numAccepted)
+	{
+		boost::asio_sctp::ip::sctp::endpoint peerEndpoint;
+		boost::system::error_code ec;
+		boost::asio_sctp::ip::sctp::acceptor::native_type s = m_Acceptor.accept_pending(peerEndpoint, ec);
+		if(ec == boost::asio::error::would_block)
+		{
+			WaitForAccept();  // queue drained
+			return;
+		}
+		else if(ec == boost::asio::error::connection_aborted)
+		{
+			continue;  // went away while queued
+		}
+		else if(ec)
+		{
+			BOOST_ASIO_SCTP_LOG(error, ("CSctpServer::OnAcceptReady - accept error {}", ec.message()));
+			m_TimerWheel.arm(m_AcceptRetryTimer, boost::posix_time::milliseconds(ACCEPT_RETRY_MS));
+			return;
+		}
+
+		if(!m_Admission.admit(peerEndpoint.address()))
+		{
+			BOOST_ASIO_SCTP_LOG(debug, ("CSctpServer::OnAcceptReady - refused {}, {} refused so far",
+					peerEndpoint.address().to_string(), m_Admission.rejected()));
+			m_Acceptor.reject(s, ec);
+			continue;
+		}
+
+		CTunerPtr pTuner;
+		{
+			boost::mutex::scoped_lock lock(m_ConnectionsMutex);
+			pTuner = m_pTuner;
+		}
+		CSctpConnection* new_connection = CSctpConnection::Create(m_Acceptor.get_io_service(), m_TimerWheel,
+				m_Trace.is_open() ? &m_Trace : NULL, pTuner, &m_Admission);
+		new_connection->m_Socket.assign(peerEndpoint.protocol(), s, ec);
+		if(ec)
+		{
+			m_Acceptor.reject(s, ec);
+			m_Admission.release();
+			delete new_connection;
+			continue;
+		}
+		OnAccept(new_connection, ec);
+	}
+
+	// More may be queued; carry on once other handlers have had a turn
+	m_Acceptor.get_io_service().post(m_AcceptMemory.wrap(boost::bind(&CSctpServer::OnAcceptReady, this, boost::system::error_code())));
 }
 
 /**
@@ -219,6 +899,9 @@ void CSctpServer::OnAccept(CSctpConnection* pNewConnection, const boost::system:
 		boost::asio_sctp::socket_option::sctp_ack_delay ackDelay(0);  // disable delayed-SACK algorithm
 		pNewConnection->m_Socket.set_option(ackDelay);
 
+		boost::asio_sctp::ip::sctp::receive_timestamps timestamps(true);  // to measure delay between kernel and OnReceive
+		pNewConnection->m_Socket.set_option(timestamps);
+
 		const struct sctp_event_subscribe subs = {1, 0, 0, 0, 0, 0, 0, 0, 0};
 		boost::asio_sctp::socket_option::sctp_event_subscribe eventSubs(subs);
 		pNewConnection->m_Socket.set_option(eventSubs);
@@ -231,20 +914,319 @@ void CSctpServer::OnAccept(CSctpConnection* pNewConnection, const boost::system:
 		boost::asio_sctp::socket_option::sctp_peer_addr_params peerParams(params);
 		pNewConnection->m_Socket.set_option(peerParams);
 
-		StartAccept();  // resume listening for other incoming connections
-		std::cout << "CSctpServer::OnAccept" << std::endl;
+		if(m_WatchingAddresses)
+		{
+			m_AddressWatcher.add(pNewConnection->m_Socket);  // it has its own copy of the listener's addresses
+			pNewConnection->m_pAddressWatcher = &m_AddressWatcher;
+		}
+		pNewConnection->m_pStreamExecutor = m_pStreamExecutor.get();
+
+		pNewConnection->StartTimers();
+		pNewConnection->StartReceiving();
+
+		boost::mutex::scoped_lock lock(m_ConnectionsMutex);
+		m_Connections.push_back(pNewConnection);
+
+		BOOST_ASIO_SCTP_LOG(info, ("CSctpServer::OnAccept"));
 	}
 	else
 	{
-		std::cout << "CSctpServer::OnAccept - error " << std::dec << error.message() << std::endl;
+		BOOST_ASIO_SCTP_LOG(error, ("CSctpServer::OnAccept - error {}", error.message()));
 	}
 }
 
+/**
+ * Called on the IO service thread every STATS_INTERVAL_MS; reports how long received
+ * messages waited in the socket and the stream executor's queues before OnReceive
+ * handled them, separately from network latency
+ */
+void CSctpServer::OnStatsTimer(void)
+{
+	{
+		boost::mutex::scoped_lock lock(m_ConnectionsMutex);
+		PruneConnections();
+	}
+
+	if(g_ReceiveDelay.count() != 0)
+	{
+		BOOST_ASIO_SCTP_LOG(info, ("CSctpServer::OnStatsTimer - receive delay p50 {} us, p99 {} us, max {} us, {} messages",
+				g_ReceiveDelay.percentile(50) / 1000, g_ReceiveDelay.percentile(99) / 1000,
+				g_ReceiveDelay.max() / 1000, g_ReceiveDelay.count()));
+		g_ReceiveDelay.reset();
+	}
+	m_TimerWheel.arm(m_StatsTimer, boost::posix_time::milliseconds(STATS_INTERVAL_MS));
+}
+
 /**
  * Stops the server by closing the acceptor socket
  */
 void CSctpServer::Stop(void)
 {
 	m_Acceptor.close();
+	boost::system::error_code ec;
+	m_AddressWatcher.stop();
+	m_HandoverAcceptor.close(ec);
+	m_Trace.close(ec);
+}
+
+/**
+ * Asks a running server for its listening socket, so that no association attempt is
+ * refused while this server replaces it
+ *
+ * @param pPath the running server's handover socket
+ * @param endpoint the address being listened on
+ *
+ * @return TRUE if the listening socket was taken over, else FALSE
+ */
+bool CSctpServer::TakeOver(const char* pPath, const boost::asio_sctp::ip::sctp::endpoint& endpoint)
+{
+	boost::system::error_code ec;
+	boost::asio::local::stream_protocol::socket channel(m_Acceptor.get_io_service());
+	channel.connect(boost::asio::local::stream_protocol::endpoint(pPath), ec);
+	if(ec)
+	{
+		BOOST_ASIO_SCTP_LOG(info, ("CSctpServer::TakeOver - no server to take over from at {}: {}", pPath, ec.message()));
+		return false;
+	}
+
+	int fds[boost::asio_sctp::sctp_handover::max_batch];
+	boost::asio_sctp::sctp_handover::kind kind = boost::asio_sctp::sctp_handover::listener;
+	size_t numFds = boost::asio_sctp::sctp_handover::receive(channel.native_handle(), kind, fds, ec);
+	if((numFds != 1) || (kind != boost::asio_sctp::sctp_handover::listener))
+	{
+		for(size_t i = 0; i < numFds; ++i)
+		{
+			::close(fds[i]);
+		}
+		BOOST_ASIO_SCTP_LOG(error, ("CSctpServer::TakeOver - no listening socket received from {}: {}", pPath,
+				ec ? ec.message() : std::string("unexpected descriptors")));
+		return false;
+	}
+
+	m_Acceptor.assign(endpoint.protocol(), fds[0], ec);
+	if(ec)
+	{
+		::close(fds[0]);
+		BOOST_ASIO_SCTP_LOG(error, ("CSctpServer::TakeOver - error {}", ec.message()));
+		return false;
+	}
+	BOOST_ASIO_SCTP_LOG(info, ("CSctpServer::TakeOver - listening socket taken over from {}", pPath));
+	return true;
+}
+
+/**
+ * Lets a successor take over: when a new server connects to pPath the listening socket
+ * is passed to it, and this server's connections are closed gracefully
+ *
+ * @param pPath name of the unix socket to listen on; a stale file of that name is removed
+ *
+ * @return TRUE if listening, else FALSE
+ */
+bool CSctpServer::ListenForHandover(const char* pPath)
+{
+	boost::system::error_code ec;
+	boost::asio::local::stream_protocol::endpoint endpoint(pPath);
+	::unlink(pPath);
+	m_HandoverAcceptor.open(endpoint.protocol(), ec);
+	if(!ec)
+	{
+		m_HandoverAcceptor.bind(endpoint, ec);
+	}
+	if(!ec)
+	{
+		m_HandoverAcceptor.listen(1, ec);
+	}
+	if(ec)
+	{
+		BOOST_ASIO_SCTP_LOG(error, ("CSctpServer::ListenForHandover - cannot listen on {}: {}", pPath, ec.message()));
+		boost::system::error_code ignored;
+		m_HandoverAcceptor.close(ignored);
+		return false;
+	}
+	WaitForHandover();
+	return true;
+}
+
+/**
+ * Waits for a successor to connect to the handover socket
+ */
+void CSctpServer::WaitForHandover(void)
+{
+	m_HandoverAcceptor.async_accept(m_HandoverSocket, boost::bind(&CSctpServer::OnHandoverRequest, this,
+		boost::asio::placeholders::error));
+}
+
+/**
+ * Called when a successor has connected to the handover socket.  Passes it the listening
+ * socket, then drains the connections a few at a time over DRAIN_SPREAD_MS, so that
+ * their peers reconnect to the successor gradually rather than all at once
+ *
+ * @param error the handover socket's error condition
+ */
+void CSctpServer::OnHandoverRequest(const boost::system::error_code& error)
+{
+	if(error)
+	{
+		if(error != boost::asio::error::operation_aborted)  // aborted by Stop
+		{
+			BOOST_ASIO_SCTP_LOG(error, ("CSctpServer::OnHandoverRequest - error {}", error.message()));
+		}
+		return;
+	}
+
+	boost::system::error_code ec;
+	int fd = m_Acceptor.native_handle();
+	boost::asio_sctp::sctp_handover::send(m_HandoverSocket.native_handle(), boost::asio_sctp::sctp_handover::listener, &fd, 1, ec);
+	boost::system::error_code ignored;
+	m_HandoverSocket.close(ignored);
+	if(ec)
+	{
+		BOOST_ASIO_SCTP_LOG(error, ("CSctpServer::OnHandoverRequest - cannot pass the listening socket: {}", ec.message()));
+		WaitForHandover();  // carry on serving; the successor may try again
+		return;
+	}
+
+	// The successor now accepts from the same queue, and listens on the handover
+	// socket itself, so neither is removed here
+	m_Acceptor.close_handed_over(ignored);
+	m_HandoverAcceptor.close(ignored);
+
+	std::list<CSctpConnection*> connections;
+	{
+		boost::mutex::scoped_lock lock(m_ConnectionsMutex);
+		m_HandedOver = true;
+		PruneConnections();
+		connections = m_Connections;
+	}
+	boost::uint64_t numConnections = connections.size();
+	boost::uint64_t index = 0;
+	for(std::list<CSctpConnection*>::iterator it = connections.begin(); it != connections.end(); ++it, ++index)
+	{
+		(*it)->Drain(boost::posix_time::milliseconds(DRAIN_SPREAD_MS * index / numConnections),
+				boost::posix_time::milliseconds(DRAIN_LIMIT_MS));
+	}
+	BOOST_ASIO_SCTP_LOG(info, ("CSctpServer::OnHandoverRequest - listening socket handed over, draining {} connections",
+			numConnections));
 }
 
+/**
+ * Whether the server has handed over to a successor and closed all its connections,
+ * so that the process may exit
+ */
+bool CSctpServer::IsRetired(void)
+{
+	boost::mutex::scoped_lock lock(m_ConnectionsMutex);
+	PruneConnections();
+	return m_HandedOver && m_Connections.empty();
+}
+
+/**
+ * Forgets connections which have closed.  The caller must hold m_ConnectionsMutex
+ */
+void CSctpServer::PruneConnections(void)
+{
+	for(std::list<CSctpConnection*>::iterator it = m_Connections.begin(); it != m_Connections.end(); )
+	{
+		if((*it)->IsOpen())
+		{
+			++it;
+		}
+		else
+		{
+			it = m_Connections.erase(it);
+		}
+	}
+}
+
+/**
+ * Records the traffic of connections accepted from now on into a trace file, which
+ * sctp_replay can play back against a server
+ *
+ * @param pPath name of the trace file, which is created or truncated
+ *
+ * @return TRUE if the file was opened, else FALSE
+ */
+bool CSctpServer::StartTrace(const char* pPath)
+{
+	boost::system::error_code ec;
+	m_Trace.open(pPath, ec);
+	if(ec)
+	{
+		BOOST_ASIO_SCTP_LOG(error, ("CSctpServer::StartTrace - cannot open {}: {}", pPath, ec.message()));
+		return false;
+	}
+	BOOST_ASIO_SCTP_LOG(info, ("CSctpServer::StartTrace - recording to {}", pPath));
+	return true;
+}
+
+
+/**
+ * Fits the settings of connections accepted from now on to their measured path, within
+ * the given bounds - e.g. boost::asio_sctp::sctp_tuning_profile::lan() for femtocells on
+ * the local network, backhaul() for those reached over DSL or mobile backhaul
+ *
+ * @param profile the bounds for RTO, retransmission limit and socket buffer sizes
+ */
+void CSctpServer::SetTuningProfile(const boost::asio_sctp::sctp_tuning_profile& profile)
+{
+	CTunerPtr pTuner(new boost::asio_sctp::sctp_tuner(profile));
+	boost::mutex::scoped_lock lock(m_ConnectionsMutex);  // the IO service threads take it for each accepted connection
+	m_pTuner = pTuner;
+}
+
+/**
+ * Follows addresses coming and going on the local machine: each is added to or removed
+ * from the listener and every live association, and the femtocells are told with ASCONF,
+ * so traffic moves to a new link without the association being set up again.  Must be
+ * called before StartAccept, so that accepted associations negotiate address
+ * reconfiguration
+ *
+ * @param promoteMbps ask femtocells to send to a new address by preference if its link
+ * runs at least this many Mb/s; 0 never does
+ *
+ * @return TRUE if address changes are being watched, else FALSE
+ */
+bool CSctpServer::WatchAddresses(unsigned int promoteMbps)
+{
+	boost::system::error_code ec;
+#if defined(SCTP_ASCONF_SUPPORTED)
+	m_Acceptor.set_option(boost::asio_sctp::socket_option::sctp_asconf_supported(true), ec);
+	if(ec)
+	{
+		BOOST_ASIO_SCTP_LOG(warning, ("CSctpServer::WatchAddresses - ASCONF not available, is net.sctp.auth_enable set? {}", ec.message()));
+	}
+#endif
+	m_AddressWatcher.promote_links(promoteMbps);
+	m_AddressWatcher.start(ec);
+	if(ec)
+	{
+		BOOST_ASIO_SCTP_LOG(error, ("CSctpServer::WatchAddresses - cannot watch addresses: {}", ec.message()));
+		return false;
+	}
+	m_AddressWatcher.add(m_Acceptor);
+	m_WatchingAddresses = true;
+	return true;
+}
+
+/**
+ * Processes the messages received on connections accepted from now on by worker threads
+ * rather than each connection's receive thread, so that a connection carrying many
+ * independent streams may use more than one core.  Messages of one stream are still
+ * processed one at a time and in order; the message handlers must allow for other streams
+ * of the same connection being processed at the same time.  May only be called once
+ *
+ * @param numThreads number of worker threads
+ *
+ * @return TRUE if the workers were started, else FALSE
+ */
+bool CSctpServer::SetReceiveWorkers(size_t numThreads)
+{
+	if(m_pStreamExecutor)
+	{
+		return false;
+	}
+	m_pStreamExecutor.reset(new CStreamExecutor(&CSctpConnection::OnStreamMessage, numThreads, RX_STREAM_QUEUE_SIZE));
+	m_pStreamExecutor->start();
+	BOOST_ASIO_SCTP_LOG(info, ("CSctpServer::SetReceiveWorkers - {} workers", m_pStreamExecutor->size()));
+	return true;
+}
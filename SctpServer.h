@@ -15,15 +15,35 @@
 /* System includes */
 #include <boost/asio.hpp>
 #include <boost/asio_sctp/ip/sctp.hpp>
+#include <boost/asio_sctp/message_dispatcher.hpp>
+#include <boost/asio_sctp/sctp_address_watcher.hpp>
+#include <boost/asio_sctp/sctp_admission.hpp>
+#include <boost/asio_sctp/sctp_handler_allocator.hpp>
+#include <boost/asio_sctp/sctp_handover.hpp>
+#include <boost/asio_sctp/sctp_receive_batch.hpp>
+#include <boost/asio_sctp/sctp_send_queue.hpp>
+#include <boost/asio_sctp/sctp_send_ring.hpp>
+#include <boost/asio_sctp/sctp_stream_executor.hpp>
+#include <boost/asio_sctp/sctp_tuner.hpp>
+#include <boost/asio_sctp/timer_wheel.hpp>
+#include <boost/asio_sctp/trace_file.hpp>
+#include <boost/mpl/vector.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include <list>
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 /* Project / bespoke includes */
 /* None */
 
 /* Macros / defines */
 #define SERVER_PORT	54321
+#define RX_BUFFER_SIZE	65536
 
 typedef unsigned char BYTE;
 typedef unsigned short UINT16;
@@ -37,6 +57,51 @@ typedef unsigned long UINT32;
 
 /* Class definitions */
 
+class CSctpConnection;
+
+/**
+*	@struct SMessageHeader
+*	Common header at the start of every application message
+*/
+struct SMessageHeader
+{
+	BYTE version;
+	BYTE spare;
+	BYTE messageClass;
+	BYTE messageType;
+};
+
+/**
+*	@struct CUnhandledMessage
+*	Dispatcher fallback for messages with no registered handler
+*/
+struct CUnhandledMessage
+{
+	static void handle(CSctpConnection& rConnection, const boost::asio_sctp::sctp_message& msg);
+};
+
+/**
+*	Application message handlers, as boost::asio_sctp::dispatch_rule entries keyed
+*	by message type, class, payload protocol ID and stream range
+*/
+typedef boost::mpl::vector<> MessageHandlers;
+
+typedef boost::asio_sctp::message_dispatcher<CSctpConnection, MessageHandlers,
+		boost::asio_sctp::default_header_layout, CUnhandledMessage> CMessageDispatcher;
+
+/**
+*	Received messages of one stream of one connection, which are processed in order
+*/
+typedef std::pair<CSctpConnection*, UINT16> StreamKey;
+
+typedef boost::asio_sctp::sctp_stream_executor<void (*)(const StreamKey&, const boost::asio_sctp::sctp_message&),
+		StreamKey> CStreamExecutor;
+
+/**
+*	A tuner, never changed once published, so that connections may use it while a new one replaces it
+*/
+typedef boost::shared_ptr<const boost::asio_sctp::sctp_tuner> CTunerPtr;
+
 /**
 *	@class CFemtoConnection
 *	Encapsulates an SCTP connection
@@ -46,22 +111,72 @@ class CSctpConnection : public boost::noncopyable
 friend class CSctpServer;
 
 public:
-	static CSctpConnection* Create(boost::asio::io_service& IO_Service);
+	static CSctpConnection* Create(boost::asio::io_service& IO_Service, boost::asio_sctp::timer_wheel& rTimerWheel,
+			boost::asio_sctp::trace_writer* pTrace = NULL, const CTunerPtr& pTuner = CTunerPtr(),
+			boost::asio_sctp::sctp_admission_control* pAdmission = NULL);
 	~CSctpConnection(void);
 	void StartReceiving(void);
 	void Close(void);
-	void Send(const BYTE* pData, size_t numBytes, UINT16 streamNum, UINT32 payloadProtocolID);
+	void Drain(const boost::posix_time::time_duration& delay, const boost::posix_time::time_duration& limit);
+	bool IsOpen(void);
+	bool Send(const BYTE* pData, size_t numBytes, UINT16 streamNum, UINT32 payloadProtocolID);
+	static BYTE* Reserve(size_t numBytes, boost::asio_sctp::sctp_send_ring::region& rMessage);
+	bool Send(boost::asio_sctp::sctp_send_ring::region& rMessage, UINT16 streamNum, UINT32 payloadProtocolID);
 	bool GetPeerIpAddr(boost::asio::ip::address& rPeerAddress);
 
 private:
-	CSctpConnection(boost::asio::io_service& IO_Service);
-	void OnReceive(const boost::system::error_code& Error, size_t numBytes, UINT16 streamNum, UINT32 payloadProtocolID);
+	CSctpConnection(boost::asio::io_service& IO_Service, boost::asio_sctp::timer_wheel& rTimerWheel,
+			boost::asio_sctp::trace_writer* pTrace, const CTunerPtr& pTuner,
+			boost::asio_sctp::sctp_admission_control* pAdmission);
+	void StartTimers(void);
+	void NoteActivity(void);
+	void OnKeepaliveTimer(void);
+	void OnIdleTimer(void);
+	void OnTuneTimer(void);
+	void OnDrainTimer(void);
+	void OnSenderDry(void);
+	void OnSendError(const boost::system::error_code& Error);
+	void OnSendQueueFull(void);
+	void OnSendQueueReady(void);
+	void OnStreamSendQueueFull(UINT16 netStreamNum);
+	void OnStreamSendQueueReady(UINT16 netStreamNum);
+	bool Hold(const BYTE* pData, size_t numBytes, UINT16 streamNum, UINT32 payloadProtocolID);
+	void ResumeHeld(void);
+	void OnReceive(const boost::system::error_code& Error, const boost::asio_sctp::sctp_message& msg);
 	void ReceiveLoop(void);
-	BYTE RxBuffer[1024];
-	BYTE TxBuffer[1024];
+	static void OnStreamMessage(const StreamKey& key, const boost::asio_sctp::sctp_message& msg);
 	boost::asio_sctp::ip::sctp::socket m_Socket;
-	struct sctp_sndrcvinfo m_RxSRI;
-	struct sockaddr m_PeerAddr;
+	boost::asio_sctp::sctp_send_queue<boost::asio_sctp::ip::sctp::socket> m_SendQueue;
+	boost::asio_sctp::timer_wheel& m_TimerWheel;
+	boost::asio_sctp::timer_wheel_entry m_KeepaliveTimer;
+	boost::asio_sctp::timer_wheel_entry m_IdleTimer;
+	boost::asio_sctp::timer_wheel_entry m_TuneTimer;
+	boost::asio_sctp::timer_wheel_entry m_DrainTimer;  // starts draining, then bounds how long it may take
+	boost::posix_time::time_duration m_DrainLimit;
+	bool m_Draining;  // closing once the peer has acknowledged everything sent
+	volatile boost::uint64_t m_LastActivityTick;  // written by the receive thread, read on the IO service
+	boost::asio_sctp::sctp_receive_batch m_RxBatch;  // messages taken from the socket in one pass, reassembled where needed
+	boost::asio_sctp::trace_writer* m_pTrace;  // NULL unless traffic is being captured
+	CTunerPtr m_pTuner;  // NULL unless the association settings are tuned to the path
+	boost::asio_sctp::sctp_tuning_state m_TuningState;
+	boost::asio_sctp::sctp_admission_control* m_pAdmission;  // released on Close, if the connection was admitted through it
+	boost::asio_sctp::sctp_address_watcher* m_pAddressWatcher;  // NULL unless local address changes are applied to the association
+	CStreamExecutor* m_pStreamExecutor;  // NULL unless received messages are processed by stream on worker threads
+	boost::asio_sctp::sctp_handler_allocator m_HandlerMemory;  // for handlers posted by the connection
+
+	/** A message refused by the send queue, waiting for it to drain */
+	struct SHeldMessage
+	{
+		std::vector<BYTE> data;
+		UINT16 streamNum;
+		UINT32 payloadProtocolID;
+		boost::uint64_t deadlineMs;  // on the send queue's clock; dropped if not sent by then
+	};
+	std::list<SHeldMessage> m_HeldMessages;  // in the order they were sent
+	std::map<UINT16, size_t> m_HeldPerStream;  // streams with messages held, whose later messages must wait behind them
+	size_t m_HeldBytes;
+	volatile size_t m_NumHeld;  // read without m_HeldMutex, so that Send only takes it while messages are held
+	boost::mutex m_HeldMutex;  // guards the held messages
 };
 
 /**
@@ -71,13 +186,41 @@ private:
 class CSctpServer : public boost::noncopyable
 {
 public:
-	CSctpServer(boost::asio::io_service& IO_Service, boost::asio::ip::address addr);
+	CSctpServer(boost::asio::io_service& IO_Service, boost::asio::ip::address addr, const char* pHandoverPath = NULL);
 	void StartAccept(void);
 	void Stop(void);
+	bool ListenForHandover(const char* pPath);
+	bool IsRetired(void);
+	bool StartTrace(const char* pPath);
+	void SetTuningProfile(const boost::asio_sctp::sctp_tuning_profile& profile);
+	bool WatchAddresses(unsigned int promoteMbps);
+	bool SetReceiveWorkers(size_t numThreads);
 
 private:
+	void WaitForAccept(void);
+	void OnAcceptReady(const boost::system::error_code& error);
 	void OnAccept(CSctpConnection* pNewConnection, const boost::system::error_code& error);
+	void OnStatsTimer(void);
+	bool TakeOver(const char* pPath, const boost::asio_sctp::ip::sctp::endpoint& endpoint);
+	void WaitForHandover(void);
+	void OnHandoverRequest(const boost::system::error_code& error);
+	void PruneConnections(void);
 	boost::asio_sctp::ip::sctp::acceptor m_Acceptor;
+	boost::asio_sctp::sctp_admission_control m_Admission;  // per-source rate and overall limit on new connections
+	boost::asio_sctp::timer_wheel_entry m_AcceptRetryTimer;
+	boost::asio_sctp::sctp_handler_allocator m_AcceptMemory;  // for the accept wait and the posts between accept batches
+	boost::asio_sctp::timer_wheel_entry m_StatsTimer;
+	boost::asio_sctp::timer_wheel m_TimerWheel;  // keepalive and idle timers for all connections
+	boost::asio_sctp::trace_writer m_Trace;  // capture of all traffic, for sctp_replay
+	CTunerPtr m_pTuner;  // adjusts RTO, retransmissions and buffers of accepted connections; NULL until SetTuningProfile, guarded by m_ConnectionsMutex
+	boost::asio_sctp::sctp_address_watcher m_AddressWatcher;  // adds and removes local addresses on live associations
+	bool m_WatchingAddresses;  // FALSE until WatchAddresses
+	boost::scoped_ptr<CStreamExecutor> m_pStreamExecutor;  // NULL until SetReceiveWorkers
+	std::list<CSctpConnection*> m_Connections;  // accepted and not yet seen closed
+	boost::mutex m_ConnectionsMutex;
+	boost::asio::local::stream_protocol::acceptor m_HandoverAcceptor;  // where a successor asks for the listening socket
+	boost::asio::local::stream_protocol::socket m_HandoverSocket;
+	volatile bool m_HandedOver;  // the successor has the listening socket; connections are draining
 //	boost::asio_sctp::sctp_socket_acceptor<boost::asio_sctp::ip::sctp> m_Acceptor;
 };
 
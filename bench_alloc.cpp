@@ -0,0 +1,206 @@
+/**
+*	@file
+*
+*	@section Purpose
+*
+*	Counts heap allocations on the steady-state send and receive path of one
+*	loopback association.  Bursts of small messages are encoded in place in a
+*	send ring, committed to an sctp_send_queue and read back with
+*	sctp_receive_batch::async_fill, all on one IO service thread; the next burst
+*	is sent once the last one has arrived.  After a warm-up, every call to
+*	operator new is counted.  With the handler memory recycled this should
+*	come to zero per message.
+*
+*	Usage: bench_alloc [--copy] [bursts]
+*
+*	--copy sends with sctp_send_queue::push, which copies each message into a
+*	heap allocation, for comparison.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <boost/bind.hpp>
+
+#include <boost/asio_sctp/ip/sctp.hpp>
+#include <boost/asio_sctp/sctp_receive_batch.hpp>
+#include <boost/asio_sctp/sctp_send_queue.hpp>
+#include <boost/asio_sctp/sctp_send_ring.hpp>
+
+#define BENCH_PORT			54324
+#define MESSAGE_SIZE		128
+#define BURST_SIZE			32		// messages sent before waiting for them to arrive
+#define WARMUP_BURSTS		1000	// before allocations are counted
+#define DEFAULT_BURSTS		100000
+#define RING_SIZE			(256 * 1024)
+#define BATCH_MESSAGES		64
+#define BATCH_BYTES			65536
+
+using boost::asio_sctp::ip::sctp;
+
+/* Every allocation in the process goes through here */
+static volatile unsigned long g_Allocations = 0;
+
+void* operator new(std::size_t numBytes)
+{
+	__sync_fetch_and_add(&g_Allocations, 1UL);
+	void* p = std::malloc(numBytes ? numBytes : 1);
+	if(!p)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new(std::size_t numBytes, const std::nothrow_t&) throw()
+{
+	__sync_fetch_and_add(&g_Allocations, 1UL);
+	return std::malloc(numBytes ? numBytes : 1);
+}
+
+void operator delete(void* p) throw()
+{
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) throw()
+{
+	std::free(p);
+}
+
+static sctp::socket* g_pServer;
+static boost::asio_sctp::sctp_send_queue<sctp::socket>* g_pQueue;
+static boost::asio_sctp::sctp_send_ring* g_pRing;
+static boost::asio_sctp::sctp_receive_batch* g_pBatch;
+static bool g_Copy = false;
+static unsigned long g_Bursts = DEFAULT_BURSTS;
+static unsigned long g_BurstsSent = 0;
+static unsigned long g_Sent = 0;
+static unsigned long g_Received = 0;
+static unsigned long g_Batches = 0;
+static unsigned long g_StartAllocations = 0;
+static unsigned long g_StartReceived = 0;
+static unsigned long g_StartBatches = 0;
+static boost::uint64_t g_StartNs = 0;
+static boost::uint64_t g_EndNs = 0;
+
+static boost::uint64_t NowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (boost::uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void SendBurst(void)
+{
+	unsigned char payload[MESSAGE_SIZE];
+	std::memset(payload, 0x5A, sizeof(payload));
+	for(int i = 0; i < BURST_SIZE; ++i)
+	{
+		bool accepted;
+		if(g_Copy)
+		{
+			accepted = g_pQueue->push(payload, sizeof(payload), 0, 0);
+		}
+		else
+		{
+			boost::asio_sctp::sctp_send_ring::region message;
+			g_pRing->reserve(MESSAGE_SIZE, message);
+			std::memset(message.data(), 0x5A, message.size());  // encoded in place
+			accepted = g_pQueue->commit(message, 0, 0);
+		}
+		if(accepted)
+		{
+			++g_Sent;
+		}
+	}
+	++g_BurstsSent;
+}
+
+static void OnBatch(const boost::system::error_code& ec, const boost::asio_sctp::sctp_receive_batch& batch)
+{
+	if(ec)
+	{
+		std::printf("receive failed: %s\n", ec.message().c_str());
+		return;
+	}
+	g_Received += batch.size();
+	++g_Batches;
+	if(g_Received < g_Sent)
+	{
+		g_pBatch->async_fill(*g_pServer, &OnBatch);
+		return;
+	}
+
+	if(g_BurstsSent == WARMUP_BURSTS)
+	{
+		g_StartAllocations = g_Allocations;
+		g_StartReceived = g_Received;
+		g_StartBatches = g_Batches;
+		g_StartNs = NowNs();
+	}
+	if(g_BurstsSent == WARMUP_BURSTS + g_Bursts)
+	{
+		g_EndNs = NowNs();
+		return;  // nothing more outstanding, so run() returns
+	}
+	SendBurst();
+	g_pBatch->async_fill(*g_pServer, &OnBatch);
+}
+
+int main(int argc, char* argv[])
+{
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--copy") == 0)
+		{
+			g_Copy = true;
+		}
+		else
+		{
+			g_Bursts = std::strtoul(argv[i], NULL, 10);
+		}
+	}
+
+	boost::asio::io_service ioService;
+	sctp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), BENCH_PORT);
+
+	sctp::acceptor acceptor(ioService);
+	acceptor.open(endpoint.protocol());
+	acceptor.set_option(sctp::acceptor::reuse_address(true));
+	acceptor.bind(endpoint);
+	acceptor.listen();
+	sctp::socket client(ioService);
+	client.connect(endpoint);
+	sctp::socket server(ioService);
+	acceptor.accept(server);
+
+	boost::asio_sctp::sctp_send_queue<sctp::socket> queue(client);
+	boost::asio_sctp::sctp_receive_batch batch(BATCH_MESSAGES, BATCH_BYTES);
+	g_pServer = &server;
+	g_pQueue = &queue;
+	g_pBatch = &batch;
+	g_pRing = boost::asio_sctp::sctp_send_ring::create(RING_SIZE);
+
+	SendBurst();
+	batch.async_fill(server, &OnBatch);
+	ioService.run();
+
+	unsigned long allocations = g_Allocations - g_StartAllocations;
+	unsigned long messages = g_Received - g_StartReceived;
+	unsigned long batches = g_Batches - g_StartBatches;
+	double seconds = (g_EndNs - g_StartNs) / 1e9;
+	std::printf("%s, %lu x %d-byte messages in bursts of %d after %d bursts of warm-up\n",
+			g_Copy ? "copied with push" : "encoded in place", messages, MESSAGE_SIZE, BURST_SIZE, WARMUP_BURSTS);
+	std::printf("heap allocations: %lu in total, %.3f per message\n",
+			allocations, messages ? (double)allocations / messages : 0.0);
+	std::printf("%.1f messages per receive handler call, %.0f messages/s\n",
+			batches ? (double)messages / batches : 0.0, seconds > 0 ? messages / seconds : 0.0);
+
+	client.close();
+	server.close();
+	boost::asio_sctp::sctp_send_ring::retire(g_pRing);
+	return 0;
+}
@@ -0,0 +1,155 @@
+/**
+*	@file
+*
+*	@section Purpose
+*
+*	Measures the cost of routing a received message with message_dispatcher,
+*	whose rules are expanded at compile time into a table indexed by message
+*	type, against a runtime list of the same rules searched in order, as a
+*	handler registry built at startup would be.  The messages cycle through
+*	every rule's type, plus types no rule names, so that both the matched and
+*	the fallback paths are timed.
+*
+*	Usage: bench_dispatch [messages]
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/mpl/vector.hpp>
+
+#include <boost/asio_sctp/message_dispatcher.hpp>
+
+#define DEFAULT_MESSAGES	50000000
+#define NUM_TYPES			20		// message types cycled through...
+#define NUM_RULES			16		// ...of which these first ones have a rule
+#define PPID_S1AP			46
+#define PPID_X2AP			27
+
+struct SContext
+{
+	unsigned long handled[NUM_TYPES + 1];  // the last counts unmatched messages
+};
+
+template <unsigned Type>
+struct Count
+{
+	static void handle(SContext& ctx, const boost::asio_sctp::sctp_message&)
+	{
+		++ctx.handled[Type];
+	}
+};
+
+struct CountUnhandled
+{
+	static void handle(SContext& ctx, const boost::asio_sctp::sctp_message&)
+	{
+		++ctx.handled[NUM_TYPES];
+	}
+};
+
+#define RULE(type, ppid) boost::asio_sctp::dispatch_rule<Count<type>, type, boost::asio_sctp::any_message_class, ppid>
+
+typedef boost::mpl::vector16<
+	RULE(0, PPID_S1AP), RULE(1, PPID_S1AP), RULE(2, PPID_S1AP), RULE(3, PPID_S1AP),
+	RULE(4, PPID_S1AP), RULE(5, PPID_S1AP), RULE(6, PPID_S1AP), RULE(7, PPID_S1AP),
+	RULE(8, PPID_X2AP), RULE(9, PPID_X2AP), RULE(10, PPID_X2AP), RULE(11, PPID_X2AP),
+	RULE(12, PPID_X2AP), RULE(13, PPID_X2AP), RULE(14, PPID_X2AP), RULE(15, PPID_X2AP)
+> Rules;
+
+typedef boost::asio_sctp::message_dispatcher<SContext, Rules,
+		boost::asio_sctp::default_header_layout, CountUnhandled> Dispatcher;
+
+/* One entry of the runtime registry */
+struct SRuntimeRule
+{
+	unsigned type;
+	boost::uint32_t ppid;
+	void (*pHandler)(SContext&, const boost::asio_sctp::sctp_message&);
+};
+
+static bool RuntimeDispatch(const std::vector<SRuntimeRule>& rules, SContext& ctx, const boost::asio_sctp::sctp_message& msg)
+{
+	if(msg.size >= boost::asio_sctp::default_header_layout::min_length)
+	{
+		unsigned type = boost::asio_sctp::default_header_layout::message_type(msg.data);
+		for(size_t i = 0; i < rules.size(); ++i)
+		{
+			if((rules[i].type == type) && (rules[i].ppid == msg.ppid))
+			{
+				rules[i].pHandler(ctx, msg);
+				return true;
+			}
+		}
+	}
+	CountUnhandled::handle(ctx, msg);
+	return false;
+}
+
+static boost::uint64_t NowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (boost::uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long numMessages = (argc > 1) ? std::strtoul(argv[1], NULL, 10) : DEFAULT_MESSAGES;
+
+	unsigned char headers[NUM_TYPES][4];
+	std::vector<boost::asio_sctp::sctp_message> messages(NUM_TYPES);
+	for(unsigned type = 0; type < NUM_TYPES; ++type)
+	{
+		headers[type][0] = 1;
+		headers[type][1] = 0;
+		headers[type][2] = 0;
+		headers[type][3] = (unsigned char)type;
+		std::memset(&messages[type], 0, sizeof(messages[type]));
+		messages[type].data = headers[type];
+		messages[type].size = sizeof(headers[type]);
+		messages[type].ppid = (type < NUM_RULES / 2) ? PPID_S1AP : PPID_X2AP;
+	}
+
+#define RUNTIME_RULE(type, ppid) { SRuntimeRule r = { type, ppid, &Count<type>::handle }; runtimeRules.push_back(r); }
+	std::vector<SRuntimeRule> runtimeRules;
+	RUNTIME_RULE(0, PPID_S1AP) RUNTIME_RULE(1, PPID_S1AP) RUNTIME_RULE(2, PPID_S1AP) RUNTIME_RULE(3, PPID_S1AP)
+	RUNTIME_RULE(4, PPID_S1AP) RUNTIME_RULE(5, PPID_S1AP) RUNTIME_RULE(6, PPID_S1AP) RUNTIME_RULE(7, PPID_S1AP)
+	RUNTIME_RULE(8, PPID_X2AP) RUNTIME_RULE(9, PPID_X2AP) RUNTIME_RULE(10, PPID_X2AP) RUNTIME_RULE(11, PPID_X2AP)
+	RUNTIME_RULE(12, PPID_X2AP) RUNTIME_RULE(13, PPID_X2AP) RUNTIME_RULE(14, PPID_X2AP) RUNTIME_RULE(15, PPID_X2AP)
+#undef RUNTIME_RULE
+
+	SContext table;
+	std::memset(&table, 0, sizeof(table));
+	unsigned long matched = 0;
+	boost::uint64_t startNs = NowNs();
+	for(unsigned long i = 0; i < numMessages; ++i)
+	{
+		matched += Dispatcher::dispatch(table, messages[i % NUM_TYPES]);
+	}
+	double tableNs = double(NowNs() - startNs) / numMessages;
+
+	SContext runtime;
+	std::memset(&runtime, 0, sizeof(runtime));
+	unsigned long runtimeMatched = 0;
+	startNs = NowNs();
+	for(unsigned long i = 0; i < numMessages; ++i)
+	{
+		runtimeMatched += RuntimeDispatch(runtimeRules, runtime, messages[i % NUM_TYPES]);
+	}
+	double runtimeNs = double(NowNs() - startNs) / numMessages;
+
+	std::printf("%lu messages over %d types, %d with a rule; %lu matched, %lu to the fallback\n",
+			numMessages, NUM_TYPES, NUM_RULES, matched, table.handled[NUM_TYPES]);
+	std::printf("message_dispatcher: %.2f ns per message\n", tableNs);
+	std::printf("runtime rule list:  %.2f ns per message\n", runtimeNs);
+	if((runtimeMatched != matched) || (std::memcmp(&table, &runtime, sizeof(table)) != 0))
+	{
+		std::printf("the two dispatchers routed the messages differently\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,193 @@
+/**
+*	@file
+*
+*	@section Purpose
+*
+*	Measures the latency of small messages on one stream while multi-megabyte
+*	messages are being sent on another stream of the same association, with and
+*	without user message interleaving (I-DATA, RFC 8260).
+*
+*	Usage: bench_interleave [--no-interleave] [seconds]
+*
+*	Interleaving also needs the net.sctp.intl_enable sysctl set to 1.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <boost/asio_sctp/ip/sctp.hpp>
+#include <boost/asio_sctp/latency_histogram.hpp>
+#include <boost/asio_sctp/sctp_reassembler.hpp>
+
+#define BENCH_PORT			54322
+#define PROBE_STREAM		0
+#define BULK_STREAM			1
+#define PROBE_SIZE			64
+#define BULK_SIZE			(4 * 1024 * 1024)
+#define PROBE_INTERVAL_US	1000
+
+using boost::asio_sctp::ip::sctp;
+
+static volatile bool g_Running = true;
+static volatile unsigned long g_BulkMessages = 0;
+static boost::asio_sctp::latency_histogram g_ProbeLatency;
+
+static boost::uint64_t NowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (boost::uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+template <typename SocketOrAcceptor>
+static void EnableInterleaving(SocketOrAcceptor& rSocket)
+{
+	boost::system::error_code ec;
+	rSocket.set_option(sctp::fragment_interleave(2), ec);
+	if(ec)
+	{
+		std::printf("warning: fragment interleaving not available: %s\n", ec.message().c_str());
+	}
+#if defined(SCTP_INTERLEAVING_SUPPORTED)
+	rSocket.set_option(boost::asio_sctp::socket_option::sctp_interleaving_supported(true), ec);
+	if(ec)
+	{
+		std::printf("warning: user message interleaving not available: %s\n", ec.message().c_str());
+	}
+#endif
+}
+
+// Without this the kernel reports no stream, and every message looks like a probe
+template <typename SocketOrAcceptor>
+static void SubscribeDataIo(SocketOrAcceptor& rSocket)
+{
+	struct sctp_event_subscribe subs;
+	std::memset(&subs, 0, sizeof(subs));
+	subs.sctp_data_io_event = 1;
+	rSocket.set_option(boost::asio_sctp::socket_option::sctp_event_subscribe(subs));
+}
+
+static void SendMessage(sctp::socket& rSocket, const void* pData, size_t numBytes, uint16_t streamNum)
+{
+	boost::asio_sctp::sctp_outbound_message msg;
+	msg.buffer = boost::asio::const_buffer(pData, numBytes);
+	msg.stream = streamNum;
+	msg.ppid = 0;
+	msg.flags = 0;
+	msg.time_to_live = 0;
+	boost::system::error_code ec;
+	rSocket.send_batch(&msg, &msg + 1, ec);
+}
+
+static void BulkSender(sctp::socket* pSocket)
+{
+	std::vector<unsigned char> payload(BULK_SIZE, 0xAB);
+	while(g_Running)
+	{
+		SendMessage(*pSocket, &payload[0], payload.size(), BULK_STREAM);
+		++g_BulkMessages;
+	}
+}
+
+static void ProbeSender(sctp::socket* pSocket)
+{
+	unsigned char payload[PROBE_SIZE];
+	std::memset(payload, 0, sizeof(payload));
+	while(g_Running)
+	{
+		boost::uint64_t sentAt = NowNs();
+		std::memcpy(payload, &sentAt, sizeof(sentAt));
+		SendMessage(*pSocket, payload, sizeof(payload), PROBE_STREAM);
+		boost::this_thread::sleep(boost::posix_time::microseconds(PROBE_INTERVAL_US));
+	}
+}
+
+static void Receiver(sctp::socket* pSocket)
+{
+	std::vector<unsigned char> buffer(65536);
+	boost::asio_sctp::sctp_reassembler reassembler;
+	while(g_Running)
+	{
+		boost::asio_sctp::sctp_receive_info info;
+		boost::system::error_code ec;
+		size_t numBytes = pSocket->receive_message(boost::asio::buffer(buffer), 0, info, ec);
+		if(ec || numBytes == 0)
+		{
+			break;
+		}
+		boost::asio_sctp::sctp_message msg;
+		if(reassembler.add(&buffer[0], numBytes, info, msg) && msg.stream == PROBE_STREAM)
+		{
+			boost::uint64_t sentAt;
+			std::memcpy(&sentAt, msg.data, sizeof(sentAt));
+			g_ProbeLatency.record(NowNs() - sentAt);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool interleave = true;
+	int seconds = 10;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--no-interleave") == 0)
+		{
+			interleave = false;
+		}
+		else
+		{
+			seconds = std::atoi(argv[i]);
+		}
+	}
+
+	boost::asio::io_service ioService;
+	sctp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), BENCH_PORT);
+
+	sctp::acceptor acceptor(ioService);
+	acceptor.open(endpoint.protocol());
+	acceptor.set_option(sctp::acceptor::reuse_address(true));
+	SubscribeDataIo(acceptor);
+	sctp::socket client(ioService);
+	client.open(endpoint.protocol());
+	if(interleave)
+	{
+		EnableInterleaving(acceptor);
+		EnableInterleaving(client);
+	}
+	acceptor.bind(endpoint);
+	acceptor.listen();
+
+	client.set_option(boost::asio::socket_base::send_buffer_size(2 * BULK_SIZE));
+	client.connect(endpoint);
+	sctp::socket server(ioService);
+	acceptor.accept(server);
+	SubscribeDataIo(server);
+
+	boost::thread receiver(boost::bind(Receiver, &server));
+	boost::thread bulk(boost::bind(BulkSender, &client));
+	boost::thread probe(boost::bind(ProbeSender, &client));
+
+	boost::this_thread::sleep(boost::posix_time::seconds(seconds));
+	g_Running = false;
+	probe.join();
+	client.close();
+	bulk.join();
+	server.close();
+	receiver.join();
+
+	std::printf("interleaving %s, %d s, %lu x %d-byte bulk messages on stream %d\n",
+			interleave ? "on" : "off", seconds, (unsigned long)g_BulkMessages, BULK_SIZE, BULK_STREAM);
+	std::printf("probe latency (us): n=%llu p50=%.1f p99=%.1f p99.9=%.1f max=%.1f\n",
+			(unsigned long long)g_ProbeLatency.count(),
+			g_ProbeLatency.percentile(50) / 1000.0,
+			g_ProbeLatency.percentile(99) / 1000.0,
+			g_ProbeLatency.percentile(99.9) / 1000.0,
+			g_ProbeLatency.max() / 1000.0);
+	return 0;
+}
@@ -0,0 +1,209 @@
+/**
+*	@file
+*
+*	@section Purpose
+*
+*	Compares the throughput of small messages over one loopback association
+*	sent and received through ip::sctp::iostream with the same traffic through
+*	the socket calls it is built on (send_batch and sctp_receive_batch), and
+*	with boost::asio::basic_socket_iostream, which the iostream typedef used to
+*	be.  Each message is written and flushed on its own, and read back whole.
+*	Every message carries its sequence number, and the receiver checks each
+*	one's size, stream, sequence and payload, so a run also shows that the
+*	loopback traffic arrived intact; a rate is only worth comparing when no
+*	message was bad or missing.
+*
+*	Usage: bench_iostream [--raw | --asio] [messages]
+*
+*	Exits with 0 if every message arrived intact.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/asio/basic_socket_iostream.hpp>
+
+#include <boost/asio_sctp/ip/sctp.hpp>
+#include <boost/asio_sctp/sctp_receive_batch.hpp>
+
+#define BENCH_PORT			54325
+#define MESSAGE_SIZE		128
+#define MESSAGE_STREAM		1
+#define MESSAGE_PPID		42
+#define DEFAULT_MESSAGES	1000000
+#define BATCH_MESSAGES		64
+#define BATCH_BYTES			(256 * 1024)
+
+using boost::asio_sctp::ip::sctp;
+
+enum EMode
+{
+	MODE_IOSTREAM,
+	MODE_RAW,
+	MODE_ASIO
+};
+
+static EMode g_Mode = MODE_IOSTREAM;
+static unsigned long g_Messages = DEFAULT_MESSAGES;
+
+static boost::uint64_t NowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (boost::uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* Fills a message with its sequence number followed by a fixed pattern */
+static void Fill(char* pMessage, boost::uint32_t seq)
+{
+	std::memset(pMessage, 0x5A, MESSAGE_SIZE);
+	std::memcpy(pMessage, &seq, sizeof(seq));
+}
+
+/* Whether a message received whole is the one expected next */
+static bool Intact(const char* pMessage, boost::uint32_t seq)
+{
+	char expected[MESSAGE_SIZE];
+	Fill(expected, seq);
+	return std::memcmp(pMessage, expected, MESSAGE_SIZE) == 0;
+}
+
+static void Sender(sctp::endpoint endpoint)
+{
+	char payload[MESSAGE_SIZE];
+	if(g_Mode == MODE_RAW)
+	{
+		boost::asio::io_service ioService;
+		sctp::socket client(ioService);
+		client.connect(endpoint);
+		boost::asio_sctp::sctp_outbound_message msg;
+		msg.buffer = boost::asio::const_buffer(payload, sizeof(payload));
+		msg.stream = MESSAGE_STREAM;
+		msg.ppid = MESSAGE_PPID;
+		msg.flags = 0;
+		msg.time_to_live = 0;
+		for(unsigned long i = 0; i < g_Messages; ++i)
+		{
+			Fill(payload, i);
+			client.send_batch(&msg, &msg + 1);
+		}
+	}
+	else if(g_Mode == MODE_ASIO)
+	{
+		boost::asio::basic_socket_iostream<sctp> client(endpoint);
+		for(unsigned long i = 0; i < g_Messages; ++i)
+		{
+			Fill(payload, i);
+			client.write(payload, sizeof(payload));
+			client.flush();
+		}
+	}
+	else
+	{
+		sctp::iostream client(endpoint);
+		client.set_outbound(MESSAGE_STREAM, MESSAGE_PPID);
+		for(unsigned long i = 0; i < g_Messages; ++i)
+		{
+			Fill(payload, i);
+			client.write(payload, sizeof(payload));
+			client.flush();  // one message
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--raw") == 0)
+		{
+			g_Mode = MODE_RAW;
+		}
+		else if(std::strcmp(argv[i], "--asio") == 0)
+		{
+			g_Mode = MODE_ASIO;
+		}
+		else
+		{
+			g_Messages = std::strtoul(argv[i], NULL, 10);
+		}
+	}
+
+	boost::asio::io_service ioService;
+	sctp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), BENCH_PORT);
+	sctp::acceptor acceptor(ioService);
+	acceptor.open(endpoint.protocol());
+	acceptor.set_option(sctp::acceptor::reuse_address(true));
+	acceptor.bind(endpoint);
+	acceptor.listen();
+
+	boost::thread sender(boost::bind(Sender, endpoint));
+
+	unsigned long received = 0;
+	unsigned long badMessages = 0;
+	char message[MESSAGE_SIZE];
+	boost::uint64_t startNs = NowNs();
+	if(g_Mode == MODE_RAW)
+	{
+		sctp::socket server(ioService);
+		acceptor.accept(server);
+		sctp_event_subs_t subs;
+		std::memset(&subs, 0, sizeof(subs));
+		subs.sctp_data_io_event = 1;  // for each message's stream, as the iostream subscribes
+		server.set_option(boost::asio_sctp::socket_option::sctp_event_subscribe(subs));
+		boost::asio_sctp::sctp_receive_batch batch(BATCH_MESSAGES, BATCH_BYTES);
+		boost::system::error_code ec;
+		while(received < g_Messages && batch.fill(server, ec) != 0)
+		{
+			for(size_t i = 0; i < batch.size(); ++i)
+			{
+				size_t numBytes = (batch[i].size < sizeof(message)) ? batch[i].size : sizeof(message);
+				std::memcpy(message, batch[i].data, numBytes);  // as the iostream's read does
+				if((batch[i].size != MESSAGE_SIZE) || (batch[i].stream != MESSAGE_STREAM) || !Intact(message, received))
+				{
+					++badMessages;
+				}
+				++received;
+			}
+		}
+	}
+	else if(g_Mode == MODE_ASIO)
+	{
+		boost::asio::basic_socket_iostream<sctp> server;
+		acceptor.accept(*server.rdbuf());
+		while(received < g_Messages && server.read(message, sizeof(message)))
+		{
+			if(!Intact(message, received))  // no boundaries, stream or PPID to check
+			{
+				++badMessages;
+			}
+			++received;
+		}
+	}
+	else
+	{
+		sctp::iostream server;
+		server.accept(acceptor);  // subscribes to data_io events, for stream()
+		server.set_message_mode(true);
+		while(received < g_Messages && server.next_message())
+		{
+			if((server.message_size() != MESSAGE_SIZE) || (server.stream() != MESSAGE_STREAM)
+				|| !server.read(message, sizeof(message)) || !Intact(message, received))
+			{
+				++badMessages;
+			}
+			++received;
+		}
+	}
+	double seconds = (NowNs() - startNs) / 1e9;
+	sender.join();
+
+	static const char* modeNames[] = {"sctp::iostream", "send_batch and sctp_receive_batch", "basic_socket_iostream"};
+	std::printf("%s: %lu x %d-byte messages in %.2f s, %.0f messages/s, %lu bad, %lu missing\n", modeNames[g_Mode],
+			received, MESSAGE_SIZE, seconds, seconds > 0 ? received / seconds : 0.0, badMessages, g_Messages - received);
+	return ((badMessages == 0) && (received == g_Messages)) ? 0 : 1;
+}
@@ -0,0 +1,621 @@
+/**
+*	@file
+*
+*	@section Purpose
+*
+*	Soak test of association scale.  Ramps loopback associations up to each
+*	target in turn against CSctpServer instances in a child process, holds them
+*	with light traffic, and finally aborts them all at once and lets every client
+*	reconnect.  Reports the server process's memory, descriptors and threads per
+*	association, its accept rate, the time for all clients to re-attach after
+*	the mass abort, and the connect latency during the ramps and the storm.
+*
+*	Each server admits at most MAX_CONNECTIONS associations, and a few at a time
+*	from each source address, so the servers listen on 127.0.0.1, 127.0.0.2, ...
+*	and clients bind to their own 127.1.x.y source addresses.  --servers must be
+*	at least the largest target / MAX_CONNECTIONS, and the hard RLIMIT_NOFILE
+*	must allow the largest target with some to spare; the client and server
+*	processes each need a descriptor per association.
+*
+*	Usage: bench_soak [--servers N] [--rate connects/s] [--hold seconds] [--log file] [targets...]
+*
+*	The default targets are 10000 50000 100000.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <vector>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include "SctpServer.h"
+#include <boost/asio_sctp/latency_histogram.hpp>
+#include <boost/asio_sctp/log.hpp>
+
+#define MAX_SERVER_CONNECTIONS	10000	// MAX_CONNECTIONS in SctpServer.cpp
+#define SOURCE_ASSOCIATIONS		4		// ADMISSION_BURST in SctpServer.cpp
+#define DEFAULT_SERVERS			10
+#define DEFAULT_CONNECT_RATE	2000	// new associations per second while ramping
+#define DEFAULT_HOLD_SECONDS	30
+#define MAX_IN_FLIGHT			1000	// handshakes outstanding at once
+#define PACE_TICK_MS			10
+#define POLL_MS					250		// how often the server process is sampled
+#define RETRY_MS				1000	// before reconnecting a refused client, plus up to as much again
+#define TRAFFIC_INTERVAL_MS		5000	// each held association sends one message this often
+#define SETTLE_TIMEOUT_S		120		// give up waiting for the associations after this long
+
+using boost::asio_sctp::ip::sctp;
+
+static boost::uint64_t NowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (boost::uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static boost::asio::ip::address ServerAddress(int serverNum)
+{
+	return boost::asio::ip::address_v4(0x7F000001 + serverNum);  // 127.0.0.1 onwards
+}
+
+static boost::asio::ip::address SourceAddress(size_t sourceNum)
+{
+	return boost::asio::ip::address_v4(0x7F010000 + 1 + (unsigned long)sourceNum);  // 127.1.0.1 onwards
+}
+
+/**
+*	@struct SProcessStats
+*	Resource use of the server process, from /proc
+*/
+struct SProcessStats
+{
+	unsigned long rssKb;
+	unsigned long threads;
+	unsigned long fds;
+};
+
+static bool ReadProcessStats(pid_t pid, SProcessStats& rStats)
+{
+	char path[64];
+	std::sprintf(path, "/proc/%d/status", (int)pid);
+	std::FILE* pFile = std::fopen(path, "r");
+	if(!pFile)
+	{
+		return false;
+	}
+	rStats.rssKb = 0;
+	rStats.threads = 0;
+	char line[256];
+	while(std::fgets(line, sizeof(line), pFile))
+	{
+		std::sscanf(line, "VmRSS: %lu", &rStats.rssKb);
+		std::sscanf(line, "Threads: %lu", &rStats.threads);
+	}
+	std::fclose(pFile);
+
+	std::sprintf(path, "/proc/%d/fd", (int)pid);
+	DIR* pDir = opendir(path);
+	if(!pDir)
+	{
+		return false;
+	}
+	rStats.fds = 0;
+	while(struct dirent* pEntry = readdir(pDir))
+	{
+		if(pEntry->d_name[0] != '.')
+		{
+			++rStats.fds;
+		}
+	}
+	closedir(pDir);
+	return true;
+}
+
+static void PrintLatency(const char* pLabel, const boost::asio_sctp::latency_histogram& histogram)
+{
+	std::printf("  %s latency (us): n=%llu p50=%.1f p99=%.1f p99.9=%.1f max=%.1f\n", pLabel,
+			(unsigned long long)histogram.count(),
+			histogram.percentile(50) / 1000.0,
+			histogram.percentile(99) / 1000.0,
+			histogram.percentile(99.9) / 1000.0,
+			histogram.max() / 1000.0);
+}
+
+/**
+ * Runs the servers in the child process, as server1 does, until the parent exits
+ */
+static void RunServers(int numServers, const char* pLogPath)
+{
+	prctl(PR_SET_PDEATHSIG, SIGKILL);
+	std::FILE* pLog = std::fopen(pLogPath, "w");
+	if(pLog)
+	{
+		boost::asio_sctp::logging::logger::instance().set_output(pLog);
+	}
+
+	boost::asio::io_service ioService;
+	boost::asio::io_service::work work(ioService);
+	std::vector<CSctpServer*> servers;
+	for(int i = 0; i < numServers; ++i)
+	{
+		CSctpServer* pServer = new CSctpServer(ioService, ServerAddress(i));
+		pServer->StartAccept();
+		servers.push_back(pServer);
+	}
+	ioService.run();
+}
+
+/**
+*	@struct SClient
+*	Client end of one association
+*/
+struct SClient
+{
+	explicit SClient(boost::asio::io_service& IO_Service)
+		: socket(IO_Service)
+		, retryTimer(IO_Service)
+		, generation(0)
+		, startNs(0)
+		, up(false)
+	{
+	}
+
+	sctp::socket socket;
+	boost::asio::deadline_timer retryTimer;
+	unsigned int generation;  // bumped on abort, so stale handlers are ignored
+	boost::uint64_t startNs;
+	bool up;
+};
+
+/**
+*	@class CSoakClients
+*	The client associations, all driven by one IO service thread.  The counters
+*	are read by the main thread.
+*/
+class CSoakClients : public boost::noncopyable
+{
+public:
+	CSoakClients(boost::asio::io_service& IO_Service, int numServers, int connectRate)
+		: m_IO_Service(IO_Service)
+		, m_PaceTimer(IO_Service)
+		, m_NumServers(numServers)
+		, m_ConnectsPerTick(connectRate * PACE_TICK_MS / 1000 > 0 ? connectRate * PACE_TICK_MS / 1000 : 1)
+		, m_Pacing(true)
+		, m_Traffic(false)
+		, m_TrafficNext(0)
+		, m_Up(0)
+		, m_InFlight(0)
+		, m_Refused(0)
+		, m_Failed(0)
+		, m_pLatency(&m_RampLatency)
+	{
+		OnPaceTimer(boost::system::error_code());
+	}
+
+	/** Adds clients up to numClients and starts connecting them */
+	void Grow(size_t numClients)
+	{
+		m_IO_Service.post(boost::bind(&CSoakClients::DoGrow, this, numClients));
+	}
+
+	/** Aborts every association and reconnects them all at once, without pacing */
+	void AbortAll(void)
+	{
+		m_IO_Service.post(boost::bind(&CSoakClients::DoAbortAll, this));
+	}
+
+	/** Sends light traffic on the associations which are up */
+	void SetTraffic(bool on)
+	{
+		m_Traffic = on;
+	}
+
+	size_t Up(void) const { return m_Up; }
+	size_t Refused(void) const { return m_Refused; }
+	size_t Failed(void) const { return m_Failed; }
+
+	boost::asio_sctp::latency_histogram m_RampLatency;  // connect latency while ramping
+	boost::asio_sctp::latency_histogram m_StormLatency;  // connect latency after the mass abort
+
+private:
+	void DoGrow(size_t numClients)
+	{
+		while(m_Clients.size() < numClients)
+		{
+			m_Clients.push_back(new SClient(m_IO_Service));
+			m_Pending.push_back(m_Clients.size() - 1);
+		}
+	}
+
+	void DoAbortAll(void)
+	{
+		m_Pacing = false;
+		m_pLatency = &m_StormLatency;
+		m_Pending.clear();
+		for(size_t i = 0; i < m_Clients.size(); ++i)
+		{
+			SClient& rClient = *m_Clients[i];
+			++rClient.generation;
+			boost::system::error_code ec;
+			rClient.retryTimer.cancel(ec);
+			if(rClient.socket.is_open())
+			{
+				rClient.socket.set_option(boost::asio::socket_base::linger(true, 0), ec);  // ABORT rather than SHUTDOWN
+				rClient.socket.close(ec);
+			}
+			if(rClient.up)
+			{
+				rClient.up = false;
+				--m_Up;
+			}
+			m_Pending.push_back(i);
+		}
+	}
+
+	/**
+	 * Starts the next batch of pending connects, and sends the traffic due this tick
+	 */
+	void OnPaceTimer(const boost::system::error_code& error)
+	{
+		if(error)
+		{
+			return;
+		}
+
+		size_t budget = m_Pacing ? m_ConnectsPerTick : m_Pending.size();
+		while(budget-- > 0 && !m_Pending.empty() && m_InFlight < MAX_IN_FLIGHT)
+		{
+			Connect(m_Pending.front());
+			m_Pending.pop_front();
+		}
+
+		if(m_Traffic && !m_Clients.empty())
+		{
+			size_t numToSend = m_Clients.size() * PACE_TICK_MS / TRAFFIC_INTERVAL_MS + 1;
+			for(size_t n = 0; n < numToSend; ++n)
+			{
+				SClient& rClient = *m_Clients[m_TrafficNext++ % m_Clients.size()];
+				if(rClient.up)
+				{
+					Send(rClient);
+				}
+			}
+		}
+
+		m_PaceTimer.expires_from_now(boost::posix_time::milliseconds(PACE_TICK_MS));
+		m_PaceTimer.async_wait(boost::bind(&CSoakClients::OnPaceTimer, this, boost::asio::placeholders::error));
+	}
+
+	void Connect(size_t clientNum)
+	{
+		SClient& rClient = *m_Clients[clientNum];
+		boost::system::error_code ec;
+		if(rClient.socket.is_open())
+		{
+			rClient.socket.close(ec);
+		}
+		rClient.socket.open(sctp::v4(), ec);
+		if(!ec)
+		{
+			rClient.socket.bind(sctp::endpoint(SourceAddress(clientNum / SOURCE_ASSOCIATIONS), 0), ec);
+		}
+		if(ec)
+		{
+			++m_Failed;
+			Retry(clientNum);
+			return;
+		}
+
+		++m_InFlight;
+		rClient.startNs = NowNs();
+		rClient.socket.async_connect(sctp::endpoint(ServerAddress(clientNum % m_NumServers), SERVER_PORT),
+				boost::bind(&CSoakClients::OnConnect, this, clientNum, rClient.generation,
+				boost::asio::placeholders::error));
+	}
+
+	void OnConnect(size_t clientNum, unsigned int generation, const boost::system::error_code& error)
+	{
+		--m_InFlight;
+		SClient& rClient = *m_Clients[clientNum];
+		if(generation != rClient.generation)
+		{
+			return;  // aborted meanwhile
+		}
+		if(error)
+		{
+			++m_Failed;
+			Retry(clientNum);
+			return;
+		}
+
+		m_pLatency->record(NowNs() - rClient.startNs);
+		rClient.up = true;
+		++m_Up;
+		WaitForClose(clientNum);
+	}
+
+	/**
+	 * Watches for the server refusing or dropping the association
+	 */
+	void WaitForClose(size_t clientNum)
+	{
+		SClient& rClient = *m_Clients[clientNum];
+		rClient.socket.async_receive(boost::asio::null_buffers(),
+				boost::bind(&CSoakClients::OnReadable, this, clientNum, rClient.generation,
+				boost::asio::placeholders::error));
+	}
+
+	void OnReadable(size_t clientNum, unsigned int generation, const boost::system::error_code& error)
+	{
+		SClient& rClient = *m_Clients[clientNum];
+		if(generation != rClient.generation)
+		{
+			return;
+		}
+
+		boost::system::error_code ec = error;
+		if(!ec)
+		{
+			unsigned char buffer[256];
+			boost::asio_sctp::sctp_receive_info info;
+			size_t numBytes = rClient.socket.receive_message(boost::asio::buffer(buffer), MSG_DONTWAIT, info, ec);
+			if(ec == boost::asio::error::would_block || (!ec && numBytes != 0))
+			{
+				WaitForClose(clientNum);  // the server has nothing to say; ignore it
+				return;
+			}
+		}
+
+		rClient.up = false;
+		--m_Up;
+		++m_Refused;
+		++rClient.generation;
+		Retry(clientNum);
+	}
+
+	void Retry(size_t clientNum)
+	{
+		SClient& rClient = *m_Clients[clientNum];
+		boost::system::error_code ec;
+		rClient.socket.close(ec);
+		rClient.retryTimer.expires_from_now(boost::posix_time::milliseconds(RETRY_MS + std::rand() % RETRY_MS));
+		rClient.retryTimer.async_wait(boost::bind(&CSoakClients::OnRetryTimer, this, clientNum, rClient.generation,
+				boost::asio::placeholders::error));
+	}
+
+	void OnRetryTimer(size_t clientNum, unsigned int generation, const boost::system::error_code& error)
+	{
+		if(!error && generation == m_Clients[clientNum]->generation)
+		{
+			m_Pending.push_back(clientNum);
+		}
+	}
+
+	void Send(SClient& rClient)
+	{
+		unsigned char payload[16];
+		std::memset(payload, 0, sizeof(payload));
+		SMessageHeader* pHeader = reinterpret_cast<SMessageHeader*>(payload);
+		pHeader->version = 1;
+		boost::asio_sctp::sctp_outbound_message msg;
+		msg.buffer = boost::asio::const_buffer(payload, sizeof(payload));
+		msg.stream = 0;
+		msg.ppid = 0;
+		msg.flags = 0;
+		msg.time_to_live = 0;
+		boost::system::error_code ec;
+		rClient.socket.send_batch(&msg, &msg + 1, MSG_DONTWAIT, ec);
+	}
+
+	boost::asio::io_service& m_IO_Service;
+	boost::asio::deadline_timer m_PaceTimer;
+	std::vector<SClient*> m_Clients;
+	std::deque<size_t> m_Pending;  // clients waiting to connect
+	int m_NumServers;
+	size_t m_ConnectsPerTick;
+	bool m_Pacing;
+	volatile bool m_Traffic;
+	size_t m_TrafficNext;
+	volatile size_t m_Up;
+	size_t m_InFlight;
+	volatile size_t m_Refused;
+	volatile size_t m_Failed;
+	boost::asio_sctp::latency_histogram* m_pLatency;
+};
+
+/**
+ * Waits until every client is up and the server holds an association for each of
+ * them, tracking the server's peak resource use meanwhile
+ *
+ * @return seconds taken, or a negative number on timeout or if the server died
+ */
+static double WaitForAssociations(const CSoakClients& rClients, pid_t serverPid, size_t numAssociations,
+		unsigned long baselineFds, SProcessStats& rPeak)
+{
+	boost::uint64_t startNs = NowNs();
+	rPeak.rssKb = rPeak.threads = rPeak.fds = 0;
+	while(NowNs() - startNs < SETTLE_TIMEOUT_S * 1000000000ull)
+	{
+		boost::this_thread::sleep(boost::posix_time::milliseconds(POLL_MS));
+		SProcessStats stats;
+		if(!ReadProcessStats(serverPid, stats))
+		{
+			std::printf("server process has exited\n");
+			return -1;
+		}
+		rPeak.rssKb = std::max(rPeak.rssKb, stats.rssKb);
+		rPeak.threads = std::max(rPeak.threads, stats.threads);
+		rPeak.fds = std::max(rPeak.fds, stats.fds);
+		if(rClients.Up() >= numAssociations && stats.fds == baselineFds + numAssociations)  // and none left over from before an abort
+		{
+			return (NowNs() - startNs) / 1e9;
+		}
+	}
+	std::printf("timed out with %lu of %lu clients up\n", (unsigned long)rClients.Up(), (unsigned long)numAssociations);
+	return -1;
+}
+
+static void RunIoService(boost::asio::io_service* pIO_Service)
+{
+	boost::asio::io_service::work work(*pIO_Service);
+	pIO_Service->run();
+}
+
+static void Usage(void)
+{
+	std::fprintf(stderr, "Usage: bench_soak [--servers N] [--rate connects/s] [--hold seconds] [--log file] [targets...]\n");
+	std::exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+	int numServers = DEFAULT_SERVERS;
+	int connectRate = DEFAULT_CONNECT_RATE;
+	int holdSeconds = DEFAULT_HOLD_SECONDS;
+	const char* pLogPath = "bench_soak_server.log";
+	std::vector<size_t> targets;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--servers") == 0 && i + 1 < argc)
+		{
+			numServers = std::atoi(argv[++i]);
+		}
+		else if(std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+		{
+			connectRate = std::atoi(argv[++i]);
+		}
+		else if(std::strcmp(argv[i], "--hold") == 0 && i + 1 < argc)
+		{
+			holdSeconds = std::atoi(argv[++i]);
+		}
+		else if(std::strcmp(argv[i], "--log") == 0 && i + 1 < argc)
+		{
+			pLogPath = argv[++i];
+		}
+		else if(argv[i][0] != '-' && std::atol(argv[i]) > 0)
+		{
+			targets.push_back(std::atol(argv[i]));
+		}
+		else
+		{
+			Usage();
+		}
+	}
+	if(targets.empty())
+	{
+		targets.push_back(10000);
+		targets.push_back(50000);
+		targets.push_back(100000);
+	}
+	std::sort(targets.begin(), targets.end());
+	if(numServers < 1 || connectRate < 1 || holdSeconds < 0)
+	{
+		Usage();
+	}
+	if(targets.back() > (size_t)numServers * MAX_SERVER_CONNECTIONS)
+	{
+		std::printf("warning: %d servers admit at most %lu associations\n", numServers,
+				(unsigned long)numServers * MAX_SERVER_CONNECTIONS);
+	}
+
+	// Both processes need a descriptor per association, plus the server's listeners and files
+	struct rlimit limit;
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+	if(limit.rlim_cur < targets.back() + 1024)
+	{
+		std::printf("warning: RLIMIT_NOFILE is %lu\n", (unsigned long)limit.rlim_cur);
+	}
+
+	// Fork before any threads (including the logger's) are started
+	pid_t serverPid = fork();
+	if(serverPid == 0)
+	{
+		RunServers(numServers, pLogPath);
+		_exit(0);
+	}
+	else if(serverPid < 0)
+	{
+		std::perror("fork");
+		return 1;
+	}
+
+	boost::this_thread::sleep(boost::posix_time::milliseconds(500));  // let the servers start listening
+	SProcessStats baseline;
+	if(!ReadProcessStats(serverPid, baseline))
+	{
+		std::printf("server process failed to start\n");
+		return 1;
+	}
+	std::printf("%d servers: rss %lu kB, %lu fds, %lu threads\n", numServers, baseline.rssKb, baseline.fds,
+			baseline.threads);
+
+	boost::asio::io_service ioService;
+	CSoakClients clients(ioService, numServers, connectRate);
+	boost::thread ioThread(boost::bind(RunIoService, &ioService));
+
+	bool healthy = true;
+	size_t numAssociations = 0;
+	for(size_t t = 0; t < targets.size() && healthy; ++t)
+	{
+		size_t previous = numAssociations;
+		numAssociations = targets[t];
+		size_t refused = clients.Refused();
+		size_t failed = clients.Failed();
+		clients.m_RampLatency.reset();
+		clients.SetTraffic(true);
+		clients.Grow(numAssociations);
+
+		SProcessStats peak;
+		double seconds = WaitForAssociations(clients, serverPid, numAssociations, baseline.fds, peak);
+		healthy = (seconds >= 0);
+		if(healthy)
+		{
+			boost::this_thread::sleep(boost::posix_time::seconds(holdSeconds));
+		}
+
+		SProcessStats stats;
+		if(!ReadProcessStats(serverPid, stats))
+		{
+			std::printf("server process has exited\n");
+			break;
+		}
+		std::printf("%lu associations: ramp %.1f s, %.0f accepts/s, %lu refused, %lu failed\n",
+				(unsigned long)numAssociations, seconds, seconds > 0 ? (numAssociations - previous) / seconds : 0.0,
+				(unsigned long)(clients.Refused() - refused), (unsigned long)(clients.Failed() - failed));
+		std::printf("  server after %d s: rss %lu kB (%.1f kB/association), %lu fds, %lu threads\n", holdSeconds,
+				stats.rssKb, (double)(stats.rssKb - baseline.rssKb) / numAssociations, stats.fds, stats.threads);
+		PrintLatency("connect", clients.m_RampLatency);
+	}
+
+	if(healthy)
+	{
+		size_t refused = clients.Refused();
+		size_t failed = clients.Failed();
+		clients.AbortAll();
+
+		SProcessStats peak;
+		double seconds = WaitForAssociations(clients, serverPid, numAssociations, baseline.fds, peak);
+		std::printf("mass reconnect of %lu associations: re-attached in %.1f s, %.0f accepts/s, %lu refused, %lu failed\n",
+				(unsigned long)numAssociations, seconds, seconds > 0 ? numAssociations / seconds : 0.0,
+				(unsigned long)(clients.Refused() - refused), (unsigned long)(clients.Failed() - failed));
+		std::printf("  server peak: rss %lu kB, %lu fds, %lu threads\n", peak.rssKb, peak.fds, peak.threads);
+		PrintLatency("connect", clients.m_StormLatency);
+	}
+
+	kill(serverPid, SIGKILL);
+	waitpid(serverPid, NULL, 0);
+	std::fflush(stdout);
+	_exit(healthy ? 0 : 1);  // skip tearing down 100k sockets
+}
@@ -0,0 +1,78 @@
+//
+// detail/atomic.hpp
+// ~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_DETAIL_ATOMIC_HPP
+#define BOOST_ASIO_SCTP_DETAIL_ATOMIC_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+namespace detail {
+namespace atomic {
+
+// Thin wrappers over the GCC __sync builtins, which are full barriers. They are
+// used for the handful of lock-free structures in the library, which only need
+// plain loads/stores of word-sized values ordered against each other.
+
+template <typename T>
+inline T load_acquire(const volatile T& v)
+{
+	T result = v;
+	__sync_synchronize();
+	return result;
+}
+
+template <typename T>
+inline void store_release(volatile T& v, T value)
+{
+	__sync_synchronize();
+	v = value;
+}
+
+template <typename T>
+inline T fetch_add(volatile T& v, T delta)
+{
+	return __sync_fetch_and_add(&v, delta);
+}
+
+template <typename T>
+inline T fetch_sub(volatile T& v, T delta)
+{
+	return __sync_fetch_and_sub(&v, delta);
+}
+
+template <typename T>
+inline bool compare_exchange(volatile T& v, T expected, T desired)
+{
+	return __sync_bool_compare_and_swap(&v, expected, desired);
+}
+
+template <typename T>
+inline T exchange(volatile T& v, T value)
+{
+	// __sync_lock_test_and_set is only an acquire barrier.
+	__sync_synchronize();
+	return __sync_lock_test_and_set(&v, value);
+}
+
+} // namespace atomic
+} // namespace detail
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_DETAIL_ATOMIC_HPP
@@ -0,0 +1,120 @@
+//
+// detail/bridge_transport.hpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_DETAIL_BRIDGE_TRANSPORT_HPP
+#define BOOST_ASIO_SCTP_DETAIL_BRIDGE_TRANSPORT_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio_sctp/detail/sctp_bridge.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+namespace detail {
+
+// A user-space transport behind bridged sockets (see sctp_bridge.hpp). The
+// socket services only ask it for new associations; accepted ones arrive by
+// the transport connecting to the acceptor's listener name.
+class bridge_transport
+	: private boost::noncopyable
+{
+public:
+	typedef boost::function<void (const boost::system::error_code&, int)> connect_handler;
+
+	/// The transport in use once sockets are bridged; null before.
+	static bridge_transport* active()
+	{
+		return slot();
+	}
+
+	/// Make transport the one used by bridged sockets.
+	static void activate(bridge_transport& transport)
+	{
+		slot() = &transport;
+	}
+
+	/// The name an acceptor for the given SCTP port binds its bridge socket to.
+	static socklen_t listener_name(unsigned short port, sockaddr_un& name)
+	{
+		return bridge_name::make(name, "listen", 0, port, 0);
+	}
+
+	/// Start an association; the handler is called, possibly from another thread, with the bridge descriptor.
+	virtual void async_connect(const sockaddr* remote, socklen_t length,
+		const connect_handler& handler) = 0;
+
+	/// Start an association and wait for it to be established.
+	int connect(const sockaddr* remote, socklen_t length, boost::system::error_code& ec)
+	{
+		connect_result result;
+		async_connect(remote, length,
+			boost::bind(&connect_result::complete, &result, _1, _2));
+		boost::mutex::scoped_lock lock(result.mutex);
+		while (!result.done)
+			result.condition.wait(lock);
+		ec = result.ec;
+		return result.fd;
+	}
+
+protected:
+	bridge_transport()
+	{
+	}
+
+	virtual ~bridge_transport()
+	{
+	}
+
+private:
+	struct connect_result
+	{
+		connect_result() : done(false), fd(-1) {}
+
+		void complete(const boost::system::error_code& e, int f)
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			ec = e;
+			fd = f;
+			done = true;
+			condition.notify_all();
+		}
+
+		boost::mutex mutex;
+		boost::condition_variable condition;
+		bool done;
+		boost::system::error_code ec;
+		int fd;
+	};
+
+	static bridge_transport*& slot()
+	{
+		static bridge_transport* transport = 0;
+		return transport;
+	}
+};
+
+} // namespace detail
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_DETAIL_BRIDGE_TRANSPORT_HPP
@@ -0,0 +1,117 @@
+//
+// detail/crc32c.hpp
+// ~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_DETAIL_CRC32C_HPP
+#define BOOST_ASIO_SCTP_DETAIL_CRC32C_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <cstring>
+#include <boost/cstdint.hpp>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) \
+	&& ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+# define BOOST_ASIO_SCTP_HAS_SSE42_CRC32C 1
+# include <nmmintrin.h>
+#endif
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+namespace detail {
+namespace crc32c {
+
+// CRC32c (Castagnoli), as used for the SCTP checksum (RFC 4960, appendix B).
+// The SSE4.2 crc32 instruction is used when the CPU has it, otherwise a
+// byte-at-a-time table.
+
+inline const boost::uint32_t* table()
+{
+	static boost::uint32_t t[256];
+	static volatile bool initialised = false;
+	if (!initialised)
+	{
+		for (boost::uint32_t i = 0; i < 256; ++i)
+		{
+			boost::uint32_t c = i;
+			for (int k = 0; k < 8; ++k)
+				c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : (c >> 1);
+			t[i] = c;
+		}
+		initialised = true;  // racing initialisers write identical values
+	}
+	return t;
+}
+
+inline boost::uint32_t update_table(boost::uint32_t crc, const unsigned char* p, std::size_t n)
+{
+	const boost::uint32_t* t = table();
+	while (n--)
+		crc = t[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+#if defined(BOOST_ASIO_SCTP_HAS_SSE42_CRC32C)
+__attribute__((target("sse4.2")))
+inline boost::uint32_t update_sse42(boost::uint32_t crc, const unsigned char* p, std::size_t n)
+{
+#if defined(__x86_64__)
+	boost::uint64_t crc64 = crc;
+	for (; n >= 8; n -= 8, p += 8)
+	{
+		boost::uint64_t v;
+		std::memcpy(&v, p, sizeof(v));
+		crc64 = _mm_crc32_u64(crc64, v);
+	}
+	crc = static_cast<boost::uint32_t>(crc64);
+#endif
+	for (; n >= 4; n -= 4, p += 4)
+	{
+		boost::uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		crc = _mm_crc32_u32(crc, v);
+	}
+	while (n--)
+		crc = _mm_crc32_u8(crc, *p++);
+	return crc;
+}
+
+inline bool have_sse42()
+{
+	static const bool supported = __builtin_cpu_supports("sse4.2");
+	return supported;
+}
+#endif // defined(BOOST_ASIO_SCTP_HAS_SSE42_CRC32C)
+
+/// CRC32c of a buffer.
+inline boost::uint32_t compute(const void* data, std::size_t size)
+{
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	boost::uint32_t crc = 0xffffffffu;
+#if defined(BOOST_ASIO_SCTP_HAS_SSE42_CRC32C)
+	if (have_sse42())
+		return ~update_sse42(crc, p, size);
+#endif
+	return ~update_table(crc, p, size);
+}
+
+} // namespace crc32c
+} // namespace detail
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_DETAIL_CRC32C_HPP
@@ -16,11 +16,18 @@
 #pragma once
 #endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
 
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
 #include <boost/asio.hpp>
 #include <boost/asio/detail/socket_ops.hpp>
 #include <boost/asio/detail/buffer_sequence_adapter.hpp>
 #include <boost/asio/error.hpp>
 #include <boost/asio/detail/socket_types.hpp>
+#include <boost/asio_sctp/detail/sctp_bridge.hpp>
+#include <boost/asio_sctp/detail/sctp_socket_types.hpp>
 
 #include <boost/asio/detail/push_options.hpp>
 
@@ -212,6 +219,368 @@ int recvmsg(boost::asio::detail::socket_type s,
 	return result;
 }
 
+inline int call_send_one(boost::asio::detail::socket_type s,
+	const buf* bufs, size_t count, uint16_t stream_no, uint32_t ppid,
+	uint16_t sinfo_flags, uint32_t time_to_live, int msg_flags)
+{
+	char control[CMSG_SPACE(sizeof(struct sctp_sndrcvinfo))];
+	std::memset(control, 0, sizeof(control));
+
+	msghdr msg = msghdr();
+	msg.msg_iov = const_cast<buf*>(bufs);
+	msg.msg_iovlen = count;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = IPPROTO_SCTP;
+	cmsg->cmsg_type = SCTP_SNDRCV;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(struct sctp_sndrcvinfo));
+	struct sctp_sndrcvinfo* sinfo = (struct sctp_sndrcvinfo*)CMSG_DATA(cmsg);
+	sinfo->sinfo_stream = stream_no;
+	sinfo->sinfo_ppid = ppid;
+	sinfo->sinfo_flags = sinfo_flags;
+	sinfo->sinfo_timetolive = time_to_live;
+
+	return ::sendmsg(s, &msg, msg_flags | MSG_NOSIGNAL);
+}
+
+// Whether a message of total bytes fits in the bridge's send buffer now. One
+// bigger than the whole buffer is let through once the buffer is empty.
+inline bool bridge_has_room(boost::asio::detail::socket_type s, size_t total)
+{
+	enum { piece_overhead = 1024 };  // roughly the kernel's own cost of each piece
+	int queued = 0;
+	int size = 0;
+	socklen_t length = sizeof(size);
+	if (::ioctl(s, SIOCOUTQ, &queued) != 0
+		|| ::getsockopt(s, SOL_SOCKET, SO_SNDBUF, &size, &length) != 0)
+		return true;  // cannot tell; the pieces wait for room as they go
+	size_t pieces = total / BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE + 1;
+	return queued == 0 || queued + total + pieces * (piece_overhead + sizeof(bridge_header))
+		<= static_cast<size_t>(size);
+}
+
+// Send a message across a bridge in pieces of at most BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE.
+// Once the first piece is accepted the rest are sent even if that means waiting,
+// so that a would_block never leaves half a message behind. A non-blocking
+// caller gets would_block, with nothing sent, unless the whole message fits in
+// the bridge; the engine reads the rest of a message it has begun whatever its
+// window, so any wait for the remaining pieces is on the engine thread, never
+// on the network.
+inline int call_bridge_send_one(boost::asio::detail::socket_type s,
+	const buf* bufs, size_t count, uint16_t stream_no, uint32_t ppid,
+	uint16_t sinfo_flags, uint32_t time_to_live, int msg_flags)
+{
+	enum { max_pieces = 64 };
+	bridge_header header = bridge_header();
+	header.stream = stream_no;
+	header.sinfo_flags = sinfo_flags;
+	header.ppid = ppid;
+	header.time_to_live = time_to_live;
+
+	size_t total = 0;
+	for (size_t i = 0; i < count; ++i)
+		total += bufs[i].iov_len;
+
+	if (total > BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE
+		&& ((msg_flags & MSG_DONTWAIT) || (::fcntl(s, F_GETFL) & O_NONBLOCK))
+		&& !bridge_has_room(s, total))
+	{
+		errno = EAGAIN;
+		return -1;
+	}
+
+	size_t sent = 0;
+	size_t index = 0;
+	size_t offset = 0;
+	do
+	{
+		buf iov[max_pieces + 1];
+		iov[0].iov_base = &header;
+		iov[0].iov_len = sizeof(header);
+		size_t n = 1;
+		size_t piece = 0;
+		while (index < count && n <= max_pieces && piece < BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE)
+		{
+			size_t length = bufs[index].iov_len - offset;
+			if (length > BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE - piece)
+				length = BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE - piece;
+			iov[n].iov_base = static_cast<char*>(bufs[index].iov_base) + offset;
+			iov[n].iov_len = length;
+			++n;
+			piece += length;
+			offset += length;
+			if (offset == bufs[index].iov_len)
+			{
+				++index;
+				offset = 0;
+			}
+		}
+		header.flags = (sent + piece == total) ? bridge_header::end_of_record : 0;
+
+		msghdr msg = msghdr();
+		msg.msg_iov = iov;
+		msg.msg_iovlen = n;
+		int result;
+		while ((result = ::sendmsg(s, &msg, (sent ? 0 : msg_flags) | MSG_NOSIGNAL)) < 0
+			&& sent && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		{
+			pollfd pfd = { s, POLLOUT, 0 };
+			::poll(&pfd, 1, -1);
+		}
+		if (result < 0)
+			return result;
+		sent += piece;
+	}
+	while (sent < total);
+	return static_cast<int>(sent);
+}
+
+int send_one(boost::asio::detail::socket_type s, const buf* bufs, size_t count,
+	uint16_t stream_no, uint32_t ppid, uint16_t sinfo_flags, uint32_t time_to_live,
+	int msg_flags, boost::system::error_code& ec)
+{
+	if (s == invalid_socket)
+	{
+		ec = boost::asio::error::bad_descriptor;
+		return socket_error_retval;
+	}
+
+	clear_last_error();
+	int result = error_wrapper(bridged()
+		? call_bridge_send_one(s, bufs, count, stream_no, ppid, sinfo_flags, time_to_live, msg_flags)
+		: call_send_one(s, bufs, count, stream_no, ppid, sinfo_flags, time_to_live, msg_flags), ec);
+	if (result >= 0)
+		ec = boost::system::error_code();
+	return result;
+}
+
+// Pick up the SO_TIMESTAMPNS receive time, if the option is set.
+inline void read_timestamp(const cmsghdr* cmsg, sctp_receive_info& info)
+{
+	if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+	{
+		struct timespec ts;
+		std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+		info.timestamp_ns = boost::uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+	}
+}
+
+inline int call_recv_one(boost::asio::detail::socket_type s,
+	buf* bufs, size_t count, int in_flags, sctp_receive_info& info)
+{
+	char control[CMSG_SPACE(sizeof(struct sctp_sndrcvinfo))
+		+ CMSG_SPACE(sizeof(struct timespec))];
+
+	msghdr msg = msghdr();
+	msg.msg_iov = bufs;
+	msg.msg_iovlen = count;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	int result = ::recvmsg(s, &msg, in_flags);
+	if (result < 0)
+		return result;
+
+	info.msg_flags = msg.msg_flags;
+	for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if (cmsg->cmsg_level == IPPROTO_SCTP && cmsg->cmsg_type == SCTP_SNDRCV)
+		{
+			const struct sctp_sndrcvinfo* sinfo = (const struct sctp_sndrcvinfo*)CMSG_DATA(cmsg);
+			info.stream = sinfo->sinfo_stream;
+			info.ppid = sinfo->sinfo_ppid;
+			info.assoc_id = sinfo->sinfo_assoc_id;
+			info.sinfo_flags = sinfo->sinfo_flags;
+		}
+		read_timestamp(cmsg, info);
+	}
+	return result;
+}
+
+inline int call_bridge_recv_one(boost::asio::detail::socket_type s,
+	buf* bufs, size_t count, int in_flags, sctp_receive_info& info)
+{
+	enum { max_buffers = 64 };
+	bridge_header header;
+	buf iov[max_buffers + 1];
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	size_t n = count < max_buffers ? count : max_buffers;
+	for (size_t i = 0; i < n; ++i)
+		iov[i + 1] = bufs[i];
+
+	char control[CMSG_SPACE(sizeof(struct timespec))];
+	msghdr msg = msghdr();
+	msg.msg_iov = iov;
+	msg.msg_iovlen = n + 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	int result = ::recvmsg(s, &msg, in_flags);
+	if (result <= 0)
+		return result;  // 0 when the association has been shut down
+	if (result < static_cast<int>(sizeof(header)) || (msg.msg_flags & MSG_TRUNC))
+	{
+		errno = EMSGSIZE;  // the buffers must hold at least one piece
+		return -1;
+	}
+
+	info.stream = header.stream;
+	info.ppid = header.ppid;
+	info.sinfo_flags = header.sinfo_flags;
+	info.msg_flags = (msg.msg_flags & ~MSG_EOR)
+		| ((header.flags & bridge_header::end_of_record) ? MSG_EOR : 0)
+		| ((header.flags & bridge_header::notification) ? MSG_NOTIFICATION : 0);
+	for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		read_timestamp(cmsg, info);  // when the transport queued the piece
+	return result - static_cast<int>(sizeof(header));
+}
+
+int recv_one(boost::asio::detail::socket_type s, buf* bufs, size_t count,
+	int in_flags, sctp_receive_info& info, boost::system::error_code& ec)
+{
+	if (s == invalid_socket)
+	{
+		ec = boost::asio::error::bad_descriptor;
+		return socket_error_retval;
+	}
+
+	std::memset(&info, 0, sizeof(info));
+	clear_last_error();
+	int result = error_wrapper(bridged()
+		? call_bridge_recv_one(s, bufs, count, in_flags, info)
+		: call_recv_one(s, bufs, count, in_flags, info), ec);
+	if (result >= 0)
+		ec = boost::system::error_code();
+	return result;
+}
+
+inline boost::asio::detail::socket_type call_peeloff(
+	boost::asio::detail::socket_type s, sctp_assoc_t assoc_id)
+{
+#if defined(HAVE_SCTP_PEELOFF_FLAGS) && defined(SOCK_CLOEXEC)
+	return ::sctp_peeloff_flags(s, assoc_id, SOCK_CLOEXEC);
+#else
+	int new_s = ::sctp_peeloff(s, assoc_id);
+	if (new_s >= 0)
+		::fcntl(new_s, F_SETFD, FD_CLOEXEC);
+	return new_s;
+#endif
+}
+
+boost::asio::detail::socket_type peeloff(boost::asio::detail::socket_type s,
+	sctp_assoc_t assoc_id, boost::system::error_code& ec)
+{
+	if (s == invalid_socket)
+	{
+		ec = boost::asio::error::bad_descriptor;
+		return invalid_socket;
+	}
+
+	clear_last_error();
+	boost::asio::detail::socket_type new_s = error_wrapper(call_peeloff(s, assoc_id), ec);
+	if (new_s != invalid_socket)
+		ec = boost::system::error_code();
+	return new_s;
+}
+
+// Close with a zero linger time, so the association is aborted instead of shut
+// down; nothing more is exchanged with the peer and no state is kept behind.
+int abort_close(boost::asio::detail::socket_type s, boost::system::error_code& ec)
+{
+	if (s == invalid_socket)
+	{
+		ec = boost::asio::error::bad_descriptor;
+		return socket_error_retval;
+	}
+
+	::linger opt;
+	opt.l_onoff = 1;
+	opt.l_linger = 0;
+	::setsockopt(s, SOL_SOCKET, SO_LINGER, &opt, sizeof(opt));
+	clear_last_error();
+	return error_wrapper(::close(s), ec);
+}
+
+// Set once a user-space transport has been selected; from then on every SCTP
+// socket is a bridge to it.
+inline volatile bool& bridged_flag()
+{
+	static volatile bool flag = false;
+	return flag;
+}
+
+bool bridged()
+{
+	return bridged_flag();
+}
+
+void set_bridged(bool bridged)
+{
+	bridged_flag() = bridged;
+}
+
+// The transport's end of a connected bridge carries the association's name;
+// a listening bridge socket is bound to its port's name itself.
+inline int bridge_name_of(boost::asio::detail::socket_type s, bool peer,
+	sockaddr_storage& local, sockaddr_storage& remote,
+	boost::system::error_code& ec)
+{
+	if (s == invalid_socket)
+	{
+		ec = boost::asio::error::bad_descriptor;
+		return socket_error_retval;
+	}
+
+	sockaddr_un name;
+	socklen_t length = sizeof(name);
+	clear_last_error();
+	int result = error_wrapper(peer
+		? ::getpeername(s, reinterpret_cast<sockaddr*>(&name), &length)
+		: ::getsockname(s, reinterpret_cast<sockaddr*>(&name), &length), ec);
+	if (result != 0)
+		return result;
+	if (!bridge_name::parse(name, length, local, remote))
+	{
+		ec = boost::asio::error::not_connected;
+		return socket_error_retval;
+	}
+	ec = boost::system::error_code();
+	return 0;
+}
+
+int bridge_endpoints(boost::asio::detail::socket_type s,
+	sockaddr_storage& local, sockaddr_storage& remote,
+	boost::system::error_code& ec)
+{
+	return bridge_name_of(s, true, local, remote, ec);
+}
+
+int bridge_listen_endpoint(boost::asio::detail::socket_type s,
+	sockaddr_storage& local, boost::system::error_code& ec)
+{
+	sockaddr_storage remote;
+	return bridge_name_of(s, false, local, remote, ec);
+}
+
+// Kernels before 4.17 reject MSG_MORE on SCTP sockets; once seen, stop asking.
+inline volatile bool& msg_more_flag()
+{
+	static volatile bool supported = true;
+	return supported;
+}
+
+bool msg_more_supported()
+{
+	return msg_more_flag();
+}
+
+void set_msg_more_supported(bool supported)
+{
+	msg_more_flag() = supported;
+}
+
 } // namespace sctp_socket_ops
 } // namespace detail
 } // namespace asio_sctp
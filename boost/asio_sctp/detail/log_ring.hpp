@@ -0,0 +1,132 @@
+//
+// detail/log_ring.hpp
+// ~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_DETAIL_LOG_RING_HPP
+#define BOOST_ASIO_SCTP_DETAIL_LOG_RING_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <ctime>
+#include <boost/noncopyable.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/asio_sctp/detail/atomic.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+#ifndef BOOST_ASIO_SCTP_LOG_RING_SIZE
+#define BOOST_ASIO_SCTP_LOG_RING_SIZE 1024
+#endif
+
+namespace boost {
+namespace asio_sctp {
+namespace detail {
+
+// One unformatted log record. The format string must be a literal; integer
+// arguments are stored by value and string arguments are copied into text.
+struct log_record
+{
+	enum { max_args = 4, text_size = 64 };
+	enum arg_type { integer_arg, unsigned_arg, string_arg };
+
+	int level;
+	struct timespec time;
+	const char* format;
+	unsigned char arg_count;
+	unsigned char types[max_args];
+	union
+	{
+		long long integer;
+		unsigned long long unsigned_integer;
+		std::size_t text_offset;
+	} args[max_args];
+	char text[text_size];
+};
+
+// Single-producer/single-consumer ring of log records. The producer is the
+// thread which owns the ring; the consumer is the logger's output thread.
+class log_ring
+	: private boost::noncopyable
+{
+public:
+	enum { capacity = BOOST_ASIO_SCTP_LOG_RING_SIZE };
+	BOOST_STATIC_ASSERT((capacity & (capacity - 1)) == 0);
+
+	log_ring()
+		: head_(0), tail_(0), dropped_(0), closed_(false)
+	{
+	}
+
+	// Producer: get the next free slot, or 0 if the ring is full.
+	log_record* reserve()
+	{
+		std::size_t tail = atomic::load_acquire(tail_);
+		if (head_ - tail == capacity)
+		{
+			++dropped_;
+			return 0;
+		}
+		return &records_[head_ & (capacity - 1)];
+	}
+
+	// Producer: publish the slot returned by reserve().
+	void commit()
+	{
+		atomic::store_release(head_, head_ + 1);
+	}
+
+	// Producer: the owning thread has exited.
+	void close()
+	{
+		atomic::store_release(closed_, true);
+	}
+
+	// Consumer: pass each pending record to the handler, then free the slots.
+	template <typename Handler>
+	std::size_t consume(Handler& handler)
+	{
+		std::size_t head = atomic::load_acquire(head_);
+		std::size_t count = head - tail_;
+		for (std::size_t t = tail_; t != head; ++t)
+			handler(records_[t & (capacity - 1)]);
+		atomic::store_release(tail_, head);
+		return count;
+	}
+
+	// Number of records discarded because the ring was full.
+	std::size_t dropped() const
+	{
+		return atomic::load_acquire(dropped_);
+	}
+
+	bool closed() const
+	{
+		return atomic::load_acquire(closed_);
+	}
+
+private:
+	log_record records_[capacity];
+	volatile std::size_t head_;
+	char pad_[64];  // keep producer and consumer indices on separate cache lines
+	volatile std::size_t tail_;
+	volatile std::size_t dropped_;
+	volatile bool closed_;
+};
+
+} // namespace detail
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_DETAIL_LOG_RING_HPP
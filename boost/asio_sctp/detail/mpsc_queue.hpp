@@ -0,0 +1,98 @@
+//
+// detail/mpsc_queue.hpp
+// ~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_DETAIL_MPSC_QUEUE_HPP
+#define BOOST_ASIO_SCTP_DETAIL_MPSC_QUEUE_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <boost/noncopyable.hpp>
+#include <boost/asio_sctp/detail/atomic.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+namespace detail {
+
+struct mpsc_node
+{
+	mpsc_node* volatile next;
+};
+
+// Intrusive multi-producer, single-consumer queue (D. Vyukov's). push() is
+// one atomic exchange and never waits, whatever the other threads are doing;
+// nodes come out in the order their exchanges took effect. pop() must only be
+// called by one thread at a time. It can miss a node whose push() is still
+// between its two steps, so a producer which needs the consumer woken should
+// do so after push() returns.
+class mpsc_queue
+	: private boost::noncopyable
+{
+public:
+	mpsc_queue()
+		: head_(&stub_), tail_(&stub_)
+	{
+		stub_.next = 0;
+	}
+
+	void push(mpsc_node* n)
+	{
+		n->next = 0;
+		mpsc_node* prev = atomic::exchange(head_, n);
+		atomic::store_release(prev->next, n);
+	}
+
+	// The oldest node, or null if there is none (or it is not yet linked in).
+	mpsc_node* pop()
+	{
+		mpsc_node* tail = tail_;
+		mpsc_node* next = atomic::load_acquire(tail->next);
+		if (tail == &stub_)
+		{
+			if (!next)
+				return 0;
+			tail_ = next;
+			tail = next;
+			next = atomic::load_acquire(tail->next);
+		}
+		if (next)
+		{
+			tail_ = next;
+			return tail;
+		}
+		if (tail != atomic::load_acquire(head_))
+			return 0;  // a push is half done
+		push(&stub_);  // so that tail can be unlinked
+		next = atomic::load_acquire(tail->next);
+		if (next)
+		{
+			tail_ = next;
+			return tail;
+		}
+		return 0;
+	}
+
+private:
+	mpsc_node stub_;
+	mpsc_node* volatile head_;  // last pushed; producers
+	mpsc_node* tail_;  // next to pop; consumer
+};
+
+} // namespace detail
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_DETAIL_MPSC_QUEUE_HPP
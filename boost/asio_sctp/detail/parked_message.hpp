@@ -0,0 +1,104 @@
+//
+// detail/parked_message.hpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_DETAIL_PARKED_MESSAGE_HPP
+#define BOOST_ASIO_SCTP_DETAIL_PARKED_MESSAGE_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+namespace detail {
+
+// A copy of a received message, kept until it can be handled.
+struct parked_message
+{
+	std::vector<unsigned char>* data;
+	uint16_t stream;
+	uint32_t ppid;
+	sctp_assoc_t assoc_id;
+	int flags;
+	boost::uint64_t timestamp_ns;
+
+	// The message as handed to a handler; valid until the copy is released.
+	sctp_message view() const
+	{
+		sctp_message msg;
+		msg.data = data->empty() ? 0 : &(*data)[0];
+		msg.size = data->size();
+		msg.stream = stream;
+		msg.ppid = ppid;
+		msg.assoc_id = assoc_id;
+		msg.flags = flags;
+		msg.timestamp_ns = timestamp_ns;
+		return msg;
+	}
+};
+
+// Message buffers are recycled so a steady flow does not allocate. Not
+// thread safe; the owner serialises the calls.
+class parked_message_pool
+	: private boost::noncopyable
+{
+public:
+	~parked_message_pool()
+	{
+		for (std::size_t i = 0; i < idle_.size(); ++i)
+			delete idle_[i];
+	}
+
+	// Copies msg into a recycled buffer.
+	parked_message park(const sctp_message& msg)
+	{
+		parked_message p;
+		if (idle_.empty())
+			p.data = new std::vector<unsigned char>;
+		else
+		{
+			p.data = idle_.back();
+			idle_.pop_back();
+		}
+		p.data->assign(msg.data, msg.data + msg.size);
+		p.stream = msg.stream;
+		p.ppid = msg.ppid;
+		p.assoc_id = msg.assoc_id;
+		p.flags = msg.flags;
+		p.timestamp_ns = msg.timestamp_ns;
+		return p;
+	}
+
+	// Takes back the buffer of a copy which has been handled or discarded.
+	void release(const parked_message& p)
+	{
+		idle_.push_back(p.data);
+	}
+
+private:
+	std::vector<std::vector<unsigned char>*> idle_;
+};
+
+} // namespace detail
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_DETAIL_PARKED_MESSAGE_HPP
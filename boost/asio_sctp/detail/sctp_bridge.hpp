@@ -0,0 +1,143 @@
+//
+// detail/sctp_bridge.hpp
+// ~~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_DETAIL_SCTP_BRIDGE_HPP
+#define BOOST_ASIO_SCTP_DETAIL_SCTP_BRIDGE_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <boost/cstdint.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+/// Largest piece of a user message passed across the bridge in one record.
+#ifndef BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE
+#define BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE 65536
+#endif
+
+namespace boost {
+namespace asio_sctp {
+namespace detail {
+
+// With a user-space transport the application's socket is one end of an
+// AF_UNIX SOCK_SEQPACKET pair, the other end belonging to the transport. Each
+// record is a bridge_header followed by all or part of one user message; the
+// piece which ends a message carries end_of_record. The transport binds its
+// end to an abstract name describing the association, so the application side
+// can read its endpoints with getpeername(). A transport may pass an SCTP
+// notification as a record carrying notification; the application never does.
+
+struct bridge_header
+{
+	enum { end_of_record = 0x1, notification = 0x2 };
+
+	boost::uint16_t stream;
+	boost::uint16_t sinfo_flags;
+	boost::uint32_t ppid;
+	boost::uint32_t time_to_live;
+	boost::uint16_t flags;
+	boost::uint16_t reserved;
+};
+
+namespace bridge_name {
+
+// Abstract socket names, "\0asio-sctp/<pid>/<kind>/<serial>/<local port>/<address>/<port>".
+
+inline socklen_t make(sockaddr_un& name, const char* kind, unsigned long serial,
+	unsigned short local_port, const sockaddr* remote)
+{
+	char address[INET6_ADDRSTRLEN] = "-";
+	unsigned short remote_port = 0;
+	if (remote && remote->sa_family == AF_INET)
+	{
+		const sockaddr_in* in = reinterpret_cast<const sockaddr_in*>(remote);
+		::inet_ntop(AF_INET, &in->sin_addr, address, sizeof(address));
+		remote_port = ntohs(in->sin_port);
+	}
+	else if (remote && remote->sa_family == AF_INET6)
+	{
+		const sockaddr_in6* in6 = reinterpret_cast<const sockaddr_in6*>(remote);
+		::inet_ntop(AF_INET6, &in6->sin6_addr, address, sizeof(address));
+		remote_port = ntohs(in6->sin6_port);
+	}
+	std::memset(&name, 0, sizeof(name));
+	name.sun_family = AF_UNIX;
+	int n = std::snprintf(name.sun_path + 1, sizeof(name.sun_path) - 1,
+		"asio-sctp/%ld/%s/%lu/%u/%s/%u", static_cast<long>(::getpid()), kind,
+		serial, local_port, address, remote_port);
+	return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + n);
+}
+
+// Parse a name; the remote address is returned with remote_port, and an
+// unspecified address of the same family with local_port.
+inline bool parse(const sockaddr_un& name, socklen_t length,
+	sockaddr_storage& local, sockaddr_storage& remote)
+{
+	std::size_t path_length = length - offsetof(sockaddr_un, sun_path);
+	if (length <= offsetof(sockaddr_un, sun_path) + 1 || name.sun_path[0] != '\0'
+		|| path_length >= sizeof(name.sun_path))
+		return false;
+	char path[sizeof(name.sun_path)];
+	std::memcpy(path, name.sun_path + 1, path_length - 1);
+	path[path_length - 1] = '\0';
+
+	long pid;
+	char kind[16];
+	unsigned long serial;
+	unsigned int local_port, remote_port;
+	char address[INET6_ADDRSTRLEN + 1];
+	if (std::sscanf(path, "asio-sctp/%ld/%15[^/]/%lu/%u/%46[^/]/%u",
+		&pid, kind, &serial, &local_port, address, &remote_port) != 6)
+		return false;
+
+	std::memset(&local, 0, sizeof(local));
+	std::memset(&remote, 0, sizeof(remote));
+	sockaddr_in6* in6 = reinterpret_cast<sockaddr_in6*>(&remote);
+	sockaddr_in* in = reinterpret_cast<sockaddr_in*>(&remote);
+	if (::inet_pton(AF_INET6, address, &in6->sin6_addr) == 1)
+	{
+		in6->sin6_family = AF_INET6;
+		in6->sin6_port = htons(remote_port);
+		reinterpret_cast<sockaddr_in6*>(&local)->sin6_family = AF_INET6;
+		reinterpret_cast<sockaddr_in6*>(&local)->sin6_port = htons(local_port);
+	}
+	else
+	{
+		if (::inet_pton(AF_INET, address, &in->sin_addr) == 1)
+		{
+			in->sin_family = AF_INET;
+			in->sin_port = htons(remote_port);
+		}
+		reinterpret_cast<sockaddr_in*>(&local)->sin_family = AF_INET;
+		reinterpret_cast<sockaddr_in*>(&local)->sin_port = htons(local_port);
+	}
+	return true;
+}
+
+} // namespace bridge_name
+} // namespace detail
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_DETAIL_SCTP_BRIDGE_HPP
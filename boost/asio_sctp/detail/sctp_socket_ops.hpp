@@ -21,6 +21,8 @@
 #include <boost/asio/detail/buffer_sequence_adapter.hpp>
 #include <boost/asio/error.hpp>
 #include <boost/asio/detail/socket_types.hpp>
+#include <boost/asio_sctp/detail/sctp_socket_types.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
 
 #include <boost/asio/detail/push_options.hpp>
 
@@ -67,6 +69,37 @@ BOOST_ASIO_DECL int recvmsg(boost::asio::detail::socket_type s,
 	const boost::asio::detail::socket_addr_type* pAddr,
 	uint16_t& stream_no, uint32_t& ppid, int* flags, boost::system::error_code& ec);
 
+BOOST_ASIO_DECL int send_one(boost::asio::detail::socket_type s,
+	const buf* bufs, size_t count, uint16_t stream_no, uint32_t ppid,
+	uint16_t sinfo_flags, uint32_t time_to_live, int msg_flags,
+	boost::system::error_code& ec);
+
+BOOST_ASIO_DECL int recv_one(boost::asio::detail::socket_type s,
+	buf* bufs, size_t count, int in_flags, sctp_receive_info& info,
+	boost::system::error_code& ec);
+
+BOOST_ASIO_DECL boost::asio::detail::socket_type peeloff(
+	boost::asio::detail::socket_type s, sctp_assoc_t assoc_id,
+	boost::system::error_code& ec);
+
+BOOST_ASIO_DECL int abort_close(boost::asio::detail::socket_type s,
+	boost::system::error_code& ec);
+
+BOOST_ASIO_DECL bool bridged();
+
+BOOST_ASIO_DECL void set_bridged(bool bridged);
+
+BOOST_ASIO_DECL int bridge_endpoints(boost::asio::detail::socket_type s,
+	sockaddr_storage& local, sockaddr_storage& remote,
+	boost::system::error_code& ec);
+
+BOOST_ASIO_DECL int bridge_listen_endpoint(boost::asio::detail::socket_type s,
+	sockaddr_storage& local, boost::system::error_code& ec);
+
+BOOST_ASIO_DECL bool msg_more_supported();
+
+BOOST_ASIO_DECL void set_msg_more_supported(bool supported);
+
 } // namespace sctp_socket_ops
 } // namespace detail
 } // namespace asio_sctp
@@ -74,4 +107,8 @@ BOOST_ASIO_DECL int recvmsg(boost::asio::detail::socket_type s,
 
 #include <boost/asio/detail/pop_options.hpp>
 
+#if defined(BOOST_ASIO_HEADER_ONLY)
+# include <boost/asio_sctp/detail/impl/sctp_socket_ops.ipp>
+#endif // defined(BOOST_ASIO_HEADER_ONLY)
+
 #endif // BOOST_ASIO_SCTP_DETAIL_SCTP_SOCKET_OPS_HPP
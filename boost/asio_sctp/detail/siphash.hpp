@@ -0,0 +1,95 @@
+//
+// detail/siphash.hpp
+// ~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_DETAIL_SIPHASH_HPP
+#define BOOST_ASIO_SCTP_DETAIL_SIPHASH_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+namespace detail {
+namespace siphash {
+
+// SipHash-2-4 (Aumasson and Bernstein), a keyed MAC with a 128-bit key and
+// a 64-bit tag. Unlike a CRC it cannot be forged without the key, however
+// many tagged messages an attacker has seen.
+
+inline boost::uint64_t rotl(boost::uint64_t x, int b)
+{
+	return (x << b) | (x >> (64 - b));
+}
+
+inline void round(boost::uint64_t& v0, boost::uint64_t& v1, boost::uint64_t& v2, boost::uint64_t& v3)
+{
+	v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+	v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+	v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+	v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+}
+
+// Little-endian, as the algorithm is defined, whatever the host.
+inline boost::uint64_t get64(const unsigned char* p, std::size_t n = 8)
+{
+	boost::uint64_t v = 0;
+	for (std::size_t i = 0; i < n; ++i)
+		v |= boost::uint64_t(p[i]) << (8 * i);
+	return v;
+}
+
+// The tag of n bytes at p under the 16-byte key.
+inline boost::uint64_t compute(const unsigned char key[16], const unsigned char* p, std::size_t n)
+{
+	boost::uint64_t k0 = get64(key);
+	boost::uint64_t k1 = get64(key + 8);
+	boost::uint64_t v0 = k0 ^ 0x736f6d6570736575ull;
+	boost::uint64_t v1 = k1 ^ 0x646f72616e646f6dull;
+	boost::uint64_t v2 = k0 ^ 0x6c7967656e657261ull;
+	boost::uint64_t v3 = k1 ^ 0x7465646279746573ull;
+
+	std::size_t left = n;
+	for (; left >= 8; left -= 8, p += 8)
+	{
+		boost::uint64_t m = get64(p);
+		v3 ^= m;
+		round(v0, v1, v2, v3);
+		round(v0, v1, v2, v3);
+		v0 ^= m;
+	}
+	boost::uint64_t last = (boost::uint64_t(n) << 56) | get64(p, left);
+	v3 ^= last;
+	round(v0, v1, v2, v3);
+	round(v0, v1, v2, v3);
+	v0 ^= last;
+
+	v2 ^= 0xff;
+	round(v0, v1, v2, v3);
+	round(v0, v1, v2, v3);
+	round(v0, v1, v2, v3);
+	round(v0, v1, v2, v3);
+	return v0 ^ v1 ^ v2 ^ v3;
+}
+
+} // namespace siphash
+} // namespace detail
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_DETAIL_SIPHASH_HPP
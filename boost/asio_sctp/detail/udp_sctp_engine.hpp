@@ -0,0 +1,1709 @@
+//
+// detail/udp_sctp_engine.hpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_DETAIL_UDP_SCTP_ENGINE_HPP
+#define BOOST_ASIO_SCTP_DETAIL_UDP_SCTP_ENGINE_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio_sctp/detail/bridge_transport.hpp>
+#include <boost/asio_sctp/detail/crc32c.hpp>
+#include <boost/asio_sctp/detail/sctp_bridge.hpp>
+#include <boost/asio_sctp/detail/sctp_socket_types.hpp>
+#include <boost/asio_sctp/detail/siphash.hpp>
+#include <boost/asio_sctp/log.hpp>
+#include <boost/asio_sctp/sctp_clock.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+/// UDP port for SCTP encapsulation (RFC 6951).
+#ifndef BOOST_ASIO_SCTP_UDP_PORT
+#define BOOST_ASIO_SCTP_UDP_PORT 9899
+#endif
+
+/// Largest UDP payload sent; 1472 fits a 1500-byte Ethernet MTU.
+#ifndef BOOST_ASIO_SCTP_UDP_MTU
+#define BOOST_ASIO_SCTP_UDP_MTU 1472
+#endif
+
+/// Receive window advertised, and the most unacknowledged data sent, per association.
+#ifndef BOOST_ASIO_SCTP_UDP_WINDOW
+#define BOOST_ASIO_SCTP_UDP_WINDOW (1024 * 1024)
+#endif
+
+/// Lower bound on the retransmission timeout, in milliseconds (RFC 4960 RTO.Min).
+#ifndef BOOST_ASIO_SCTP_UDP_RTO_MIN
+#define BOOST_ASIO_SCTP_UDP_RTO_MIN 1000
+#endif
+
+/// Datagrams read or written per recvmmsg/sendmmsg call.
+#ifndef BOOST_ASIO_SCTP_UDP_BATCH
+#define BOOST_ASIO_SCTP_UDP_BATCH 32
+#endif
+
+namespace boost {
+namespace asio_sctp {
+namespace detail {
+
+namespace sctp_wire {
+
+// RFC 4960 chunk types.
+enum chunk_type
+{
+	data = 0, init = 1, init_ack = 2, sack = 3, heartbeat = 4,
+	heartbeat_ack = 5, abort = 6, shutdown = 7, shutdown_ack = 8,
+	cookie_echo = 10, cookie_ack = 11, shutdown_complete = 14
+};
+
+enum
+{
+	common_header_size = 12,
+	chunk_header_size = 4,
+	data_header_size = 16,
+	sack_size = 16,
+	init_size = 20,
+	state_cookie_param = 7,
+	data_end = 0x1, data_begin = 0x2, data_unordered = 0x4
+};
+
+inline void put16(unsigned char* p, boost::uint16_t v)
+{
+	p[0] = static_cast<unsigned char>(v >> 8);
+	p[1] = static_cast<unsigned char>(v);
+}
+
+inline void put32(unsigned char* p, boost::uint32_t v)
+{
+	p[0] = static_cast<unsigned char>(v >> 24);
+	p[1] = static_cast<unsigned char>(v >> 16);
+	p[2] = static_cast<unsigned char>(v >> 8);
+	p[3] = static_cast<unsigned char>(v);
+}
+
+inline boost::uint16_t get16(const unsigned char* p)
+{
+	return static_cast<boost::uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline boost::uint32_t get32(const unsigned char* p)
+{
+	return (boost::uint32_t(p[0]) << 24) | (boost::uint32_t(p[1]) << 16)
+		| (boost::uint32_t(p[2]) << 8) | boost::uint32_t(p[3]);
+}
+
+// TSN serial number arithmetic (RFC 1982).
+inline bool after(boost::uint32_t a, boost::uint32_t b)
+{
+	return static_cast<boost::int32_t>(a - b) > 0;
+}
+
+// The checksum is the CRC32c of the packet with the checksum field zeroed,
+// stored least significant byte first.
+inline void seal(unsigned char* packet, std::size_t size)
+{
+	std::memset(packet + 8, 0, 4);
+	boost::uint32_t crc = crc32c::compute(packet, size);
+	packet[8] = static_cast<unsigned char>(crc);
+	packet[9] = static_cast<unsigned char>(crc >> 8);
+	packet[10] = static_cast<unsigned char>(crc >> 16);
+	packet[11] = static_cast<unsigned char>(crc >> 24);
+}
+
+inline bool verify(unsigned char* packet, std::size_t size)
+{
+	unsigned char stored[4];
+	std::memcpy(stored, packet + 8, 4);
+	seal(packet, size);
+	return std::memcmp(stored, packet + 8, 4) == 0;
+}
+
+} // namespace sctp_wire
+
+/// User-space SCTP over UDP (RFC 6951).
+/**
+ * One thread owns a UDP socket and every association. Packets are read and
+ * written in batches with recvmmsg/sendmmsg; each association is exposed to
+ * the application as one end of an AF_UNIX SOCK_SEQPACKET pair (see
+ * sctp_bridge.hpp), so the socket services only swap the descriptor.
+ *
+ * The protocol is a deliberately small subset of RFC 4960: the four-way
+ * handshake with a stateless cookie, authenticated with SipHash and bound to
+ * the peer's address, and the RFC 4960 section 5.2 handling of INITs and
+ * COOKIE ECHOs for an existing association; DATA with
+ * fragmentation and per-stream sequence numbers; SACKs with gap blocks, fast
+ * retransmit and retransmission timeouts with RFC 4960 congestion control; heartbeat replies, ABORT and graceful
+ * shutdown. Only IPv4 peers are supported, over a single path, and PR-SCTP
+ * lifetimes are not applied.
+ */
+class udp_sctp_engine
+	: public bridge_transport
+{
+public:
+	static udp_sctp_engine& instance()
+	{
+		static udp_sctp_engine engine;
+		return engine;
+	}
+
+	/// Bind the UDP port and start the engine thread; remote_udp_port is used for new associations.
+	boost::system::error_code start(unsigned short local_udp_port,
+		unsigned short remote_udp_port, boost::system::error_code& ec)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (thread_)
+			return ec = boost::asio::error::already_started;
+		stopping_ = false;
+
+		udp_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (udp_ < 0)
+			return ec = last_error();
+		int size = 4 * 1024 * 1024;
+		::setsockopt(udp_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+		::setsockopt(udp_, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+		sockaddr_in local = sockaddr_in();
+		local.sin_family = AF_INET;
+		local.sin_port = htons(local_udp_port);
+		if (::bind(udp_, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0)
+		{
+			ec = last_error();
+			::close(udp_);
+			udp_ = -1;
+			return ec;
+		}
+		wake_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		remote_udp_port_ = remote_udp_port;
+		thread_.reset(new boost::thread(boost::bind(&udp_sctp_engine::run, this)));
+		return ec = boost::system::error_code();
+	}
+
+	/// Abort every association and stop the engine thread; start() may then be called again.
+	void stop()
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if (!thread_ || stopping_)
+				return;
+			stopping_ = true;
+		}
+		wake();
+		thread_->join();
+
+		boost::mutex::scoped_lock lock(mutex_);
+		thread_.reset();
+		::close(udp_);
+		::close(wake_);
+		udp_ = -1;
+		wake_ = -1;
+	}
+
+	/// Start an association; the handler is called from the engine thread with the bridge descriptor.
+	void async_connect(const sockaddr* remote, socklen_t length, const connect_handler& handler)
+	{
+		if (length < sizeof(sockaddr_in) || remote->sa_family != AF_INET)
+		{
+			handler(boost::asio::error::address_family_not_supported, -1);
+			return;
+		}
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if (!thread_ || stopping_)
+			{
+				lock.unlock();
+				handler(boost::asio::error::not_connected, -1);
+				return;
+			}
+			connect_request request;
+			std::memcpy(&request.remote, remote, sizeof(sockaddr_in));
+			request.handler = handler;
+			requests_.push_back(request);
+		}
+		wake();
+	}
+
+private:
+	enum state
+	{
+		cookie_wait,
+		cookie_echoed,
+		established,
+		shutdown_pending,  // the application has closed; draining sent data
+		shutdown_sent,
+		shutdown_received,  // the peer has shut down; draining our data before SHUTDOWN ACK
+		shutdown_ack_sent,
+		delivering,  // shut down; passing on what was received before closing the bridge
+		closed
+	};
+
+	struct connect_request
+	{
+		sockaddr_in remote;
+		connect_handler handler;
+	};
+
+	typedef std::map<boost::uint32_t, std::vector<unsigned char> > held_map;
+
+	struct out_chunk
+	{
+		boost::uint32_t tsn;
+		boost::uint16_t stream;
+		boost::uint16_t ssn;
+		boost::uint32_t ppid;
+		unsigned char flags;
+		bool gap_acked;  // reported received in a gap block
+		bool lost;  // to be sent again
+		int misses;  // gap reports of later chunks since it was last sent
+		boost::uint32_t sent_before;  // first TSN not yet sent when it was last sent
+		std::vector<unsigned char> data;
+	};
+
+	struct cookie
+	{
+		boost::uint32_t local_tag;
+		boost::uint32_t peer_tag;
+		boost::uint32_t local_tsn;
+		boost::uint32_t peer_tsn;
+		boost::uint32_t peer_rwnd;
+		boost::uint16_t local_port;
+		boost::uint16_t peer_port;
+		boost::uint32_t peer_address;  // the INIT's source, in network byte order
+		boost::uint16_t peer_udp_port;  // likewise
+		boost::uint32_t local_tie_tag;  // the tags of the association the INIT found, if any
+		boost::uint32_t peer_tie_tag;
+		boost::uint64_t created_ms;
+		boost::uint64_t mac;
+	};
+
+	struct association
+	{
+		association()
+			: state_(cookie_wait), local_tag(0), peer_tag(0), local_port(0),
+				peer_port(0), fd(-1), next_tsn(0), outstanding(0), queued_bytes(0),
+				peer_rwnd(BOOST_ASIO_SCTP_UDP_WINDOW), cwnd(initial_cwnd),
+				ssthresh(BOOST_ASIO_SCTP_UDP_WINDOW), in_message(false), message_ssn(0),
+				deadline(0), rto(initial_rto_ms), base_rto(initial_rto_ms), retries(0),
+				srtt(0), rttvar(0), timing(false), rtt_tsn(0), rtt_start(0),
+				recovering(false), recover_tsn(0), lost_count(0), cum_tsn(0), delivered_tsn(0), held_bytes(0),
+				sack_due(false), rx_blocked(false)
+		{
+			std::memset(&peer, 0, sizeof(peer));
+		}
+
+		state state_;
+		boost::uint32_t local_tag;
+		boost::uint32_t peer_tag;
+		boost::uint16_t local_port;
+		boost::uint16_t peer_port;
+		sockaddr_in peer;  // UDP address of the peer
+		int fd;
+		connect_handler on_connect;
+		std::vector<unsigned char> cookie_echo;
+
+		// Sending.
+		boost::uint32_t next_tsn;
+		std::deque<out_chunk*> sent;  // sent at least once, in TSN order
+		std::deque<out_chunk*> queued;  // never sent
+		std::size_t outstanding;  // in flight: sent and neither gap acknowledged nor lost
+		std::size_t queued_bytes;
+		std::size_t peer_rwnd;
+		std::size_t cwnd;
+		std::size_t ssthresh;
+		std::vector<boost::uint16_t> ssn;
+		bool in_message;
+		boost::uint16_t message_ssn;
+		boost::uint64_t deadline;
+		unsigned int rto;
+		unsigned int base_rto;  // rto before backoff
+		int retries;
+		unsigned int srtt;
+		unsigned int rttvar;
+		bool timing;
+		boost::uint32_t rtt_tsn;
+		boost::uint64_t rtt_start;
+		bool recovering;  // fast recovery until recover_tsn is acknowledged
+		boost::uint32_t recover_tsn;
+		std::size_t lost_count;
+
+		// Receiving.
+		boost::uint32_t cum_tsn;  // everything up to here has been received
+		boost::uint32_t delivered_tsn;  // and everything up to here passed on
+		held_map held;  // received, not yet passed on
+		std::size_t held_bytes;
+		bool sack_due;
+		bool rx_blocked;
+	};
+
+	struct packet
+	{
+		unsigned char data[BOOST_ASIO_SCTP_UDP_MTU];
+		std::size_t size;
+		sockaddr_in to;
+	};
+
+	enum
+	{
+		mtu = BOOST_ASIO_SCTP_UDP_MTU,
+		initial_cwnd = 4 * BOOST_ASIO_SCTP_UDP_MTU,
+		initial_rto_ms = 1000 > BOOST_ASIO_SCTP_UDP_RTO_MIN ? 1000 : BOOST_ASIO_SCTP_UDP_RTO_MIN,
+		min_rto_ms = BOOST_ASIO_SCTP_UDP_RTO_MIN,
+		max_rto_ms = 60000,
+		max_init_retransmits = 8,
+		max_retransmits = 10,
+		cookie_lifetime_ms = 60000,
+		cookie_size = 56,  // see write_cookie()
+		cookie_mac_offset = 48,
+		max_gap_blocks = 64,
+		max_chunk_data = BOOST_ASIO_SCTP_UDP_MTU - sctp_wire::common_header_size
+			- sctp_wire::sack_size - 4 - sctp_wire::data_header_size,
+		rx_buffer_size = 9216
+	};
+
+public:
+	/// An engine of its own, e.g. for a test to run both ends; instance() is the one the sockets use.
+	udp_sctp_engine()
+		: stopping_(false), udp_(-1), wake_(-1), remote_udp_port_(BOOST_ASIO_SCTP_UDP_PORT),
+			serial_(0), out_count_(0), out_(BOOST_ASIO_SCTP_UDP_BATCH),
+			rx_(BOOST_ASIO_SCTP_UDP_BATCH * rx_buffer_size),
+			app_buffer_(BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE)
+	{
+		random_ = sctp_clock::now_ms() ^ (boost::uint64_t(::getpid()) << 32);
+		int fd = ::open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+		if (fd >= 0)
+		{
+			boost::uint64_t seed;
+			if (::read(fd, &seed, sizeof(seed)) == sizeof(seed))
+				random_ ^= seed;
+			::close(fd);
+		}
+		random_ |= 1;
+		for (std::size_t i = 0; i < sizeof(secret_); i += 4)
+			sctp_wire::put32(secret_ + i, next_random());
+	}
+
+	// instance() is a static, so this runs at exit: the thread must not outlive it.
+	~udp_sctp_engine()
+	{
+		stop();
+		for (std::size_t i = 0; i < free_chunks_.size(); ++i)
+			delete free_chunks_[i];
+	}
+
+private:
+
+	static boost::system::error_code last_error()
+	{
+		return boost::system::error_code(errno, boost::asio::error::get_system_category());
+	}
+
+	boost::uint32_t next_random()
+	{
+		random_ ^= random_ << 13;
+		random_ ^= random_ >> 7;
+		random_ ^= random_ << 17;
+		boost::uint32_t r = static_cast<boost::uint32_t>(random_ >> 16);
+		return r ? r : 1;
+	}
+
+	void run()
+	{
+		std::vector<pollfd> fds;
+		std::vector<association*> polled;
+		for (;;)
+		{
+			fds.clear();
+			polled.clear();
+			pollfd udp = { udp_, POLLIN, 0 };
+			pollfd wake = { wake_, POLLIN, 0 };
+			fds.push_back(udp);
+			fds.push_back(wake);
+			boost::uint64_t now = sctp_clock::now_ms();
+			int timeout = -1;
+			for (association_map::iterator it = associations_.begin(); it != associations_.end(); ++it)
+			{
+				association& a = *it->second;
+				short events = 0;
+				if (accepting(a))
+					events |= POLLIN;
+				if (a.fd >= 0 && a.rx_blocked)
+					events |= POLLOUT;
+				if (events)
+				{
+					pollfd p = { a.fd, events, 0 };
+					fds.push_back(p);
+					polled.push_back(&a);
+				}
+				if (a.deadline)
+				{
+					int wait = a.deadline > now ? static_cast<int>(a.deadline - now) : 0;
+					if (timeout < 0 || wait < timeout)
+						timeout = wait;
+				}
+			}
+
+			::poll(&fds[0], fds.size(), timeout);
+
+			if (fds[1].revents & POLLIN)
+			{
+				boost::uint64_t count;
+				ssize_t ignored = ::read(wake_, &count, sizeof(count));
+				(void)ignored;
+				if (stop_requested())
+					break;
+				start_requested();
+			}
+			if (fds[0].revents & POLLIN)
+				receive_packets();
+			for (std::size_t i = 0; i < polled.size(); ++i)
+			{
+				short revents = fds[i + 2].revents;
+				if (revents & POLLOUT)
+				{
+					polled[i]->rx_blocked = false;
+					polled[i]->sack_due = polled[i]->state_ != delivering;  // window update
+					deliver_held(*polled[i]);
+					if (polled[i]->state_ == delivering && polled[i]->held.empty())
+						close(*polled[i]);
+				}
+				if (revents & (POLLIN | POLLHUP | POLLERR))
+					read_from_application(*polled[i]);
+			}
+			run_timers(sctp_clock::now_ms());
+			transmit_all();
+			reap();
+		}
+
+		// Stopping: fail the connects not yet started and abort the rest.
+		std::vector<connect_request> requests;
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			requests.swap(requests_);
+		}
+		for (std::size_t i = 0; i < requests.size(); ++i)
+			requests[i].handler(boost::asio::error::operation_aborted, -1);
+		for (association_map::iterator it = associations_.begin(); it != associations_.end(); ++it)
+		{
+			complete_connect(*it->second, boost::asio::error::operation_aborted, -1);
+			if (it->second->state_ != closed)
+				abort(*it->second);
+		}
+		flush();
+		reap();
+	}
+
+	void wake()
+	{
+		boost::uint64_t one = 1;
+		ssize_t ignored = ::write(wake_, &one, sizeof(one));
+		(void)ignored;
+	}
+
+	bool stop_requested()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return stopping_;
+	}
+
+	// Association setup.
+
+	void start_requested()
+	{
+		std::vector<connect_request> requests;
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			requests.swap(requests_);
+		}
+		for (std::size_t i = 0; i < requests.size(); ++i)
+		{
+			association* a = new association;
+			a->local_tag = unused_tag();
+			a->local_port = static_cast<boost::uint16_t>(49152 + next_random() % 16384);
+			a->peer_port = ntohs(requests[i].remote.sin_port);
+			a->peer = requests[i].remote;
+			a->peer.sin_port = htons(remote_udp_port_);
+			a->next_tsn = next_random();
+			a->on_connect = requests[i].handler;
+			associations_[a->local_tag] = a;
+			send_init(*a);
+			a->deadline = sctp_clock::now_ms() + a->rto;
+		}
+	}
+
+	boost::uint32_t unused_tag()
+	{
+		boost::uint32_t tag;
+		do
+			tag = next_random();
+		while (associations_.count(tag));
+		return tag;
+	}
+
+	void send_init(association& a)
+	{
+		unsigned char chunk[sctp_wire::init_size];
+		write_init(chunk, sctp_wire::init, sctp_wire::init_size, a.local_tag, a.next_tsn);
+		send_control(a.peer, 0, a.local_port, a.peer_port, chunk, sizeof(chunk));
+	}
+
+	static void write_init(unsigned char* p, int type, std::size_t length,
+		boost::uint32_t tag, boost::uint32_t tsn)
+	{
+		p[0] = static_cast<unsigned char>(type);
+		p[1] = 0;
+		sctp_wire::put16(p + 2, static_cast<boost::uint16_t>(length));
+		sctp_wire::put32(p + 4, tag);
+		sctp_wire::put32(p + 8, BOOST_ASIO_SCTP_UDP_WINDOW);
+		sctp_wire::put16(p + 12, 0xffff);  // outbound streams
+		sctp_wire::put16(p + 14, 0xffff);  // maximum inbound streams
+		sctp_wire::put32(p + 16, tsn);
+	}
+
+	// The cookie goes out in network byte order whatever the host: the tags,
+	// the initial TSNs and the peer's window, the SCTP ports, the peer's UDP
+	// address and port (kept in network byte order) and two bytes of padding,
+	// the tie-tags, the creation time and then the MAC, each 64-bit value as
+	// two 32-bit halves, high first; cookie_size bytes in all.
+	static void write_cookie(unsigned char* p, const cookie& c)
+	{
+		sctp_wire::put32(p, c.local_tag);
+		sctp_wire::put32(p + 4, c.peer_tag);
+		sctp_wire::put32(p + 8, c.local_tsn);
+		sctp_wire::put32(p + 12, c.peer_tsn);
+		sctp_wire::put32(p + 16, c.peer_rwnd);
+		sctp_wire::put16(p + 20, c.local_port);
+		sctp_wire::put16(p + 22, c.peer_port);
+		std::memcpy(p + 24, &c.peer_address, 4);
+		std::memcpy(p + 28, &c.peer_udp_port, 2);
+		sctp_wire::put16(p + 30, 0);
+		sctp_wire::put32(p + 32, c.local_tie_tag);
+		sctp_wire::put32(p + 36, c.peer_tie_tag);
+		sctp_wire::put32(p + 40, static_cast<boost::uint32_t>(c.created_ms >> 32));
+		sctp_wire::put32(p + 44, static_cast<boost::uint32_t>(c.created_ms));
+		sctp_wire::put32(p + cookie_mac_offset, static_cast<boost::uint32_t>(c.mac >> 32));
+		sctp_wire::put32(p + cookie_mac_offset + 4, static_cast<boost::uint32_t>(c.mac));
+	}
+
+	static cookie read_cookie(const unsigned char* p)
+	{
+		cookie c;
+		c.local_tag = sctp_wire::get32(p);
+		c.peer_tag = sctp_wire::get32(p + 4);
+		c.local_tsn = sctp_wire::get32(p + 8);
+		c.peer_tsn = sctp_wire::get32(p + 12);
+		c.peer_rwnd = sctp_wire::get32(p + 16);
+		c.local_port = sctp_wire::get16(p + 20);
+		c.peer_port = sctp_wire::get16(p + 22);
+		std::memcpy(&c.peer_address, p + 24, 4);
+		std::memcpy(&c.peer_udp_port, p + 28, 2);
+		c.local_tie_tag = sctp_wire::get32(p + 32);
+		c.peer_tie_tag = sctp_wire::get32(p + 36);
+		c.created_ms = (boost::uint64_t(sctp_wire::get32(p + 40)) << 32) | sctp_wire::get32(p + 44);
+		c.mac = (boost::uint64_t(sctp_wire::get32(p + cookie_mac_offset)) << 32)
+			| sctp_wire::get32(p + cookie_mac_offset + 4);
+		return c;
+	}
+
+	// A keyed MAC, so that a cookie can be neither forged nor altered without
+	// the secret, which never leaves the host.
+	boost::uint64_t cookie_mac(const cookie& c) const
+	{
+		unsigned char buffer[cookie_size];
+		cookie copy = c;
+		copy.mac = 0;
+		write_cookie(buffer, copy);
+		return siphash::compute(secret_, buffer, cookie_mac_offset);
+	}
+
+	// The live association, if any, between the same two ports and UDP address.
+	association* find_association(const sockaddr_in& from, boost::uint16_t src_port,
+		boost::uint16_t dst_port)
+	{
+		for (association_map::iterator it = associations_.begin(); it != associations_.end(); ++it)
+		{
+			association& a = *it->second;
+			if (a.state_ != closed && a.local_port == dst_port && a.peer_port == src_port
+				&& a.peer.sin_addr.s_addr == from.sin_addr.s_addr && a.peer.sin_port == from.sin_port)
+				return &a;
+		}
+		return 0;
+	}
+
+	// INIT is answered statelessly; everything needed is in the cookie.
+	void handle_init(const sockaddr_in& from, boost::uint16_t src_port,
+		boost::uint16_t dst_port, const unsigned char* chunk, std::size_t length)
+	{
+		if (length < sctp_wire::init_size)
+			return;
+		cookie c;
+		c.peer_tag = sctp_wire::get32(chunk + 4);
+		c.peer_rwnd = sctp_wire::get32(chunk + 8);
+		c.peer_tsn = sctp_wire::get32(chunk + 16);
+		c.local_port = dst_port;
+		c.peer_port = src_port;
+		c.peer_address = from.sin_addr.s_addr;
+		c.peer_udp_port = from.sin_port;
+		c.local_tie_tag = 0;
+		c.peer_tie_tag = 0;
+		association* existing = find_association(from, src_port, dst_port);
+		if (existing && (existing->state_ == cookie_wait || existing->state_ == cookie_echoed))
+		{
+			// Our INIT crossed the peer's: answer with the tag and TSN we sent (RFC 4960 5.2.1).
+			c.local_tag = existing->local_tag;
+			c.local_tsn = existing->next_tsn;
+		}
+		else
+		{
+			// A new tag; if there is an association already, its tags are the
+			// tie-tags by which a restart of the peer is recognised (5.2.2).
+			c.local_tag = unused_tag();
+			c.local_tsn = next_random();
+			if (existing)
+			{
+				c.local_tie_tag = existing->local_tag;
+				c.peer_tie_tag = existing->peer_tag;
+			}
+		}
+		c.created_ms = sctp_clock::now_ms();
+		c.mac = cookie_mac(c);
+
+		unsigned char reply[sctp_wire::init_size + 4 + cookie_size];
+		write_init(reply, sctp_wire::init_ack, sizeof(reply), c.local_tag, c.local_tsn);
+		sctp_wire::put16(reply + sctp_wire::init_size, sctp_wire::state_cookie_param);
+		sctp_wire::put16(reply + sctp_wire::init_size + 2, 4 + cookie_size);
+		write_cookie(reply + sctp_wire::init_size + 4, c);
+		send_control(from, c.peer_tag, dst_port, src_port, reply, sizeof(reply));
+	}
+
+	void handle_init_ack(association& a, const unsigned char* chunk, std::size_t length)
+	{
+		if (a.state_ != cookie_wait || length < sctp_wire::init_size)
+			return;
+		a.peer_tag = sctp_wire::get32(chunk + 4);
+		a.peer_rwnd = sctp_wire::get32(chunk + 8);
+		a.cum_tsn = a.delivered_tsn = sctp_wire::get32(chunk + 16) - 1;
+		for (std::size_t offset = sctp_wire::init_size; offset + 4 <= length; )
+		{
+			std::size_t param_length = sctp_wire::get16(chunk + offset + 2);
+			if (param_length < 4 || offset + param_length > length)
+				break;
+			if (sctp_wire::get16(chunk + offset) == sctp_wire::state_cookie_param)
+			{
+				a.cookie_echo.assign(chunk + offset + 4, chunk + offset + param_length);
+				break;
+			}
+			offset += (param_length + 3) & ~std::size_t(3);
+		}
+		if (a.cookie_echo.empty())
+			return;
+		a.state_ = cookie_echoed;
+		a.retries = 0;
+		send_cookie_echo(a);
+		a.deadline = sctp_clock::now_ms() + a.rto;
+	}
+
+	void send_cookie_echo(association& a)
+	{
+		std::vector<unsigned char> chunk(sctp_wire::chunk_header_size + a.cookie_echo.size());
+		chunk[0] = sctp_wire::cookie_echo;
+		chunk[1] = 0;
+		sctp_wire::put16(&chunk[2], static_cast<boost::uint16_t>(chunk.size()));
+		std::memcpy(&chunk[4], &a.cookie_echo[0], a.cookie_echo.size());
+		send_control(a.peer, a.peer_tag, a.local_port, a.peer_port, &chunk[0], chunk.size());
+	}
+
+	// Returns the association the chunks after the COOKIE ECHO belong to, or
+	// null if the cookie is not valid for this packet and they are to be
+	// discarded.
+	association* handle_cookie_echo(const sockaddr_in& from, boost::uint16_t src_port,
+		boost::uint16_t dst_port, boost::uint32_t tag, const unsigned char* chunk, std::size_t length)
+	{
+		if (length < sctp_wire::chunk_header_size + cookie_size)
+			return 0;
+		cookie c = read_cookie(chunk + sctp_wire::chunk_header_size);
+		if (c.mac != cookie_mac(c) || c.local_tag != tag
+			|| c.local_port != dst_port || c.peer_port != src_port
+			|| c.peer_address != from.sin_addr.s_addr || c.peer_udp_port != from.sin_port
+			|| sctp_clock::now_ms() - c.created_ms > cookie_lifetime_ms)
+			return 0;
+
+		// An association with this peer already: RFC 4960 5.2.4.
+		association* existing = find_association(from, src_port, dst_port);
+		if (existing)
+		{
+			bool local_match = (c.local_tag == existing->local_tag);
+			bool peer_match = (c.peer_tag == existing->peer_tag);
+			if (local_match && (peer_match || existing->state_ == cookie_wait
+				|| existing->state_ == cookie_echoed))
+			{
+				// D: our COOKIE ACK was lost, or B: the INITs crossed, when the
+				// peer's tag and TSN are those of the INIT it answered.
+				if (existing->state_ == cookie_wait || existing->state_ == cookie_echoed)
+				{
+					existing->peer_tag = c.peer_tag;
+					existing->peer_rwnd = c.peer_rwnd;
+					existing->cum_tsn = existing->delivered_tsn = c.peer_tsn - 1;
+					establish(*existing);
+				}
+				if (existing->state_ == closed)
+					return 0;
+				send_simple(*existing, sctp_wire::cookie_ack);
+				return existing;
+			}
+			if (local_match || peer_match || c.local_tie_tag != existing->local_tag
+				|| c.peer_tie_tag != existing->peer_tag)
+				return 0;  // C, or tags which match nothing: silently discarded
+
+			// A: the peer has restarted, so the old association is gone.
+			BOOST_ASIO_SCTP_LOG(debug, ("udp_sctp_engine - peer restarted on port {}", c.local_port));
+			close(*existing);
+		}
+		if (associations_.count(c.local_tag))
+			return 0;  // the tag has since been taken by another association
+
+		association* a = new association;
+		a->state_ = established;
+		a->local_tag = c.local_tag;
+		a->peer_tag = c.peer_tag;
+		a->local_port = c.local_port;
+		a->peer_port = c.peer_port;
+		a->peer = from;
+		a->next_tsn = c.local_tsn;
+		a->cum_tsn = a->delivered_tsn = c.peer_tsn - 1;
+		a->peer_rwnd = c.peer_rwnd;
+		associations_[a->local_tag] = a;
+
+		// Hand the association to the acceptor listening on the port.
+		sockaddr_un listener;
+		socklen_t listener_length = listener_name(c.local_port, listener);
+		a->fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (a->fd < 0 || !bind_bridge(*a, "a")
+			|| ::connect(a->fd, reinterpret_cast<sockaddr*>(&listener), listener_length) != 0)
+		{
+			BOOST_ASIO_SCTP_LOG(debug, ("udp_sctp_engine - no listener on port {}", c.local_port));
+			abort(*a);
+			return 0;
+		}
+		send_simple(*a, sctp_wire::cookie_ack);
+		return a;
+	}
+
+	void handle_cookie_ack(association& a)
+	{
+		if (a.state_ != cookie_echoed)
+			return;
+		establish(a);
+	}
+
+	// Our own association is up: give the application its end of the bridge.
+	void establish(association& a)
+	{
+		int pair[2];
+		if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) != 0)
+		{
+			boost::system::error_code ec = last_error();
+			complete_connect(a, ec, -1);
+			abort(a);
+			return;
+		}
+		::fcntl(pair[0], F_SETFL, ::fcntl(pair[0], F_GETFL) | O_NONBLOCK);
+		a.fd = pair[0];
+		bind_bridge(a, "c");
+		a.state_ = established;
+		a.deadline = 0;
+		a.retries = 0;
+		a.rto = a.base_rto;
+		a.cookie_echo.clear();
+		complete_connect(a, boost::system::error_code(), pair[1]);
+	}
+
+	bool bind_bridge(association& a, const char* kind)
+	{
+		sockaddr_in remote = a.peer;
+		remote.sin_port = htons(a.peer_port);
+		sockaddr_un name;
+		socklen_t length = bridge_name::make(name, kind, ++serial_, a.local_port,
+			reinterpret_cast<const sockaddr*>(&remote));
+		return ::bind(a.fd, reinterpret_cast<sockaddr*>(&name), length) == 0;
+	}
+
+	void complete_connect(association& a, const boost::system::error_code& ec, int fd)
+	{
+		if (a.on_connect)
+		{
+			connect_handler handler;
+			handler.swap(a.on_connect);
+			handler(ec, fd);
+		}
+	}
+
+	// Incoming packets.
+
+	void receive_packets()
+	{
+		mmsghdr headers[BOOST_ASIO_SCTP_UDP_BATCH];
+		iovec iov[BOOST_ASIO_SCTP_UDP_BATCH];
+		sockaddr_in from[BOOST_ASIO_SCTP_UDP_BATCH];
+		for (int round = 0; round < 4; ++round)
+		{
+			for (int i = 0; i < BOOST_ASIO_SCTP_UDP_BATCH; ++i)
+			{
+				iov[i].iov_base = &rx_[i * rx_buffer_size];
+				iov[i].iov_len = rx_buffer_size;
+				std::memset(&headers[i], 0, sizeof(headers[i]));
+				headers[i].msg_hdr.msg_iov = &iov[i];
+				headers[i].msg_hdr.msg_iovlen = 1;
+				headers[i].msg_hdr.msg_name = &from[i];
+				headers[i].msg_hdr.msg_namelen = sizeof(from[i]);
+			}
+			int count = ::recvmmsg(udp_, headers, BOOST_ASIO_SCTP_UDP_BATCH, MSG_DONTWAIT, 0);
+			if (count <= 0)
+				return;
+			for (int i = 0; i < count; ++i)
+			{
+				if (!(headers[i].msg_hdr.msg_flags & MSG_TRUNC))
+					handle_packet(&rx_[i * rx_buffer_size], headers[i].msg_len, from[i]);
+			}
+			if (count < BOOST_ASIO_SCTP_UDP_BATCH)
+				return;
+		}
+	}
+
+	void handle_packet(unsigned char* p, std::size_t size, const sockaddr_in& from)
+	{
+		if (size < sctp_wire::common_header_size + sctp_wire::chunk_header_size
+			|| !sctp_wire::verify(p, size))
+			return;
+		boost::uint16_t src_port = sctp_wire::get16(p);
+		boost::uint16_t dst_port = sctp_wire::get16(p + 2);
+		boost::uint32_t tag = sctp_wire::get32(p + 4);
+
+		association* a = 0;
+		if (tag != 0)
+		{
+			association_map::iterator it = associations_.find(tag);
+			if (it != associations_.end() && it->second->local_port == dst_port
+				&& it->second->peer_port == src_port)
+				a = it->second;
+		}
+
+		for (std::size_t offset = sctp_wire::common_header_size;
+			offset + sctp_wire::chunk_header_size <= size; )
+		{
+			const unsigned char* chunk = p + offset;
+			std::size_t length = sctp_wire::get16(chunk + 2);
+			if (length < sctp_wire::chunk_header_size || offset + length > size)
+				return;
+			offset += (length + 3) & ~std::size_t(3);
+
+			int type = chunk[0];
+			if (type == sctp_wire::init)
+			{
+				if (tag == 0)
+					handle_init(from, src_port, dst_port, chunk, length);
+				return;  // INIT must be alone in its packet
+			}
+			if (type == sctp_wire::cookie_echo)
+			{
+				a = handle_cookie_echo(from, src_port, dst_port, tag, chunk, length);
+				if (!a)
+					return;
+				continue;
+			}
+			if (!a || a->state_ == closed)
+				return;  // out of the blue
+
+			switch (type)
+			{
+			case sctp_wire::data:
+				handle_data(*a, chunk, length);
+				break;
+			case sctp_wire::sack:
+				handle_sack(*a, chunk, length);
+				break;
+			case sctp_wire::init_ack:
+				handle_init_ack(*a, chunk, length);
+				break;
+			case sctp_wire::cookie_ack:
+				handle_cookie_ack(*a);
+				break;
+			case sctp_wire::heartbeat:
+				{
+					std::vector<unsigned char> reply(chunk, chunk + length);
+					reply[0] = sctp_wire::heartbeat_ack;
+					send_control(a->peer, a->peer_tag, a->local_port, a->peer_port, &reply[0], reply.size());
+				}
+				break;
+			case sctp_wire::abort:
+				complete_connect(*a, boost::asio::error::connection_refused, -1);
+				close(*a);
+				return;
+			case sctp_wire::shutdown:
+				handle_shutdown(*a, chunk, length);
+				break;
+			case sctp_wire::shutdown_ack:
+				send_simple(*a, sctp_wire::shutdown_complete);
+				finish(*a);
+				return;
+			case sctp_wire::shutdown_complete:
+				finish(*a);
+				return;
+			default:
+				break;
+			}
+		}
+	}
+
+	// Data still flows, and is acknowledged, until one end has sent SHUTDOWN
+	// ACK: the end that shut down first goes on receiving what the other had
+	// queued.
+	static bool carrying_data(const association& a)
+	{
+		return a.state_ == established || a.state_ == shutdown_pending
+			|| a.state_ == shutdown_sent || a.state_ == shutdown_received;
+	}
+
+	void handle_data(association& a, const unsigned char* chunk, std::size_t length)
+	{
+		if (length <= sctp_wire::data_header_size || a.fd < 0 || !carrying_data(a))
+			return;
+		a.sack_due = true;
+		boost::uint32_t tsn = sctp_wire::get32(chunk + 4);
+		if (!sctp_wire::after(tsn, a.cum_tsn) || a.held.count(tsn))
+			return;  // duplicate
+
+		if (tsn == a.cum_tsn + 1 && a.held.empty() && deliver(a, chunk, length))
+		{
+			a.cum_tsn = a.delivered_tsn = tsn;
+			return;
+		}
+
+		// Hold chunks which arrive out of order, or which the application has no room
+		// for, within the window.
+		if (a.held_bytes + length > BOOST_ASIO_SCTP_UDP_WINDOW)
+			return;
+		a.held[tsn].assign(chunk, chunk + length);
+		a.held_bytes += length;
+		while (a.held.count(a.cum_tsn + 1))
+			++a.cum_tsn;
+		deliver_held(a);
+	}
+
+	void deliver_held(association& a)
+	{
+		held_map::iterator next;
+		while (!a.held.empty() && (next = a.held.begin())->first == a.delivered_tsn + 1
+			&& deliver(a, &next->second[0], next->second.size()))
+		{
+			a.delivered_tsn = next->first;
+			a.held_bytes -= next->second.size();
+			a.held.erase(next);
+		}
+	}
+
+	// Pass a DATA chunk to the application; false if the bridge is full.
+	bool deliver(association& a, const unsigned char* chunk, std::size_t length)
+	{
+		if (a.rx_blocked)
+			return false;
+		bridge_header header = bridge_header();
+		header.stream = sctp_wire::get16(chunk + 8);
+		header.ppid = sctp_wire::get32(chunk + 12);
+		header.sinfo_flags = (chunk[1] & sctp_wire::data_unordered) ? SCTP_UNORDERED : 0;
+		header.flags = (chunk[1] & sctp_wire::data_end) ? bridge_header::end_of_record : 0;
+		iovec iov[2];
+		iov[0].iov_base = &header;
+		iov[0].iov_len = sizeof(header);
+		iov[1].iov_base = const_cast<unsigned char*>(chunk + sctp_wire::data_header_size);
+		iov[1].iov_len = length - sctp_wire::data_header_size;
+		msghdr msg = msghdr();
+		msg.msg_iov = iov;
+		msg.msg_iovlen = 2;
+		if (::sendmsg(a.fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0
+			&& (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			a.rx_blocked = true;  // resumes once the application reads
+			return false;
+		}
+		return true;  // or dropped, the application having closed its socket
+	}
+
+	void handle_sack(association& a, const unsigned char* chunk, std::size_t length)
+	{
+		if (length < sctp_wire::sack_size)
+			return;
+		boost::uint32_t cum_ack = sctp_wire::get32(chunk + 4);
+		std::size_t gaps = sctp_wire::get16(chunk + 12);
+		if (length < sctp_wire::sack_size + 4 * gaps)
+			return;
+		a.peer_rwnd = sctp_wire::get32(chunk + 8);
+		acknowledge(a, cum_ack);
+		if (gaps)
+			apply_gap_blocks(a, cum_ack, chunk + sctp_wire::sack_size, gaps);
+		continue_shutdown(a);
+	}
+
+	// Everything up to cum_ack has been received by the peer.
+	void acknowledge(association& a, boost::uint32_t cum_ack)
+	{
+		bool advanced = false;
+		std::size_t acked = 0;
+		while (!a.sent.empty() && !sctp_wire::after(a.sent.front()->tsn, cum_ack))
+		{
+			out_chunk* c = a.sent.front();
+			acked += c->data.size();
+			if (c->lost)
+				--a.lost_count;
+			else if (!c->gap_acked)
+				a.outstanding -= c->data.size();
+			release(c);
+			a.sent.pop_front();
+			advanced = true;
+		}
+
+		if (advanced)
+		{
+			// Slow start below ssthresh, then about one MTU per window acknowledged.
+			if (!a.recovering)
+			{
+				if (a.cwnd <= a.ssthresh)
+					a.cwnd += acked < mtu ? acked : std::size_t(mtu);
+				else
+					a.cwnd += acked * mtu / a.cwnd + 1;
+				if (a.cwnd > BOOST_ASIO_SCTP_UDP_WINDOW)
+					a.cwnd = BOOST_ASIO_SCTP_UDP_WINDOW;
+			}
+			if (a.timing && !sctp_wire::after(a.rtt_tsn, cum_ack))
+				measure_rtt(a, static_cast<unsigned int>(sctp_clock::now_ms() - a.rtt_start));
+			a.retries = 0;
+			a.rto = a.base_rto;
+			a.deadline = a.sent.empty() ? 0 : sctp_clock::now_ms() + a.rto;
+		}
+		if (a.recovering && !sctp_wire::after(a.recover_tsn, cum_ack))
+			a.recovering = false;
+	}
+
+	// Chunks reported received take no more room in flight. A chunk missed by
+	// three reports of later chunks sent after it is taken to be lost and is
+	// sent again (RFC 4960 section 7.2.4).
+	void apply_gap_blocks(association& a, boost::uint32_t cum_ack,
+		const unsigned char* blocks, std::size_t count)
+	{
+		boost::uint32_t highest = cum_ack + sctp_wire::get16(blocks + 4 * (count - 1) + 2);
+		std::size_t block = 0;
+		bool newly_lost = false;
+		for (std::size_t i = 0; i < a.sent.size(); ++i)
+		{
+			out_chunk* c = a.sent[i];
+			if (sctp_wire::after(c->tsn, highest))
+				break;
+			while (block < count && sctp_wire::after(c->tsn,
+				cum_ack + sctp_wire::get16(blocks + 4 * block + 2)))
+				++block;
+			bool covered = block < count && !sctp_wire::after(
+				cum_ack + sctp_wire::get16(blocks + 4 * block), c->tsn);
+			if (covered)
+			{
+				if (!c->gap_acked)
+				{
+					c->gap_acked = true;
+					if (c->lost)
+						--a.lost_count;
+					else
+						a.outstanding -= c->data.size();
+					c->lost = false;
+				}
+			}
+			else if (!c->gap_acked && !c->lost && sctp_wire::after(highest, c->sent_before - 1)
+				&& ++c->misses >= 3)
+			{
+				c->lost = true;
+				++a.lost_count;
+				a.outstanding -= c->data.size();
+				newly_lost = true;
+			}
+		}
+		if (newly_lost && !a.recovering)
+		{
+			a.ssthresh = reduced_window(a);
+			a.cwnd = a.ssthresh;
+			a.recovering = true;
+			a.recover_tsn = first_unsent(a) - 1;
+			a.timing = false;  // Karn's algorithm
+		}
+	}
+
+	// Outgoing data.
+
+	// Whether to read from the application: while the window has room, and
+	// always to finish a message it has begun, so that a sender part way
+	// through a message waits for this thread and never for the network.
+	// Once the peer has shut down, only that message is finished.
+	static bool accepting(const association& a)
+	{
+		if (a.fd < 0)
+			return false;
+		if (a.in_message)
+			return a.state_ == established || a.state_ == shutdown_received;
+		return a.state_ == established && a.queued_bytes < BOOST_ASIO_SCTP_UDP_WINDOW;
+	}
+
+	void read_from_application(association& a)
+	{
+		while (accepting(a))
+		{
+			bridge_header header;
+			iovec iov[2];
+			iov[0].iov_base = &header;
+			iov[0].iov_len = sizeof(header);
+			iov[1].iov_base = &app_buffer_[0];
+			iov[1].iov_len = app_buffer_.size();
+			msghdr msg = msghdr();
+			msg.msg_iov = iov;
+			msg.msg_iovlen = 2;
+			ssize_t result = ::recvmsg(a.fd, &msg, MSG_DONTWAIT);
+			if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+				return;
+			if (result <= 0)
+			{
+				// The application has closed its socket: finish sending, then shut down.
+				if (a.state_ == established)
+					a.state_ = shutdown_pending;
+				a.in_message = false;
+				continue_shutdown(a);
+				return;
+			}
+			if (result < static_cast<ssize_t>(sizeof(header)))
+				continue;
+			enqueue(a, header, &app_buffer_[0], result - sizeof(header));
+		}
+	}
+
+	void enqueue(association& a, const bridge_header& header,
+		const unsigned char* data, std::size_t size)
+	{
+		bool unordered = (header.sinfo_flags & SCTP_UNORDERED) != 0;
+		bool end = (header.flags & bridge_header::end_of_record) != 0;
+		if (!a.in_message)
+		{
+			if (size == 0)
+				return;  // SCTP has no empty messages
+			if (!unordered)
+			{
+				if (header.stream >= a.ssn.size())
+					a.ssn.resize(header.stream + 1, 0);
+				a.message_ssn = a.ssn[header.stream]++;
+			}
+		}
+		for (std::size_t offset = 0; offset < size || (end && offset == 0 && size == 0); )
+		{
+			std::size_t length = size - offset;
+			if (length > max_chunk_data)
+				length = max_chunk_data;
+			out_chunk* c = allocate();
+			c->tsn = a.next_tsn++;
+			c->stream = header.stream;
+			c->ssn = a.message_ssn;
+			c->ppid = header.ppid;
+			c->flags = unordered ? sctp_wire::data_unordered : 0;
+			if (!a.in_message)
+				c->flags |= sctp_wire::data_begin;
+			a.in_message = true;
+			offset += length;
+			if (end && offset == size)
+			{
+				c->flags |= sctp_wire::data_end;
+				a.in_message = false;
+			}
+			c->data.assign(data + offset - length, data + offset);
+			a.queued.push_back(c);
+			a.queued_bytes += length;
+			if (length == 0)
+				break;
+		}
+	}
+
+	void transmit_all()
+	{
+		for (association_map::iterator it = associations_.begin(); it != associations_.end(); ++it)
+			transmit(*it->second);
+		flush();
+	}
+
+	void transmit(association& a)
+	{
+		if (!carrying_data(a))
+			return;
+		packet* p = 0;
+		if (a.sack_due)
+		{
+			p = begin_packet(a);
+			unsigned char* s = p->data + p->size;
+			s[0] = sctp_wire::sack;
+			s[1] = 0;
+			sctp_wire::put32(s + 4, a.cum_tsn);
+			sctp_wire::put32(s + 8, BOOST_ASIO_SCTP_UDP_WINDOW - a.held_bytes);
+			sctp_wire::put32(s + 12, 0);  // no duplicates reported
+			std::size_t length = sctp_wire::sack_size;
+			// Gap blocks for the runs of chunks held beyond cum_tsn.
+			std::size_t gaps = 0;
+			held_map::iterator it = a.held.upper_bound(a.cum_tsn);
+			while (it != a.held.end() && gaps < max_gap_blocks
+				&& it->first - a.cum_tsn <= 0xffff)
+			{
+				boost::uint32_t start = it->first;
+				boost::uint32_t end = start;
+				while (++it != a.held.end() && it->first == end + 1 && it->first - a.cum_tsn <= 0xffff)
+					++end;
+				sctp_wire::put16(s + length, static_cast<boost::uint16_t>(start - a.cum_tsn));
+				sctp_wire::put16(s + length + 2, static_cast<boost::uint16_t>(end - a.cum_tsn));
+				length += 4;
+				++gaps;
+			}
+			sctp_wire::put16(s + 12, static_cast<boost::uint16_t>(gaps));
+			sctp_wire::put16(s + 2, static_cast<boost::uint16_t>(length));
+			p->size += length;
+			a.sack_due = false;
+		}
+		std::size_t window = a.peer_rwnd < a.cwnd ? a.peer_rwnd : a.cwnd;
+		for (std::size_t i = 0; a.lost_count && i < a.sent.size(); ++i)
+		{
+			out_chunk* c = a.sent[i];
+			if (!c->lost)
+				continue;
+			if (a.outstanding && a.outstanding + c->data.size() > window)
+				break;
+			if (!p || p->size + chunk_space(*c) > BOOST_ASIO_SCTP_UDP_MTU)
+			{
+				if (p)
+					finish_packet(*p);
+				p = begin_packet(a);
+			}
+			write_data(*p, *c);
+			c->lost = false;
+			c->misses = 0;
+			c->sent_before = first_unsent(a);
+			--a.lost_count;
+			a.outstanding += c->data.size();
+			if (!a.deadline)
+				a.deadline = sctp_clock::now_ms() + a.rto;
+		}
+
+		while (!a.lost_count && !a.queued.empty())
+		{
+			out_chunk* c = a.queued.front();
+			if (a.outstanding && a.outstanding + c->data.size() > window)
+				break;
+			if (!p || p->size + chunk_space(*c) > BOOST_ASIO_SCTP_UDP_MTU)
+			{
+				if (p)
+					finish_packet(*p);
+				p = begin_packet(a);
+			}
+			write_data(*p, *c);
+			c->gap_acked = false;
+			c->lost = false;
+			c->misses = 0;
+			c->sent_before = c->tsn + 1;
+
+			a.queued.pop_front();
+			a.queued_bytes -= c->data.size();
+			a.sent.push_back(c);
+			a.outstanding += c->data.size();
+			if (!a.timing)
+			{
+				a.timing = true;
+				a.rtt_tsn = c->tsn;
+				a.rtt_start = sctp_clock::now_ms();
+			}
+			if (!a.deadline)
+				a.deadline = sctp_clock::now_ms() + a.rto;
+		}
+		if (p)
+			finish_packet(*p);
+	}
+
+	static std::size_t chunk_space(const out_chunk& c)
+	{
+		return (sctp_wire::data_header_size + c.data.size() + 3) & ~std::size_t(3);
+	}
+
+	static void write_data(packet& p, const out_chunk& c)
+	{
+		std::size_t length = sctp_wire::data_header_size + c.data.size();
+		unsigned char* d = p.data + p.size;
+		d[0] = sctp_wire::data;
+		d[1] = c.flags;
+		sctp_wire::put16(d + 2, static_cast<boost::uint16_t>(length));
+		sctp_wire::put32(d + 4, c.tsn);
+		sctp_wire::put16(d + 8, c.stream);
+		sctp_wire::put16(d + 10, c.ssn);
+		sctp_wire::put32(d + 12, c.ppid);
+		if (!c.data.empty())
+			std::memcpy(d + sctp_wire::data_header_size, &c.data[0], c.data.size());
+		std::memset(d + length, 0, chunk_space(c) - length);
+		p.size += chunk_space(c);
+	}
+
+	static boost::uint32_t first_unsent(const association& a)
+	{
+		return a.queued.empty() ? a.next_tsn : a.queued.front()->tsn;
+	}
+
+	static std::size_t reduced_window(const association& a)
+	{
+		return a.cwnd / 2 > 4 * mtu ? a.cwnd / 2 : std::size_t(4 * mtu);
+	}
+
+	// RFC 4960 section 6.3.1.
+	static void measure_rtt(association& a, unsigned int rtt)
+	{
+		if (!a.srtt)
+		{
+			a.srtt = rtt ? rtt : 1;
+			a.rttvar = rtt / 2;
+		}
+		else
+		{
+			unsigned int delta = a.srtt > rtt ? a.srtt - rtt : rtt - a.srtt;
+			a.rttvar = (3 * a.rttvar + delta) / 4;
+			a.srtt = (7 * a.srtt + rtt) / 8;
+		}
+		unsigned int rto = a.srtt + 4 * a.rttvar;
+		a.base_rto = rto < min_rto_ms ? unsigned(min_rto_ms)
+			: rto > max_rto_ms ? unsigned(max_rto_ms) : rto;
+		a.timing = false;
+	}
+
+	// After a timeout, everything in flight is taken to be lost (RFC 4960 section 6.3.3).
+	void retransmit(association& a)
+	{
+		a.ssthresh = reduced_window(a);
+		a.cwnd = mtu;
+		for (std::size_t i = 0; i < a.sent.size(); ++i)
+		{
+			out_chunk* c = a.sent[i];
+			if (!c->gap_acked && !c->lost)
+			{
+				c->lost = true;
+				++a.lost_count;
+			}
+		}
+		a.outstanding = 0;
+		a.recovering = false;
+		a.timing = false;
+	}
+
+	void run_timers(boost::uint64_t now)
+	{
+		for (association_map::iterator it = associations_.begin(); it != associations_.end(); ++it)
+		{
+			association& a = *it->second;
+			if (!a.deadline || a.deadline > now)
+				continue;
+			int limit = (a.state_ == cookie_wait || a.state_ == cookie_echoed)
+				? int(max_init_retransmits) : int(max_retransmits);
+			if (++a.retries > limit)
+			{
+				BOOST_ASIO_SCTP_LOG(debug, ("udp_sctp_engine - association to port {} timed out", a.peer_port));
+				complete_connect(a, boost::asio::error::timed_out, -1);
+				abort(a);
+				continue;
+			}
+			a.rto = a.rto * 2 < max_rto_ms ? a.rto * 2 : unsigned(max_rto_ms);
+			a.deadline = now + a.rto;
+			switch (a.state_)
+			{
+			case cookie_wait:
+				send_init(a);
+				break;
+			case cookie_echoed:
+				send_cookie_echo(a);
+				break;
+			case shutdown_sent:
+				send_shutdown(a);
+				break;
+			case shutdown_ack_sent:
+				send_simple(a, sctp_wire::shutdown_ack);
+				break;
+			default:
+				retransmit(a);
+				break;
+			}
+		}
+	}
+
+	// Shutdown and teardown.
+
+	void begin_shutdown(association& a)
+	{
+		a.state_ = shutdown_sent;
+		a.retries = 0;
+		send_shutdown(a);
+		a.deadline = sctp_clock::now_ms() + a.rto;
+	}
+
+	// The peer has nothing more to send (RFC 4960 section 9.2). What the
+	// application had written by now is still sent, and SHUTDOWN ACK only
+	// goes once all of it has been acknowledged.
+	void handle_shutdown(association& a, const unsigned char* chunk, std::size_t length)
+	{
+		if (length < 8)
+			return;
+		if (a.state_ == established)
+			read_from_application(a);
+		switch (a.state_)
+		{
+		case established:
+		case shutdown_pending:
+			a.state_ = shutdown_received;
+			break;
+		case shutdown_received:
+			break;
+		case shutdown_sent:  // both ends shutting down at once
+		case shutdown_ack_sent:  // our SHUTDOWN ACK was lost
+			begin_shutdown_ack(a);
+			return;
+		default:
+			return;
+		}
+		acknowledge(a, sctp_wire::get32(chunk + 4));
+		continue_shutdown(a);
+	}
+
+	// Move a shutdown on once everything sent has been acknowledged.
+	void continue_shutdown(association& a)
+	{
+		if (!a.sent.empty() || !a.queued.empty())
+			return;
+		if (a.state_ == shutdown_pending)
+			begin_shutdown(a);
+		else if (a.state_ == shutdown_received && !a.in_message)
+			begin_shutdown_ack(a);
+	}
+
+	void begin_shutdown_ack(association& a)
+	{
+		a.state_ = shutdown_ack_sent;
+		a.retries = 0;
+		send_simple(a, sctp_wire::shutdown_ack);
+		a.deadline = sctp_clock::now_ms() + a.rto;
+	}
+
+	void send_shutdown(association& a)
+	{
+		unsigned char chunk[8];
+		chunk[0] = sctp_wire::shutdown;
+		chunk[1] = 0;
+		sctp_wire::put16(chunk + 2, sizeof(chunk));
+		sctp_wire::put32(chunk + 4, a.cum_tsn);
+		send_control(a.peer, a.peer_tag, a.local_port, a.peer_port, chunk, sizeof(chunk));
+	}
+
+	void abort(association& a)
+	{
+		if (a.peer_tag)
+			send_simple(a, sctp_wire::abort);
+		close(a);
+	}
+
+	// The association has been shut down gracefully: everything the peer sent
+	// has been acknowledged, so the bridge is closed only once the application
+	// has been given all of it.
+	void finish(association& a)
+	{
+		if (a.fd >= 0)
+			deliver_held(a);
+		if (a.held.empty() || !a.rx_blocked)
+		{
+			close(a);
+			return;
+		}
+		a.state_ = delivering;
+		a.deadline = 0;
+	}
+
+	// Close the bridge, which the application sees as end of file; the
+	// association itself is deleted by reap().
+	void close(association& a)
+	{
+		if (a.fd >= 0)
+			::close(a.fd);
+		a.fd = -1;
+		a.state_ = closed;
+		a.deadline = 0;
+	}
+
+	void reap()
+	{
+		for (association_map::iterator it = associations_.begin(); it != associations_.end(); )
+		{
+			association* a = it->second;
+			if (a->state_ != closed)
+			{
+				++it;
+				continue;
+			}
+			complete_connect(*a, boost::asio::error::connection_aborted, -1);
+			for (std::size_t i = 0; i < a->sent.size(); ++i)
+				release(a->sent[i]);
+			for (std::size_t i = 0; i < a->queued.size(); ++i)
+				release(a->queued[i]);
+			delete a;
+			associations_.erase(it++);
+		}
+	}
+
+	// Packet assembly.
+
+	packet* begin_packet(association& a)
+	{
+		if (out_count_ == out_.size())
+			flush();
+		packet* p = &out_[out_count_++];
+		p->to = a.peer;
+		sctp_wire::put16(p->data, a.local_port);
+		sctp_wire::put16(p->data + 2, a.peer_port);
+		sctp_wire::put32(p->data + 4, a.peer_tag);
+		p->size = sctp_wire::common_header_size;
+		return p;
+	}
+
+	static void finish_packet(packet& p)
+	{
+		sctp_wire::seal(p.data, p.size);
+	}
+
+	void send_simple(association& a, int type)
+	{
+		unsigned char chunk[4] = { static_cast<unsigned char>(type), 0, 0, 4 };
+		send_control(a.peer, a.peer_tag, a.local_port, a.peer_port, chunk, sizeof(chunk));
+	}
+
+	void send_control(const sockaddr_in& to, boost::uint32_t tag,
+		boost::uint16_t src_port, boost::uint16_t dst_port,
+		const unsigned char* chunk, std::size_t length)
+	{
+		std::size_t padded = (length + 3) & ~std::size_t(3);
+		if (sctp_wire::common_header_size + padded > BOOST_ASIO_SCTP_UDP_MTU)
+			return;
+		if (out_count_ == out_.size())
+			flush();
+		packet& p = out_[out_count_++];
+		p.to = to;
+		sctp_wire::put16(p.data, src_port);
+		sctp_wire::put16(p.data + 2, dst_port);
+		sctp_wire::put32(p.data + 4, tag);
+		std::memcpy(p.data + sctp_wire::common_header_size, chunk, length);
+		std::memset(p.data + sctp_wire::common_header_size + length, 0, padded - length);
+		p.size = sctp_wire::common_header_size + padded;
+		finish_packet(p);
+	}
+
+	void flush()
+	{
+		mmsghdr headers[BOOST_ASIO_SCTP_UDP_BATCH];
+		iovec iov[BOOST_ASIO_SCTP_UDP_BATCH];
+		std::size_t done = 0;
+		while (done < out_count_)
+		{
+			std::size_t n = out_count_ - done;
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				packet& p = out_[done + i];
+				iov[i].iov_base = p.data;
+				iov[i].iov_len = p.size;
+				std::memset(&headers[i], 0, sizeof(headers[i]));
+				headers[i].msg_hdr.msg_iov = &iov[i];
+				headers[i].msg_hdr.msg_iovlen = 1;
+				headers[i].msg_hdr.msg_name = &p.to;
+				headers[i].msg_hdr.msg_namelen = sizeof(p.to);
+			}
+			int sent = ::sendmmsg(udp_, headers, static_cast<unsigned int>(n), 0);
+			if (sent <= 0)
+			{
+				if (sent < 0 && errno == EINTR)
+					continue;
+				if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+				{
+					pollfd pfd = { udp_, POLLOUT, 0 };
+					::poll(&pfd, 1, 10);
+					continue;
+				}
+				++done;  // e.g. no route; the packet is lost and will be retransmitted
+				continue;
+			}
+			done += sent;
+		}
+		out_count_ = 0;
+	}
+
+	out_chunk* allocate()
+	{
+		if (free_chunks_.empty())
+			return new out_chunk;
+		out_chunk* c = free_chunks_.back();
+		free_chunks_.pop_back();
+		return c;
+	}
+
+	void release(out_chunk* c)
+	{
+		c->data.clear();
+		free_chunks_.push_back(c);
+	}
+
+	typedef std::map<boost::uint32_t, association*> association_map;
+
+	boost::mutex mutex_;  // protects thread_, stopping_ and requests_
+	boost::scoped_ptr<boost::thread> thread_;
+	bool stopping_;
+	std::vector<connect_request> requests_;
+	int udp_;
+	int wake_;
+	unsigned short remote_udp_port_;
+
+	// Owned by the engine thread.
+	association_map associations_;
+	boost::uint64_t random_;
+	unsigned char secret_[16];  // the cookie MAC key
+	unsigned long serial_;
+	std::size_t out_count_;
+	std::vector<packet> out_;
+	std::vector<unsigned char> rx_;
+	std::vector<unsigned char> app_buffer_;
+	std::vector<out_chunk*> free_chunks_;
+};
+
+} // namespace detail
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_DETAIL_UDP_SCTP_ENGINE_HPP
@@ -0,0 +1,135 @@
+//
+// io_service_pool.hpp
+// ~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_IO_SERVICE_POOL_HPP
+#define BOOST_ASIO_SCTP_IO_SERVICE_POOL_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <pthread.h>
+#include <sched.h>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio_sctp/detail/atomic.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// A set of io_services, each run by its own thread.
+/**
+ * Each io_service is a shard: the sockets and timers created on it are only
+ * ever serviced by its one thread, so they need no locking among themselves.
+ * get_io_service() hands out shards round-robin.
+ *
+ * @par Thread Safety
+ * get_io_service() may be called from any thread.
+ */
+class io_service_pool
+	: private boost::noncopyable
+{
+public:
+	/// Construct a pool of the given number of io_services.
+	explicit io_service_pool(std::size_t size)
+		: next_(0)
+	{
+		for (std::size_t i = 0; i < (size ? size : 1); ++i)
+		{
+			io_service_ptr io_service(new boost::asio::io_service(1));
+			services_.push_back(io_service);
+			work_.push_back(work_ptr(new boost::asio::io_service::work(*io_service)));
+		}
+	}
+
+	~io_service_pool()
+	{
+		stop();
+		join();
+	}
+
+	/// Start one thread per io_service; optionally pin thread i to CPU i.
+	void start(bool pin_threads = false)
+	{
+		for (std::size_t i = 0; i < services_.size(); ++i)
+		{
+			thread_ptr thread(new boost::thread(boost::bind(
+				&boost::asio::io_service::run, services_[i].get())));
+			if (pin_threads)
+			{
+				cpu_set_t cpus;
+				CPU_ZERO(&cpus);
+				CPU_SET(i % CPU_SETSIZE, &cpus);
+				::pthread_setaffinity_np(thread->native_handle(), sizeof(cpus), &cpus);
+			}
+			threads_.push_back(thread);
+		}
+	}
+
+	/// Stop all the io_services; handlers not yet run are abandoned.
+	void stop()
+	{
+		work_.clear();
+		for (std::size_t i = 0; i < services_.size(); ++i)
+			services_[i]->stop();
+	}
+
+	/// Wait for the threads to exit.
+	void join()
+	{
+		for (std::size_t i = 0; i < threads_.size(); ++i)
+			threads_[i]->join();
+		threads_.clear();
+	}
+
+	/// Number of io_services in the pool.
+	std::size_t size() const
+	{
+		return services_.size();
+	}
+
+	/// The next io_service, round-robin.
+	boost::asio::io_service& get_io_service()
+	{
+		std::size_t n = detail::atomic::fetch_add(next_, std::size_t(1));
+		return *services_[n % services_.size()];
+	}
+
+	/// A particular io_service.
+	boost::asio::io_service& get_io_service(std::size_t index)
+	{
+		return *services_[index % services_.size()];
+	}
+
+private:
+	typedef boost::shared_ptr<boost::asio::io_service> io_service_ptr;
+	typedef boost::shared_ptr<boost::asio::io_service::work> work_ptr;
+	typedef boost::shared_ptr<boost::thread> thread_ptr;
+
+	std::vector<io_service_ptr> services_;
+	std::vector<work_ptr> work_;
+	std::vector<thread_ptr> threads_;
+	volatile std::size_t next_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_IO_SERVICE_POOL_HPP
@@ -19,13 +19,24 @@
 #include <boost/asio_sctp/sctp_socket_acceptor.hpp>
 #include <boost/asio_sctp/sctp_stream_socket.hpp>
 #include <boost/asio_sctp/detail/sctp_socket_types.hpp>  // for definition of sctp_event_subscribe
+#include <boost/throw_exception.hpp>
+#include <cstring>
+#include <stdexcept>
 
 typedef struct sctp_event_subscribe sctp_event_subs_t;
+typedef struct sctp_status sctp_status_t;
+#if defined(SCTP_GET_ASSOC_STATS)
+typedef struct sctp_assoc_stats sctp_assoc_stats_t;
+#endif
 
 #include <boost/asio/detail/push_options.hpp>
 
 namespace boost {
 namespace asio_sctp {
+
+template <typename Protocol>
+class basic_sctp_iostream;
+
 namespace ip {
 
 /// Encapsulates the flags needed for SCTP.
@@ -63,10 +74,29 @@ public:
 		return sctp(PF_INET6);
 	}
 
+	/// Construct to represent IPv4 SCTP on a one-to-many (SOCK_SEQPACKET) socket.
+	/**
+	* A one-to-many socket carries every association in one descriptor; busy
+	* associations can be moved onto their own socket with
+	* sctp_stream_socket::peeloff(). Endpoints always report the one-to-one
+	* protocol, so one-to-many sockets must be opened with this protocol
+	* explicitly.
+	*/
+	static sctp v4_one_to_many()
+	{
+		return sctp(PF_INET, SOCK_SEQPACKET);
+	}
+
+	/// Construct to represent IPv6 SCTP on a one-to-many (SOCK_SEQPACKET) socket.
+	static sctp v6_one_to_many()
+	{
+		return sctp(PF_INET6, SOCK_SEQPACKET);
+	}
+
 	/// Obtain an identifier for the type of the protocol.
 	int type() const
 	{
-		return SOCK_STREAM;
+		return type_;
 	}
 
 	/// Obtain an identifier for the protocol.
@@ -90,8 +120,8 @@ public:
 	/// The SCTP resolver type.
 	typedef boost::asio::ip::basic_resolver<sctp> resolver;
 
-	/// The SCTP iostream type.
-	typedef boost::asio::basic_socket_iostream<sctp> iostream;
+	/// The SCTP iostream type; each flush sends one message.
+	typedef basic_sctp_iostream<sctp> iostream;
 
 	/// Socket option for disabling the Nagle algorithm.
 	/**
@@ -126,26 +156,106 @@ public:
 		IPPROTO_SCTP, SCTP_NODELAY> no_delay;
 #endif
 
+	/// Socket option controlling how partial deliveries of large messages interleave.
+	/**
+	* Implements the IPPROTO_SCTP/SCTP_FRAGMENT_INTERLEAVE socket option. Level 0
+	* blocks every other message until a partially delivered message completes,
+	* level 1 interleaves only across associations, and level 2 also interleaves
+	* across streams of one association, as required for I-DATA.
+	*
+	* @par Examples
+	* Setting the option:
+	* @code
+	* boost::asio_sctp::ip::sctp::acceptor acceptor(io_service);
+	* ...
+	* boost::asio_sctp::ip::sctp::fragment_interleave option(2);
+	* acceptor.set_option(option);
+	* @endcode
+	*
+	* @par Concepts:
+	* Socket_Option, Integer_Socket_Option.
+	*/
+#if defined(GENERATING_DOCUMENTATION)
+	typedef implementation_defined fragment_interleave;
+#else
+	typedef boost::asio::detail::socket_option::integer<
+		IPPROTO_SCTP, SCTP_FRAGMENT_INTERLEAVE> fragment_interleave;
+#endif
+
+	/// Socket option for timestamping received data in the kernel.
+	/**
+	* Implements the SOL_SOCKET/SO_TIMESTAMPNS socket option. Once set,
+	* receive_message reports in sctp_receive_info::timestamp_ns when the kernel
+	* queued each piece of data on the socket.
+	*
+	* @par Examples
+	* Setting the option:
+	* @code
+	* boost::asio_sctp::ip::sctp::socket socket(io_service);
+	* ...
+	* boost::asio_sctp::ip::sctp::receive_timestamps option(true);
+	* socket.set_option(option);
+	* @endcode
+	*
+	* @par Concepts:
+	* Socket_Option, Boolean_Socket_Option.
+	*/
+#if defined(GENERATING_DOCUMENTATION)
+	typedef implementation_defined receive_timestamps;
+#else
+	typedef boost::asio::detail::socket_option::boolean<
+		SOL_SOCKET, SO_TIMESTAMPNS> receive_timestamps;
+#endif
+
+	/// Socket option to follow the local machine's addresses automatically.
+	/**
+	* Implements the IPPROTO_SCTP/SCTP_AUTO_ASCONF socket option. A socket bound
+	* to the wildcard address which has this set adds addresses as they appear on
+	* the local machine, and removes them as they go, telling the peers of its
+	* associations with ASCONF chunks. The net.sctp.auto_asconf sysctl sets the
+	* default for new sockets. Sockets bound to particular addresses are not
+	* affected; see sctp_address_watcher.
+	*
+	* @par Examples
+	* Setting the option:
+	* @code
+	* boost::asio_sctp::ip::sctp::acceptor acceptor(io_service);
+	* ...
+	* boost::asio_sctp::ip::sctp::auto_asconf option(true);
+	* acceptor.set_option(option);
+	* @endcode
+	*
+	* @par Concepts:
+	* Socket_Option, Boolean_Socket_Option.
+	*/
+#if defined(GENERATING_DOCUMENTATION)
+	typedef implementation_defined auto_asconf;
+#elif defined(SCTP_AUTO_ASCONF)
+	typedef boost::asio::detail::socket_option::boolean<
+		IPPROTO_SCTP, SCTP_AUTO_ASCONF> auto_asconf;
+#endif
+
 	/// Compare two protocols for equality.
 	friend bool operator==(const sctp& p1, const sctp& p2)
 	{
-		return p1.family_ == p2.family_;
+		return p1.family_ == p2.family_ && p1.type_ == p2.type_;
 	}
 
 	/// Compare two protocols for inequality.
 	friend bool operator!=(const sctp& p1, const sctp& p2)
 	{
-		return p1.family_ != p2.family_;
+		return !(p1 == p2);
 	}
 
 private:
-	// Construct with a specific family.
-	explicit sctp(int family)
-		: family_(family)
+	// Construct with a specific family and socket type.
+	explicit sctp(int family, int type = SOCK_STREAM)
+		: family_(family), type_(type)
 	{
 	}
 
 	int family_;
+	int type_;
 };
 
 } // namespace ip
@@ -332,11 +442,708 @@ private:
 	sctp_paddrparams peerAddrParams;
 };
 
+#if defined(SCTP_INTERLEAVING_SUPPORTED)
+// Enables RFC 8260 user message interleaving (I-DATA) for new associations.
+// Must be set on the listening or connecting socket, together with
+// fragment_interleave level 2, before the association is established.
+class sctp_interleaving_supported
+{
+public:
+	// Construct with a specific option value.
+	explicit sctp_interleaving_supported(bool enabled = false)
+	{
+		assocValue.assoc_id = 0;
+		assocValue.assoc_value = enabled ? 1 : 0;
+	}
+
+	// Set the current value of the option.
+	sctp_interleaving_supported& operator=(bool enabled)
+	{
+		assocValue.assoc_value = enabled ? 1 : 0;
+		return *this;
+	}
+
+	// Get the current value of the option.
+	bool value() const
+	{
+		return assocValue.assoc_value != 0;
+	}
+
+	// Get the level of the socket option.
+	template <typename Protocol>
+	int level(const Protocol&) const
+	{
+		return IPPROTO_SCTP;
+	}
+
+	// Get the name of the socket option.
+	template <typename Protocol>
+	int name(const Protocol&) const
+	{
+		return SCTP_INTERLEAVING_SUPPORTED;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	int* data(const Protocol&)
+	{
+		return (int*)&assocValue;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	const int* data(const Protocol&) const
+	{
+		return (int*)&assocValue;
+	}
+
+	// Get the size of the data.
+	template <typename Protocol>
+	std::size_t size(const Protocol&) const
+	{
+		return sizeof(assocValue);
+	}
+
+	// Set the size of the data.
+	template <typename Protocol>
+	void resize(const Protocol&, std::size_t s)
+	{
+		if (s != sizeof(assocValue))
+		{
+			std::length_error ex("sctp_interleaving_supported socket option resize");
+			boost::throw_exception(ex);
+		}
+	}
+
+private:
+	struct sctp_assoc_value assocValue;
+};
+#endif // defined(SCTP_INTERLEAVING_SUPPORTED)
+
+#if defined(SCTP_ASCONF_SUPPORTED)
+// Advertises support for dynamic address reconfiguration (RFC 5061) to the
+// peers of new associations. Without it on both ends, addresses added to or
+// removed from an established association are not passed on to the peer.
+class sctp_asconf_supported
+{
+public:
+	// Construct with a specific option value.
+	explicit sctp_asconf_supported(bool enabled = false)
+	{
+		assocValue.assoc_id = 0;
+		assocValue.assoc_value = enabled ? 1 : 0;
+	}
+
+	// Set the current value of the option.
+	sctp_asconf_supported& operator=(bool enabled)
+	{
+		assocValue.assoc_value = enabled ? 1 : 0;
+		return *this;
+	}
+
+	// Get the current value of the option.
+	bool value() const
+	{
+		return assocValue.assoc_value != 0;
+	}
+
+	// Get the level of the socket option.
+	template <typename Protocol>
+	int level(const Protocol&) const
+	{
+		return IPPROTO_SCTP;
+	}
+
+	// Get the name of the socket option.
+	template <typename Protocol>
+	int name(const Protocol&) const
+	{
+		return SCTP_ASCONF_SUPPORTED;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	int* data(const Protocol&)
+	{
+		return (int*)&assocValue;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	const int* data(const Protocol&) const
+	{
+		return (int*)&assocValue;
+	}
+
+	// Get the size of the data.
+	template <typename Protocol>
+	std::size_t size(const Protocol&) const
+	{
+		return sizeof(assocValue);
+	}
+
+	// Set the size of the data.
+	template <typename Protocol>
+	void resize(const Protocol&, std::size_t s)
+	{
+		if (s != sizeof(assocValue))
+		{
+			std::length_error ex("sctp_asconf_supported socket option resize");
+			boost::throw_exception(ex);
+		}
+	}
+
+private:
+	struct sctp_assoc_value assocValue;
+};
+#endif // defined(SCTP_ASCONF_SUPPORTED)
+
+// Asks the peer of a one-to-one association to send to one of our addresses
+// by preference, using an ASCONF Set Primary Address chunk. The address must
+// already be part of the association. Write only.
+class sctp_set_peer_primary_addr
+{
+public:
+	// Construct for a local endpoint.
+	template <typename Endpoint>
+	explicit sctp_set_peer_primary_addr(const Endpoint& local)
+	{
+		memset(&prim, 0, sizeof(prim));
+		memcpy(&prim.sspp_addr, local.data(), local.size());
+	}
+
+	// Get the level of the socket option.
+	template <typename Protocol>
+	int level(const Protocol&) const
+	{
+		return IPPROTO_SCTP;
+	}
+
+	// Get the name of the socket option.
+	template <typename Protocol>
+	int name(const Protocol&) const
+	{
+		return SCTP_SET_PEER_PRIMARY_ADDR;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	const int* data(const Protocol&) const
+	{
+		return (int*)&prim;
+	}
+
+	// Get the size of the data.
+	template <typename Protocol>
+	std::size_t size(const Protocol&) const
+	{
+		return sizeof(prim);
+	}
+
+private:
+	struct sctp_setpeerprim prim;
+};
+
+class sctp_status
+{
+public:
+	// Construct for the association of a one-to-one socket.
+	sctp_status()
+	{
+		memset(&status, 0, sizeof(status));
+	}
+
+	// Construct for a specific association of a one-to-many socket.
+	explicit sctp_status(sctp_assoc_t assocId)
+	{
+		memset(&status, 0, sizeof(status));
+		status.sstat_assoc_id = assocId;
+	}
+
+	// Get the current value of the structure
+	const sctp_status_t& value() const
+	{
+		return status;
+	}
+
+	// Number of DATA chunks queued in the kernel but not yet sent.
+	uint32_t pending_chunks() const
+	{
+		return status.sstat_penddata;
+	}
+
+	// Number of DATA chunks sent but not yet acknowledged.
+	uint32_t unacked_chunks() const
+	{
+		return status.sstat_unackdata;
+	}
+
+	// Smoothed round trip time on the primary path, in milliseconds; zero
+	// until the first measurement.
+	uint32_t srtt_ms() const
+	{
+		return status.sstat_primary.spinfo_srtt;
+	}
+
+	// Current retransmission timeout on the primary path, in milliseconds.
+	uint32_t rto_ms() const
+	{
+		return status.sstat_primary.spinfo_rto;
+	}
+
+	// Congestion window on the primary path, in bytes.
+	uint32_t cwnd() const
+	{
+		return status.sstat_primary.spinfo_cwnd;
+	}
+
+	// Path MTU of the primary path, in bytes.
+	uint32_t mtu() const
+	{
+		return status.sstat_primary.spinfo_mtu;
+	}
+
+	// The peer's receive window, in bytes.
+	uint32_t peer_rwnd() const
+	{
+		return status.sstat_rwnd;
+	}
+
+	// Association state, e.g. SCTP_ESTABLISHED.
+	int32_t state() const
+	{
+		return status.sstat_state;
+	}
+
+	// Number of outbound streams negotiated with the peer.
+	uint16_t outbound_streams() const
+	{
+		return status.sstat_outstrms;
+	}
+
+	// Get the level of the socket option.
+	template <typename Protocol>
+	int level(const Protocol&) const
+	{
+		return IPPROTO_SCTP;
+	}
+
+	// Get the name of the socket option.
+	template <typename Protocol>
+	int name(const Protocol&) const
+	{
+		return SCTP_STATUS;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	int* data(const Protocol&)
+	{
+		return (int*)&status;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	const int* data(const Protocol&) const
+	{
+		return (int*)&status;
+	}
+
+	// Get the size of the data.
+	template <typename Protocol>
+	std::size_t size(const Protocol&) const
+	{
+		return sizeof(status);
+	}
+
+	// Set the size of the data.
+	template <typename Protocol>
+	void resize(const Protocol&, std::size_t s)
+	{
+		if (s != sizeof(status))
+		{
+			std::length_error ex("sctp_status socket option resize");
+			boost::throw_exception(ex);
+		}
+	}
+
+private:
+	sctp_status_t status;
+};
+
+// Retransmission timeout bounds (RFC 4960 RTO.Initial, RTO.Max and RTO.Min).
+// On a one-to-one socket they apply to its association, on a listening
+// socket to associations accepted from then on. A zero field is left as it is.
+class sctp_rto_info
+{
+public:
+	// Construct for reading the current values.
+	sctp_rto_info()
+	{
+		memset(&rtoInfo, 0, sizeof(rtoInfo));
+	}
+
+	// Construct with specific values, in milliseconds.
+	sctp_rto_info(uint32_t initialMs, uint32_t minMs, uint32_t maxMs)
+	{
+		memset(&rtoInfo, 0, sizeof(rtoInfo));
+		rtoInfo.srto_initial = initialMs;
+		rtoInfo.srto_min = minMs;
+		rtoInfo.srto_max = maxMs;
+	}
+
+	// Get the initial RTO, in milliseconds.
+	uint32_t initial_ms() const
+	{
+		return rtoInfo.srto_initial;
+	}
+
+	// Get the minimum RTO, in milliseconds.
+	uint32_t min_ms() const
+	{
+		return rtoInfo.srto_min;
+	}
+
+	// Get the maximum RTO, in milliseconds.
+	uint32_t max_ms() const
+	{
+		return rtoInfo.srto_max;
+	}
+
+	// Get the level of the socket option.
+	template <typename Protocol>
+	int level(const Protocol&) const
+	{
+		return IPPROTO_SCTP;
+	}
+
+	// Get the name of the socket option.
+	template <typename Protocol>
+	int name(const Protocol&) const
+	{
+		return SCTP_RTOINFO;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	int* data(const Protocol&)
+	{
+		return (int*)&rtoInfo;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	const int* data(const Protocol&) const
+	{
+		return (int*)&rtoInfo;
+	}
+
+	// Get the size of the data.
+	template <typename Protocol>
+	std::size_t size(const Protocol&) const
+	{
+		return sizeof(rtoInfo);
+	}
+
+	// Set the size of the data.
+	template <typename Protocol>
+	void resize(const Protocol&, std::size_t s)
+	{
+		if (s != sizeof(rtoInfo))
+		{
+			std::length_error ex("sctp_rto_info socket option resize");
+			boost::throw_exception(ex);
+		}
+	}
+
+private:
+	struct sctp_rtoinfo rtoInfo;
+};
+
+// Association parameters. Only the retransmission limit (Association.Max.Retrans)
+// and cookie life can be set; a zero field is left as it is.
+class sctp_assoc_info
+{
+public:
+	// Construct for reading the current values.
+	sctp_assoc_info()
+	{
+		memset(&assocParams, 0, sizeof(assocParams));
+	}
+
+	// Construct to set the retransmission limit.
+	explicit sctp_assoc_info(uint16_t maxRetransmissions, uint32_t cookieLifeMs = 0)
+	{
+		memset(&assocParams, 0, sizeof(assocParams));
+		assocParams.sasoc_asocmaxrxt = maxRetransmissions;
+		assocParams.sasoc_cookie_life = cookieLifeMs;
+	}
+
+	// Get the number of retransmissions after which the association is aborted.
+	uint16_t max_retransmissions() const
+	{
+		return assocParams.sasoc_asocmaxrxt;
+	}
+
+	// Get the number of peer addresses.
+	uint16_t peer_destinations() const
+	{
+		return assocParams.sasoc_number_peer_destinations;
+	}
+
+	// Get the peer's receive window, in bytes.
+	uint32_t peer_rwnd() const
+	{
+		return assocParams.sasoc_peer_rwnd;
+	}
+
+	// Get the local receive window, in bytes.
+	uint32_t local_rwnd() const
+	{
+		return assocParams.sasoc_local_rwnd;
+	}
+
+	// Get the lifetime of state cookies, in milliseconds.
+	uint32_t cookie_life_ms() const
+	{
+		return assocParams.sasoc_cookie_life;
+	}
+
+	// Get the level of the socket option.
+	template <typename Protocol>
+	int level(const Protocol&) const
+	{
+		return IPPROTO_SCTP;
+	}
+
+	// Get the name of the socket option.
+	template <typename Protocol>
+	int name(const Protocol&) const
+	{
+		return SCTP_ASSOCINFO;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	int* data(const Protocol&)
+	{
+		return (int*)&assocParams;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	const int* data(const Protocol&) const
+	{
+		return (int*)&assocParams;
+	}
+
+	// Get the size of the data.
+	template <typename Protocol>
+	std::size_t size(const Protocol&) const
+	{
+		return sizeof(assocParams);
+	}
+
+	// Set the size of the data.
+	template <typename Protocol>
+	void resize(const Protocol&, std::size_t s)
+	{
+		if (s != sizeof(assocParams))
+		{
+			std::length_error ex("sctp_assoc_info socket option resize");
+			boost::throw_exception(ex);
+		}
+	}
+
+private:
+	struct sctp_assocparams assocParams;
+};
+
+// Stream counts and INIT retransmission limits offered when associating. Set
+// on a socket before connect(), or on a listening socket; a zero field uses
+// the system default.
+class sctp_init_msg
+{
+public:
+	// Construct for reading the current values.
+	sctp_init_msg()
+	{
+		memset(&initMsg, 0, sizeof(initMsg));
+	}
+
+	// Construct to request stream counts.
+	sctp_init_msg(uint16_t outStreams, uint16_t maxInStreams,
+		uint16_t maxAttempts = 0, uint16_t maxInitTimeoutMs = 0)
+	{
+		memset(&initMsg, 0, sizeof(initMsg));
+		initMsg.sinit_num_ostreams = outStreams;
+		initMsg.sinit_max_instreams = maxInStreams;
+		initMsg.sinit_max_attempts = maxAttempts;
+		initMsg.sinit_max_init_timeo = maxInitTimeoutMs;
+	}
+
+	// Get the number of outbound streams requested.
+	uint16_t out_streams() const
+	{
+		return initMsg.sinit_num_ostreams;
+	}
+
+	// Get the largest number of inbound streams accepted.
+	uint16_t max_in_streams() const
+	{
+		return initMsg.sinit_max_instreams;
+	}
+
+	// Get the level of the socket option.
+	template <typename Protocol>
+	int level(const Protocol&) const
+	{
+		return IPPROTO_SCTP;
+	}
+
+	// Get the name of the socket option.
+	template <typename Protocol>
+	int name(const Protocol&) const
+	{
+		return SCTP_INITMSG;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	int* data(const Protocol&)
+	{
+		return (int*)&initMsg;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	const int* data(const Protocol&) const
+	{
+		return (int*)&initMsg;
+	}
+
+	// Get the size of the data.
+	template <typename Protocol>
+	std::size_t size(const Protocol&) const
+	{
+		return sizeof(initMsg);
+	}
+
+	// Set the size of the data.
+	template <typename Protocol>
+	void resize(const Protocol&, std::size_t s)
+	{
+		if (s != sizeof(initMsg))
+		{
+			std::length_error ex("sctp_init_msg socket option resize");
+			boost::throw_exception(ex);
+		}
+	}
+
+private:
+	struct sctp_initmsg initMsg;
+};
+
+#if defined(SCTP_GET_ASSOC_STATS)
+// Association counters (read only, Linux 3.11 and later). max_rto_ms() is the
+// largest RTO seen since it was last read.
+class sctp_assoc_stats
+{
+public:
+	// Construct for the association of a one-to-one socket.
+	sctp_assoc_stats()
+	{
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	// Get the current value of the structure
+	const sctp_assoc_stats_t& value() const
+	{
+		return stats;
+	}
+
+	// Number of packets sent.
+	uint64_t packets_sent() const
+	{
+		return stats.sas_opackets;
+	}
+
+	// Number of packets received.
+	uint64_t packets_received() const
+	{
+		return stats.sas_ipackets;
+	}
+
+	// Number of DATA chunks sent, ordered and unordered.
+	uint64_t data_chunks_sent() const
+	{
+		return stats.sas_oodchunks + stats.sas_ouodchunks;
+	}
+
+	// Number of DATA chunks retransmitted.
+	uint64_t retransmitted_chunks() const
+	{
+		return stats.sas_rtxchunks;
+	}
+
+	// Largest RTO since the last read, in milliseconds.
+	uint64_t max_rto_ms() const
+	{
+		return stats.sas_maxrto;
+	}
+
+	// Get the level of the socket option.
+	template <typename Protocol>
+	int level(const Protocol&) const
+	{
+		return IPPROTO_SCTP;
+	}
+
+	// Get the name of the socket option.
+	template <typename Protocol>
+	int name(const Protocol&) const
+	{
+		return SCTP_GET_ASSOC_STATS;
+	}
+
+	// Get the address of the data.
+	template <typename Protocol>
+	int* data(const Protocol&)
+	{
+		return (int*)&stats;
+	}
+
+	// Get the size of the data.
+	template <typename Protocol>
+	std::size_t size(const Protocol&) const
+	{
+		return sizeof(stats);
+	}
+
+	// Set the size of the data; older kernels return fewer counters.
+	template <typename Protocol>
+	void resize(const Protocol&, std::size_t s)
+	{
+		if (s > sizeof(stats))
+		{
+			std::length_error ex("sctp_assoc_stats socket option resize");
+			boost::throw_exception(ex);
+		}
+	}
+
+private:
+	sctp_assoc_stats_t stats;
+};
+#endif // defined(SCTP_GET_ASSOC_STATS)
+
 } // namespace socket_option
 } // namespace asio_sctp
 } // namespace boost
 
 #include <boost/asio/detail/pop_options.hpp>
 
+// After the socket options, which the iostream sets.
+#include <boost/asio_sctp/sctp_iostream.hpp>
+
 #endif // BOOST_ASIO_SCTP_IP_SCTP_HPP
 
@@ -0,0 +1,145 @@
+//
+// latency_histogram.hpp
+// ~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_LATENCY_HISTOGRAM_HPP
+#define BOOST_ASIO_SCTP_LATENCY_HISTOGRAM_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <cstring>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/asio_sctp/detail/atomic.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Fixed-size log-linear histogram of latencies in nanoseconds.
+/**
+ * Each power-of-two range is split into 16 linear sub-buckets, giving a
+ * relative error of at most 1/16 from 1ns up to 2^47ns (about 39 hours).
+ * Recording is a single atomic increment, so any number of threads may
+ * record concurrently; reading while recording gives an approximate snapshot.
+ */
+class latency_histogram
+	: private boost::noncopyable
+{
+public:
+	enum { sub_bits = 4, sub_buckets = 1 << sub_bits, ranges = 44,
+		bucket_count = ranges * sub_buckets };
+
+	latency_histogram()
+	{
+		reset();
+	}
+
+	/// Clear all counts.
+	void reset()
+	{
+		std::memset(const_cast<boost::uint64_t*>(counts_), 0, sizeof(counts_));
+		count_ = 0;
+		max_ = 0;
+	}
+
+	/// Record one sample.
+	void record(boost::uint64_t ns)
+	{
+		detail::atomic::fetch_add(counts_[bucket_of(ns)], boost::uint64_t(1));
+		detail::atomic::fetch_add(count_, boost::uint64_t(1));
+		boost::uint64_t max = max_;
+		while (ns > max && !detail::atomic::compare_exchange(max_, max, ns))
+			max = max_;
+	}
+
+	/// Number of samples recorded.
+	boost::uint64_t count() const
+	{
+		return detail::atomic::load_acquire(count_);
+	}
+
+	/// Largest sample recorded.
+	boost::uint64_t max() const
+	{
+		return detail::atomic::load_acquire(max_);
+	}
+
+	/// Upper bound of the bucket holding the given percentile (0-100).
+	boost::uint64_t percentile(double p) const
+	{
+		boost::uint64_t total = count();
+		if (total == 0)
+			return 0;
+		boost::uint64_t rank = static_cast<boost::uint64_t>(p / 100.0 * total + 0.5);
+		if (rank == 0)
+			rank = 1;
+		boost::uint64_t seen = 0;
+		for (std::size_t i = 0; i < bucket_count; ++i)
+		{
+			seen += counts_[i];
+			if (seen >= rank)
+			{
+				boost::uint64_t upper = upper_bound_of(i);
+				return upper < max() ? upper : max();
+			}
+		}
+		return max();
+	}
+
+	/// Add another histogram's counts to this one.
+	void merge(const latency_histogram& other)
+	{
+		for (std::size_t i = 0; i < bucket_count; ++i)
+			detail::atomic::fetch_add(counts_[i], other.counts_[i]);
+		detail::atomic::fetch_add(count_, other.count());
+		boost::uint64_t max = max_;
+		while (other.max() > max && !detail::atomic::compare_exchange(max_, max, other.max()))
+			max = max_;
+	}
+
+private:
+	static std::size_t bucket_of(boost::uint64_t ns)
+	{
+		if (ns < sub_buckets)
+			return static_cast<std::size_t>(ns);
+		int msb = 63 - __builtin_clzll(ns);
+		std::size_t range = msb - sub_bits + 1;
+		if (range >= ranges)
+			return bucket_count - 1;
+		std::size_t sub = static_cast<std::size_t>(ns >> (msb - sub_bits)) & (sub_buckets - 1);
+		return range * sub_buckets + sub;
+	}
+
+	static boost::uint64_t upper_bound_of(std::size_t bucket)
+	{
+		std::size_t range = bucket / sub_buckets;
+		std::size_t sub = bucket % sub_buckets;
+		if (range == 0)
+			return sub;
+		int shift = static_cast<int>(range) - 1;
+		return ((boost::uint64_t(sub_buckets + sub + 1)) << shift) - 1;
+	}
+
+	volatile boost::uint64_t counts_[bucket_count];
+	volatile boost::uint64_t count_;
+	volatile boost::uint64_t max_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_LATENCY_HISTOGRAM_HPP
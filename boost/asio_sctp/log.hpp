@@ -0,0 +1,382 @@
+//
+// log.hpp
+// ~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_LOG_HPP
+#define BOOST_ASIO_SCTP_LOG_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/asio_sctp/detail/log_ring.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+/// Records below this level are compiled out entirely.
+#ifndef BOOST_ASIO_SCTP_LOG_LEVEL
+#define BOOST_ASIO_SCTP_LOG_LEVEL info
+#endif
+
+/// How long the output thread sleeps when there is nothing to write.
+#ifndef BOOST_ASIO_SCTP_LOG_POLL_MS
+#define BOOST_ASIO_SCTP_LOG_POLL_MS 5
+#endif
+
+/// Log a record without blocking the calling thread.
+/**
+ * The arguments are a parenthesised format literal followed by up to four
+ * integer or string arguments, each substituted for a "{}" placeholder.
+ * If the level is below BOOST_ASIO_SCTP_LOG_LEVEL the arguments are not even
+ * evaluated.
+ *
+ * @par Example
+ * @code
+ * BOOST_ASIO_SCTP_LOG(debug, ("received {} bytes on stream {}", n, stream));
+ * @endcode
+ */
+#define BOOST_ASIO_SCTP_LOG(lvl, args) \
+	do \
+	{ \
+		if (::boost::asio_sctp::logging::is_enabled< \
+			::boost::asio_sctp::logging::lvl>::value) \
+			::boost::asio_sctp::logging::write< \
+				::boost::asio_sctp::logging::lvl> args; \
+	} while (0)
+
+namespace boost {
+namespace asio_sctp {
+namespace logging {
+
+enum level
+{
+	trace,
+	debug,
+	info,
+	warning,
+	error
+};
+
+/// Compile-time level filter.
+template <level Level>
+struct is_enabled
+{
+	static const bool value = (Level >= BOOST_ASIO_SCTP_LOG_LEVEL);
+};
+
+/// A single log argument, captured without allocation.
+class argument
+{
+public:
+	argument(int v) : type_(detail::log_record::integer_arg), integer_(v), text_(0) {}
+	argument(long v) : type_(detail::log_record::integer_arg), integer_(v), text_(0) {}
+	argument(long long v) : type_(detail::log_record::integer_arg), integer_(v), text_(0) {}
+	argument(unsigned int v) : type_(detail::log_record::unsigned_arg), integer_(v), text_(0) {}
+	argument(unsigned long v) : type_(detail::log_record::unsigned_arg), integer_(v), text_(0) {}
+	argument(unsigned long long v) : type_(detail::log_record::unsigned_arg), integer_(v), text_(0) {}
+	argument(const char* v) : type_(detail::log_record::string_arg), integer_(0), text_(v) {}
+	argument(const std::string& v) : type_(detail::log_record::string_arg), integer_(0), text_(v.c_str()) {}
+
+	// Copy the argument into slot n of a record.
+	void store(detail::log_record& rec, std::size_t& text_used) const
+	{
+		std::size_t n = rec.arg_count++;
+		rec.types[n] = static_cast<unsigned char>(type_);
+		if (type_ != detail::log_record::string_arg)
+		{
+			rec.args[n].integer = integer_;
+			return;
+		}
+		// Strings share the record's text area and are truncated to fit.
+		std::size_t avail = detail::log_record::text_size - text_used;
+		std::size_t len = avail ? std::strlen(text_) : 0;
+		if (len >= avail)
+			len = avail ? avail - 1 : 0;
+		rec.args[n].text_offset = text_used;
+		if (avail)
+		{
+			std::memcpy(rec.text + text_used, text_, len);
+			rec.text[text_used + len] = '\0';
+			text_used += len + 1;
+		}
+		else
+		{
+			rec.types[n] = detail::log_record::integer_arg;
+			rec.args[n].integer = 0;
+		}
+	}
+
+private:
+	int type_;
+	long long integer_;
+	const char* text_;
+};
+
+/// Owns the per-thread rings and the background output thread.
+class logger
+	: private boost::noncopyable
+{
+public:
+	static logger& instance()
+	{
+		static logger the_logger;
+		return the_logger;
+	}
+
+	/// Redirect output (stdout by default).
+	void set_output(std::FILE* output)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		output_ = output;
+	}
+
+	/// The calling thread's ring, created on first use.
+	detail::log_ring& local_ring()
+	{
+		detail::log_ring* ring = local_ring_.get();
+		if (!ring)
+		{
+			ring = new detail::log_ring;
+			local_ring_.reset(ring);
+			boost::mutex::scoped_lock lock(mutex_);
+			rings_.push_back(ring);
+		}
+		return *ring;
+	}
+
+	/// Total records discarded because a ring was full.
+	std::size_t dropped() const
+	{
+		return detail::atomic::load_acquire(dropped_);
+	}
+
+	~logger()
+	{
+		detail::atomic::store_release(stopping_, true);
+		thread_.join();
+	}
+
+private:
+	logger()
+		: output_(stdout),
+			local_ring_(&logger::release_ring),
+			retired_dropped_(0),
+			dropped_(0),
+			stopping_(false),
+			thread_(&logger::run, this)
+	{
+	}
+
+	// The ring outlives its thread until the output thread has drained it.
+	static void release_ring(detail::log_ring* ring)
+	{
+		ring->close();
+	}
+
+	struct formatter
+	{
+		explicit formatter(std::FILE* out) : out_(out) {}
+
+		void operator()(const detail::log_record& rec)
+		{
+			static const char* const names[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR" };
+			char stamp[32];
+			struct tm tm_time;
+			time_t secs = rec.time.tv_sec;
+			localtime_r(&secs, &tm_time);
+			std::strftime(stamp, sizeof(stamp), "%H:%M:%S", &tm_time);
+			std::fprintf(out_, "%s.%06ld %-5s ", stamp, rec.time.tv_nsec / 1000, names[rec.level]);
+
+			std::size_t n = 0;
+			for (const char* p = rec.format; *p; ++p)
+			{
+				if (p[0] == '{' && p[1] == '}' && n < rec.arg_count)
+				{
+					switch (rec.types[n])
+					{
+					case detail::log_record::integer_arg:
+						std::fprintf(out_, "%lld", rec.args[n].integer);
+						break;
+					case detail::log_record::unsigned_arg:
+						std::fprintf(out_, "%llu", rec.args[n].unsigned_integer);
+						break;
+					default:
+						std::fputs(rec.text + rec.args[n].text_offset, out_);
+						break;
+					}
+					++n;
+					++p;
+				}
+				else
+				{
+					std::fputc(*p, out_);
+				}
+			}
+			std::fputc('\n', out_);
+		}
+
+		std::FILE* out_;
+	};
+
+	// Drain every ring; returns the number of records written.
+	std::size_t drain()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		formatter format(output_);
+		std::size_t written = 0;
+		std::size_t dropped = 0;
+		for (std::size_t i = 0; i < rings_.size(); )
+		{
+			detail::log_ring* ring = rings_[i];
+			bool closed = ring->closed();  // read before draining so nothing is lost
+			written += ring->consume(format);
+			if (closed)
+			{
+				retired_dropped_ += ring->dropped();
+				rings_[i] = rings_.back();
+				rings_.pop_back();
+				delete ring;
+			}
+			else
+			{
+				dropped += ring->dropped();
+				++i;
+			}
+		}
+		dropped += retired_dropped_;
+		if (dropped != detail::atomic::load_acquire(dropped_))
+		{
+			std::fprintf(output_, "log: %lu records dropped\n", (unsigned long)dropped);
+			detail::atomic::store_release(dropped_, dropped);
+			++written;
+		}
+		if (written)
+			std::fflush(output_);
+		return written;
+	}
+
+	void run()
+	{
+		while (!detail::atomic::load_acquire(stopping_))
+		{
+			if (!drain())
+				boost::this_thread::sleep(boost::posix_time::milliseconds(BOOST_ASIO_SCTP_LOG_POLL_MS));
+		}
+		drain();
+	}
+
+	boost::mutex mutex_;
+	std::FILE* output_;
+	std::vector<detail::log_ring*> rings_;
+	boost::thread_specific_ptr<detail::log_ring> local_ring_;
+	std::size_t retired_dropped_;
+	volatile std::size_t dropped_;
+	volatile bool stopping_;
+	boost::thread thread_;
+};
+
+template <level Level>
+inline detail::log_record* begin_record(detail::log_ring& ring, const char* format)
+{
+	detail::log_record* rec = ring.reserve();
+	if (rec)
+	{
+		rec->level = Level;
+		clock_gettime(CLOCK_REALTIME, &rec->time);
+		rec->format = format;
+		rec->arg_count = 0;
+	}
+	return rec;
+}
+
+/// Append a record to the calling thread's ring; never blocks.
+/**
+ * If the ring is full the record is counted as dropped and discarded.
+ */
+template <level Level>
+inline void write(const char* format)
+{
+	detail::log_ring& ring = logger::instance().local_ring();
+	if (begin_record<Level>(ring, format))
+		ring.commit();
+}
+
+template <level Level>
+inline void write(const char* format, const argument& a1)
+{
+	detail::log_ring& ring = logger::instance().local_ring();
+	if (detail::log_record* rec = begin_record<Level>(ring, format))
+	{
+		std::size_t text_used = 0;
+		a1.store(*rec, text_used);
+		ring.commit();
+	}
+}
+
+template <level Level>
+inline void write(const char* format, const argument& a1, const argument& a2)
+{
+	detail::log_ring& ring = logger::instance().local_ring();
+	if (detail::log_record* rec = begin_record<Level>(ring, format))
+	{
+		std::size_t text_used = 0;
+		a1.store(*rec, text_used);
+		a2.store(*rec, text_used);
+		ring.commit();
+	}
+}
+
+template <level Level>
+inline void write(const char* format, const argument& a1, const argument& a2,
+	const argument& a3)
+{
+	detail::log_ring& ring = logger::instance().local_ring();
+	if (detail::log_record* rec = begin_record<Level>(ring, format))
+	{
+		std::size_t text_used = 0;
+		a1.store(*rec, text_used);
+		a2.store(*rec, text_used);
+		a3.store(*rec, text_used);
+		ring.commit();
+	}
+}
+
+template <level Level>
+inline void write(const char* format, const argument& a1, const argument& a2,
+	const argument& a3, const argument& a4)
+{
+	detail::log_ring& ring = logger::instance().local_ring();
+	if (detail::log_record* rec = begin_record<Level>(ring, format))
+	{
+		std::size_t text_used = 0;
+		a1.store(*rec, text_used);
+		a2.store(*rec, text_used);
+		a3.store(*rec, text_used);
+		a4.store(*rec, text_used);
+		ring.commit();
+	}
+}
+
+} // namespace logging
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_LOG_HPP
@@ -0,0 +1,205 @@
+//
+// message_dispatcher.hpp
+// ~~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_MESSAGE_DISPATCHER_HPP
+#define BOOST_ASIO_SCTP_MESSAGE_DISPATCHER_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <boost/mpl/begin_end.hpp>
+#include <boost/mpl/deref.hpp>
+#include <boost/mpl/next.hpp>
+#include <boost/mpl/vector.hpp>
+#include <boost/preprocessor/repetition/enum.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Wildcard for the message class of a dispatch rule.
+const unsigned any_message_class = 0x100;
+
+/// Wildcard for the payload protocol identifier of a dispatch rule.
+const uint32_t any_ppid = 0xffffffff;
+
+/// Describes where the dispatch fields live in a message header.
+/**
+ * The message type selects the jump-table slot, so it must be a single byte.
+ * The message class is compared against the rules sharing that slot.
+ */
+template <std::size_t TypeOffset, std::size_t ClassOffset, std::size_t MinLength>
+struct byte_header_layout
+{
+	static const std::size_t min_length = MinLength;
+
+	static unsigned message_type(const unsigned char* data)
+	{
+		return data[TypeOffset];
+	}
+
+	static unsigned message_class(const unsigned char* data)
+	{
+		return data[ClassOffset];
+	}
+};
+
+/// Version at offset 0, class at offset 2 and type at offset 3.
+typedef byte_header_layout<3, 2, 4> default_header_layout;
+
+/// Associates a handler with a message type, class, PPID and stream range.
+/**
+ * Handler must provide:
+ * @code
+ * static void handle(Context& ctx, const boost::asio_sctp::sctp_message& msg);
+ * @endcode
+ */
+template <typename Handler, unsigned Type,
+	unsigned Class = any_message_class, uint32_t Ppid = any_ppid,
+	uint16_t FirstStream = 0, uint16_t LastStream = 0xffff>
+struct dispatch_rule
+{
+	typedef Handler handler_type;
+	static const unsigned message_type = Type;
+
+	// All comparisons against wildcards fold away at compile time.
+	static bool matches(const sctp_message& msg, unsigned msg_class)
+	{
+		return (Class == any_message_class || msg_class == Class)
+			&& (Ppid == any_ppid || msg.ppid == Ppid)
+			&& ((FirstStream == 0 && LastStream == 0xffff)
+				|| (msg.stream >= FirstStream && msg.stream <= LastStream));
+	}
+};
+
+/// Fallback which silently discards unmatched messages.
+struct ignore_unhandled
+{
+	template <typename Context>
+	static void handle(Context&, const sctp_message&)
+	{
+	}
+};
+
+namespace detail {
+
+// Walks the rules for one message type; unrolled entirely at compile time.
+template <typename Context, typename Layout, typename Fallback, unsigned Type,
+	typename First, typename Last>
+struct dispatch_chain
+{
+	typedef typename boost::mpl::deref<First>::type rule;
+	typedef dispatch_chain<Context, Layout, Fallback, Type,
+		typename boost::mpl::next<First>::type, Last> next;
+
+	static bool call(Context& ctx, const sctp_message& msg)
+	{
+		if (rule::message_type == Type
+			&& rule::matches(msg, Layout::message_class(msg.data)))
+		{
+			rule::handler_type::handle(ctx, msg);
+			return true;
+		}
+		return next::call(ctx, msg);
+	}
+};
+
+template <typename Context, typename Layout, typename Fallback, unsigned Type,
+	typename Last>
+struct dispatch_chain<Context, Layout, Fallback, Type, Last, Last>
+{
+	static bool call(Context& ctx, const sctp_message& msg)
+	{
+		Fallback::handle(ctx, msg);
+		return false;
+	}
+};
+
+template <typename Context, typename Rules, typename Layout, typename Fallback,
+	unsigned Type>
+struct dispatch_entry
+	: dispatch_chain<Context, Layout, Fallback, Type,
+		typename boost::mpl::begin<Rules>::type,
+		typename boost::mpl::end<Rules>::type>
+{
+};
+
+} // namespace detail
+
+/// Routes received messages to statically registered handlers.
+/**
+ * The rules are a Boost.MPL sequence of dispatch_rule instantiations. At
+ * compile time they are expanded into a 256-entry table of function pointers,
+ * indexed by the message type byte; each slot holds the fully inlined chain of
+ * rules for that type. Dispatching a message is therefore one bounds check,
+ * one indirect call and a handful of constant comparisons, independent of the
+ * number of registered handlers, with no virtual calls or allocation.
+ *
+ * @par Example
+ * @code
+ * struct on_attach
+ * {
+ *   static void handle(connection& c, const boost::asio_sctp::sctp_message& m);
+ * };
+ *
+ * typedef boost::mpl::vector<
+ *   boost::asio_sctp::dispatch_rule<on_attach, 0x01, 0x02, 46>
+ * > rules;
+ *
+ * boost::asio_sctp::message_dispatcher<connection, rules>::dispatch(conn, msg);
+ * @endcode
+ */
+template <typename Context, typename Rules,
+	typename Layout = default_header_layout,
+	typename Fallback = ignore_unhandled>
+class message_dispatcher
+{
+public:
+	typedef bool (*entry_type)(Context&, const sctp_message&);
+
+	/// Dispatch a message, returning false if no rule matched.
+	static bool dispatch(Context& ctx, const sctp_message& msg)
+	{
+		if (msg.size < Layout::min_length)
+		{
+			Fallback::handle(ctx, msg);
+			return false;
+		}
+		return table_[Layout::message_type(msg.data)](ctx, msg);
+	}
+
+private:
+	static const entry_type table_[256];
+};
+
+#define BOOST_ASIO_SCTP_DISPATCH_ENTRY(z, n, data) \
+	&detail::dispatch_entry<Context, Rules, Layout, Fallback, n>::call
+
+// Constant-initialised: the table is laid out by the compiler, not at startup.
+template <typename Context, typename Rules, typename Layout, typename Fallback>
+const typename message_dispatcher<Context, Rules, Layout, Fallback>::entry_type
+message_dispatcher<Context, Rules, Layout, Fallback>::table_[256] =
+{
+	BOOST_PP_ENUM(256, BOOST_ASIO_SCTP_DISPATCH_ENTRY, ~)
+};
+
+#undef BOOST_ASIO_SCTP_DISPATCH_ENTRY
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_MESSAGE_DISPATCHER_HPP
@@ -0,0 +1,699 @@
+//
+// sctp_address_watcher.hpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_ADDRESS_WATCHER_HPP
+#define BOOST_ASIO_SCTP_SCTP_ADDRESS_WATCHER_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <unistd.h>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/detail/throw_error.hpp>
+#include <boost/asio_sctp/ip/sctp.hpp>
+#include <boost/asio_sctp/log.hpp>
+#include <boost/asio_sctp/sctp_handler_allocator.hpp>
+#include <boost/asio_sctp/detail/sctp_socket_ops.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Carries changes to the local machine's addresses over to live associations.
+/**
+ * The watcher listens to the kernel's routing netlink for addresses coming
+ * and going, and adds each new address to, or removes each lost one from,
+ * the listening sockets and associations registered with it (sctp_bindx).
+ * On an established association the kernel passes the change to the peer in
+ * an ASCONF chunk, so the peer starts using a new link as soon as it is up and
+ * stops using a dead one at once, instead of noticing through heartbeat
+ * timeouts; the association is never re-established.
+ *
+ * A socket bound to the wildcard address needs no help: registering it turns
+ * on ip::sctp::auto_asconf and the kernel does the same by itself. Sockets
+ * bound to particular addresses are handled by the watcher, which is why an
+ * association accepted from such a listener must be registered as well; it
+ * has its own copy of the listener's addresses. Loopback, link-local and
+ * tentative addresses are never added, and a filter may narrow the rest down.
+ *
+ * If the kernel drops changes because the watcher fell behind (ENOBUFS), the
+ * watcher dumps the machine's addresses and compares them with each socket's
+ * bound set, adding what is missing and removing what is gone; overflows()
+ * counts these resyncs.
+ *
+ * A new address may also be promoted: if its interface's link is at least as
+ * fast as set with promote_links(), the peer of each association is asked to
+ * make it the primary path (sctp_set_peer_primary_addr), so traffic moves to
+ * the faster link rather than only being able to fail over to it.
+ *
+ * Both ends need address reconfiguration, which Linux advertises only with
+ * net.sctp.addip_enable, or socket_option::sctp_asconf_supported set on the
+ * listening socket before associations are set up; either requires
+ * authentication (net.sctp.auth_enable) as well.
+ *
+ * @par Example
+ * @code
+ * boost::asio_sctp::sctp_address_watcher watcher(io_service);
+ * watcher.promote_links(10000);  // 10 Gb/s or faster
+ * watcher.start();
+ * watcher.add(acceptor);
+ * ...
+ * acceptor.accept(socket);
+ * watcher.add(socket);
+ * ...
+ * watcher.remove(socket);
+ * socket.close();
+ * @endcode
+ *
+ * @par Thread Safety
+ * Sockets may be added and removed from any thread. Once remove() returns,
+ * the watcher no longer touches the socket, so it may be closed. The watcher
+ * must outlive its wait on the io_service, i.e. be stopped first.
+ */
+class sctp_address_watcher
+	: private boost::noncopyable
+{
+public:
+	/// Decides whether an address on an interface should be used.
+	typedef boost::function<bool (const boost::asio::ip::address&,
+		const std::string& interface_name)> filter_type;
+
+	explicit sctp_address_watcher(boost::asio::io_service& io_service)
+		: descriptor_(io_service),
+			promote_mbps_(0),
+			added_(0),
+			removed_(0),
+			promoted_(0),
+			failed_(0),
+			overflows_(0)
+	{
+	}
+
+	~sctp_address_watcher()
+	{
+		stop();
+	}
+
+	/// Subscribe to address changes and start applying them.
+	void start()
+	{
+		boost::system::error_code ec;
+		start(ec);
+		boost::asio::detail::throw_error(ec);
+	}
+
+	/// Subscribe to address changes and start applying them.
+	boost::system::error_code start(boost::system::error_code& ec)
+	{
+		int fd = ::socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+		if (fd < 0)
+			return ec = boost::system::error_code(errno, boost::asio::error::get_system_category());
+
+		struct sockaddr_nl local;
+		std::memset(&local, 0, sizeof(local));
+		local.nl_family = AF_NETLINK;
+		local.nl_groups = RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+		if (::bind(fd, reinterpret_cast<struct sockaddr*>(&local), sizeof(local)) != 0)
+		{
+			ec = boost::system::error_code(errno, boost::asio::error::get_system_category());
+			::close(fd);
+			return ec;
+		}
+
+		descriptor_.assign(fd, ec);
+		if (ec)
+		{
+			::close(fd);
+			return ec;
+		}
+		wait();
+		return ec;
+	}
+
+	/// Stop watching; the registered sockets are left as they are.
+	void stop()
+	{
+		boost::system::error_code ec;
+		descriptor_.close(ec);
+	}
+
+	/// Only use addresses the filter accepts; the default accepts all.
+	void set_filter(const filter_type& filter)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		filter_ = filter;
+	}
+
+	/// Promote new addresses on links of at least mbps Mb/s; 0 (the default) never does.
+	void promote_links(unsigned int mbps)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		promote_mbps_ = mbps;
+	}
+
+	/// Apply address changes to a listening socket or an association.
+	template <typename Socket>
+	void add(Socket& socket)
+	{
+		add_descriptor(socket.native_handle());
+	}
+
+	/// Stop applying address changes to a socket; call before closing it.
+	template <typename Socket>
+	void remove(Socket& socket)
+	{
+		remove_descriptor(socket.native_handle());
+	}
+
+	/// The speed of an interface's link in Mb/s, or 0 if it is unknown.
+	static unsigned int link_speed(const std::string& interface_name)
+	{
+		std::string path = "/sys/class/net/" + interface_name + "/speed";
+		std::FILE* f = std::fopen(path.c_str(), "r");
+		if (!f)
+			return 0;
+		int mbps = 0;
+		if (std::fscanf(f, "%d", &mbps) != 1 || mbps < 0)
+			mbps = 0;  // down, or a virtual link without a speed
+		std::fclose(f);
+		return mbps;
+	}
+
+	/// Addresses added to a socket so far.
+	unsigned long added() const
+	{
+		return added_;
+	}
+
+	/// Addresses removed from a socket so far.
+	unsigned long removed() const
+	{
+		return removed_;
+	}
+
+	/// Peers asked to make a new address their primary path so far.
+	unsigned long promoted() const
+	{
+		return promoted_;
+	}
+
+	/// Changes a socket refused so far.
+	unsigned long failed() const
+	{
+		return failed_;
+	}
+
+	/// Times the kernel dropped changes and the sockets were resynced.
+	unsigned long overflows() const
+	{
+		return overflows_;
+	}
+
+private:
+	struct entry
+	{
+		int fd;
+		unsigned short port;  // the socket is bound to
+		bool v4_only;  // an AF_INET socket, which cannot take IPv6 addresses
+		bool v6_only;  // an AF_INET6 socket with IPV6_V6ONLY
+		bool listener;
+	};
+
+	void add_descriptor(int fd)
+	{
+		if (detail::sctp_socket_ops::bridged())
+			return;  // the user-space transport has no kernel address set
+
+		sockaddr_storage local;
+		socklen_t len = sizeof(local);
+		if (::getsockname(fd, reinterpret_cast<struct sockaddr*>(&local), &len) != 0)
+		{
+			BOOST_ASIO_SCTP_LOG(warning, ("sctp_address_watcher - getsockname failed, errno {}", errno));
+			return;
+		}
+
+		entry e;
+		e.fd = fd;
+		e.v4_only = (local.ss_family == AF_INET);
+		e.v6_only = false;
+		bool wildcard;
+		if (e.v4_only)
+		{
+			const sockaddr_in* sin = reinterpret_cast<const sockaddr_in*>(&local);
+			e.port = ntohs(sin->sin_port);
+			wildcard = (sin->sin_addr.s_addr == htonl(INADDR_ANY));
+		}
+		else
+		{
+			const sockaddr_in6* sin6 = reinterpret_cast<const sockaddr_in6*>(&local);
+			e.port = ntohs(sin6->sin6_port);
+			wildcard = IN6_IS_ADDR_UNSPECIFIED(&sin6->sin6_addr);
+			int v6only = 0;
+			socklen_t optlen = sizeof(v6only);
+			if (::getsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, &optlen) == 0)
+				e.v6_only = (v6only != 0);
+		}
+		int accepting = 0;
+		socklen_t optlen = sizeof(accepting);
+		e.listener = (::getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &optlen) == 0 && accepting);
+
+		if (wildcard)
+		{
+#if defined(SCTP_AUTO_ASCONF)
+			// The kernel follows the addresses itself.
+			int on = 1;
+			if (::setsockopt(fd, IPPROTO_SCTP, SCTP_AUTO_ASCONF, &on, sizeof(on)) != 0)
+				BOOST_ASIO_SCTP_LOG(warning, ("sctp_address_watcher - SCTP_AUTO_ASCONF failed, errno {}", errno));
+#endif
+			return;
+		}
+
+		boost::mutex::scoped_lock lock(mutex_);
+		entries_.push_back(e);
+	}
+
+	void remove_descriptor(int fd)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		for (std::size_t i = 0; i < entries_.size(); ++i)
+		{
+			if (entries_[i].fd == fd)
+			{
+				entries_[i] = entries_.back();
+				entries_.pop_back();
+				return;
+			}
+		}
+	}
+
+	void wait()
+	{
+		descriptor_.async_read_some(boost::asio::null_buffers(), handler_memory_.wrap(
+			boost::bind(&sctp_address_watcher::on_readable, this,
+				boost::asio::placeholders::error)));
+	}
+
+	void on_readable(const boost::system::error_code& ec)
+	{
+		if (ec)
+		{
+			if (ec != boost::asio::error::operation_aborted)
+				BOOST_ASIO_SCTP_LOG(error, ("sctp_address_watcher - wait failed: {}", ec.message()));
+			return;
+		}
+
+		bool overflowed = false;
+		for (;;)
+		{
+			ssize_t n = ::recv(descriptor_.native_handle(), buffer_, sizeof(buffer_), MSG_DONTWAIT);
+			if (n < 0)
+			{
+				if (errno == ENOBUFS)
+				{
+					// The kernel dropped changes while we were behind; which ones
+					// is unknown, so the sockets are compared with a fresh dump
+					// once the changes that follow have been drained.
+					overflowed = true;
+					continue;
+				}
+				break;  // drained
+			}
+			parse(n);
+		}
+		if (overflowed)
+		{
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				++overflows_;
+			}
+			BOOST_ASIO_SCTP_LOG(warning, ("sctp_address_watcher - address changes lost, resyncing"));
+			resync();
+		}
+		wait();
+	}
+
+	void parse(std::size_t n)
+	{
+		int len = static_cast<int>(n);
+		for (const struct nlmsghdr* h = reinterpret_cast<const struct nlmsghdr*>(buffer_);
+			NLMSG_OK(h, len); h = NLMSG_NEXT(h, len))
+		{
+			if (h->nlmsg_type != RTM_NEWADDR && h->nlmsg_type != RTM_DELADDR)
+				continue;
+
+			boost::asio::ip::address a;
+			bool usable;
+			if (!decode(h, a, usable) || !usable)
+				continue;
+			apply(a, interface_name(h), h->nlmsg_type == RTM_NEWADDR);
+		}
+	}
+
+	// The address an RTM_NEWADDR or RTM_DELADDR message is about, and whether
+	// it may be added to a socket; false if it is neither IPv4 nor IPv6.
+	static bool decode(const struct nlmsghdr* h, boost::asio::ip::address& a, bool& usable)
+	{
+		const struct ifaddrmsg* ifa = static_cast<const struct ifaddrmsg*>(NLMSG_DATA(h));
+		unsigned int flags = ifa->ifa_flags;
+		const void* local = 0;
+		const void* address = 0;
+		int attrlen = IFA_PAYLOAD(h);
+		for (const struct rtattr* rta = IFA_RTA(ifa); RTA_OK(rta, attrlen); rta = RTA_NEXT(rta, attrlen))
+		{
+			if (rta->rta_type == IFA_LOCAL)
+				local = RTA_DATA(rta);
+			else if (rta->rta_type == IFA_ADDRESS)
+				address = RTA_DATA(rta);
+#if defined(IFA_FLAGS)
+			else if (rta->rta_type == IFA_FLAGS)
+				flags = *static_cast<const boost::uint32_t*>(RTA_DATA(rta));
+#endif
+		}
+		if (local)
+			address = local;  // on a point-to-point link IFA_ADDRESS is the far end
+		if (!address)
+			return false;
+
+		if (ifa->ifa_family == AF_INET)
+		{
+			boost::asio::ip::address_v4::bytes_type bytes;
+			std::memcpy(bytes.data(), address, bytes.size());
+			a = boost::asio::ip::address_v4(bytes);
+		}
+		else if (ifa->ifa_family == AF_INET6)
+		{
+			boost::asio::ip::address_v6::bytes_type bytes;
+			std::memcpy(bytes.data(), address, bytes.size());
+			a = boost::asio::ip::address_v6(bytes);
+		}
+		else
+			return false;
+
+		// Loopback and link-local addresses are no use to a peer; tentative ones
+		// are reported again once duplicate address detection is done.
+		usable = (ifa->ifa_scope < RT_SCOPE_LINK);
+		if (h->nlmsg_type == RTM_NEWADDR && (flags & (IFA_F_TENTATIVE | IFA_F_DADFAILED)))
+			usable = false;
+		return true;
+	}
+
+	static std::string interface_name(const struct nlmsghdr* h)
+	{
+		const struct ifaddrmsg* ifa = static_cast<const struct ifaddrmsg*>(NLMSG_DATA(h));
+		char name[IF_NAMESIZE] = "";
+		if (!::if_indextoname(ifa->ifa_index, name))
+			name[0] = '\0';
+		return name;
+	}
+
+	struct dumped
+	{
+		boost::asio::ip::address address;
+		std::string interface_name;
+		bool usable;
+	};
+
+	// Every address on the machine, from an RTM_GETADDR dump on a socket of its
+	// own, so that it cannot be mistaken for the changes being watched.
+	bool dump(std::vector<dumped>& addresses)
+	{
+		int fd = ::socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+		if (fd < 0)
+		{
+			BOOST_ASIO_SCTP_LOG(error, ("sctp_address_watcher - netlink socket failed, errno {}", errno));
+			return false;
+		}
+
+		struct
+		{
+			struct nlmsghdr header;
+			struct ifaddrmsg message;
+		} request;
+		std::memset(&request, 0, sizeof(request));
+		request.header.nlmsg_len = NLMSG_LENGTH(sizeof(request.message));
+		request.header.nlmsg_type = RTM_GETADDR;
+		request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+		request.header.nlmsg_seq = 1;
+		request.message.ifa_family = AF_UNSPEC;
+
+		struct sockaddr_nl kernel;
+		std::memset(&kernel, 0, sizeof(kernel));
+		kernel.nl_family = AF_NETLINK;
+		if (::sendto(fd, &request, request.header.nlmsg_len, 0,
+			reinterpret_cast<struct sockaddr*>(&kernel), sizeof(kernel)) < 0)
+		{
+			BOOST_ASIO_SCTP_LOG(error, ("sctp_address_watcher - address dump failed, errno {}", errno));
+			::close(fd);
+			return false;
+		}
+
+		bool done = false;
+		bool failed = false;
+		while (!done && !failed)
+		{
+			ssize_t n = ::recv(fd, buffer_, sizeof(buffer_), 0);
+			if (n < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				BOOST_ASIO_SCTP_LOG(error, ("sctp_address_watcher - address dump failed, errno {}", errno));
+				failed = true;
+				break;
+			}
+			int len = static_cast<int>(n);
+			for (const struct nlmsghdr* h = reinterpret_cast<const struct nlmsghdr*>(buffer_);
+				!done && !failed && NLMSG_OK(h, len); h = NLMSG_NEXT(h, len))
+			{
+				if (h->nlmsg_type == NLMSG_DONE)
+					done = true;
+				else if (h->nlmsg_type == NLMSG_ERROR)
+				{
+					BOOST_ASIO_SCTP_LOG(error, ("sctp_address_watcher - address dump refused"));
+					failed = true;
+				}
+				else if (h->nlmsg_type == RTM_NEWADDR)
+				{
+					dumped d;
+					if (decode(h, d.address, d.usable))
+					{
+						d.interface_name = interface_name(h);
+						addresses.push_back(d);
+					}
+				}
+			}
+		}
+		::close(fd);
+		return done;
+	}
+
+	// The addresses a socket is bound to.
+	static void bound(int fd, std::vector<boost::asio::ip::address>& addresses)
+	{
+		addresses.clear();
+		boost::asio::detail::socket_addr_type* addrs = 0;
+		boost::system::error_code ec;
+		int cnt = detail::sctp_socket_ops::getladdrs(fd, &addrs, ec);
+		const char* p = reinterpret_cast<const char*>(addrs);
+		for (int i = 0; i < cnt; ++i)
+		{
+			// Packed one after another, each as long as its family needs.
+			const sockaddr* sa = reinterpret_cast<const sockaddr*>(p);
+			if (sa->sa_family == AF_INET)
+			{
+				sockaddr_in sin;
+				std::memcpy(&sin, p, sizeof(sin));
+				addresses.push_back(boost::asio::ip::address_v4(ntohl(sin.sin_addr.s_addr)));
+				p += sizeof(sin);
+			}
+			else if (sa->sa_family == AF_INET6)
+			{
+				sockaddr_in6 sin6;
+				std::memcpy(&sin6, p, sizeof(sin6));
+				boost::asio::ip::address_v6::bytes_type bytes;
+				std::memcpy(bytes.data(), sin6.sin6_addr.s6_addr, bytes.size());
+				boost::asio::ip::address_v6 a(bytes);  // no scope, as in the dump
+				if (a.is_v4_mapped())
+					addresses.push_back(a.to_v4());
+				else
+					addresses.push_back(a);
+				p += sizeof(sin6);
+			}
+			else
+				break;
+		}
+		if (cnt > 0)
+			detail::sctp_socket_ops::freeladdrs(addrs);
+	}
+
+	// After an overflow: adds each usable address a socket is missing and
+	// removes each bound address the machine no longer has. New addresses are
+	// not promoted; whether they were announced on a fast link is unknown.
+	void resync()
+	{
+		std::vector<dumped> present;
+		if (!dump(present))
+			return;
+
+		boost::mutex::scoped_lock lock(mutex_);
+		std::vector<boost::asio::ip::address> addresses;
+		for (std::size_t i = 0; i < entries_.size(); ++i)
+		{
+			const entry& e = entries_[i];
+			bound(e.fd, addresses);
+
+			for (std::size_t j = 0; j < present.size(); ++j)
+			{
+				const dumped& d = present[j];
+				if (!d.usable || (d.address.is_v6() && e.v4_only) || (d.address.is_v4() && e.v6_only))
+					continue;
+				if (filter_ && !filter_(d.address, d.interface_name))
+					continue;
+				if (std::find(addresses.begin(), addresses.end(), d.address) != addresses.end())
+					continue;
+
+				ip::sctp::endpoint endpoint(d.address, e.port);
+				boost::system::error_code ec;
+				detail::sctp_socket_ops::bind_add(e.fd, endpoint.data(), endpoint.size(), ec);
+				if (ec && ec != boost::asio::error::address_in_use)
+				{
+					++failed_;
+					BOOST_ASIO_SCTP_LOG(debug, ("sctp_address_watcher - fd {}: {}", e.fd, ec.message()));
+				}
+				else if (!ec)
+				{
+					++added_;
+					BOOST_ASIO_SCTP_LOG(info, ("sctp_address_watcher - fd {}: added {} on resync",
+						e.fd, d.address.to_string()));
+				}
+			}
+
+			for (std::size_t j = 0; j < addresses.size(); ++j)
+			{
+				bool gone = true;
+				for (std::size_t k = 0; k < present.size() && gone; ++k)
+					gone = !(present[k].address == addresses[j]);
+				if (!gone)
+					continue;
+
+				ip::sctp::endpoint endpoint(addresses[j], e.port);
+				boost::system::error_code ec;
+				detail::sctp_socket_ops::bind_remove(e.fd, endpoint.data(), endpoint.size(), ec);
+				if (ec)
+				{
+					++failed_;  // e.g. the last address
+					BOOST_ASIO_SCTP_LOG(debug, ("sctp_address_watcher - fd {}: {}", e.fd, ec.message()));
+					continue;
+				}
+				++removed_;
+				BOOST_ASIO_SCTP_LOG(info, ("sctp_address_watcher - fd {}: removed {} on resync",
+					e.fd, addresses[j].to_string()));
+			}
+		}
+	}
+
+	void apply(const boost::asio::ip::address& a, const std::string& interface_name, bool added)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (filter_ && !filter_(a, interface_name))
+			return;
+
+		bool promote = false;
+		if (added && promote_mbps_ != 0)
+			promote = (link_speed(interface_name) >= promote_mbps_);
+
+		BOOST_ASIO_SCTP_LOG(info, ("sctp_address_watcher - {} {} on {}{}", added ? "adding" : "removing",
+			a.to_string(), interface_name, promote ? ", promoting" : ""));
+
+		for (std::size_t i = 0; i < entries_.size(); ++i)
+		{
+			const entry& e = entries_[i];
+			if ((a.is_v6() && e.v4_only) || (a.is_v4() && e.v6_only))
+				continue;
+
+			ip::sctp::endpoint endpoint(a, e.port);
+			boost::system::error_code ec;
+			if (added)
+			{
+				detail::sctp_socket_ops::bind_add(e.fd, endpoint.data(), endpoint.size(), ec);
+				if (ec == boost::asio::error::address_in_use)
+					continue;  // already there
+			}
+			else
+				detail::sctp_socket_ops::bind_remove(e.fd, endpoint.data(), endpoint.size(), ec);
+
+			if (ec)
+			{
+				// E.g. the last address, which cannot be removed, or a peer which
+				// does not support reconfiguration.
+				++failed_;
+				BOOST_ASIO_SCTP_LOG(debug, ("sctp_address_watcher - fd {}: {}", e.fd, ec.message()));
+				continue;
+			}
+			if (added)
+				++added_;
+			else
+				++removed_;
+
+			if (promote && !e.listener)
+			{
+				socket_option::sctp_set_peer_primary_addr primary(endpoint);
+				if (::setsockopt(e.fd, IPPROTO_SCTP, SCTP_SET_PEER_PRIMARY_ADDR,
+					primary.data(ip::sctp::v4()), primary.size(ip::sctp::v4())) == 0)
+					++promoted_;
+				else
+					++failed_;
+			}
+		}
+	}
+
+	boost::asio::posix::stream_descriptor descriptor_;  // the netlink socket
+	sctp_handler_allocator handler_memory_;  // for the readable wait
+	boost::mutex mutex_;  // guards the members below
+	std::vector<entry> entries_;
+	filter_type filter_;
+	unsigned int promote_mbps_;
+	unsigned long added_;
+	unsigned long removed_;
+	unsigned long promoted_;
+	unsigned long failed_;
+	unsigned long overflows_;
+	boost::uint32_t buffer_[2048];  // netlink messages, only touched by the readable handler
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_ADDRESS_WATCHER_HPP
@@ -0,0 +1,164 @@
+//
+// sctp_admission.hpp
+// ~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_ADMISSION_HPP
+#define BOOST_ASIO_SCTP_SCTP_ADMISSION_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <boost/asio/ip/address.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/asio_sctp/detail/atomic.hpp>
+#include <boost/asio_sctp/sctp_clock.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Decides which incoming associations a server takes on.
+/**
+ * Each source address has a token bucket: it may open burst associations at
+ * once, then rate per second. On top of that no more than max_active
+ * associations are admitted at a time. After an outage every client
+ * reconnects at once; this spreads the reconnections out so the server stays
+ * up to serve them, and stops one misbehaving peer from taking every slot.
+ *
+ * Buckets which have refilled carry no information and are dropped once more
+ * than max_sources addresses are being tracked.
+ *
+ * @par Thread Safety
+ * admit() must only be called from the thread which accepts; release() may be
+ * called from any thread.
+ */
+class sctp_admission_control
+	: private boost::noncopyable
+{
+public:
+	/// Construct; each source may open burst associations, then rate per second.
+	sctp_admission_control(double rate, std::size_t burst, std::size_t max_active,
+		std::size_t max_sources = 65536)
+		: rate_per_ms_(rate / 1000),
+			burst_(burst ? double(burst) : 1.0),
+			max_active_(max_active),
+			max_sources_(max_sources),
+			prune_at_(max_sources),
+			active_(0),
+			rejected_(0)
+	{
+	}
+
+	/// Decide whether to take on an association from source.
+	/**
+	 * @returns true if the association is admitted; release() must then be
+	 * called when it ends.
+	 */
+	bool admit(const boost::asio::ip::address& source)
+	{
+		if (detail::atomic::load_acquire(active_) >= max_active_)
+		{
+			++rejected_;
+			return false;
+		}
+
+		boost::uint64_t now = sctp_clock::now_ms();
+		std::map<boost::asio::ip::address, bucket>::iterator i = buckets_.find(source);
+		if (i == buckets_.end())
+		{
+			if (buckets_.size() >= prune_at_)
+				prune(now);
+			bucket b = { burst_, now };
+			i = buckets_.insert(std::make_pair(source, b)).first;
+		}
+		else
+		{
+			refill(i->second, now);
+		}
+
+		if (i->second.tokens < 1.0)
+		{
+			++rejected_;
+			return false;
+		}
+		i->second.tokens -= 1.0;
+		detail::atomic::fetch_add(active_, std::size_t(1));
+		return true;
+	}
+
+	/// An admitted association has ended.
+	void release()
+	{
+		detail::atomic::fetch_sub(active_, std::size_t(1));
+	}
+
+	/// Number of admitted associations which have not been released.
+	std::size_t active() const
+	{
+		return detail::atomic::load_acquire(active_);
+	}
+
+	/// Number of associations refused so far.
+	std::size_t rejected() const
+	{
+		return rejected_;
+	}
+
+private:
+	struct bucket
+	{
+		double tokens;
+		boost::uint64_t last_ms;
+	};
+
+	void refill(bucket& b, boost::uint64_t now) const
+	{
+		b.tokens = std::min(burst_, b.tokens + (now - b.last_ms) * rate_per_ms_);
+		b.last_ms = now;
+	}
+
+	// Drop the buckets which are full again. If most sources are still
+	// limited, let the map grow rather than scanning it on every admit().
+	void prune(boost::uint64_t now)
+	{
+		std::map<boost::asio::ip::address, bucket>::iterator i = buckets_.begin();
+		while (i != buckets_.end())
+		{
+			refill(i->second, now);
+			if (i->second.tokens >= burst_)
+				buckets_.erase(i++);
+			else
+				++i;
+		}
+		prune_at_ = std::max(max_sources_, 2 * buckets_.size());
+	}
+
+	double rate_per_ms_;
+	double burst_;
+	std::size_t max_active_;
+	std::size_t max_sources_;
+	std::size_t prune_at_;
+	std::map<boost::asio::ip::address, bucket> buckets_;
+	volatile std::size_t active_;
+	std::size_t rejected_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_ADMISSION_HPP
@@ -0,0 +1,774 @@
+//
+// sctp_association_pool.hpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_ASSOCIATION_POOL_HPP
+#define BOOST_ASIO_SCTP_SCTP_ASSOCIATION_POOL_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <vector>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/detail/throw_error.hpp>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/asio_sctp/ip/sctp.hpp>
+#include <boost/asio_sctp/log.hpp>
+#include <boost/asio_sctp/sctp_backend.hpp>
+#include <boost/asio_sctp/sctp_clock.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+#include <boost/asio_sctp/sctp_reassembler.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Limits and timings for sctp_association_pool.
+struct sctp_pool_settings
+{
+	sctp_pool_settings()
+		: warm_associations(1),
+			max_associations(4),
+			streams(16),
+			max_waiting(1024),
+			connect_timeout_ms(5000),
+			health_interval_ms(2000),
+			backoff_min_ms(100),
+			backoff_max_ms(30000)
+	{
+	}
+
+	/// Associations kept open to each peer once it has been used, even while idle.
+	std::size_t warm_associations;
+
+	/// Most associations opened to one peer.
+	std::size_t max_associations;
+
+	/// Outbound streams requested per association; each carries one session at a time.
+	uint16_t streams;
+
+	/// Most acquire requests queued for one peer while every stream is in use.
+	std::size_t max_waiting;
+
+	/// Time allowed for the handshake with each of a peer's addresses.
+	unsigned int connect_timeout_ms;
+
+	/// Interval between SCTP_STATUS checks of the open associations; zero disables them.
+	unsigned int health_interval_ms;
+
+	/// Reconnection delay after the first failure, and the limit it doubles up to.
+	unsigned int backoff_min_ms;
+	unsigned int backoff_max_ms;
+};
+
+/// Keeps warm outbound associations to upstream peers and shares them between sessions.
+/**
+ * A peer is identified by the set of its addresses; they are tried in order
+ * until one answers, and the kernel learns the rest from the handshake. Up to
+ * max_associations are opened to each peer, each with streams outbound
+ * streams, and every session leases one stream of one association for as long
+ * as it is held. Requests are therefore served without a handshake whenever a
+ * stream is free, and the number of associations to an upstream stays bounded
+ * however many sessions use it; beyond that, requests wait for a stream to be
+ * released.
+ *
+ * Once a peer has been used, warm_associations to it are kept open while idle.
+ * Open associations are checked with SCTP_STATUS every health_interval_ms and
+ * closed if they have left the ESTABLISHED state; an association which fails
+ * is replaced in the background after a delay which doubles with each
+ * consecutive failure, randomised between half and all of it so that many
+ * clients do not reconnect in step. Sessions on a failed association get an
+ * error through their receive handler and should be given up.
+ *
+ * Messages the peer sends back are delivered to the receive handler of the
+ * session holding the stream they arrive on; the peer is expected to answer on
+ * the stream it was addressed on.
+ *
+ * @par Example
+ * @code
+ * pool.async_acquire(upstream, on_reply,
+ *   boost::bind(&request::start, this, _1, _2));
+ *
+ * void request::start(const boost::system::error_code& ec,
+ *   sctp_association_pool::session s)
+ * {
+ *   if (!ec)
+ *   {
+ *     session_ = s;
+ *     session_.send(query.data(), query.size(), QUERY_PPID, ec);
+ *   }
+ * }
+ * @endcode
+ *
+ * @par Thread Safety
+ * All members, and the members of session, may be called from any thread.
+ * Handlers are called from threads running the io_service; a receive handler
+ * is not called concurrently with itself. The pool must outlive its sessions
+ * and must not be destroyed while the io_service is still running it.
+ */
+class sctp_association_pool
+	: private boost::noncopyable
+{
+	struct association;
+	struct lease;
+	struct peer_entry;
+
+public:
+	typedef ip::sctp::socket socket_type;
+	typedef ip::sctp::endpoint endpoint_type;
+
+	/// The addresses of one peer.
+	typedef std::vector<endpoint_type> peer_set;
+
+	/// Called with each message received on a session's stream, or with the error which ended its association.
+	typedef boost::function<void (const boost::system::error_code&, const sctp_message&)> receive_handler;
+
+	/// One stream of a pooled association, leased for as long as a copy is held.
+	class session
+	{
+	public:
+		/// Construct without a stream.
+		session()
+		{
+		}
+
+		/// Whether the session holds a stream.
+		bool valid() const
+		{
+			return lease_.get() != 0;
+		}
+
+		/// The stream the session's messages are sent and received on.
+		uint16_t stream() const
+		{
+			return lease_->stream;
+		}
+
+		/// The underlying socket, e.g. to read its options; it is shared with other sessions.
+		socket_type& socket() const
+		{
+			return lease_->assoc->socket;
+		}
+
+		/// Send one message on the session's stream.
+		std::size_t send(const void* data, std::size_t size, uint32_t ppid,
+			boost::system::error_code& ec) const
+		{
+			sctp_outbound_message msg;
+			msg.buffer = boost::asio::buffer(data, size);
+			msg.stream = lease_->stream;
+			msg.ppid = ppid;
+			msg.flags = 0;
+			msg.time_to_live = 0;
+			return lease_->assoc->socket.send_batch(&msg, &msg + 1, ec) ? size : 0;
+		}
+
+		/// Send one message on the session's stream; throws on failure.
+		std::size_t send(const void* data, std::size_t size, uint32_t ppid) const
+		{
+			boost::system::error_code ec;
+			std::size_t n = send(data, size, ppid, ec);
+			boost::asio::detail::throw_error(ec, "send");
+			return n;
+		}
+
+		/// Give the stream back to the pool; other copies of the session become invalid to use.
+		void release()
+		{
+			lease_.reset();
+		}
+
+	private:
+		friend class sctp_association_pool;
+
+		explicit session(const boost::shared_ptr<lease>& l)
+			: lease_(l)
+		{
+		}
+
+		boost::shared_ptr<lease> lease_;
+	};
+
+	/// Called once a session has been acquired, or with the error which prevented it.
+	typedef boost::function<void (const boost::system::error_code&, session)> acquire_handler;
+
+	/// Construct; associations and timers run on io_service.
+	explicit sctp_association_pool(boost::asio::io_service& io_service,
+		const sctp_pool_settings& settings = sctp_pool_settings())
+		: io_service_(io_service),
+			settings_(settings),
+			health_timer_(io_service),
+			closed_(false),
+			reconnects_(0),
+			seed_(static_cast<boost::uint32_t>(sctp_clock::now_ms()) | 1)
+	{
+		if (settings_.max_associations == 0)
+			settings_.max_associations = 1;
+		if (settings_.streams == 0)
+			settings_.streams = 1;
+		if (settings_.health_interval_ms)
+			start_health_timer();
+	}
+
+	~sctp_association_pool()
+	{
+		shutdown();
+	}
+
+	/// Open warm_associations to a peer now, ahead of its first session.
+	void warm(const peer_set& peers)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (closed_)
+			return;
+		peer_entry& p = entry(peers);
+		p.warm = std::max(p.warm, settings_.warm_associations);
+		ensure(p);
+	}
+
+	/// Lease a stream on an association to a peer.
+	/**
+	 * @param peers The addresses of the peer.
+	 * @param on_receive Called with each message received on the session's stream.
+	 * @param handler Called when the session is ready, as
+	 * @code void handler(const boost::system::error_code& ec, session s); @endcode
+	 * It fails if no association to the peer is open and the attempt to open
+	 * one fails, or if max_waiting requests are already queued.
+	 */
+	void async_acquire(const peer_set& peers, const receive_handler& on_receive,
+		const acquire_handler& handler)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (closed_)
+		{
+			io_service_.post(boost::bind(handler, boost::asio::error::operation_aborted, session()));
+			return;
+		}
+
+		peer_entry& p = entry(peers);
+		p.warm = std::max(p.warm, settings_.warm_associations);
+		if (p.waiting.size() >= settings_.max_waiting)
+		{
+			io_service_.post(boost::bind(handler, boost::asio::error::no_buffer_space, session()));
+			return;
+		}
+		waiter w = { on_receive, handler };
+		p.waiting.push_back(w);
+		serve_waiting(p);
+		ensure(p);
+	}
+
+	/// Close every association and fail the queued requests with operation_aborted.
+	void shutdown()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (closed_)
+			return;
+		closed_ = true;
+
+		boost::system::error_code ignored;
+		health_timer_.cancel(ignored);
+		for (peer_map::iterator i = peers_.begin(); i != peers_.end(); ++i)
+		{
+			peer_entry& p = *i->second;
+			p.retry_timer.cancel(ignored);
+			while (!p.associations.empty())
+				fail(p.associations.back(), boost::asio::error::operation_aborted);
+			fail_waiting(p, boost::asio::error::operation_aborted);
+		}
+	}
+
+	/// Number of associations open or opening to a peer.
+	std::size_t associations(const peer_set& peers) const
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		peer_map::const_iterator i = peers_.find(normalise(peers));
+		return i == peers_.end() ? 0 : i->second->associations.size();
+	}
+
+	/// Number of associations opened to replace ones which failed.
+	std::size_t reconnects() const
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return reconnects_;
+	}
+
+private:
+	struct association
+	{
+		enum state_type { connecting, up, down };
+
+		association(boost::asio::io_service& io_service, peer_entry* owner)
+			: socket(io_service),
+				timer(io_service),
+				peer(owner),
+				state(connecting),
+				next_endpoint(0),
+				buffer(65536)
+		{
+		}
+
+		socket_type socket;
+		boost::asio::deadline_timer timer;  // handshake timeout
+		peer_entry* peer;
+		state_type state;
+		std::size_t next_endpoint;
+		boost::system::error_code last_error;
+		std::vector<receive_handler> handlers;  // by stream; empty while the stream is free
+		std::vector<uint16_t> free_streams;
+		sctp_reassembler reassembler;  // used only by the receive chain
+		std::vector<unsigned char> buffer;
+	};
+
+	struct lease
+	{
+		lease(sctp_association_pool* p, const boost::shared_ptr<association>& a, uint16_t s)
+			: pool(p), assoc(a), stream(s)
+		{
+		}
+
+		~lease()
+		{
+			pool->release(assoc, stream);
+		}
+
+		sctp_association_pool* pool;
+		boost::shared_ptr<association> assoc;
+		uint16_t stream;
+	};
+
+	struct waiter
+	{
+		receive_handler on_receive;
+		acquire_handler handler;
+	};
+
+	struct peer_entry
+	{
+		explicit peer_entry(boost::asio::io_service& io_service)
+			: retry_timer(io_service),
+				warm(0),
+				failures(0),
+				retry_pending(false)
+		{
+		}
+
+		peer_set peers;
+		std::vector<boost::shared_ptr<association> > associations;
+		std::deque<waiter> waiting;
+		boost::asio::deadline_timer retry_timer;
+		std::size_t warm;
+		unsigned int failures;  // consecutive, reset by a successful handshake
+		bool retry_pending;
+	};
+
+	// Entries are kept until the pool is destroyed, so associations may point at theirs.
+	typedef std::map<peer_set, boost::shared_ptr<peer_entry> > peer_map;
+
+	static peer_set normalise(peer_set peers)
+	{
+		std::sort(peers.begin(), peers.end());
+		peers.erase(std::unique(peers.begin(), peers.end()), peers.end());
+		return peers;
+	}
+
+	peer_entry& entry(const peer_set& peers)
+	{
+		peer_set key = normalise(peers);
+		boost::shared_ptr<peer_entry>& p = peers_[key];
+		if (!p)
+		{
+			p.reset(new peer_entry(io_service_));
+			p->peers = peers;  // in the caller's order of preference
+		}
+		return *p;
+	}
+
+	// The rest is called with mutex_ held.
+
+	// Open associations until the peer has its warm count, or enough streams
+	// for the queued requests, within max_associations.
+	void ensure(peer_entry& p)
+	{
+		if (closed_ || p.retry_pending || p.peers.empty())
+			return;
+
+		std::size_t capacity = 0;
+		for (std::size_t i = 0; i < p.associations.size(); ++i)
+		{
+			const association& a = *p.associations[i];
+			capacity += a.state == association::connecting ? settings_.streams : a.free_streams.size();
+		}
+
+		std::size_t target = std::max(p.warm, p.associations.size());
+		if (p.waiting.size() > capacity)
+			target = std::max(target, p.associations.size()
+				+ (p.waiting.size() - capacity + settings_.streams - 1) / settings_.streams);
+		target = std::min(target, settings_.max_associations);
+
+		while (p.associations.size() < target)
+		{
+			boost::shared_ptr<association> a(new association(io_service_, &p));
+			p.associations.push_back(a);
+			if (p.failures)
+				++reconnects_;
+			connect_next(a);
+		}
+	}
+
+	// Try the peer's next address, or give up once all have been tried.
+	void connect_next(const boost::shared_ptr<association>& a)
+	{
+		const peer_set& peers = a->peer->peers;
+		while (a->next_endpoint < peers.size())
+		{
+			const endpoint_type& endpoint = peers[a->next_endpoint++];
+			boost::system::error_code ec;
+			if (a->socket.is_open())
+				a->socket.close(ec);
+			if (a->socket.open(endpoint.protocol(), ec))
+			{
+				a->last_error = ec;
+				continue;
+			}
+			boost::system::error_code ignored;  // not supported by the user-space transport
+			a->socket.set_option(socket_option::sctp_init_msg(settings_.streams, settings_.streams), ignored);
+
+			a->timer.expires_from_now(boost::posix_time::milliseconds(settings_.connect_timeout_ms));
+			a->timer.async_wait(boost::bind(&sctp_association_pool::handle_connect_timeout,
+				this, a, boost::asio::placeholders::error));
+			a->socket.async_connect(endpoint, boost::bind(&sctp_association_pool::handle_connect,
+				this, a, boost::asio::placeholders::error));
+			return;
+		}
+		connect_failed(a);
+	}
+
+	void handle_connect_timeout(boost::shared_ptr<association> a, const boost::system::error_code& ec)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (!ec && a->state == association::connecting)
+		{
+			boost::system::error_code ignored;
+			a->socket.close(ignored);  // handle_connect sees operation_aborted
+		}
+	}
+
+	void handle_connect(boost::shared_ptr<association> a, boost::system::error_code ec)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (closed_ || a->state != association::connecting)
+			return;
+		boost::system::error_code ignored;
+		a->timer.cancel(ignored);
+
+		peer_entry& p = *a->peer;
+		if (ec)
+		{
+			a->last_error = ec == boost::asio::error::operation_aborted
+				? boost::system::error_code(boost::asio::error::timed_out) : ec;
+			connect_next(a);
+			return;
+		}
+
+		// Replies are routed by stream, which is only reported with data_io events.
+		sctp_event_subs_t subs;
+		std::memset(&subs, 0, sizeof(subs));
+		subs.sctp_data_io_event = 1;
+		if (a->socket.set_option(socket_option::sctp_event_subscribe(subs), ec))
+		{
+			a->last_error = ec;
+			connect_next(a);
+			return;
+		}
+
+		// Use the streams the peer agreed to, as many as were asked for.
+		uint16_t streams = settings_.streams;
+		socket_option::sctp_status status;
+		if (!a->socket.get_option(status, ignored) && status.outbound_streams())
+			streams = std::min(streams, status.outbound_streams());
+		a->handlers.resize(streams);
+		for (uint16_t s = streams; s > 0; --s)
+			a->free_streams.push_back(s - 1);  // lowest first
+		a->state = association::up;
+		p.failures = 0;
+
+		start_receive(a);
+		serve_waiting(p);
+		ensure(p);
+	}
+
+	void connect_failed(const boost::shared_ptr<association>& a)
+	{
+		peer_entry& p = *a->peer;
+		BOOST_ASIO_SCTP_LOG(warning, ("sctp_association_pool - association to {}:{} ({} addresses) failed: {}",
+			p.peers.front().address().to_string(), p.peers.front().port(), p.peers.size(),
+			a->last_error.message()));
+		remove(a);
+		a->state = association::down;
+		boost::system::error_code ignored;
+		a->socket.close(ignored);
+
+		++p.failures;
+		if (!has_open(p))
+			fail_waiting(p, a->last_error);
+		schedule_retry(p);
+	}
+
+	// Close an association which was open and notify the sessions on it.
+	void fail(const boost::shared_ptr<association>& a, const boost::system::error_code& ec)
+	{
+		if (a->state == association::connecting)
+		{
+			a->state = association::down;
+			remove(a);
+			boost::system::error_code ignored;
+			a->timer.cancel(ignored);
+			a->socket.close(ignored);
+			return;
+		}
+		if (a->state != association::up)
+			return;
+
+		a->state = association::down;
+		remove(a);
+		// Shut down rather than close: sessions may still be sending on it, and
+		// the descriptor must not be reused under them. It is closed with the
+		// last reference.
+		boost::system::error_code ignored;
+		a->socket.cancel(ignored);
+		a->socket.shutdown(boost::asio::socket_base::shutdown_both, ignored);
+
+		sctp_message none = sctp_message();
+		for (std::size_t s = 0; s < a->handlers.size(); ++s)
+			if (a->handlers[s])
+				io_service_.post(boost::bind(a->handlers[s], ec, none));
+
+		if (!closed_)
+		{
+			const endpoint_type& peer = a->peer->peers[a->next_endpoint - 1];
+			BOOST_ASIO_SCTP_LOG(warning, ("sctp_association_pool - association to {}:{} lost: {}",
+				peer.address().to_string(), peer.port(), ec.message()));
+			++a->peer->failures;
+			schedule_retry(*a->peer);
+		}
+	}
+
+	void remove(const boost::shared_ptr<association>& a)
+	{
+		std::vector<boost::shared_ptr<association> >& v = a->peer->associations;
+		v.erase(std::remove(v.begin(), v.end(), a), v.end());
+	}
+
+	bool has_open(const peer_entry& p) const
+	{
+		for (std::size_t i = 0; i < p.associations.size(); ++i)
+			if (p.associations[i]->state != association::down)
+				return true;
+		return false;
+	}
+
+	void fail_waiting(peer_entry& p, const boost::system::error_code& ec)
+	{
+		for (std::size_t i = 0; i < p.waiting.size(); ++i)
+			io_service_.post(boost::bind(p.waiting[i].handler, ec, session()));
+		p.waiting.clear();
+	}
+
+	// Hand free streams to queued requests, spreading sessions over the associations.
+	void serve_waiting(peer_entry& p)
+	{
+		while (!p.waiting.empty())
+		{
+			boost::shared_ptr<association> best;
+			for (std::size_t i = 0; i < p.associations.size(); ++i)
+			{
+				const boost::shared_ptr<association>& a = p.associations[i];
+				if (a->state == association::up && !a->free_streams.empty()
+					&& (!best || a->free_streams.size() > best->free_streams.size()))
+					best = a;
+			}
+			if (!best)
+				return;
+
+			waiter w = p.waiting.front();
+			p.waiting.pop_front();
+			uint16_t stream = best->free_streams.back();
+			best->free_streams.pop_back();
+			best->handlers[stream] = w.on_receive;
+			session s(boost::shared_ptr<lease>(new lease(this, best, stream)));
+			io_service_.post(boost::bind(w.handler, boost::system::error_code(), s));
+		}
+	}
+
+	void schedule_retry(peer_entry& p)
+	{
+		if (closed_ || p.retry_pending)
+			return;
+		p.retry_pending = true;
+		p.retry_timer.expires_from_now(boost::posix_time::milliseconds(backoff(p.failures)));
+		p.retry_timer.async_wait(boost::bind(&sctp_association_pool::handle_retry,
+			this, &p, boost::asio::placeholders::error));
+	}
+
+	void handle_retry(peer_entry* p, const boost::system::error_code& ec)
+	{
+		if (ec)
+			return;
+		boost::mutex::scoped_lock lock(mutex_);
+		p->retry_pending = false;
+		ensure(*p);
+	}
+
+	// Random delay in [d/2, d], where d doubles with each consecutive failure.
+	unsigned int backoff(unsigned int failures)
+	{
+		boost::uint64_t delay = settings_.backoff_min_ms;
+		for (unsigned int i = 1; i < failures && delay < settings_.backoff_max_ms; ++i)
+			delay *= 2;
+		delay = std::min<boost::uint64_t>(delay, settings_.backoff_max_ms);
+		seed_ ^= seed_ << 13;
+		seed_ ^= seed_ >> 17;
+		seed_ ^= seed_ << 5;
+		return static_cast<unsigned int>(delay / 2 + seed_ % (delay / 2 + 1));
+	}
+
+	void release(const boost::shared_ptr<association>& a, uint16_t stream)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (a->state != association::up)
+			return;
+		a->handlers[stream].clear();
+		a->free_streams.push_back(stream);
+		serve_waiting(*a->peer);
+	}
+
+	void start_health_timer()
+	{
+		health_timer_.expires_from_now(boost::posix_time::milliseconds(settings_.health_interval_ms));
+		health_timer_.async_wait(boost::bind(&sctp_association_pool::handle_health_timer,
+			this, boost::asio::placeholders::error));
+	}
+
+	// An association which has left ESTABLISHED (shutting down, or aborted
+	// without the receive side noticing yet) is replaced. The user-space
+	// transport has no SCTP_STATUS; there the receive side is relied on.
+	void handle_health_timer(const boost::system::error_code& ec)
+	{
+		if (ec)
+			return;
+		boost::mutex::scoped_lock lock(mutex_);
+		if (closed_)
+			return;
+
+		if (sctp_backend::current() == sctp_backend::kernel)
+		{
+			std::vector<std::pair<boost::shared_ptr<association>, boost::system::error_code> > failed;
+			for (peer_map::iterator i = peers_.begin(); i != peers_.end(); ++i)
+			{
+				peer_entry& p = *i->second;
+				for (std::size_t j = 0; j < p.associations.size(); ++j)
+				{
+					association& a = *p.associations[j];
+					if (a.state != association::up)
+						continue;
+					boost::system::error_code status_ec;
+					socket_option::sctp_status status;
+					if (!a.socket.get_option(status, status_ec) && status.state() != SCTP_ESTABLISHED)
+						status_ec = boost::asio::error::connection_reset;
+					if (status_ec)
+						failed.push_back(std::make_pair(p.associations[j], status_ec));
+				}
+			}
+			for (std::size_t i = 0; i < failed.size(); ++i)
+				fail(failed[i].first, failed[i].second);
+		}
+		start_health_timer();
+	}
+
+	void start_receive(const boost::shared_ptr<association>& a)
+	{
+		a->socket.async_receive(boost::asio::null_buffers(),
+			boost::bind(&sctp_association_pool::handle_readable,
+				this, a, boost::asio::placeholders::error));
+	}
+
+	// Read everything the kernel has for the association and pass each message
+	// to the session holding its stream. The lock is not held while reading or
+	// calling handlers.
+	void handle_readable(boost::shared_ptr<association> a, boost::system::error_code ec)
+	{
+		while (!ec)
+		{
+			sctp_receive_info info;
+			std::size_t n = a->socket.receive_message(boost::asio::buffer(a->buffer),
+				MSG_DONTWAIT, info, ec);
+			if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again)
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				if (a->state == association::up)
+					start_receive(a);
+				return;
+			}
+			if (!ec && n == 0)
+				ec = boost::asio::error::eof;
+			if (ec || (info.msg_flags & MSG_NOTIFICATION))
+				continue;
+
+			sctp_message msg;
+			if (!a->reassembler.add(&a->buffer[0], n, info, msg))
+				continue;
+			receive_handler handler;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				if (a->state != association::up)
+					return;
+				if (msg.stream < a->handlers.size())
+					handler = a->handlers[msg.stream];
+			}
+			if (handler)
+				handler(boost::system::error_code(), msg);
+		}
+
+		boost::mutex::scoped_lock lock(mutex_);
+		fail(a, ec);
+	}
+
+	boost::asio::io_service& io_service_;
+	sctp_pool_settings settings_;
+	mutable boost::mutex mutex_;  // protects everything below, and the associations' state
+	peer_map peers_;
+	boost::asio::deadline_timer health_timer_;
+	bool closed_;
+	std::size_t reconnects_;
+	boost::uint32_t seed_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_ASSOCIATION_POOL_HPP
@@ -0,0 +1,124 @@
+//
+// sctp_auto_peeloff.hpp
+// ~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_AUTO_PEELOFF_HPP
+#define BOOST_ASIO_SCTP_SCTP_AUTO_PEELOFF_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <map>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/asio_sctp/io_service_pool.hpp>
+#include <boost/asio_sctp/sctp_clock.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Peels associations off a one-to-many socket once their message rate gets too high.
+/**
+ * The owner of the one-to-many socket passes every message it receives to
+ * note(). Messages are counted per association over a fixed window; when an
+ * association exceeds the configured rate it is peeled off onto a new socket
+ * on the next io_service of the pool, and handed to the peeled handler, which
+ * takes ownership of it.
+ *
+ * @par Thread Safety
+ * Must only be used from the thread which receives on the one-to-many socket.
+ */
+template <typename Socket>
+class sctp_auto_peeloff
+	: private boost::noncopyable
+{
+public:
+	/// Called with each peeled-off socket; the handler takes ownership.
+	typedef boost::function<void (Socket*, sctp_assoc_t)> peeled_handler;
+
+	/// Construct; associations sending more than max_messages per window_ms are peeled off.
+	sctp_auto_peeloff(Socket& socket, io_service_pool& pool,
+		const peeled_handler& handler, std::size_t max_messages,
+		unsigned int window_ms = 1000)
+		: socket_(socket),
+			pool_(pool),
+			handler_(handler),
+			max_messages_(max_messages),
+			window_ms_(window_ms ? window_ms : 1),
+			window_start_(sctp_clock::now_ms()),
+			peeled_(0)
+	{
+	}
+
+	/// Count a message received on the one-to-many socket.
+	/**
+	 * @returns true if this message took its association over the limit and the
+	 * association has been peeled off.
+	 */
+	bool note(sctp_assoc_t assoc_id)
+	{
+		boost::uint64_t now = sctp_clock::now_ms();
+		if (now - window_start_ >= window_ms_)
+		{
+			counts_.clear();
+			window_start_ = now;
+		}
+		if (++counts_[assoc_id] <= max_messages_)
+			return false;
+
+		counts_.erase(assoc_id);
+		Socket* peer = new Socket(pool_.get_io_service());
+		boost::system::error_code ec;
+		socket_.peeloff(assoc_id, *peer, ec);
+		if (ec)
+		{
+			delete peer;
+			return false;  // e.g. the association has just gone away
+		}
+		++peeled_;
+		handler_(peer, assoc_id);
+		return true;
+	}
+
+	/// Count a received message.
+	bool note(const sctp_message& msg)
+	{
+		return note(msg.assoc_id);
+	}
+
+	/// Number of associations peeled off so far.
+	std::size_t peeled() const
+	{
+		return peeled_;
+	}
+
+private:
+	Socket& socket_;
+	io_service_pool& pool_;
+	peeled_handler handler_;
+	std::size_t max_messages_;
+	boost::uint64_t window_ms_;
+	boost::uint64_t window_start_;
+	std::map<sctp_assoc_t, std::size_t> counts_;
+	std::size_t peeled_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_AUTO_PEELOFF_HPP
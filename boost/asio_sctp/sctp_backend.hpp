@@ -0,0 +1,102 @@
+//
+// sctp_backend.hpp
+// ~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_BACKEND_HPP
+#define BOOST_ASIO_SCTP_SCTP_BACKEND_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <boost/asio/detail/throw_error.hpp>
+#include <boost/asio_sctp/detail/sctp_socket_ops.hpp>
+#include <boost/asio_sctp/detail/udp_sctp_engine.hpp>
+#include <boost/asio_sctp/sctp_emulator.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Selects the transport used by all SCTP sockets in the process.
+/**
+ * By default sockets use the kernel's SCTP. use_udp_encapsulation() switches
+ * to the user-space SCTP-over-UDP transport (RFC 6951) for hosts without
+ * kernel SCTP or where only UDP gets through; both ends of an association must
+ * use the same transport. The choice must be made before any SCTP socket is
+ * created and cannot be undone.
+ *
+ * With the user-space transport the IPPROTO_SCTP socket options have no
+ * effect, the multi-homing calls (bind_add, local_endpoints, ...) and one-to-many
+ * sockets are not supported, acceptors listen on every address, and only IPv4
+ * peers can be reached.
+ *
+ * use_emulator() instead keeps every association inside the process, under
+ * the control of an sctp_emulator, and makes its virtual time the library's
+ * clock; it is meant for tests, and has the same limitations.
+ */
+class sctp_backend
+{
+public:
+	enum type
+	{
+		kernel,
+		udp_encapsulated,
+		emulated
+	};
+
+	/// Use SCTP over UDP, listening on local_udp_port and connecting to peers' remote_udp_port.
+	static void use_udp_encapsulation(
+		unsigned short local_udp_port = BOOST_ASIO_SCTP_UDP_PORT,
+		unsigned short remote_udp_port = BOOST_ASIO_SCTP_UDP_PORT)
+	{
+		boost::system::error_code ec;
+		use_udp_encapsulation(local_udp_port, remote_udp_port, ec);
+		boost::asio::detail::throw_error(ec, "use_udp_encapsulation");
+	}
+
+	/// Use SCTP over UDP, listening on local_udp_port and connecting to peers' remote_udp_port.
+	static boost::system::error_code use_udp_encapsulation(
+		unsigned short local_udp_port, unsigned short remote_udp_port,
+		boost::system::error_code& ec)
+	{
+		if (!detail::udp_sctp_engine::instance().start(local_udp_port, remote_udp_port, ec))
+		{
+			detail::bridge_transport::activate(detail::udp_sctp_engine::instance());
+			detail::sctp_socket_ops::set_bridged(true);
+		}
+		return ec;
+	}
+
+	/// Emulate associations in process, on the emulator's clock; emulator must outlive every SCTP socket.
+	static void use_emulator(sctp_emulator& emulator)
+	{
+		detail::bridge_transport::activate(emulator);
+		sctp_clock::activate(&emulator);
+		detail::sctp_socket_ops::set_bridged(true);
+	}
+
+	/// The transport in use.
+	static type current()
+	{
+		if (!detail::sctp_socket_ops::bridged())
+			return kernel;
+		return detail::bridge_transport::active() == &detail::udp_sctp_engine::instance()
+			? udp_encapsulated : emulated;
+	}
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_BACKEND_HPP
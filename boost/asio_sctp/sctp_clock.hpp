@@ -0,0 +1,128 @@
+//
+// sctp_clock.hpp
+// ~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_CLOCK_HPP
+#define BOOST_ASIO_SCTP_SCTP_CLOCK_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <ctime>
+#include <boost/asio/basic_deadline_timer.hpp>
+#include <boost/asio/time_traits.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// The clock the library's deadlines and timers are measured on.
+/**
+ * By default this is CLOCK_MONOTONIC. A virtual clock, such as an
+ * sctp_emulator's (see sctp_backend::use_emulator()), may be put in its
+ * place, so that send queue deadlines and timer_wheel ticks follow the
+ * emulated time and a test behaves the same on every run. The clock must be
+ * chosen before anything reads it and not changed while timers are armed.
+ */
+class sctp_clock
+{
+public:
+	/// Microseconds since an arbitrary start.
+	static boost::uint64_t now_us()
+	{
+		const sctp_clock* clock = slot();
+		if (clock)
+			return clock->elapsed_us();
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return boost::uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+	}
+
+	/// Milliseconds since an arbitrary start.
+	static boost::uint64_t now_ms()
+	{
+		return now_us() / 1000;
+	}
+
+	/// Whether a virtual clock is in use.
+	static bool is_virtual()
+	{
+		return slot() != 0;
+	}
+
+	/// Measure time on clock from now on; null goes back to CLOCK_MONOTONIC.
+	static void activate(const sctp_clock* clock)
+	{
+		slot() = clock;
+	}
+
+	/// The virtual clock in use; null if none.
+	static const sctp_clock* active()
+	{
+		return slot();
+	}
+
+protected:
+	sctp_clock()
+	{
+	}
+
+	virtual ~sctp_clock()
+	{
+	}
+
+	/// The virtual time, in microseconds.
+	virtual boost::uint64_t elapsed_us() const = 0;
+
+private:
+	static const sctp_clock*& slot()
+	{
+		static const sctp_clock* clock = 0;
+		return clock;
+	}
+};
+
+/// Time traits for deadline timers which run on sctp_clock.
+/**
+ * The io_service still waits in real time, so while a virtual clock is in
+ * use it is told that the next timer is due at once, and checks its timers
+ * against the virtual time on every pass; a test advances the clock and then
+ * runs the io_service with poll().
+ */
+struct sctp_clock_time_traits
+	: boost::asio::time_traits<boost::posix_time::ptime>
+{
+	static time_type now()
+	{
+		static const time_type start(boost::gregorian::date(1970, 1, 1));
+		return start + boost::posix_time::microseconds(
+			static_cast<boost::int64_t>(sctp_clock::now_us()));
+	}
+
+	static boost::posix_time::time_duration to_posix_duration(const duration_type& d)
+	{
+		return sctp_clock::is_virtual() ? boost::posix_time::time_duration() : d;
+	}
+};
+
+/// A deadline timer which runs on sctp_clock.
+typedef boost::asio::basic_deadline_timer<boost::posix_time::ptime,
+	sctp_clock_time_traits> sctp_deadline_timer;
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_CLOCK_HPP
@@ -0,0 +1,736 @@
+//
+// sctp_emulator.hpp
+// ~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_EMULATOR_HPP
+#define BOOST_ASIO_SCTP_SCTP_EMULATOR_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <boost/asio/ip/address.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/asio_sctp/detail/bridge_transport.hpp>
+#include <boost/asio_sctp/detail/sctp_socket_types.hpp>
+#include <boost/asio_sctp/log.hpp>
+#include <boost/asio_sctp/sctp_clock.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// The emulated network between the two ends of an association.
+struct sctp_link_conditions
+{
+	sctp_link_conditions()
+		: delay_ms(0),
+			jitter_ms(0),
+			loss(0),
+			rto_ms(1000),
+			max_retransmits(10),
+			fragment_size(0)
+	{
+	}
+
+	/// One-way delay, and up to how much more is added at random to each message, in milliseconds.
+	boost::uint32_t delay_ms;
+	boost::uint32_t jitter_ms;
+
+	/// Chance that a transmission is lost, from 0 to 1; each loss delays the message by rto_ms.
+	double loss;
+	boost::uint32_t rto_ms;
+
+	/// A message lost more often than this aborts the association (Association.Max.Retrans).
+	unsigned int max_retransmits;
+
+	/// Pass messages to the receiver in pieces of at most this many bytes, as
+	/// partial delivery does; zero passes each message whole.
+	std::size_t fragment_size;
+};
+
+/// What an sctp_emulator has done so far.
+struct sctp_emulator_statistics
+{
+	boost::uint64_t messages_sent;
+	boost::uint64_t messages_delivered;
+	boost::uint64_t retransmissions;
+	boost::uint64_t abandoned;  // PR-SCTP lifetime ran out
+	boost::uint64_t aborted;  // associations
+};
+
+/// An in-process stand-in for SCTP, for tests which must behave the same on every run.
+/**
+ * Once selected with sctp_backend::use_emulator(), connecting a socket pairs
+ * it with the acceptor bound to the peer's port in the same process, through
+ * the same bridge as the user-space transport (see sctp_bridge.hpp), so the
+ * code under test uses the ordinary socket classes. Stream, PPID and flags
+ * travel with each message.
+ *
+ * Nothing moves by itself: messages are taken from the senders by poll(), and
+ * time is virtual, passing only in advance() and settle(). The emulator is
+ * also the library's clock while it is in use (see sctp_clock), so send queue
+ * deadlines and timer_wheel ticks follow the same time; timers fire when the
+ * io_service is next polled after the clock has passed them. Every message is
+ * given a delivery time from the link conditions of its association, drawn
+ * with a random generator seeded at construction, so the same sequence of
+ * calls produces the same deliveries:
+ *
+ * @li the one-way delay plus jitter;
+ * @li rto_ms for each loss, and an abort (SCTP_COMM_LOST) after more than
+ * max_retransmits losses of one message;
+ * @li ordered messages never overtake earlier ones on their stream, so a loss
+ * blocks the stream behind it while unordered messages pass;
+ * @li a message with a lifetime which would be delivered later than that is
+ * abandoned, as with PR-SCTP.
+ *
+ * Path events and aborts are raised by the test through notify_path_change()
+ * and abort(), and are read by the application as notifications
+ * (MSG_NOTIFICATION). Associations are set up at once, without handshake
+ * delay; the connecting side's address is the loopback address of the peer's
+ * family, with a port chosen per association.
+ *
+ * @par Example
+ * @code
+ * boost::asio_sctp::sctp_emulator emulator(42);
+ * sctp_link_conditions lossy;
+ * lossy.delay_ms = 20;
+ * lossy.loss = 0.05;
+ * emulator.set_conditions(lossy);
+ * boost::asio_sctp::sctp_backend::use_emulator(emulator);
+ * ...
+ * client.send(...);
+ * emulator.advance(100);  // delivers what is due by then, and moves the timers on
+ * io_service.poll();
+ * @endcode
+ *
+ * @par Thread Safety
+ * All member functions may be called from any thread. The emulator must
+ * outlive every socket created while it is in use.
+ */
+class sctp_emulator
+	: public detail::bridge_transport,
+		public sctp_clock
+{
+public:
+	/// Construct; seed fixes the random choices of delay and loss.
+	explicit sctp_emulator(boost::uint64_t seed = 1)
+		: random_(seed ? seed : 1),
+			now_(0),
+			serial_(0),
+			sequence_(0),
+			app_buffer_(BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE)
+	{
+		std::memset(&stats_, 0, sizeof(stats_));
+	}
+
+	/// Close every association; the applications see end of file.
+	~sctp_emulator()
+	{
+		if (sctp_clock::active() == this)
+			sctp_clock::activate(0);
+		for (association_map::iterator i = associations_.begin(); i != associations_.end(); ++i)
+			destroy(i->second);
+		for (timeline::iterator i = timeline_.begin(); i != timeline_.end(); ++i)
+			delete i->second.m;
+	}
+
+	/// Set the conditions of associations whose port has none of its own.
+	void set_conditions(const sctp_link_conditions& conditions)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		default_conditions_ = conditions;
+	}
+
+	/// Set the conditions of associations to the given port, including those already open.
+	void set_conditions(unsigned short port, const sctp_link_conditions& conditions)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		port_conditions_[port] = conditions;
+	}
+
+	/// The virtual time, in milliseconds since construction.
+	boost::uint64_t now() const
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return now_;
+	}
+
+	/// Take what the applications have sent and deliver what is due, without moving the clock.
+	/**
+	 * @returns The number of messages delivered.
+	 */
+	std::size_t poll()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return poll_locked();
+	}
+
+	/// Move the clock forward by ms, delivering each message at its time.
+	/**
+	 * @returns The number of messages delivered.
+	 */
+	std::size_t advance(boost::uint64_t ms)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		boost::uint64_t target = now_ + ms;
+		std::size_t delivered = poll_locked();
+		while (!timeline_.empty() && timeline_.begin()->first.first <= target)
+		{
+			now_ = std::max(now_, timeline_.begin()->first.first);
+			delivered += poll_locked();
+		}
+		now_ = target;
+		return delivered + poll_locked();
+	}
+
+	/// Move the clock forward until nothing is in flight, but by no more than limit_ms.
+	/**
+	 * Messages which cannot be delivered because the receiver is not reading
+	 * do not hold the clock.
+	 *
+	 * @returns The number of messages delivered.
+	 */
+	std::size_t settle(boost::uint64_t limit_ms = 60000)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		boost::uint64_t target = now_ + limit_ms;
+		std::size_t delivered = poll_locked();
+		while (!timeline_.empty() && timeline_.begin()->first.first <= target)
+		{
+			now_ = std::max(now_, timeline_.begin()->first.first);
+			delivered += poll_locked();
+		}
+		return delivered;
+	}
+
+	/// Tell every application whose peer is at address that the path to it changed state.
+	/**
+	 * @param state An sctp_spc_state value such as SCTP_ADDR_UNREACHABLE or SCTP_ADDR_AVAILABLE.
+	 *
+	 * @returns The number of notifications queued.
+	 */
+	std::size_t notify_path_change(const boost::asio::ip::address& address,
+		int state, int error = 0)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		std::size_t queued = 0;
+		for (association_map::iterator i = associations_.begin(); i != associations_.end(); ++i)
+		{
+			for (int e = 0; e < 2; ++e)
+			{
+				end& to = i->second->ends[e];
+				if (to.fd < 0 || to.closed || address_of(to.peer) != address)
+					continue;
+				sctp_paddr_change change;
+				std::memset(&change, 0, sizeof(change));
+				change.spc_type = SCTP_PEER_ADDR_CHANGE;
+				change.spc_length = sizeof(change);
+				std::memcpy(&change.spc_aaddr, &to.peer, sizeof(to.peer));
+				change.spc_state = state;
+				change.spc_error = error;
+				message* m = new message;
+				m->header = detail::bridge_header();
+				m->header.flags = detail::bridge_header::notification;
+				m->data.assign(reinterpret_cast<unsigned char*>(&change),
+					reinterpret_cast<unsigned char*>(&change) + sizeof(change));
+				to.ready.push_back(m);
+				++to.pending;
+				++queued;
+			}
+		}
+		poll_locked();
+		return queued;
+	}
+
+	/// Abort every association with a peer at address, as when all its paths fail.
+	/**
+	 * Both ends are told SCTP_COMM_LOST, then see end of file; messages in
+	 * flight are lost.
+	 *
+	 * @returns The number of associations aborted.
+	 */
+	std::size_t abort(const boost::asio::ip::address& address)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		std::size_t aborted = 0;
+		for (association_map::iterator i = associations_.begin(); i != associations_.end(); ++i)
+		{
+			association& a = *i->second;
+			if (!a.dead && (address_of(a.ends[0].peer) == address
+				|| address_of(a.ends[1].peer) == address))
+			{
+				abort(a);
+				++aborted;
+			}
+		}
+		reap();
+		return aborted;
+	}
+
+	/// Number of associations open.
+	std::size_t associations() const
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return associations_.size();
+	}
+
+	/// Counters since construction.
+	sctp_emulator_statistics statistics() const
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return stats_;
+	}
+
+	/// Pair a new association with the acceptor on the peer's port; the handler is called before returning.
+	void async_connect(const sockaddr* remote, socklen_t length, const connect_handler& handler)
+	{
+		boost::system::error_code ec;
+		int fd = -1;
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			fd = open_association(remote, length, ec);
+		}
+		handler(ec, fd);
+	}
+
+private:
+	boost::uint64_t elapsed_us() const
+	{
+		return now() * 1000;
+	}
+
+	struct message
+	{
+		boost::uint64_t sent_ms;
+		detail::bridge_header header;
+		std::vector<unsigned char> data;
+		std::size_t offset;  // passed to the receiver so far
+
+		message() : sent_ms(0), offset(0) {}
+	};
+
+	struct end
+	{
+		end() : fd(-1), closed(false), pending(0), assembling(0) {}
+
+		int fd;  // the emulator's side of the bridge
+		sockaddr_storage peer;  // as the application sees it
+		bool closed;  // the application has closed its socket
+		std::size_t pending;  // messages on their way to this end
+		std::deque<message*> ready;  // due, waiting for room in the bridge
+		message* assembling;  // pieces read so far of a message from this end
+		std::map<boost::uint16_t, boost::uint64_t> ordered_until;  // per stream, of messages from this end
+	};
+
+	struct association
+	{
+		association() : id(0), port(0), dead(false) {}
+
+		unsigned long id;
+		unsigned short port;  // the accepting side's
+		bool dead;
+		end ends[2];  // connecting side, accepting side
+	};
+
+	struct event
+	{
+		unsigned long id;
+		int to;
+		message* m;
+	};
+
+	typedef std::map<unsigned long, association*> association_map;
+	typedef std::map<std::pair<boost::uint64_t, boost::uint64_t>, event> timeline;
+
+	int open_association(const sockaddr* remote, socklen_t length,
+		boost::system::error_code& ec)
+	{
+		sockaddr_storage server = sockaddr_storage();
+		sockaddr_storage client = sockaddr_storage();
+		unsigned short port;
+		unsigned long id = ++serial_;
+		unsigned short client_port = static_cast<unsigned short>(49152 + id % 16384);
+		if (remote->sa_family == AF_INET && length >= sizeof(sockaddr_in))
+		{
+			std::memcpy(&server, remote, sizeof(sockaddr_in));
+			sockaddr_in* in = reinterpret_cast<sockaddr_in*>(&client);
+			in->sin_family = AF_INET;
+			in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			in->sin_port = htons(client_port);
+			port = ntohs(reinterpret_cast<sockaddr_in*>(&server)->sin_port);
+		}
+		else if (remote->sa_family == AF_INET6 && length >= sizeof(sockaddr_in6))
+		{
+			std::memcpy(&server, remote, sizeof(sockaddr_in6));
+			sockaddr_in6* in6 = reinterpret_cast<sockaddr_in6*>(&client);
+			in6->sin6_family = AF_INET6;
+			in6->sin6_addr = in6addr_loopback;
+			in6->sin6_port = htons(client_port);
+			port = ntohs(reinterpret_cast<sockaddr_in6*>(&server)->sin6_port);
+		}
+		else
+		{
+			ec = boost::asio::error::address_family_not_supported;
+			return -1;
+		}
+
+		// The accepting side connects to the acceptor's listener, as the
+		// user-space transport does.
+		int accepted = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (accepted < 0)
+		{
+			ec = last_error();
+			return -1;
+		}
+		sockaddr_un name;
+		socklen_t name_length = detail::bridge_name::make(name, "a", id, port,
+			reinterpret_cast<const sockaddr*>(&client));
+		sockaddr_un listener;
+		socklen_t listener_length = listener_name(port, listener);
+		if (::bind(accepted, reinterpret_cast<sockaddr*>(&name), name_length) != 0
+			|| ::connect(accepted, reinterpret_cast<sockaddr*>(&listener), listener_length) != 0)
+		{
+			ec = (errno == ENOENT || errno == ECONNREFUSED || errno == EAGAIN)
+				? boost::asio::error::connection_refused : last_error();
+			::close(accepted);
+			return -1;
+		}
+
+		int pair[2];
+		if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) != 0)
+		{
+			ec = last_error();
+			::close(accepted);
+			return -1;
+		}
+		::fcntl(pair[0], F_SETFL, ::fcntl(pair[0], F_GETFL) | O_NONBLOCK);
+		name_length = detail::bridge_name::make(name, "c", id, client_port,
+			reinterpret_cast<const sockaddr*>(&server));
+		::bind(pair[0], reinterpret_cast<sockaddr*>(&name), name_length);
+
+		association* a = new association;
+		a->id = id;
+		a->port = port;
+		a->ends[0].fd = pair[0];
+		a->ends[0].peer = server;
+		a->ends[1].fd = accepted;
+		a->ends[1].peer = client;
+		associations_[id] = a;
+		ec = boost::system::error_code();
+		return pair[1];
+	}
+
+	std::size_t poll_locked()
+	{
+		for (association_map::iterator i = associations_.begin(); i != associations_.end(); ++i)
+			for (int e = 0; e < 2; ++e)
+				read_from_application(*i->second, e);
+
+		while (!timeline_.empty() && timeline_.begin()->first.first <= now_)
+		{
+			event ev = timeline_.begin()->second;
+			timeline_.erase(timeline_.begin());
+			association_map::iterator i = associations_.find(ev.id);
+			if (i == associations_.end() || i->second->dead)
+				delete ev.m;
+			else
+				i->second->ends[ev.to].ready.push_back(ev.m);
+		}
+
+		std::size_t delivered = 0;
+		for (association_map::iterator i = associations_.begin(); i != associations_.end(); ++i)
+		{
+			association& a = *i->second;
+			for (int e = 0; e < 2 && !a.dead; ++e)
+				delivered += write_to_application(a, e);
+			for (int e = 0; e < 2 && !a.dead; ++e)
+			{
+				// Graceful shutdown: once one side has closed and everything it
+				// sent has been delivered, the other side sees end of file.
+				if (a.ends[e].closed && !a.ends[e].assembling && a.ends[1 - e].pending == 0)
+					a.dead = true;
+			}
+		}
+		reap();
+		return delivered;
+	}
+
+	void read_from_application(association& a, int from)
+	{
+		end& e = a.ends[from];
+		while (!a.dead && e.fd >= 0 && !e.closed)
+		{
+			detail::bridge_header header;
+			iovec iov[2];
+			iov[0].iov_base = &header;
+			iov[0].iov_len = sizeof(header);
+			iov[1].iov_base = &app_buffer_[0];
+			iov[1].iov_len = app_buffer_.size();
+			msghdr msg = msghdr();
+			msg.msg_iov = iov;
+			msg.msg_iovlen = 2;
+			ssize_t result = ::recvmsg(e.fd, &msg, MSG_DONTWAIT);
+			if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+				return;
+			if (result <= 0)
+			{
+				e.closed = true;
+				delete e.assembling;
+				e.assembling = 0;
+				return;
+			}
+			if (result < static_cast<ssize_t>(sizeof(header)))
+				continue;
+
+			if (!e.assembling)
+			{
+				e.assembling = new message;
+				e.assembling->sent_ms = now_;
+				e.assembling->header = header;
+			}
+			e.assembling->data.insert(e.assembling->data.end(), app_buffer_.begin(),
+				app_buffer_.begin() + (result - sizeof(header)));
+			if (header.flags & detail::bridge_header::end_of_record)
+			{
+				message* m = e.assembling;
+				e.assembling = 0;
+				schedule(a, from, m);
+			}
+		}
+	}
+
+	void schedule(association& a, int from, message* m)
+	{
+		const sctp_link_conditions& c = conditions(a.port);
+		++stats_.messages_sent;
+
+		unsigned int losses = 0;
+		while (c.loss > 0 && random_unit() < c.loss)
+		{
+			if (++losses > c.max_retransmits)
+			{
+				BOOST_ASIO_SCTP_LOG(debug, ("sctp_emulator - association {} on port {} lost after {} retransmissions",
+					a.id, a.port, c.max_retransmits));
+				delete m;
+				abort(a);
+				return;
+			}
+		}
+		stats_.retransmissions += losses;
+
+		boost::uint64_t due = now_ + c.delay_ms + boost::uint64_t(losses) * c.rto_ms;
+		if (c.jitter_ms)
+			due += next_random() % (c.jitter_ms + 1);
+		if (m->header.time_to_live && due - m->sent_ms > m->header.time_to_live)
+		{
+			++stats_.abandoned;
+			delete m;
+			return;
+		}
+		if (!(m->header.sinfo_flags & SCTP_UNORDERED))
+		{
+			boost::uint64_t& until = a.ends[from].ordered_until[m->header.stream];
+			if (due < until)
+				due = until;
+			until = due;
+		}
+
+		event ev = { a.id, 1 - from, m };
+		timeline_[std::make_pair(due, sequence_++)] = ev;
+		++a.ends[1 - from].pending;
+	}
+
+	// Pass due messages to the application, in pieces of the link's fragment
+	// size; a message which does not fit waits for the next poll.
+	std::size_t write_to_application(association& a, int to)
+	{
+		end& e = a.ends[to];
+		std::size_t piece = conditions(a.port).fragment_size;
+		if (piece == 0 || piece > BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE)
+			piece = BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE;
+		std::size_t delivered = 0;
+		while (!e.ready.empty())
+		{
+			message* m = e.ready.front();
+			if (e.closed)
+			{
+				e.ready.pop_front();
+				--e.pending;
+				delete m;
+				continue;
+			}
+			do
+			{
+				std::size_t length = m->data.size() - m->offset;
+				if (!(m->header.flags & detail::bridge_header::notification))
+					length = std::min(piece, length);  // notifications arrive whole
+				detail::bridge_header header = m->header;
+				header.flags = static_cast<boost::uint16_t>(
+					(m->header.flags & detail::bridge_header::notification)
+					| (m->offset + length == m->data.size() ? detail::bridge_header::end_of_record : 0));
+				iovec iov[2];
+				iov[0].iov_base = &header;
+				iov[0].iov_len = sizeof(header);
+				iov[1].iov_base = m->data.empty() ? 0 : &m->data[m->offset];
+				iov[1].iov_len = length;
+				msghdr msg = msghdr();
+				msg.msg_iov = iov;
+				msg.msg_iovlen = 2;
+				if (::sendmsg(e.fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+				{
+					if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+						return delivered;
+					e.closed = true;  // the application has gone
+					break;
+				}
+				m->offset += length;
+			} while (m->offset < m->data.size());
+
+			e.ready.pop_front();
+			--e.pending;
+			if (!e.closed && !(m->header.flags & detail::bridge_header::notification))
+			{
+				++stats_.messages_delivered;
+				++delivered;
+			}
+			delete m;
+		}
+		return delivered;
+	}
+
+	// Tell both applications the association is lost and close it.
+	void abort(association& a)
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			end& e = a.ends[i];
+			if (e.fd < 0 || e.closed)
+				continue;
+			sctp_assoc_change change;
+			std::memset(&change, 0, sizeof(change));
+			change.sac_type = SCTP_ASSOC_CHANGE;
+			change.sac_length = sizeof(change);
+			change.sac_state = SCTP_COMM_LOST;
+			detail::bridge_header header = detail::bridge_header();
+			header.flags = detail::bridge_header::notification | detail::bridge_header::end_of_record;
+			iovec iov[2];
+			iov[0].iov_base = &header;
+			iov[0].iov_len = sizeof(header);
+			iov[1].iov_base = &change;
+			iov[1].iov_len = sizeof(change);
+			msghdr msg = msghdr();
+			msg.msg_iov = iov;
+			msg.msg_iovlen = 2;
+			ssize_t ignored = ::sendmsg(e.fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+			(void)ignored;
+		}
+		a.dead = true;
+		++stats_.aborted;
+	}
+
+	void reap()
+	{
+		for (association_map::iterator i = associations_.begin(); i != associations_.end(); )
+		{
+			if (i->second->dead)
+			{
+				destroy(i->second);
+				associations_.erase(i++);
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+
+	static void destroy(association* a)
+	{
+		for (int i = 0; i < 2; ++i)
+		{
+			end& e = a->ends[i];
+			if (e.fd >= 0)
+				::close(e.fd);
+			for (std::size_t j = 0; j < e.ready.size(); ++j)
+				delete e.ready[j];
+			delete e.assembling;
+		}
+		delete a;
+	}
+
+	const sctp_link_conditions& conditions(unsigned short port) const
+	{
+		std::map<unsigned short, sctp_link_conditions>::const_iterator i = port_conditions_.find(port);
+		return i == port_conditions_.end() ? default_conditions_ : i->second;
+	}
+
+	static boost::asio::ip::address address_of(const sockaddr_storage& s)
+	{
+		if (s.ss_family == AF_INET6)
+		{
+			boost::asio::ip::address_v6::bytes_type bytes;
+			std::memcpy(bytes.data(), &reinterpret_cast<const sockaddr_in6&>(s).sin6_addr, 16);
+			return boost::asio::ip::address_v6(bytes);
+		}
+		return boost::asio::ip::address_v4(
+			ntohl(reinterpret_cast<const sockaddr_in&>(s).sin_addr.s_addr));
+	}
+
+	static boost::system::error_code last_error()
+	{
+		return boost::system::error_code(errno, boost::asio::error::get_system_category());
+	}
+
+	boost::uint32_t next_random()
+	{
+		random_ ^= random_ << 13;
+		random_ ^= random_ >> 7;
+		random_ ^= random_ << 17;
+		return static_cast<boost::uint32_t>(random_ >> 16);
+	}
+
+	double random_unit()
+	{
+		return (next_random() & 0xffffff) / double(0x1000000);
+	}
+
+	mutable boost::mutex mutex_;
+	sctp_link_conditions default_conditions_;
+	std::map<unsigned short, sctp_link_conditions> port_conditions_;
+	association_map associations_;
+	timeline timeline_;
+	boost::uint64_t random_;
+	boost::uint64_t now_;
+	unsigned long serial_;
+	boost::uint64_t sequence_;
+	std::vector<unsigned char> app_buffer_;
+	sctp_emulator_statistics stats_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_EMULATOR_HPP
@@ -0,0 +1,298 @@
+//
+// sctp_handler_allocator.hpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_HANDLER_ALLOCATOR_HPP
+#define BOOST_ASIO_SCTP_SCTP_HANDLER_ALLOCATOR_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <new>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/type_traits/aligned_storage.hpp>
+#include <boost/asio/handler_alloc_hook.hpp>
+#include <boost/asio/handler_invoke_hook.hpp>
+#include <boost/asio/detail/handler_invoke_helpers.hpp>
+#include <boost/asio_sctp/detail/atomic.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+namespace detail {
+
+// Blocks freed by handlers on this thread, kept for the next operation
+// started on it. Blocks are all of one size, so any may serve any request
+// which fits; they are freed when the thread exits.
+class thread_handler_cache
+{
+public:
+	enum { block_size = 512, max_blocks = 8 };
+
+	static void* allocate(std::size_t size)
+	{
+		if (size <= std::size_t(block_size))
+		{
+			thread_handler_cache* cache = current();
+			if (cache->count_)
+				return cache->blocks_[--cache->count_];
+			size = block_size;
+		}
+		return ::operator new(size);
+	}
+
+	static void deallocate(void* p, std::size_t size)
+	{
+		if (size <= std::size_t(block_size))
+		{
+			thread_handler_cache* cache = current();
+			if (cache->count_ < max_blocks)
+			{
+				cache->blocks_[cache->count_++] = p;
+				return;
+			}
+		}
+		::operator delete(p);
+	}
+
+	~thread_handler_cache()
+	{
+		while (count_)
+			::operator delete(blocks_[--count_]);
+	}
+
+private:
+	thread_handler_cache()
+		: count_(0)
+	{
+	}
+
+	static thread_handler_cache* current()
+	{
+		static __thread thread_handler_cache* cache = 0;
+		if (!cache)
+		{
+			static boost::thread_specific_ptr<thread_handler_cache> owner;
+			cache = new thread_handler_cache;
+			owner.reset(cache);  // only so that it is freed with the thread
+		}
+		return cache;
+	}
+
+	void* blocks_[max_blocks];
+	std::size_t count_;
+};
+
+} // namespace detail
+
+template <typename Handler> class sctp_alloc_handler;
+
+/// Recycles the memory of an association's asynchronous operations.
+/**
+ * Every asynchronous operation allocates an object holding its handler, and
+ * frees it just before the handler is called. Handlers wrapped by wrap() take
+ * that memory from here instead of the heap: first from a few slots owned by
+ * the allocator, which an association's handful of outstanding operations
+ * (a receive, a send, a timer, a post) take in turn, then from blocks cached
+ * per thread. Once every operation has run once, starting one allocates
+ * nothing.
+ *
+ * Both Boost.Asio's handler allocation hooks (asio_handler_allocate) and, for
+ * later versions, the associated allocator (get_allocator()) lead here.
+ *
+ * @par Example
+ * @code
+ * socket.async_receive(boost::asio::null_buffers(),
+ *   handler_memory.wrap(boost::bind(&connection::on_readable, this, _1)));
+ * @endcode
+ *
+ * @par Thread Safety
+ * Operations may be started and completed on any threads. The allocator must
+ * outlive the operations started with its handlers.
+ */
+class sctp_handler_allocator
+	: private boost::noncopyable
+{
+public:
+	enum { slot_size = 256, slot_count = 4 };
+
+	sctp_handler_allocator()
+	{
+		for (int i = 0; i < slot_count; ++i)
+			in_use_[i] = false;
+	}
+
+	void* allocate(std::size_t size)
+	{
+		if (size <= std::size_t(slot_size))
+		{
+			for (int i = 0; i < slot_count; ++i)
+			{
+				if (detail::atomic::compare_exchange(in_use_[i], false, true))
+					return slots_[i].address();
+			}
+		}
+		return detail::thread_handler_cache::allocate(size);
+	}
+
+	void deallocate(void* p, std::size_t size)
+	{
+		for (int i = 0; i < slot_count; ++i)
+		{
+			if (p == slots_[i].address())
+			{
+				detail::atomic::store_release(in_use_[i], false);
+				return;
+			}
+		}
+		detail::thread_handler_cache::deallocate(p, size);
+	}
+
+	/// Wrap a handler so that the operation it is passed to allocates from here.
+	template <typename Handler>
+	sctp_alloc_handler<Handler> wrap(Handler handler)
+	{
+		return sctp_alloc_handler<Handler>(*this, handler);
+	}
+
+	/// A standard allocator over an sctp_handler_allocator.
+	template <typename T>
+	class std_allocator
+	{
+	public:
+		typedef T value_type;
+		typedef T* pointer;
+		typedef const T* const_pointer;
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef std_allocator<U> other;
+		};
+
+		explicit std_allocator(sctp_handler_allocator& a)
+			: allocator_(&a)
+		{
+		}
+
+		template <typename U>
+		std_allocator(const std_allocator<U>& other)
+			: allocator_(other.allocator_)
+		{
+		}
+
+		T* allocate(std::size_t n)
+		{
+			return static_cast<T*>(allocator_->allocate(n * sizeof(T)));
+		}
+
+		void deallocate(T* p, std::size_t n)
+		{
+			allocator_->deallocate(p, n * sizeof(T));
+		}
+
+		template <typename U>
+		bool operator==(const std_allocator<U>& other) const
+		{
+			return allocator_ == other.allocator_;
+		}
+
+		template <typename U>
+		bool operator!=(const std_allocator<U>& other) const
+		{
+			return allocator_ != other.allocator_;
+		}
+
+	private:
+		template <typename U> friend class std_allocator;
+		sctp_handler_allocator* allocator_;
+	};
+
+private:
+	boost::aligned_storage<slot_size> slots_[slot_count];
+	volatile bool in_use_[slot_count];
+};
+
+/// A handler whose operation's memory comes from an sctp_handler_allocator.
+template <typename Handler>
+class sctp_alloc_handler
+{
+public:
+	typedef void result_type;
+	typedef sctp_handler_allocator::std_allocator<void> allocator_type;
+
+	sctp_alloc_handler(sctp_handler_allocator& allocator, Handler handler)
+		: allocator_(&allocator),
+			handler_(handler)
+	{
+	}
+
+	allocator_type get_allocator() const
+	{
+		return allocator_type(*allocator_);
+	}
+
+	void operator()()
+	{
+		handler_();
+	}
+
+	template <typename Arg1>
+	void operator()(const Arg1& arg1)
+	{
+		handler_(arg1);
+	}
+
+	template <typename Arg1, typename Arg2>
+	void operator()(const Arg1& arg1, const Arg2& arg2)
+	{
+		handler_(arg1, arg2);
+	}
+
+	friend void* asio_handler_allocate(std::size_t size, sctp_alloc_handler* h)
+	{
+		return h->allocator_->allocate(size);
+	}
+
+	friend void asio_handler_deallocate(void* p, std::size_t size, sctp_alloc_handler* h)
+	{
+		h->allocator_->deallocate(p, size);
+	}
+
+	// Keep the wrapped handler's invocation strategy, e.g. a strand's.
+	template <typename Function>
+	friend void asio_handler_invoke(Function& function, sctp_alloc_handler* h)
+	{
+		boost_asio_handler_invoke_helpers::invoke(function, h->handler_);
+	}
+
+	template <typename Function>
+	friend void asio_handler_invoke(const Function& function, sctp_alloc_handler* h)
+	{
+		boost_asio_handler_invoke_helpers::invoke(function, h->handler_);
+	}
+
+private:
+	sctp_handler_allocator* allocator_;
+	Handler handler_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_HANDLER_ALLOCATOR_HPP
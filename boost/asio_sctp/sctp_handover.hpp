@@ -0,0 +1,189 @@
+//
+// sctp_handover.hpp
+// ~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_HANDOVER_HPP
+#define BOOST_ASIO_SCTP_SCTP_HANDOVER_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <boost/asio/error.hpp>
+#include <boost/cstdint.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Passes SCTP sockets to another process, so a server can be replaced without losing its port.
+/**
+ * The descriptors travel as SCM_RIGHTS over a connected AF_UNIX socket (a
+ * boost::asio::local::stream_protocol socket's native_handle() will do), in
+ * batches of at most max_batch, each marked with what it holds. The kernel
+ * socket stays open as long as either process has it, so passing the
+ * listening socket means no association attempt is refused during the
+ * restart: the successor accepts from the same queue.
+ *
+ * An established association may be passed too, but only once the sender has
+ * stopped reading and writing it; what it has buffered in user space is not
+ * passed.
+ *
+ * @par Example
+ * @code
+ * // Old process, when the successor connects:
+ * int fd = acceptor.native_handle();
+ * sctp_handover::send(channel.native_handle(), sctp_handover::listener, &fd, 1, ec);
+ * acceptor.close_handed_over(ec);
+ *
+ * // Successor:
+ * int fds[sctp_handover::max_batch];
+ * sctp_handover::kind k;
+ * if (sctp_handover::receive(channel.native_handle(), k, fds, ec) == 1 && k == sctp_handover::listener)
+ *   acceptor.assign(boost::asio_sctp::ip::sctp::v4(), fds[0]);
+ * @endcode
+ */
+class sctp_handover
+{
+public:
+	/// What a batch of descriptors holds.
+	enum kind
+	{
+		listener = 1,
+		association = 2
+	};
+
+	/// Most descriptors passed in one message.
+	enum { max_batch = 64 };
+
+	/// Pass count descriptors of the given kind; the caller keeps its own copies.
+	/**
+	 * @returns The number of descriptors passed, all of them unless ec is set.
+	 */
+	static std::size_t send(int channel, kind k, const int* fds, std::size_t count,
+		boost::system::error_code& ec)
+	{
+		std::size_t sent = 0;
+		do
+		{
+			std::size_t n = count - sent < std::size_t(max_batch) ? count - sent : std::size_t(max_batch);
+			batch_header header = { magic, static_cast<boost::uint16_t>(k), static_cast<boost::uint16_t>(n) };
+			iovec iov = { &header, sizeof(header) };
+			char control[CMSG_SPACE(max_batch * sizeof(int))];
+			msghdr msg = msghdr();
+			msg.msg_iov = &iov;
+			msg.msg_iovlen = 1;
+			if (n)
+			{
+				msg.msg_control = control;
+				msg.msg_controllen = CMSG_SPACE(n * sizeof(int));
+				cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+				cmsg->cmsg_level = SOL_SOCKET;
+				cmsg->cmsg_type = SCM_RIGHTS;
+				cmsg->cmsg_len = CMSG_LEN(n * sizeof(int));
+				std::memcpy(CMSG_DATA(cmsg), fds + sent, n * sizeof(int));
+			}
+			ssize_t result;
+			while ((result = ::sendmsg(channel, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+				;
+			if (result != static_cast<ssize_t>(sizeof(header)))
+			{
+				ec = result < 0 ? last_error() : boost::asio::error::message_size;
+				return sent;
+			}
+			sent += n;
+		} while (sent < count);
+		ec = boost::system::error_code();
+		return sent;
+	}
+
+	/// Take one batch of descriptors, which belong to the caller from then on.
+	/**
+	 * @param fds Room for max_batch descriptors.
+	 *
+	 * @returns The number of descriptors received; zero without error once the
+	 * sender has closed the channel.
+	 */
+	static std::size_t receive(int channel, kind& k, int* fds, boost::system::error_code& ec)
+	{
+		batch_header header;
+		iovec iov = { &header, sizeof(header) };
+		char control[CMSG_SPACE(max_batch * sizeof(int))];
+		msghdr msg = msghdr();
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		ssize_t result;
+		while ((result = ::recvmsg(channel, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+			;
+		if (result < 0)
+		{
+			ec = last_error();
+			return 0;
+		}
+
+		std::size_t count = 0;
+		for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			{
+				std::size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+				std::memcpy(fds + count, CMSG_DATA(cmsg), n * sizeof(int));
+				count += n;
+			}
+		}
+		if (result == 0 && count == 0)
+		{
+			ec = boost::system::error_code();
+			return 0;
+		}
+		if (result != static_cast<ssize_t>(sizeof(header)) || header.magic != magic
+			|| header.count != count || (msg.msg_flags & MSG_CTRUNC))
+		{
+			for (std::size_t i = 0; i < count; ++i)
+				::close(fds[i]);
+			ec = boost::asio::error::invalid_argument;
+			return 0;
+		}
+		k = static_cast<kind>(header.kind);
+		ec = boost::system::error_code();
+		return count;
+	}
+
+private:
+	enum { magic = 0x53435448 };  // "SCTH"
+
+	struct batch_header
+	{
+		boost::uint32_t magic;
+		boost::uint16_t kind;
+		boost::uint16_t count;
+	};
+
+	static boost::system::error_code last_error()
+	{
+		return boost::system::error_code(errno, boost::asio::error::get_system_category());
+	}
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_HANDOVER_HPP
@@ -0,0 +1,522 @@
+//
+// sctp_iostream.hpp
+// ~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_IOSTREAM_HPP
+#define BOOST_ASIO_SCTP_SCTP_IOSTREAM_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <boost/noncopyable.hpp>
+#include <boost/utility/base_from_member.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/basic_resolver.hpp>
+#include <boost/asio/ip/basic_resolver_query.hpp>
+#include <boost/asio_sctp/ip/sctp.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+#include <boost/asio_sctp/sctp_receive_batch.hpp>
+#include <boost/asio_sctp/sctp_socket_acceptor.hpp>
+#include <boost/asio_sctp/sctp_stream_socket.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// A stream buffer over an SCTP association which keeps message boundaries.
+/**
+ * Reads take whatever messages are waiting in one go, with
+ * sctp_receive_batch, into a buffer which is reused for the life of the
+ * stream, and the get area is then each message in turn, in place; nothing is
+ * copied and there is no read per underflow. stream(), ppid() and
+ * message_size() describe the message being read. By default reading runs on
+ * into the next message as a byte stream would; with set_message_mode(true) it
+ * stops at the end of each one, and next_message() starts the next.
+ * Notifications are skipped. Connecting or accepting through the stream buffer
+ * subscribes to data_io events, without which the stream and PPID of a
+ * message are not reported; a socket set up otherwise must subscribe itself.
+ *
+ * Writes collect in a buffer which grows to hold the largest message, and
+ * each flush (sync) sends what has been written as one message, on the stream
+ * and with the PPID set by set_outbound(). A message is never split.
+ *
+ * Stream numbers and PPIDs are passed as they are, as with sctp_message and
+ * sctp_outbound_message.
+ */
+template <typename Protocol>
+class basic_sctp_streambuf
+	: public std::streambuf,
+		private boost::noncopyable
+{
+public:
+	/// The endpoint type.
+	typedef typename Protocol::endpoint endpoint_type;
+
+	/// The socket type.
+	typedef sctp_stream_socket<Protocol> socket_type;
+
+	/// The acceptor type.
+	typedef sctp_socket_acceptor<Protocol> acceptor_type;
+
+	/// Construct; batch_bytes is the most read in one go, write_bytes the initial write buffer.
+	explicit basic_sctp_streambuf(std::size_t batch_bytes = 256 * 1024,
+		std::size_t write_bytes = 64 * 1024, std::size_t max_message_size = 0)
+		: socket_(io_service_),
+			batch_(max_messages, batch_bytes, max_message_size),
+			next_(0),
+			current_(false),
+			message_mode_(false),
+			out_(write_bytes ? write_bytes : 1),
+			out_stream_(0),
+			out_ppid_(0)
+	{
+		current_message_.data = 0;
+		current_message_.size = 0;
+		current_message_.stream = 0;
+		current_message_.ppid = 0;
+		current_message_.assoc_id = 0;
+		current_message_.flags = 0;
+		current_message_.timestamp_ns = 0;
+		setg(0, 0, 0);
+		setp(&out_[0], &out_[0] + out_.size());
+	}
+
+	/// Send what has been written, then close the association.
+	virtual ~basic_sctp_streambuf()
+	{
+		if (pptr() != pbase())
+			sync();
+	}
+
+	/// Connect to an endpoint; returns null on failure, with the reason in puberror().
+	basic_sctp_streambuf* connect(const endpoint_type& endpoint)
+	{
+		init();
+		socket_.close(error_);
+		socket_.connect(endpoint, error_);
+		if (!error_)
+			subscribe();
+		return error_ ? 0 : this;
+	}
+
+	/// Resolve a host and service and connect to the first endpoint which answers.
+	basic_sctp_streambuf* connect(const std::string& host, const std::string& service)
+	{
+		init();
+		typedef boost::asio::ip::basic_resolver<Protocol> resolver_type;
+		resolver_type resolver(io_service_);
+		typename resolver_type::iterator i = resolver.resolve(
+			boost::asio::ip::basic_resolver_query<Protocol>(host, service), error_);
+		if (error_)
+			return 0;
+		error_ = boost::asio::error::host_not_found;
+		for (typename resolver_type::iterator end; i != end && error_; ++i)
+		{
+			socket_.close(error_);
+			socket_.connect(*i, error_);
+		}
+		if (!error_)
+			subscribe();
+		return error_ ? 0 : this;
+	}
+
+	/// Accept an association from an acceptor; returns null on failure, with the reason in puberror().
+	basic_sctp_streambuf* accept(acceptor_type& acceptor)
+	{
+		init();
+		socket_.close(error_);
+		acceptor.accept(socket_, error_);
+		if (!error_)
+			subscribe();
+		return error_ ? 0 : this;
+	}
+
+	/// Send what has been written, then close; returns null if that failed.
+	basic_sctp_streambuf* close()
+	{
+		sync();
+		boost::system::error_code ec;
+		socket_.close(ec);
+		if (!error_)
+			error_ = ec;
+		return error_ ? 0 : this;
+	}
+
+	/// The underlying socket, e.g. to set options on.
+	socket_type& socket()
+	{
+		return socket_;
+	}
+
+	/// The last error, if any.
+	const boost::system::error_code& puberror() const
+	{
+		return error_;
+	}
+
+	/// Stop reads at the end of each message, until next_message() is called.
+	void set_message_mode(bool stop_at_message_end)
+	{
+		message_mode_ = stop_at_message_end;
+	}
+
+	/// Skip what is left of the message being read and start on the next.
+	/**
+	 * @returns false if there is no next message: the peer has shut down, or
+	 * an error occurred, which puberror() gives.
+	 */
+	bool next_message()
+	{
+		setg(0, 0, 0);
+		current_ = false;
+		return load_next();
+	}
+
+	/// The stream the message being read arrived on.
+	uint16_t stream() const
+	{
+		return current_message_.stream;
+	}
+
+	/// The payload protocol ID of the message being read.
+	uint32_t ppid() const
+	{
+		return current_message_.ppid;
+	}
+
+	/// The size of the message being read.
+	std::size_t message_size() const
+	{
+		return current_message_.size;
+	}
+
+	/// Send the messages written from now on, one per flush, on a stream with a PPID.
+	void set_outbound(uint16_t stream, uint32_t ppid = 0)
+	{
+		out_stream_ = stream;
+		out_ppid_ = ppid;
+	}
+
+protected:
+	int_type underflow()
+	{
+		if (gptr() < egptr())
+			return traits_type::to_int_type(*gptr());
+		if (message_mode_ && current_)
+			return traits_type::eof();  // the end of this message
+		while (load_next())
+		{
+			if (gptr() < egptr())
+				return traits_type::to_int_type(*gptr());
+			if (message_mode_)
+				return traits_type::eof();  // an empty message
+		}
+		return traits_type::eof();
+	}
+
+	int_type overflow(int_type c)
+	{
+		if (traits_type::eq_int_type(c, traits_type::eof()))
+			return sync() == 0 ? traits_type::not_eof(c) : traits_type::eof();
+		reserve(1);
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+		return c;
+	}
+
+	std::streamsize xsputn(const char* s, std::streamsize n)
+	{
+		reserve(static_cast<std::size_t>(n));
+		std::memcpy(pptr(), s, static_cast<std::size_t>(n));
+		pbump(static_cast<int>(n));
+		return n;
+	}
+
+	// Send what has been written as one message.
+	int sync()
+	{
+		std::size_t n = pptr() - pbase();
+		if (n == 0)
+			return 0;
+		sctp_outbound_message msg;
+		msg.buffer = boost::asio::const_buffer(pbase(), n);
+		msg.stream = out_stream_;
+		msg.ppid = out_ppid_;
+		msg.flags = 0;
+		msg.time_to_live = 0;
+		socket_.send_batch(&msg, &msg + 1, error_);
+		setp(&out_[0], &out_[0] + out_.size());
+		return error_ ? -1 : 0;
+	}
+
+	std::streambuf* setbuf(char*, std::streamsize)
+	{
+		return 0;  // the buffers are the stream's own
+	}
+
+private:
+	// The most messages read in one go; each is a few bytes of bookkeeping.
+	enum { max_messages = 256 };
+
+	void init()
+	{
+		setg(0, 0, 0);
+		setp(&out_[0], &out_[0] + out_.size());
+		current_ = false;
+		next_ = 0;
+		error_ = boost::system::error_code();
+	}
+
+	// Have each message's stream and PPID reported; on failure the association
+	// is closed, as it could not be read as this stream buffer promises.
+	void subscribe()
+	{
+		sctp_event_subs_t subs;
+		std::memset(&subs, 0, sizeof(subs));
+		subs.sctp_data_io_event = 1;
+		if (socket_.set_option(socket_option::sctp_event_subscribe(subs), error_))
+		{
+			boost::system::error_code ec;
+			socket_.close(ec);
+		}
+	}
+
+	// Make the next message, skipping notifications, the get area; reads another
+	// batch once this one is used up.
+	bool load_next()
+	{
+		for (;;)
+		{
+			while (next_ < batch_.size())
+			{
+				std::size_t i = next_++;
+				if (batch_.info(i).msg_flags & MSG_NOTIFICATION)
+					continue;
+				current_message_ = batch_[i];
+				char* data = reinterpret_cast<char*>(const_cast<unsigned char*>(current_message_.data));
+				setg(data, data, data + current_message_.size);  // never written to
+				current_ = true;
+				return true;
+			}
+
+			if (!socket_.is_open())
+			{
+				error_ = boost::asio::error::not_connected;
+				return false;
+			}
+			next_ = 0;
+			batch_.fill(socket_, error_);
+			if (error_ == boost::asio::error::would_block
+				|| error_ == boost::asio::error::try_again)
+			{
+				// Only parts of a message, or a non-blocking socket with nothing
+				// waiting: a stream read blocks, so wait for more to arrive.
+				error_ = boost::system::error_code();
+				pollfd pfd = { socket_.native_handle(), POLLIN, 0 };
+				if (::poll(&pfd, 1, -1) < 0 && errno != EINTR)
+					error_ = boost::system::error_code(errno, boost::asio::error::get_system_category());
+			}
+			if (error_)
+			{
+				setg(0, 0, 0);
+				current_ = false;
+				return false;
+			}
+		}
+	}
+
+	// Make room for n more bytes of the message being written.
+	void reserve(std::size_t n)
+	{
+		std::size_t used = pptr() - pbase();
+		if (out_.size() - used >= n)
+			return;
+		std::size_t size = out_.size() * 2;
+		while (size - used < n)
+			size *= 2;
+		out_.resize(size);
+		setp(&out_[0], &out_[0] + out_.size());
+		pbump(static_cast<int>(used));
+	}
+
+	boost::asio::io_service io_service_;
+	socket_type socket_;
+	sctp_receive_batch batch_;
+	std::size_t next_;  // the batch message to read after this one
+	bool current_;  // the get area is a message
+	bool message_mode_;  // reads stop at the end of each message
+	sctp_message current_message_;
+	std::vector<char> out_;  // the message being written
+	uint16_t out_stream_;
+	uint32_t out_ppid_;
+	boost::system::error_code error_;
+};
+
+/// An iostream over an SCTP association which keeps message boundaries.
+/**
+ * Each flush sends what has been written since the last one as one message;
+ * std::endl and std::flush therefore end a message. See basic_sctp_streambuf
+ * for how messages are read.
+ *
+ * @par Example
+ * @code
+ * boost::asio_sctp::ip::sctp::iostream s("server.example.com", "54321");
+ * s.set_outbound(1, 42);
+ * s << "GET status" << std::flush;  // one message on stream 1
+ * s.set_message_mode(true);
+ * std::string line;
+ * while (std::getline(s, line))
+ *   std::cout << "stream " << s.stream() << ": " << line << "\n";
+ * s.next_message();  // the reply has been read; on to the next one
+ * @endcode
+ */
+template <typename Protocol>
+class basic_sctp_iostream
+	: private boost::base_from_member<basic_sctp_streambuf<Protocol> >,
+		public std::basic_iostream<char>
+{
+public:
+	/// The endpoint type.
+	typedef typename Protocol::endpoint endpoint_type;
+
+	/// The socket type.
+	typedef sctp_stream_socket<Protocol> socket_type;
+
+	/// Construct unconnected, e.g. to accept().
+	basic_sctp_iostream()
+		: std::basic_iostream<char>(&this->member)
+	{
+	}
+
+	/// Construct and connect to an endpoint.
+	explicit basic_sctp_iostream(const endpoint_type& endpoint)
+		: std::basic_iostream<char>(&this->member)
+	{
+		connect(endpoint);
+	}
+
+	/// Construct, resolve a host and service, and connect.
+	basic_sctp_iostream(const std::string& host, const std::string& service)
+		: std::basic_iostream<char>(&this->member)
+	{
+		connect(host, service);
+	}
+
+	/// Connect to an endpoint; sets failbit on failure.
+	void connect(const endpoint_type& endpoint)
+	{
+		if (rdbuf()->connect(endpoint) == 0)
+			this->setstate(std::ios_base::failbit);
+	}
+
+	/// Resolve a host and service and connect; sets failbit on failure.
+	void connect(const std::string& host, const std::string& service)
+	{
+		if (rdbuf()->connect(host, service) == 0)
+			this->setstate(std::ios_base::failbit);
+	}
+
+	/// Accept an association from an acceptor; sets failbit on failure.
+	void accept(typename basic_sctp_streambuf<Protocol>::acceptor_type& acceptor)
+	{
+		if (rdbuf()->accept(acceptor) == 0)
+			this->setstate(std::ios_base::failbit);
+	}
+
+	/// Send what has been written and close; sets failbit on failure.
+	void close()
+	{
+		if (rdbuf()->close() == 0)
+			this->setstate(std::ios_base::failbit);
+	}
+
+	/// The stream buffer.
+	basic_sctp_streambuf<Protocol>* rdbuf() const
+	{
+		return const_cast<basic_sctp_streambuf<Protocol>*>(&this->member);
+	}
+
+	/// The underlying socket.
+	socket_type& socket()
+	{
+		return rdbuf()->socket();
+	}
+
+	/// The last error, if any.
+	const boost::system::error_code& error() const
+	{
+		return rdbuf()->puberror();
+	}
+
+	/// Stop reads at the end of each message, until next_message() is called.
+	void set_message_mode(bool stop_at_message_end)
+	{
+		rdbuf()->set_message_mode(stop_at_message_end);
+	}
+
+	/// Skip the rest of the message being read and start on the next.
+	/**
+	 * Clears eofbit and failbit if there is a next message, and sets them if
+	 * there is not.
+	 */
+	bool next_message()
+	{
+		if (rdbuf()->next_message())
+		{
+			this->clear(this->rdstate() & ~(std::ios_base::eofbit | std::ios_base::failbit));
+			return true;
+		}
+		this->setstate(std::ios_base::eofbit | std::ios_base::failbit);
+		return false;
+	}
+
+	/// The stream the message being read arrived on.
+	uint16_t stream() const
+	{
+		return rdbuf()->stream();
+	}
+
+	/// The payload protocol ID of the message being read.
+	uint32_t ppid() const
+	{
+		return rdbuf()->ppid();
+	}
+
+	/// The size of the message being read.
+	std::size_t message_size() const
+	{
+		return rdbuf()->message_size();
+	}
+
+	/// Send the messages written from now on, one per flush, on a stream with a PPID.
+	void set_outbound(uint16_t stream, uint32_t ppid = 0)
+	{
+		rdbuf()->set_outbound(stream, ppid);
+	}
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_IOSTREAM_HPP
@@ -0,0 +1,152 @@
+//
+// sctp_message.hpp
+// ~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_MESSAGE_HPP
+#define BOOST_ASIO_SCTP_SCTP_MESSAGE_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <boost/asio/buffer.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <boost/asio_sctp/detail/sctp_socket_types.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// A received SCTP user message.
+/**
+ * Describes one complete user message without owning its payload: @c data
+ * points into the receive buffer it was read into and is only valid until
+ * that buffer is reused. @c timestamp_ns is when the kernel received the
+ * message (its last piece), as for sctp_receive_info.
+ */
+struct sctp_message
+{
+	const unsigned char* data;
+	std::size_t size;
+	uint16_t stream;
+	uint32_t ppid;
+	sctp_assoc_t assoc_id;
+	int flags;
+	boost::uint64_t timestamp_ns;
+};
+
+/// Metadata for one read from an SCTP socket.
+/**
+ * @c msg_flags holds the recvmsg flags; MSG_EOR is set on the read which
+ * completes a user message and MSG_NOTIFICATION on notifications.
+ *
+ * With the receive_timestamps option set, @c timestamp_ns is the time the
+ * kernel queued the data on the socket, in nanoseconds since the epoch on
+ * CLOCK_REALTIME; otherwise it is zero. The difference from the time the data
+ * is handled is the delay within this process.
+ */
+struct sctp_receive_info
+{
+	uint16_t stream;
+	uint32_t ppid;
+	sctp_assoc_t assoc_id;
+	uint16_t sinfo_flags;
+	int msg_flags;
+	boost::uint64_t timestamp_ns;
+};
+
+/// An SCTP user message to be sent.
+/**
+ * The buffer is not copied; it must remain valid until the send completes.
+ */
+struct sctp_outbound_message
+{
+	boost::asio::const_buffer buffer;
+	uint16_t stream;
+	uint32_t ppid;
+	uint16_t flags;
+	uint32_t time_to_live;
+};
+
+/// Typed, zero-copy view over a received message.
+/**
+ * Overlays a wire header on the start of a received message. The header must
+ * be a byte-aligned POD (e.g. a struct of unsigned char fields) so that it can
+ * be read in place from an unaligned receive buffer.
+ *
+ * @par Example
+ * @code
+ * struct my_header { unsigned char version, spare, msg_class, msg_type; };
+ * boost::asio_sctp::message_view<my_header> view(msg);
+ * if (view.valid() && view.header().version == 1)
+ *   process(view.body(), view.body_size());
+ * @endcode
+ */
+template <typename Header>
+class message_view
+{
+	BOOST_STATIC_ASSERT(boost::alignment_of<Header>::value == 1);
+
+public:
+	explicit message_view(const sctp_message& msg)
+		: message_(msg)
+	{
+	}
+
+	/// Whether the message is long enough to hold the header.
+	bool valid() const
+	{
+		return message_.size >= sizeof(Header);
+	}
+
+	/// The header, read in place from the receive buffer.
+	const Header& header() const
+	{
+		return *reinterpret_cast<const Header*>(message_.data);
+	}
+
+	/// Start of the payload following the header.
+	const unsigned char* body() const
+	{
+		return message_.data + sizeof(Header);
+	}
+
+	/// Number of payload bytes following the header.
+	std::size_t body_size() const
+	{
+		return message_.size - sizeof(Header);
+	}
+
+	/// The payload following the header as a buffer.
+	boost::asio::const_buffer body_buffer() const
+	{
+		return boost::asio::const_buffer(body(), body_size());
+	}
+
+	/// The underlying message.
+	const sctp_message& message() const
+	{
+		return message_;
+	}
+
+private:
+	sctp_message message_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_MESSAGE_HPP
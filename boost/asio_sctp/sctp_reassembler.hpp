@@ -0,0 +1,203 @@
+//
+// sctp_reassembler.hpp
+// ~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_REASSEMBLER_HPP
+#define BOOST_ASIO_SCTP_SCTP_REASSEMBLER_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Rebuilds whole messages from partial deliveries.
+/**
+ * A message larger than the receive buffer, or one delivered through the
+ * partial delivery API, arrives over several reads. With fragment interleaving
+ * (and I-DATA) those reads may alternate between streams and associations.
+ * Each read is passed to add() with the metadata returned alongside it; parts
+ * are collected per (association, stream) until the read carrying MSG_EOR.
+ *
+ * A message which arrives in one read is returned without copying. Reassembly
+ * buffers are pooled and reused. Once a message has grown past the size limit,
+ * the rest of its parts are dropped as they arrive, up to the one carrying
+ * MSG_EOR.
+ */
+class sctp_reassembler
+	: private boost::noncopyable
+{
+public:
+	/// Construct; messages larger than max_message_size (if non-zero) are discarded.
+	explicit sctp_reassembler(std::size_t max_message_size = 0)
+		: max_message_size_(max_message_size),
+			completed_(0),
+			discarded_(0)
+	{
+	}
+
+	~sctp_reassembler()
+	{
+		recycle();
+		for (partial_map::iterator it = partial_.begin(); it != partial_.end(); ++it)
+			delete it->second;
+		for (std::size_t i = 0; i < pool_.size(); ++i)
+			delete pool_[i];
+	}
+
+	/// Add the data from one read.
+	/**
+	 * @returns true if the read completed a message, which is then described by
+	 * @c msg. The message data remains valid until the next call to add(), or
+	 * until @c data is reused if the message arrived in a single read.
+	 */
+	bool add(const unsigned char* data, std::size_t size,
+		const sctp_receive_info& info, sctp_message& msg)
+	{
+		recycle();
+
+		key_type key(info.assoc_id, key_stream(info));
+		bool end_of_record = (info.msg_flags & MSG_EOR) != 0;
+
+		std::set<key_type>::iterator dropping = discarding_.find(key);
+		if (dropping != discarding_.end())
+		{
+			// The tail of a message already discarded.
+			if (end_of_record)
+				discarding_.erase(dropping);
+			return false;
+		}
+
+		partial_map::iterator it = partial_.find(key);
+		if (it == partial_.end())
+		{
+			if (end_of_record)
+			{
+				describe(msg, data, size, info);
+				return true;
+			}
+			it = partial_.insert(std::make_pair(key, allocate())).first;
+		}
+
+		std::vector<unsigned char>& buffer = *it->second;
+		if (max_message_size_ && buffer.size() + size > max_message_size_)
+		{
+			++discarded_;
+			buffer.clear();
+			pool_.push_back(it->second);
+			partial_.erase(it);
+			if (!end_of_record)
+				discarding_.insert(key);
+			return false;
+		}
+		buffer.insert(buffer.end(), data, data + size);
+
+		if (!end_of_record)
+			return false;
+
+		completed_ = it->second;
+		partial_.erase(it);
+		describe(msg, completed_->empty() ? 0 : &(*completed_)[0], completed_->size(), info);
+		return true;
+	}
+
+	/// Drop any partial messages for an association, e.g. after it aborts.
+	void discard(sctp_assoc_t assoc_id)
+	{
+		partial_map::iterator it = partial_.lower_bound(key_type(assoc_id, 0));
+		while (it != partial_.end() && it->first.first == assoc_id)
+		{
+			it->second->clear();
+			pool_.push_back(it->second);
+			partial_.erase(it++);
+		}
+		std::set<key_type>::iterator d = discarding_.lower_bound(key_type(assoc_id, 0));
+		while (d != discarding_.end() && d->first == assoc_id)
+			discarding_.erase(d++);
+	}
+
+	/// Number of messages currently being reassembled.
+	std::size_t partial_count() const
+	{
+		return partial_.size();
+	}
+
+	/// Number of messages dropped for exceeding the size limit.
+	std::size_t discarded() const
+	{
+		return discarded_;
+	}
+
+private:
+	typedef std::pair<sctp_assoc_t, uint32_t> key_type;
+	typedef std::map<key_type, std::vector<unsigned char>*> partial_map;
+
+	// Notifications are not sent on a stream, so they get a key of their own.
+	static uint32_t key_stream(const sctp_receive_info& info)
+	{
+		return (info.msg_flags & MSG_NOTIFICATION) ? 0x10000 : info.stream;
+	}
+
+	static void describe(sctp_message& msg, const unsigned char* data,
+		std::size_t size, const sctp_receive_info& info)
+	{
+		msg.data = data;
+		msg.size = size;
+		msg.stream = info.stream;
+		msg.ppid = info.ppid;
+		msg.assoc_id = info.assoc_id;
+		msg.flags = info.sinfo_flags;
+		msg.timestamp_ns = info.timestamp_ns;
+	}
+
+	std::vector<unsigned char>* allocate()
+	{
+		if (pool_.empty())
+			return new std::vector<unsigned char>;
+		std::vector<unsigned char>* buffer = pool_.back();
+		pool_.pop_back();
+		return buffer;
+	}
+
+	void recycle()
+	{
+		if (completed_)
+		{
+			completed_->clear();
+			pool_.push_back(completed_);
+			completed_ = 0;
+		}
+	}
+
+	std::size_t max_message_size_;
+	partial_map partial_;
+	std::set<key_type> discarding_;  // dropping the rest of an oversized message
+	std::vector<std::vector<unsigned char>*> pool_;
+	std::vector<unsigned char>* completed_;
+	std::size_t discarded_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_REASSEMBLER_HPP
@@ -0,0 +1,380 @@
+//
+// sctp_receive_batch.hpp
+// ~~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_RECEIVE_BATCH_HPP
+#define BOOST_ASIO_SCTP_SCTP_RECEIVE_BATCH_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstddef>
+#include <vector>
+#include <poll.h>
+#include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/asio_sctp/sctp_handler_allocator.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+#include <boost/asio_sctp/sctp_reassembler.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Receive buffers lent to sctp_receive_batch objects while they hold messages.
+/**
+ * A batch with a buffer of its own keeps it for its whole life, which for a
+ * server with one batch per association is one buffer per association. With
+ * a pool, a batch borrows a buffer once the socket is readable and gives it
+ * back at the start of the next fill, so the buffers in use are only those of
+ * the batches being handled at the time. Buffers are kept for reuse, never
+ * freed before the pool, so the pool settles at the most ever lent at once.
+ *
+ * @par Thread Safety
+ * Any number of batches, on any threads, may share one pool. It must outlive
+ * them.
+ */
+class sctp_receive_buffer_pool
+	: private boost::noncopyable
+{
+public:
+	explicit sctp_receive_buffer_pool(std::size_t buffer_size)
+		: buffer_size_(buffer_size ? buffer_size : 1),
+			allocated_(0)
+	{
+	}
+
+	~sctp_receive_buffer_pool()
+	{
+		for (std::size_t i = 0; i < idle_.size(); ++i)
+			delete idle_[i];
+	}
+
+	std::size_t buffer_size() const
+	{
+		return buffer_size_;
+	}
+
+	/// Buffers allocated so far, lent or idle.
+	std::size_t allocated() const
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return allocated_;
+	}
+
+	/// Borrow a buffer of buffer_size() bytes.
+	std::vector<unsigned char>* take()
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			if (!idle_.empty())
+			{
+				std::vector<unsigned char>* buffer = idle_.back();
+				idle_.pop_back();
+				return buffer;
+			}
+			++allocated_;
+		}
+		return new std::vector<unsigned char>(buffer_size_);
+	}
+
+	/// Return a buffer from take().
+	void give(std::vector<unsigned char>* buffer)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		idle_.push_back(buffer);
+	}
+
+private:
+	const std::size_t buffer_size_;
+	mutable boost::mutex mutex_;
+	std::vector<std::vector<unsigned char>*> idle_;
+	std::size_t allocated_;
+};
+
+/// Reads whatever messages are waiting on a socket, up to a limit, in one go.
+/**
+ * fill() reads messages one after the other into a buffer, owned by the batch
+ * or borrowed from a sctp_receive_buffer_pool while the batch holds messages,
+ * until max_messages have been read, max_bytes are used, or the socket has
+ * nothing more to give. The caller then handles the whole burst at once: the
+ * handler is called, locks are taken and the clock is read once per batch
+ * rather than once per message. async_fill() does the same when the socket
+ * becomes readable and passes the batch to a handler.
+ *
+ * Messages which arrive in one read are described in place. One which needed
+ * reassembly ends the batch, so it never has to be copied again. Messages,
+ * including notifications, are described by sctp_message, and the metadata of
+ * the read which completed each is kept as well; both remain valid until the
+ * next fill.
+ *
+ * An error, or the end of the association, which turns up after some messages
+ * have been read is held back and reported by the next fill, so that the
+ * messages read before it are handled first.
+ *
+ * @par Example
+ * @code
+ * boost::asio_sctp::sctp_receive_batch batch(64, 256 * 1024);
+ * while (socket.is_open())
+ * {
+ *   batch.fill(socket, ec);
+ *   for (std::size_t i = 0; i < batch.size() && !ec; ++i)
+ *     if (!(batch.info(i).msg_flags & MSG_NOTIFICATION))
+ *       process(batch[i]);
+ * }
+ * @endcode
+ */
+class sctp_receive_batch
+	: private boost::noncopyable
+{
+public:
+	/// Construct; messages larger than max_message_size (if non-zero) are discarded.
+	sctp_receive_batch(std::size_t max_messages, std::size_t max_bytes,
+		std::size_t max_message_size = 0)
+		: max_messages_(max_messages ? max_messages : 1),
+			own_(max_bytes ? max_bytes : 1),
+			pool_(0),
+			buffer_(&own_),
+			reassembler_(max_message_size)
+	{
+		messages_.reserve(max_messages_);
+		infos_.reserve(max_messages_);
+	}
+
+	/// Construct with buffers of pool.buffer_size() bytes borrowed from pool.
+	/**
+	 * A blocking fill() waits for the socket to become readable before
+	 * borrowing, so an idle association holds no buffer.
+	 */
+	sctp_receive_batch(std::size_t max_messages, sctp_receive_buffer_pool& pool,
+		std::size_t max_message_size = 0)
+		: max_messages_(max_messages ? max_messages : 1),
+			pool_(&pool),
+			buffer_(0),
+			reassembler_(max_message_size)
+	{
+		messages_.reserve(max_messages_);
+		infos_.reserve(max_messages_);
+	}
+
+	~sctp_receive_batch()
+	{
+		give_back();
+	}
+
+	/// Read the waiting messages; blocks for the first one if the socket does.
+	/**
+	 * A blocking read keeps waiting until a whole message has been read, so
+	 * a message arriving in parts never makes it return empty-handed.
+	 *
+	 * @returns The number of messages read. With none, ec says why: the error,
+	 * eof when the peer has shut down, or would_block if nothing was waiting on
+	 * a non-blocking socket.
+	 */
+	template <typename Socket>
+	std::size_t fill(Socket& socket, boost::system::error_code& ec)
+	{
+		return read(socket, 0, ec);
+	}
+
+	/// Wait for the socket to become readable, then fill the batch and call the handler.
+	/**
+	 * The handler is called as handler(ec, batch), where ec is set only if the
+	 * batch is empty.
+	 */
+	template <typename Socket, typename Handler>
+	void async_fill(Socket& socket, Handler handler)
+	{
+		socket.async_receive(boost::asio::null_buffers(), handler_memory_.wrap(
+			boost::bind(&sctp_receive_batch::on_readable<Socket, Handler>, this,
+				&socket, boost::asio::placeholders::error, handler)));
+	}
+
+	/// Number of messages in the batch.
+	std::size_t size() const
+	{
+		return messages_.size();
+	}
+
+	bool empty() const
+	{
+		return messages_.empty();
+	}
+
+	const sctp_message& operator[](std::size_t i) const
+	{
+		return messages_[i];
+	}
+
+	const sctp_message* begin() const
+	{
+		return messages_.empty() ? 0 : &messages_[0];
+	}
+
+	const sctp_message* end() const
+	{
+		return begin() + messages_.size();
+	}
+
+	/// What the read completing message i returned; MSG_NOTIFICATION marks notifications.
+	const sctp_receive_info& info(std::size_t i) const
+	{
+		return infos_[i];
+	}
+
+	/// The reassembler behind the batch, e.g. to discard an aborted association's parts.
+	sctp_reassembler& reassembler()
+	{
+		return reassembler_;
+	}
+
+private:
+	// Reads stop once less than this is left, since most messages would then
+	// be split across reads.
+	enum { min_read = 2048 };
+
+	template <typename Socket>
+	std::size_t read(Socket& socket, int first_flags, boost::system::error_code& ec)
+	{
+		messages_.clear();
+		infos_.clear();
+		give_back();
+		if (held_error_)
+		{
+			ec = held_error_;
+			held_error_ = boost::system::error_code();
+			return 0;
+		}
+
+		ec = boost::system::error_code();
+		if (pool_)
+		{
+			if (first_flags == 0 && !wait_readable(socket, ec))
+				return 0;
+			buffer_ = pool_->take();
+		}
+		std::vector<unsigned char>& buffer = *buffer_;
+		std::size_t used = 0;
+		int flags = first_flags;
+		while (messages_.size() < max_messages_
+			&& (used == 0 || buffer.size() - used >= std::size_t(min_read)))
+		{
+			sctp_receive_info info;
+			boost::system::error_code read_ec;
+			std::size_t n = socket.receive_message(
+				boost::asio::buffer(&buffer[used], buffer.size() - used), flags, info, read_ec);
+			if (!read_ec && (info.sinfo_flags & SCTP_EOF))
+				read_ec = boost::asio::error::eof;
+			else if (!read_ec && (info.sinfo_flags & SCTP_ABORT))
+				read_ec = boost::asio::error::connection_reset;
+			else if (!read_ec && n == 0)
+				read_ec = boost::asio::error::eof;  // orderly shutdown by the peer
+
+			if (read_ec)
+			{
+				bool drained = (read_ec == boost::asio::error::would_block
+					|| read_ec == boost::asio::error::try_again);
+				if (messages_.empty())
+					ec = read_ec;
+				else if (!drained)
+					held_error_ = read_ec;
+				break;
+			}
+
+			sctp_message msg;
+			if (!reassembler_.add(&buffer[used], n, info, msg))
+				continue;  // a part, copied by the reassembler
+			messages_.push_back(msg);
+			infos_.push_back(info);
+			flags = MSG_DONTWAIT;  // only what is already waiting after a whole message
+			if (msg.data != &buffer[used])
+				break;  // reassembled; valid only until the next add()
+			used += n;
+		}
+		if (messages_.empty())
+			give_back();
+		return messages_.size();
+	}
+
+	// Wait for a socket in blocking mode to become readable, as its reads
+	// would; one in non-blocking mode is left to report would_block.
+	template <typename Socket>
+	static bool wait_readable(Socket& socket, boost::system::error_code& ec)
+	{
+		if (socket.non_blocking())
+			return true;
+		pollfd pfd = { socket.native_handle(), POLLIN, 0 };
+		while (::poll(&pfd, 1, -1) < 0)
+		{
+			if (errno != EINTR)
+			{
+				ec = boost::system::error_code(errno, boost::asio::error::get_system_category());
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Return a borrowed buffer to the pool.
+	void give_back()
+	{
+		if (pool_ && buffer_)
+		{
+			pool_->give(buffer_);
+			buffer_ = 0;
+		}
+	}
+
+	template <typename Socket, typename Handler>
+	void on_readable(Socket* socket, const boost::system::error_code& ec, Handler handler)
+	{
+		if (ec)
+		{
+			messages_.clear();
+			infos_.clear();
+			handler(ec, static_cast<const sctp_receive_batch&>(*this));
+			return;
+		}
+
+		boost::system::error_code read_ec;
+		read(*socket, MSG_DONTWAIT, read_ec);
+		if (read_ec == boost::asio::error::would_block
+			|| read_ec == boost::asio::error::try_again)
+		{
+			async_fill(*socket, handler);  // only parts, or a spurious wakeup
+			return;
+		}
+		handler(read_ec, static_cast<const sctp_receive_batch&>(*this));
+	}
+
+	const std::size_t max_messages_;
+	std::vector<unsigned char> own_;  // empty with a pool
+	sctp_receive_buffer_pool* pool_;
+	std::vector<unsigned char>* buffer_;  // own_, borrowed from pool_, or none
+	std::vector<sctp_message> messages_;
+	std::vector<sctp_receive_info> infos_;
+	sctp_reassembler reassembler_;
+	sctp_handler_allocator handler_memory_;  // for the readable wait
+	boost::system::error_code held_error_;  // turned up after a batch was read
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_RECEIVE_BATCH_HPP
@@ -0,0 +1,258 @@
+//
+// sctp_receive_scheduler.hpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_RECEIVE_SCHEDULER_HPP
+#define BOOST_ASIO_SCTP_SCTP_RECEIVE_SCHEDULER_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+#include <boost/asio_sctp/detail/parked_message.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Shares receive processing fairly between the associations of a socket or io thread.
+/**
+ * Each association (or any other key, such as a connection on a shared
+ * io_service) may have up to quantum bytes and max_per_round messages handled
+ * per round. Messages within that allowance go straight to the handler as
+ * they are offered; only those beyond it are copied and parked, in a queue
+ * per key. dispatch() then hands the parked ones out by deficit round robin,
+ * unused byte credit carrying over while a key has messages waiting, and
+ * starts the next round. A peer which floods therefore gets its share and no
+ * more, while the messages of quiet peers are handled as soon as they are
+ * read.
+ *
+ * A key may park at most max_queued messages. Nothing is dropped beyond
+ * that: offer() hands out parked messages, fairly, until there is room, so
+ * the reader falls behind the socket and the peers' windows fill instead.
+ *
+ * @par Example
+ * @code
+ * void on_readable()
+ * {
+ *   // Read what the socket has, then hand out what was parked.
+ *   if (batch.fill(one_to_many, ec))
+ *     scheduler.offer(batch, handler);
+ *   scheduler.dispatch(handler, 256);
+ * }
+ * @endcode
+ *
+ * @par Thread Safety
+ * Must only be used from one thread at a time. The handler must not call
+ * offer() or dispatch().
+ */
+template <typename Key = sctp_assoc_t>
+class sctp_receive_scheduler
+	: private boost::noncopyable
+{
+public:
+	/// Construct with the per-round allowance of each association.
+	sctp_receive_scheduler(std::size_t quantum = 16384, std::size_t max_per_round = 16,
+		std::size_t max_queued = 256)
+		: quantum_(quantum ? quantum : 1),
+			max_per_round_(max_per_round ? max_per_round : 1),
+			max_queued_(max_queued ? max_queued : 1),
+			queued_(0)
+	{
+	}
+
+	~sctp_receive_scheduler()
+	{
+		for (typename flow_map::iterator i = flows_.begin(); i != flows_.end(); ++i)
+			for (std::size_t j = 0; j < i->second.messages.size(); ++j)
+				pool_.release(i->second.messages[j]);
+	}
+
+	/// Handle a message received for key now if its allowance for the round permits, or park a copy.
+	/**
+	 * @param handler Called as
+	 * @code void handler(const Key& key, const sctp_message& msg); @endcode
+	 * for this message, or for parked ones when key's queue is full.
+	 *
+	 * @returns true if the message was handled, false if it was parked.
+	 */
+	template <typename Handler>
+	bool offer(const Key& key, const sctp_message& msg, Handler handler)
+	{
+		flow& f = flows_[key];
+		if (f.messages.empty() && f.round_messages < max_per_round_
+			&& (f.round_bytes == 0 || f.round_bytes + msg.size <= quantum_))
+		{
+			++f.round_messages;
+			f.round_bytes += msg.size;
+			handler(key, msg);
+			return true;
+		}
+
+		while (f.messages.size() >= max_queued_)
+			serve(handler, 1);
+		park(key, f, msg);
+		return false;
+	}
+
+	/// Offer a message, keyed by its association.
+	template <typename Handler>
+	bool offer(const sctp_message& msg, Handler handler)
+	{
+		return offer(Key(msg.assoc_id), msg, handler);
+	}
+
+	/// Offer every message of a batch, keyed by association.
+	/**
+	 * @returns The number of messages handled straight away.
+	 */
+	template <typename Batch, typename Handler>
+	std::size_t offer(const Batch& batch, Handler handler)
+	{
+		std::size_t handled = 0;
+		for (std::size_t i = 0; i < batch.size(); ++i)
+			if (offer(Key(batch[i].assoc_id), batch[i], handler))
+				++handled;
+		return handled;
+	}
+
+	/// Hand out up to max_messages parked messages, fairly between keys, and start a new round.
+	/**
+	 * @param handler Called for each message as
+	 * @code void handler(const Key& key, const sctp_message& msg); @endcode
+	 * The message data is only valid for the duration of the call.
+	 *
+	 * @returns The number of messages handed out.
+	 */
+	template <typename Handler>
+	std::size_t dispatch(Handler handler, std::size_t max_messages)
+	{
+		std::size_t delivered = serve(handler, max_messages);
+		for (typename flow_map::iterator i = flows_.begin(); i != flows_.end(); )
+		{
+			if (i->second.messages.empty())
+			{
+				flows_.erase(i++);  // credit is not kept while idle
+				continue;
+			}
+			i->second.round_messages = 0;
+			i->second.round_bytes = 0;
+			++i;
+		}
+		return delivered;
+	}
+
+	/// Whether any messages are parked.
+	bool empty() const
+	{
+		return queued_ == 0;
+	}
+
+	/// Number of messages parked.
+	std::size_t queued() const
+	{
+		return queued_;
+	}
+
+	/// Number of messages parked for one key.
+	std::size_t queued(const Key& key) const
+	{
+		typename flow_map::const_iterator i = flows_.find(key);
+		return i == flows_.end() ? 0 : i->second.messages.size();
+	}
+
+private:
+	struct flow
+	{
+		flow()
+			: deficit(0), active(false), round_messages(0), round_bytes(0)
+		{
+		}
+
+		std::deque<detail::parked_message> messages;
+		std::size_t deficit;
+		bool active;  // in round_
+		std::size_t round_messages;  // handled straight away this round
+		std::size_t round_bytes;
+	};
+
+	typedef std::map<Key, flow> flow_map;
+
+	void park(const Key& key, flow& f, const sctp_message& msg)
+	{
+		f.messages.push_back(pool_.park(msg));
+		++queued_;
+		if (!f.active)
+		{
+			f.active = true;
+			round_.push_back(key);
+		}
+	}
+
+	// Deficit round robin over the keys with parked messages. Flows are left
+	// in place, idle ones being erased when the round ends.
+	template <typename Handler>
+	std::size_t serve(Handler& handler, std::size_t max_messages)
+	{
+		std::size_t delivered = 0;
+		while (delivered < max_messages && !round_.empty())
+		{
+			Key key = round_.front();
+			round_.pop_front();
+			flow& f = flows_.find(key)->second;
+
+			f.deficit += quantum_;
+			for (std::size_t n = 0; n < max_per_round_ && delivered < max_messages
+				&& !f.messages.empty() && f.messages.front().data->size() <= f.deficit; ++n)
+			{
+				detail::parked_message p = f.messages.front();
+				f.messages.pop_front();
+				--queued_;
+				f.deficit -= p.data->size();
+				++delivered;
+
+				handler(key, p.view());
+				pool_.release(p);
+			}
+
+			if (f.messages.empty())
+			{
+				f.active = false;
+				f.deficit = 0;
+			}
+			else
+				round_.push_back(key);
+		}
+		return delivered;
+	}
+
+	std::size_t quantum_;
+	std::size_t max_per_round_;
+	std::size_t max_queued_;
+	flow_map flows_;
+	std::deque<Key> round_;  // keys with parked messages, in service order
+	detail::parked_message_pool pool_;
+	std::size_t queued_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_RECEIVE_SCHEDULER_HPP
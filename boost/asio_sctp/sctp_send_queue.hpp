@@ -0,0 +1,797 @@
+//
+// sctp_send_queue.hpp
+// ~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_SEND_QUEUE_HPP
+#define BOOST_ASIO_SCTP_SCTP_SEND_QUEUE_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/asio_sctp/ip/sctp.hpp>
+#include <boost/asio_sctp/sctp_clock.hpp>
+#include <boost/asio_sctp/sctp_handler_allocator.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+#include <boost/asio_sctp/sctp_send_ring.hpp>
+#include <boost/asio_sctp/detail/atomic.hpp>
+#include <boost/asio_sctp/detail/mpsc_queue.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Collects messages and sends them as one corked burst.
+/**
+ * push() copies the message into a lock-free submission list, so producers
+ * on any number of threads never wait for each other or for the io_service.
+ * The first push after a flush posts the next one; later pushes only add to
+ * the list. The flush runs once the current batch of ready handlers has
+ * finished, takes everything submitted in the meantime, and sends it with
+ * sctp_stream_socket::send_batch, a handful of syscalls for any number of
+ * producers. Each stream's messages keep the order in which their push()
+ * calls took effect. A message pushed on its own still goes
+ * out on the next turn of the io_service, so no-delay latency is kept for
+ * isolated messages. Messages encoded in place in an sctp_send_ring are
+ * committed instead of pushed, and are sent from where they were encoded.
+ *
+ * Sends never block the io_service: when the kernel's send buffer is full the
+ * queue waits for the socket to become writable. Queued bytes are tracked per
+ * association and per stream. Once they reach the high watermark new messages
+ * are rejected (or accepted but flagged, with the defer policy) and the high
+ * watermark handler is called; when the queue drains to the low watermark the
+ * low watermark handler is called so that producers can resume. Each stream
+ * may also be given watermarks of its own, so that one stream backing up
+ * holds up only its own producers; its handlers are passed the stream.
+ *
+ * Each message may carry an absolute deadline, after which it is worthless.
+ * Streams are sent in order of priority, 0 first. Among streams of the same
+ * priority, the stream whose next message has the earliest deadline goes
+ * next; a message without a deadline comes after any with one, and a tie
+ * goes to the message pushed first. Deadlines never reorder messages within
+ * a stream. A message whose deadline has passed is never handed to the
+ * kernel, and is dropped once it reaches the head of its stream; those which
+ * do go out are given the time they have left as their PR-SCTP lifetime.
+ * With a slow peer, bandwidth is spent only on messages which can still
+ * arrive in time.
+ *
+ * @par Thread Safety
+ * push(), commit() and the accessors may be called from any thread; push()
+ * and commit() take no lock unless per-stream watermarks are set. The
+ * watermarks and default lifetime are read by push() unlocked, so they should
+ * be set before messages are pushed. Handlers set on the queue are
+ * called from the io_service, except the high watermark handlers, which are
+ * called from the thread whose push() crossed the watermark.
+ */
+template <typename Socket>
+class sctp_send_queue
+	: private boost::noncopyable
+{
+public:
+	typedef boost::function<void (const boost::system::error_code&)> error_handler;
+	typedef boost::function<void ()> watermark_handler;
+	typedef boost::function<void (uint16_t stream)> stream_watermark_handler;
+
+	/// What push() does with a message while the queue is above its high watermark.
+	enum overflow_policy
+	{
+		reject,  // refuse the message; push() returns false
+		defer    // queue it anyway; producers are expected to honour the handler
+	};
+
+	explicit sctp_send_queue(Socket& socket)
+		: socket_(socket),
+			sequence_(0),
+			flush_pending_(false),
+			waiting_(false),
+			time_to_live_(0),
+			queued_bytes_(0),
+			high_watermark_(0),
+			low_watermark_(0),
+			policy_(reject),
+			above_high_(false),
+			rejected_(0),
+			stream_high_watermark_(0),
+			stream_low_watermark_(0),
+			default_lifetime_(0),
+			expired_(0),
+			expired_bytes_(0)
+	{
+	}
+
+	~sctp_send_queue()
+	{
+		while (detail::mpsc_node* n = submissions_.pop())
+			static_cast<detail::send_record*>(n)->release();
+		for (typename fifo_map::iterator f = fifos_.begin(); f != fifos_.end(); ++f)
+		{
+			for (std::size_t i = 0; i < f->second.size(); ++i)
+				f->second[i].record->release();
+		}
+	}
+
+	/// Milliseconds on sctp_clock, against which deadlines are measured.
+	static boost::uint64_t now_ms()
+	{
+		return sctp_clock::now_ms();
+	}
+
+	/// Set the PR-SCTP lifetime applied to queued messages.
+	void set_time_to_live(uint32_t ms)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		time_to_live_ = ms;
+	}
+
+	/// Give messages pushed without a deadline one this long after push(); 0 means none.
+	void set_default_lifetime(uint32_t ms)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		default_lifetime_ = ms;
+	}
+
+	/// Set a stream's priority; 0, the default, is sent first.
+	/**
+	 * The stream is identified as it is passed to push().
+	 */
+	void set_stream_priority(uint16_t stream, uint8_t priority)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (stream >= stream_priorities_.size())
+			stream_priorities_.resize(stream + 1, 0);
+		stream_priorities_[stream] = priority;
+	}
+
+	/// Set the handler called, from the io_service, when a flush fails.
+	void set_error_handler(const error_handler& handler)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		error_handler_ = handler;
+	}
+
+	/// Limit the bytes queued for the association; a high watermark of 0 means unlimited.
+	void set_watermarks(std::size_t high, std::size_t low, overflow_policy policy = reject)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		high_watermark_ = high;
+		low_watermark_ = low < high ? low : high;
+		policy_ = policy;
+	}
+
+	/// Set the handler called when the queue reaches its high watermark.
+	void set_high_watermark_handler(const watermark_handler& handler)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		high_handler_ = handler;
+	}
+
+	/// Set the handler called when the queue drains back to its low watermark.
+	void set_low_watermark_handler(const watermark_handler& handler)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		low_handler_ = handler;
+	}
+
+	/// Limit the bytes queued for each stream; a high watermark of 0 means unlimited.
+	/**
+	 * A message over its stream's high watermark is treated as one over the
+	 * association's, according to the policy given to set_watermarks(). Streams
+	 * are identified as they are passed to push().
+	 */
+	void set_stream_watermarks(std::size_t high, std::size_t low)
+	{
+		boost::mutex::scoped_lock lock(stream_mutex_);
+		stream_high_watermark_ = high;
+		stream_low_watermark_ = low < high ? low : high;
+	}
+
+	/// Set the handler called when a stream reaches its high watermark.
+	void set_stream_high_watermark_handler(const stream_watermark_handler& handler)
+	{
+		boost::mutex::scoped_lock lock(stream_mutex_);
+		stream_high_handler_ = handler;
+	}
+
+	/// Set the handler called when a stream drains back to its low watermark.
+	void set_stream_low_watermark_handler(const stream_watermark_handler& handler)
+	{
+		boost::mutex::scoped_lock lock(stream_mutex_);
+		stream_low_handler_ = handler;
+	}
+
+	/// Bytes queued in user space for the association.
+	std::size_t queued_bytes() const
+	{
+		return detail::atomic::load_acquire(queued_bytes_);
+	}
+
+	/// Bytes queued in user space for one stream.
+	/**
+	 * A message is counted against its stream once a flush has taken it from
+	 * the submission list.
+	 */
+	std::size_t queued_bytes(uint16_t stream) const
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return stream < stream_bytes_.size() ? stream_bytes_[stream] : 0;
+	}
+
+	/// Whether the queue is accepting messages, i.e. has not hit its high watermark.
+	bool writable() const
+	{
+		return !detail::atomic::load_acquire(above_high_);
+	}
+
+	/// Whether the queue is accepting messages for a stream.
+	bool writable(uint16_t stream) const
+	{
+		if (!writable())
+			return false;
+		boost::mutex::scoped_lock lock(stream_mutex_);
+		typename stream_map::const_iterator i = streams_.find(stream);
+		return i == streams_.end() || !i->second.above_high;
+	}
+
+	/// Number of messages refused by push().
+	std::size_t rejected() const
+	{
+		return detail::atomic::load_acquire(rejected_);
+	}
+
+	/// Number of messages dropped because their deadline passed while queued.
+	std::size_t expired() const
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return expired_;
+	}
+
+	/// Bytes dropped because their deadline passed while queued.
+	std::size_t expired_bytes() const
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return expired_bytes_;
+	}
+
+	/// DATA chunks queued or in flight in the kernel, from SCTP_STATUS.
+	std::size_t kernel_queued_chunks(boost::system::error_code& ec) const
+	{
+		socket_option::sctp_status status;
+		socket_.get_option(status, ec);
+		return ec ? 0 : status.pending_chunks() + status.unacked_chunks();
+	}
+
+	/// Queue a copy of a message for sending, with the default lifetime.
+	/**
+	 * @returns false if the message was rejected because the queue is at its
+	 * high watermark.
+	 */
+	bool push(const void* data, std::size_t size, uint16_t stream,
+		uint32_t ppid, uint16_t flags = 0)
+	{
+		return push_until(no_deadline, data, size, stream, ppid, flags);
+	}
+
+	/// Queue a copy of a message which is to be dropped if not sent by deadline_ms.
+	/**
+	 * @param deadline_ms Time on the now_ms() clock, or no_deadline for the
+	 * default lifetime.
+	 *
+	 * @returns false if the message was rejected because the queue is at its
+	 * high watermark.
+	 */
+	bool push_until(boost::uint64_t deadline_ms, const void* data, std::size_t size,
+		uint16_t stream, uint32_t ppid, uint16_t flags = 0)
+	{
+		if (!admit(size, stream))
+			return false;
+		detail::send_record* r = detail::send_record::allocate(size);
+		if (size)
+			std::memcpy(r->bytes(), data, size);
+		submit(r, deadline_ms, stream, ppid, flags);
+		return true;
+	}
+
+	/// Queue a message encoded in an sctp_send_ring, with the default lifetime.
+	/**
+	 * The region is taken over by the queue, and is empty on return.
+	 *
+	 * @returns false if the message was rejected because the queue is at its
+	 * high watermark; the region is then left with the caller, to be held and
+	 * committed again later, or given back by resetting or destroying it.
+	 */
+	bool commit(sctp_send_ring::region& message, uint16_t stream,
+		uint32_t ppid, uint16_t flags = 0)
+	{
+		return commit_until(no_deadline, message, stream, ppid, flags);
+	}
+
+	/// Queue a message encoded in an sctp_send_ring which is to be dropped if not sent by deadline_ms.
+	/**
+	 * @param deadline_ms Time on the now_ms() clock, or no_deadline for the
+	 * default lifetime.
+	 *
+	 * @returns false if the message was rejected because the queue is at its
+	 * high watermark; the region is then left with the caller.
+	 */
+	bool commit_until(boost::uint64_t deadline_ms, sctp_send_ring::region& message,
+		uint16_t stream, uint32_t ppid, uint16_t flags = 0)
+	{
+		if (!message.data())
+			return false;
+		if (!admit(message.size(), stream))
+			return false;
+		submit(message.take(), deadline_ms, stream, ppid, flags);
+		return true;
+	}
+
+	/// Send as much of the queue as the kernel will take without blocking.
+	void flush()
+	{
+		boost::mutex::scoped_lock flush_lock(flush_mutex_);
+		for (;;)
+		{
+			error_handler on_error;
+			uint32_t time_to_live;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				if (waiting_)
+					return;  // on_writable() will flush; meanwhile pushes need not post
+				detail::atomic::store_release(flush_pending_, false);
+				collect();
+				on_error = error_handler_;
+				time_to_live = time_to_live_;
+			}
+
+			boost::uint64_t now = now_ms();
+			watermark_handler resume = drop_expired(now);
+			if (resume)
+				resume();
+			resume_streams();
+
+			schedule(time_to_live, now);
+			if (messages_.empty())
+				return;
+
+			boost::system::error_code ec;
+			std::size_t sent = socket_.send_batch(messages_.begin(), messages_.end(),
+				MSG_DONTWAIT, ec);
+
+			bool blocked = (ec == boost::asio::error::would_block
+				|| ec == boost::asio::error::try_again);
+			std::size_t done = (ec && !blocked) ? messages_.size() : sent;
+			if (blocked)
+			{
+				{
+					boost::mutex::scoped_lock lock(mutex_);
+					waiting_ = true;
+				}
+				socket_.async_send(boost::asio::null_buffers(),
+					handler_memory_.wrap(boost::bind(&sctp_send_queue::on_writable, this,
+						boost::asio::placeholders::error)));
+			}
+
+			resume = release(done, now);
+			if (resume)
+				resume();
+			resume_streams();
+			if (ec && !blocked && on_error)
+				on_error(ec);  // the rest of the batch has been discarded
+			if (blocked)
+				return;
+		}
+	}
+
+	/// Deadline value meaning the message has none of its own.
+	static const boost::uint64_t no_deadline = 0;
+
+private:
+	// Count size bytes against the watermarks. Returns false if the message
+	// is to be refused.
+	bool admit(std::size_t size, uint16_t stream)
+	{
+		bool accepted = true;
+		bool crossed = false;
+		std::size_t queued = detail::atomic::fetch_add(queued_bytes_, size);
+		if (high_watermark_ && queued && queued + size > high_watermark_)
+		{
+			crossed = detail::atomic::compare_exchange(above_high_, false, true);
+			if (policy_ == reject)
+			{
+				detail::atomic::fetch_sub(queued_bytes_, size);
+				detail::atomic::fetch_add(rejected_, std::size_t(1));
+				accepted = false;
+			}
+		}
+
+		if (crossed)
+		{
+			watermark_handler notify;
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+				notify = high_handler_;
+			}
+			if (notify)
+				notify();
+		}
+		if (accepted && !admit_stream(size, stream))
+		{
+			detail::atomic::fetch_sub(queued_bytes_, size);
+			detail::atomic::fetch_add(rejected_, std::size_t(1));
+			accepted = false;
+		}
+		return accepted;
+	}
+
+	// Count size bytes against the stream's watermarks. Returns false if the
+	// message is to be refused.
+	bool admit_stream(std::size_t size, uint16_t stream)
+	{
+		stream_watermark_handler notify;
+		bool accepted = true;
+		{
+			boost::mutex::scoped_lock lock(stream_mutex_);
+			if (!stream_high_watermark_)
+				return true;
+			stream_state& st = streams_[stream];
+			if (st.queued && st.queued + size > stream_high_watermark_)
+			{
+				if (!st.above_high)
+				{
+					st.above_high = true;
+					notify = stream_high_handler_;
+				}
+				accepted = (policy_ != reject);
+			}
+			if (accepted)
+				st.queued += size;
+		}
+		if (notify)
+			notify(stream);
+		return accepted;
+	}
+
+	// Hand an admitted message to the flush.
+	void submit(detail::send_record* r, boost::uint64_t deadline_ms,
+		uint16_t stream, uint32_t ppid, uint16_t flags)
+	{
+		if (deadline_ms == no_deadline && default_lifetime_)
+			deadline_ms = now_ms() + default_lifetime_;
+		r->deadline = deadline_ms;
+		r->ppid = ppid;
+		r->stream = stream;
+		r->flags = flags;
+		submissions_.push(r);
+
+		// Only after the push, so that the flush is sure to find the message.
+		if (!detail::atomic::exchange(flush_pending_, true))
+		{
+			socket_.get_io_service().post(handler_memory_.wrap(
+				boost::bind(&sctp_send_queue::flush, this)));
+		}
+	}
+
+	struct entry
+	{
+		detail::send_record* record;  // holds the bytes until forget()
+		std::size_t size;
+		uint16_t stream;
+		uint32_t ppid;
+		uint16_t flags;
+		boost::uint64_t deadline;  // now_ms() time, or no_deadline
+		boost::uint64_t sequence;  // order of collection, for ties
+	};
+
+	// One FIFO per stream and priority, keyed so that iterating the map
+	// visits the priorities in send order.
+	typedef std::deque<entry> fifo;
+	typedef std::map<uint32_t, fifo> fifo_map;
+
+	static uint32_t fifo_key(uint8_t priority, uint16_t stream)
+	{
+		return (uint32_t(priority) << 16) | stream;
+	}
+
+	static bool expired(const entry& e, boost::uint64_t now)
+	{
+		return e.deadline != no_deadline && e.deadline <= now;
+	}
+
+	// The next message of one stream while a flush is being scheduled.
+	struct head
+	{
+		boost::uint64_t deadline;  // no_deadline is taken as the latest
+		boost::uint64_t sequence;
+		typename fifo_map::iterator queue;
+		std::size_t next;  // index into queue->second
+	};
+
+	// Heap order: the head to send next is the one which compares greatest.
+	struct later
+	{
+		bool operator()(const head& a, const head& b) const
+		{
+			if (a.deadline != b.deadline)
+				return a.deadline > b.deadline;
+			return a.sequence > b.sequence;
+		}
+	};
+
+	// Move the messages submitted since the last flush onto their streams'
+	// FIFOs. Called with mutex_ held, and flush_mutex_, which makes this the
+	// only consumer and flush() the only thread to touch the FIFOs.
+	void collect()
+	{
+		while (detail::mpsc_node* n = submissions_.pop())
+		{
+			detail::send_record* r = static_cast<detail::send_record*>(n);
+			uint8_t priority = r->stream < stream_priorities_.size()
+				? stream_priorities_[r->stream] : 0;
+			entry e = { r, r->size, r->stream, r->ppid, r->flags, r->deadline, sequence_++ };
+			fifos_[fifo_key(priority, r->stream)].push_back(e);
+			if (r->stream >= stream_bytes_.size())
+				stream_bytes_.resize(r->stream + 1, 0);
+			stream_bytes_[r->stream] += r->size;
+		}
+	}
+
+	// Fill messages_ with every queued message in send order, recording in
+	// sources_ the FIFO each came from. Each priority's streams are merged
+	// through a heap of their heads, so only the heads are compared. Expired
+	// messages behind a head are skipped; release() drops them once they
+	// reach the head.
+	void schedule(uint32_t time_to_live, boost::uint64_t now)
+	{
+		messages_.clear();
+		sources_.clear();
+		typename fifo_map::iterator f = fifos_.begin();
+		while (f != fifos_.end())
+		{
+			uint32_t priority = f->first >> 16;
+			heads_.clear();
+			for (; f != fifos_.end() && (f->first >> 16) == priority; ++f)
+			{
+				head h = { 0, 0, f, 0 };
+				if (advance(h, now))
+					heads_.push_back(h);
+			}
+			std::make_heap(heads_.begin(), heads_.end(), later());
+
+			while (!heads_.empty())
+			{
+				std::pop_heap(heads_.begin(), heads_.end(), later());
+				head& h = heads_.back();
+				const entry& e = h.queue->second[h.next];
+				sctp_outbound_message m;
+				m.buffer = boost::asio::const_buffer(e.record->bytes(), e.size);
+				m.stream = e.stream;
+				m.ppid = e.ppid;
+				m.flags = e.flags;
+				m.time_to_live = remaining_lifetime(e, time_to_live, now);
+				messages_.push_back(m);
+				sources_.push_back(h.queue);
+
+				++h.next;
+				if (advance(h, now))
+					std::push_heap(heads_.begin(), heads_.end(), later());
+				else
+					heads_.pop_back();
+			}
+		}
+	}
+
+	// Move h to its stream's next unexpired message. Returns false if there
+	// is none.
+	static bool advance(head& h, boost::uint64_t now)
+	{
+		const fifo& q = h.queue->second;
+		while (h.next < q.size() && expired(q[h.next], now))
+			++h.next;
+		if (h.next == q.size())
+			return false;
+		const entry& e = q[h.next];
+		h.deadline = e.deadline == no_deadline ? ~boost::uint64_t(0) : e.deadline;
+		h.sequence = e.sequence;
+		return true;
+	}
+
+	// Drop the expired messages at the head of each stream. Returns the low
+	// watermark handler if it is now due.
+	watermark_handler drop_expired(boost::uint64_t now)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		typename fifo_map::iterator f = fifos_.begin();
+		while (f != fifos_.end())
+		{
+			drop_expired(f->second, now);
+			if (f->second.empty())
+				fifos_.erase(f++);
+			else
+				++f;
+		}
+		return low_watermark_due();
+	}
+
+	// Called with mutex_ held.
+	void drop_expired(fifo& q, boost::uint64_t now)
+	{
+		while (!q.empty() && expired(q.front(), now))
+		{
+			++expired_;
+			expired_bytes_ += q.front().size;
+			forget(q.front());
+			q.pop_front();
+		}
+	}
+
+	// Account for the first count messages of the last schedule() having
+	// left the queue, along with the expired ones it skipped before them.
+	// Returns the low watermark handler if it is now due.
+	watermark_handler release(std::size_t count, boost::uint64_t now)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			typename fifo_map::iterator f = sources_[i];
+			drop_expired(f->second, now);
+			forget(f->second.front());
+			f->second.pop_front();
+			if (f->second.empty())
+				fifos_.erase(f);  // no later message of the schedule is on it
+		}
+		return low_watermark_due();
+	}
+
+	// Called with mutex_ held.
+	void forget(const entry& e)
+	{
+		e.record->release();
+		detail::atomic::fetch_sub(queued_bytes_, e.size);
+		stream_bytes_[e.stream] -= e.size;
+
+		boost::mutex::scoped_lock lock(stream_mutex_);
+		typename stream_map::iterator i = streams_.find(e.stream);
+		if (i == streams_.end())
+			return;  // queued before the streams had watermarks
+		stream_state& st = i->second;
+		st.queued -= e.size < st.queued ? e.size : st.queued;
+		if (st.above_high && st.queued <= stream_low_watermark_)
+		{
+			st.above_high = false;
+			resumed_streams_.push_back(e.stream);
+		}
+		if (st.queued == 0 && !st.above_high)
+			streams_.erase(i);  // only streams with something queued are kept
+	}
+
+	// Call the stream low watermark handler for the streams forget() has
+	// found drained. Called from flush(), without mutex_.
+	void resume_streams()
+	{
+		stream_watermark_handler notify;
+		{
+			boost::mutex::scoped_lock lock(stream_mutex_);
+			if (resumed_streams_.empty())
+				return;
+			notify = stream_low_handler_;
+			resuming_.swap(resumed_streams_);
+			resumed_streams_.clear();
+		}
+		for (std::size_t i = 0; notify && i < resuming_.size(); ++i)
+			notify(resuming_[i]);
+		resuming_.clear();
+	}
+
+	// Called with mutex_ held.
+	watermark_handler low_watermark_due()
+	{
+		if (detail::atomic::load_acquire(above_high_)
+			&& detail::atomic::load_acquire(queued_bytes_) <= low_watermark_
+			&& detail::atomic::compare_exchange(above_high_, true, false))
+		{
+			return low_handler_;
+		}
+		return watermark_handler();
+	}
+
+	// The PR-SCTP lifetime for a message: what is left before its deadline,
+	// if sooner than the queue's time to live.
+	static uint32_t remaining_lifetime(const entry& e, uint32_t time_to_live, boost::uint64_t now)
+	{
+		if (e.deadline == no_deadline)
+			return time_to_live;
+		boost::uint64_t left = e.deadline - now;  // not yet expired, so at least 1
+		if (time_to_live && time_to_live < left)
+			return time_to_live;
+		return left < 0xffffffffu ? static_cast<uint32_t>(left) : 0xffffffffu;
+	}
+
+	void on_writable(const boost::system::error_code& ec)
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			waiting_ = false;
+		}
+		if (ec != boost::asio::error::operation_aborted)
+			flush();
+	}
+
+	Socket& socket_;
+	sctp_handler_allocator handler_memory_;  // for the flush post and the writable wait
+	mutable boost::mutex mutex_;
+	boost::mutex flush_mutex_;
+	detail::mpsc_queue submissions_;  // pushed, not yet collected
+	fifo_map fifos_;  // collected, not yet sent; only flush() touches these
+	boost::uint64_t sequence_;
+	std::vector<head> heads_;  // reused by schedule()
+	std::vector<sctp_outbound_message> messages_;
+	std::vector<typename fifo_map::iterator> sources_;  // the FIFO of each of messages_
+	volatile bool flush_pending_;
+	bool waiting_;
+	uint32_t time_to_live_;
+	error_handler error_handler_;
+
+	volatile std::size_t queued_bytes_;
+	std::vector<std::size_t> stream_bytes_;
+	std::size_t high_watermark_;
+	std::size_t low_watermark_;
+	overflow_policy policy_;
+	volatile bool above_high_;
+	volatile std::size_t rejected_;
+	watermark_handler high_handler_;
+	watermark_handler low_handler_;
+
+	struct stream_state
+	{
+		stream_state()
+			: queued(0),
+				above_high(false)
+		{
+		}
+
+		std::size_t queued;  // from admit() to forget()
+		bool above_high;
+	};
+
+	mutable boost::mutex stream_mutex_;  // guards the per-stream watermark state below
+	typedef std::map<uint16_t, stream_state> stream_map;
+	stream_map streams_;
+	std::size_t stream_high_watermark_;
+	std::size_t stream_low_watermark_;
+	stream_watermark_handler stream_high_handler_;
+	stream_watermark_handler stream_low_handler_;
+	std::vector<uint16_t> resumed_streams_;  // drained to the low watermark, not yet notified
+	std::vector<uint16_t> resuming_;  // being notified by flush(), which alone uses it
+
+	std::vector<uint8_t> stream_priorities_;
+	uint32_t default_lifetime_;
+	std::size_t expired_;
+	std::size_t expired_bytes_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_SEND_QUEUE_HPP
@@ -0,0 +1,309 @@
+//
+// sctp_send_ring.hpp
+// ~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_SEND_RING_HPP
+#define BOOST_ASIO_SCTP_SCTP_SEND_RING_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <new>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <boost/asio_sctp/detail/atomic.hpp>
+#include <boost/asio_sctp/detail/mpsc_queue.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+class sctp_send_ring;
+
+namespace detail {
+
+// A message on its way from a producer to a send queue's flush: this header,
+// then the message bytes. It lives in a send ring, or on the heap when the
+// message was pushed as a copy or the ring had no room.
+struct send_record : mpsc_node
+{
+	std::size_t size;
+	boost::uint64_t deadline;
+	boost::uint32_t ppid;
+	boost::uint16_t stream;
+	boost::uint16_t flags;
+	sctp_send_ring* ring;  // null on the heap
+	std::size_t span;  // ring bytes taken, this header and padding included
+	volatile bool released;
+
+	unsigned char* bytes()
+	{
+		return reinterpret_cast<unsigned char*>(this + 1);
+	}
+
+	static send_record* allocate(std::size_t size)
+	{
+		send_record* r = new (::operator new(sizeof(send_record) + size)) send_record;
+		r->size = size;
+		r->ring = 0;
+		return r;
+	}
+
+	// Give the space back; the record must not be touched afterwards.
+	inline void release();
+};
+
+} // namespace detail
+
+/// Space in which messages are encoded where they will be sent from.
+/**
+ * A producer reserves a region, encodes the message header and body into it,
+ * and commits it to an association's sctp_send_queue. The flush hands the
+ * region to the kernel as it is and then gives it back to the ring, so a
+ * message costs neither an allocation nor a copy in user space. Regions are
+ * given back in whatever order their messages leave, and the ring reuses the
+ * space as the oldest ones are. A reservation the ring has no room for is
+ * taken from the heap instead, so reserve() always succeeds.
+ *
+ * A ring may feed any number of send queues, but only one thread may reserve
+ * from it, which is why it is usually kept per thread. It is created on the
+ * heap and retired by its owner rather than deleted, since messages may still
+ * be waiting to be sent; it is freed once the last of them has gone.
+ *
+ * @par Example
+ * @code
+ * boost::thread_specific_ptr<sctp_send_ring> ring(&sctp_send_ring::retire);
+ * if (!ring.get())
+ *   ring.reset(sctp_send_ring::create(256 * 1024));
+ *
+ * sctp_send_ring::region message;
+ * ring->reserve(max_size, message);
+ * message.truncate(encode(message.data(), message.size()));
+ * queue.commit(message, stream, ppid);
+ * @endcode
+ */
+class sctp_send_ring
+	: private boost::noncopyable
+{
+public:
+	/// A reserved message, given back to its ring unless committed.
+	class region
+		: private boost::noncopyable
+	{
+	public:
+		region()
+			: record_(0)
+		{
+		}
+
+		~region()
+		{
+			reset();
+		}
+
+		/// Where the message is to be encoded; null if nothing is reserved.
+		unsigned char* data()
+		{
+			return record_ ? record_->bytes() : 0;
+		}
+
+		/// The size of the message.
+		std::size_t size() const
+		{
+			return record_ ? record_->size : 0;
+		}
+
+		/// Send only the first size bytes; the region cannot grow.
+		void truncate(std::size_t size)
+		{
+			if (record_ && size < record_->size)
+				record_->size = size;
+		}
+
+		/// Give back the reservation, if any.
+		void reset()
+		{
+			if (record_)
+			{
+				record_->release();
+				record_ = 0;
+			}
+		}
+
+		/// Hand over the reservation, which the caller must release.
+		detail::send_record* take()
+		{
+			detail::send_record* r = record_;
+			record_ = 0;
+			return r;
+		}
+
+	private:
+		friend class sctp_send_ring;
+		detail::send_record* record_;
+	};
+
+	/// Create a ring of about capacity bytes.
+	static sctp_send_ring* create(std::size_t capacity)
+	{
+		return new sctp_send_ring(capacity);
+	}
+
+	/// Give up the ring; it is freed once its outstanding messages have been sent.
+	static void retire(sctp_send_ring* ring)
+	{
+		if (ring)
+			ring->drop_ref();
+	}
+
+	/// Reserve size bytes for one message, replacing any reservation r held.
+	void reserve(std::size_t size, region& r)
+	{
+		r.reset();
+		reclaim();
+
+		std::size_t span = (sizeof(detail::send_record) + size + alignment - 1) & ~std::size_t(alignment - 1);
+		std::size_t pos = npos;
+		if (!wrapped_)
+		{
+			if (capacity_ - head_ >= span)
+			{
+				pos = head_;
+				head_ += span;
+			}
+			else if (tail_ >= span)
+			{
+				end_ = head_;
+				wrapped_ = true;
+				pos = 0;
+				head_ = span;
+			}
+		}
+		else if (tail_ - head_ >= span)
+		{
+			pos = head_;
+			head_ += span;
+		}
+
+		if (pos == npos)
+		{
+			r.record_ = detail::send_record::allocate(size);
+			return;
+		}
+		detail::send_record* record = new (buffer_ + pos) detail::send_record;
+		record->size = size;
+		record->ring = this;
+		record->span = span;
+		record->released = false;
+		detail::atomic::fetch_add(refs_, std::size_t(1));
+		r.record_ = record;
+	}
+
+	/// Bytes of the ring in use by reserved or unsent messages.
+	std::size_t used() const
+	{
+		if (wrapped_)
+			return end_ - tail_ + head_;
+		return head_ - tail_;
+	}
+
+	/// Bytes the ring holds.
+	std::size_t capacity() const
+	{
+		return capacity_;
+	}
+
+private:
+	friend struct detail::send_record;
+
+	enum { alignment = boost::alignment_of<detail::send_record>::value };
+	static const std::size_t npos = ~std::size_t(0);
+
+	explicit sctp_send_ring(std::size_t capacity)
+		: capacity_((capacity + alignment - 1) & ~std::size_t(alignment - 1)),
+			buffer_(static_cast<unsigned char*>(::operator new(capacity_))),
+			head_(0),
+			tail_(0),
+			end_(0),
+			wrapped_(false),
+			refs_(1)
+	{
+	}
+
+	~sctp_send_ring()
+	{
+		::operator delete(buffer_);
+	}
+
+	// Move the tail past the messages which have been given back. Only the
+	// reserving thread knows where each one starts, so it does this itself.
+	void reclaim()
+	{
+		for (;;)
+		{
+			if (!wrapped_ && tail_ == head_)
+			{
+				tail_ = head_ = 0;
+				return;
+			}
+			if (wrapped_ && tail_ == end_)
+			{
+				tail_ = 0;
+				wrapped_ = false;
+				continue;
+			}
+			detail::send_record* r = reinterpret_cast<detail::send_record*>(buffer_ + tail_);
+			if (!detail::atomic::load_acquire(r->released))
+				return;
+			tail_ += r->span;
+		}
+	}
+
+	void drop_ref()
+	{
+		if (detail::atomic::fetch_sub(refs_, std::size_t(1)) == 1)
+			delete this;
+	}
+
+	const std::size_t capacity_;
+	unsigned char* const buffer_;
+	std::size_t head_;  // where the next region goes
+	std::size_t tail_;  // the oldest region not yet reclaimed
+	std::size_t end_;  // where the regions stop before the wrap, while wrapped_
+	bool wrapped_;  // regions run from tail_ to end_, then from 0 to head_
+	volatile std::size_t refs_;  // the owner's, and one per region
+};
+
+namespace detail {
+
+inline void send_record::release()
+{
+	sctp_send_ring* r = ring;
+	if (!r)
+	{
+		::operator delete(this);
+		return;
+	}
+	atomic::store_release(released, true);  // the space may be reused from here on
+	r->drop_ref();
+}
+
+} // namespace detail
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_SEND_RING_HPP
@@ -167,6 +167,83 @@ public:
      return this->service.bind_remove(this->implementation, endpoint, ec);
    }
 
+   /// Wait until associations are waiting to be accepted.
+   /**
+    * Together with accept_pending() this lets an application drain the
+    * accept queue in one pass on each readiness event, and look at each peer
+    * before allocating anything for it.
+    *
+    * @param handler Called as for a read of null_buffers:
+    * @code void handler(
+    *   const boost::system::error_code& error, // Result of operation.
+    *   std::size_t bytes_transferred           // Always zero.
+    * ); @endcode
+    *
+    * @par Example
+    * @code
+    * void on_pending(const boost::system::error_code& error, std::size_t)
+    * {
+    *   for (int n = 0; !error && n < 64; ++n)
+    *   {
+    *     boost::asio_sctp::ip::sctp::endpoint peer;
+    *     boost::system::error_code ec;
+    *     native_type s = acceptor.accept_pending(peer, ec);
+    *     if (ec)
+    *       break;  // would_block once the queue is empty
+    *     if (!admitted(peer.address()))
+    *       acceptor.reject(s, ec);
+    *     else
+    *       new_connection()->socket().assign(peer.protocol(), s);
+    *   }
+    *   ...
+    * }
+    * @endcode
+    */
+   template <typename WaitHandler>
+   void async_wait_pending(WaitHandler handler)
+   {
+     this->service.async_wait_pending(this->implementation, handler);
+   }
+
+   /// Accept one waiting association without blocking.
+   /**
+    * @param peer_endpoint Set to the remote endpoint of the association.
+    *
+    * @param ec Set to would_block when no association is waiting, otherwise to
+    * indicate what error occurred, if any.
+    *
+    * @returns The association's descriptor, which the caller must either
+    * assign() to a socket or pass to reject().
+    */
+   native_type accept_pending(endpoint_type& peer_endpoint,
+       boost::system::error_code& ec)
+   {
+     return this->service.accept_pending(this->implementation, peer_endpoint, ec);
+   }
+
+   /// Abort an association returned by accept_pending().
+   /**
+    * The descriptor is closed with a zero linger time, so the peer receives
+    * an ABORT and no shutdown state is kept.
+    */
+   boost::system::error_code reject(native_type s,
+       boost::system::error_code& ec)
+   {
+     detail::sctp_socket_ops::abort_close(s, ec);
+     return ec;
+   }
+
+   /// Close the acceptor after passing its descriptor to another process.
+   /**
+    * The listening socket stays open in the other process (see
+    * sctp_handover), which goes on accepting from the same queue. Pending
+    * asynchronous operations complete with operation_aborted, as for close().
+    */
+   boost::system::error_code close_handed_over(boost::system::error_code& ec)
+   {
+     return this->service.close_handed_over(this->implementation, ec);
+   }
+
 };
 
 } // namespace asio_sctp
@@ -16,9 +16,15 @@
 #pragma once
 #endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
 
+#include <cstring>
 #include <boost/asio/socket_acceptor_service.hpp>
+#include <boost/asio/detail/handler_alloc_helpers.hpp>
+#include <boost/asio/detail/reactive_null_buffers_op.hpp>
+#include <boost/asio/detail/reactor.hpp>
+#include <boost/asio/detail/socket_ops.hpp>
 #include <boost/asio_sctp/detail/sctp_socket_types.hpp>
 #include <boost/asio_sctp/detail/sctp_socket_ops.hpp>
+#include <boost/asio_sctp/detail/bridge_transport.hpp>
 
 #include <boost/asio/detail/push_options.hpp>
 
@@ -32,13 +38,85 @@ class sctp_socket_acceptor_service
 public:
    typedef typename boost::asio::socket_acceptor_service<Protocol>::implementation_type implementation_type;
    typedef typename boost::asio::socket_acceptor_service<Protocol>::endpoint_type endpoint_type;
+   typedef typename boost::asio::socket_acceptor_service<Protocol>::protocol_type protocol_type;
 
    /// Construct a new socket acceptor service for the specified io_service.
    explicit sctp_socket_acceptor_service(boost::asio::io_service& io_service)
-     : boost::asio::socket_acceptor_service<Protocol>(io_service)
+     : boost::asio::socket_acceptor_service<Protocol>(io_service),
+       reactor_(boost::asio::use_service<boost::asio::detail::reactor>(io_service))
    {
    }
 
+  /// Open a new acceptor; with the user-space transport, a bridge listener.
+  boost::system::error_code open(implementation_type& impl,
+      const protocol_type& protocol, boost::system::error_code& ec)
+  {
+    if (!detail::sctp_socket_ops::bridged())
+      return base_type::open(impl, protocol, ec);
+
+    int fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+      return ec = boost::system::error_code(errno,
+          boost::asio::error::get_system_category());
+    if (base_type::assign(impl, protocol, fd, ec))
+      ::close(fd);
+    return ec;
+  }
+
+  /// Bind the acceptor; with the user-space transport only the port is used.
+  boost::system::error_code bind(implementation_type& impl,
+      const endpoint_type& endpoint, boost::system::error_code& ec)
+  {
+    if (!detail::sctp_socket_ops::bridged())
+      return base_type::bind(impl, endpoint, ec);
+
+    sockaddr_un name;
+    socklen_t length = detail::bridge_transport::listener_name(endpoint.port(), name);
+    boost::asio::detail::socket_ops::bind(impl.socket_,
+        reinterpret_cast<const boost::asio::detail::socket_addr_type*>(&name),
+        length, ec);
+    return ec;
+  }
+
+  /// Set an option; SCTP-level options do not apply to a bridge.
+  template <typename SettableSocketOption>
+  boost::system::error_code set_option(implementation_type& impl,
+      const SettableSocketOption& option, boost::system::error_code& ec)
+  {
+    if (detail::sctp_socket_ops::bridged()
+        && option.level(impl.protocol_) == IPPROTO_SCTP)
+      return ec = boost::system::error_code();
+    return base_type::set_option(impl, option, ec);
+  }
+
+  /// Get an option; SCTP-level options read as zero on a bridge.
+  template <typename GettableSocketOption>
+  boost::system::error_code get_option(const implementation_type& impl,
+      GettableSocketOption& option, boost::system::error_code& ec) const
+  {
+    if (detail::sctp_socket_ops::bridged()
+        && option.level(impl.protocol_) == IPPROTO_SCTP)
+    {
+      std::memset(option.data(impl.protocol_), 0, option.size(impl.protocol_));
+      return ec = boost::system::error_code();
+    }
+    return base_type::get_option(impl, option, ec);
+  }
+
+  /// Get the local endpoint.
+  endpoint_type local_endpoint(const implementation_type& impl,
+      boost::system::error_code& ec) const
+  {
+    if (!detail::sctp_socket_ops::bridged())
+      return base_type::local_endpoint(impl, ec);
+
+    endpoint_type endpoint;
+    sockaddr_storage local;
+    if (detail::sctp_socket_ops::bridge_listen_endpoint(impl.socket_, local, ec) == 0)
+      std::memcpy(endpoint.data(), &local, endpoint.capacity());
+    return endpoint;
+  }
+
    /// Add an endpoint to the set used by the acceptor.
   boost::system::error_code bind_add(implementation_type& impl,
       const endpoint_type& endpoint, boost::system::error_code& ec)
@@ -66,6 +144,90 @@ public:
     boost::asio_sctp::detail::sctp_socket_ops::bind_remove(native(impl), endpoint.data(), endpoint.size(), ec);
     return ec;
   }
+
+  /// Start an asynchronous wait until associations are waiting to be accepted.
+  /**
+   * The handler is called as for a read of null_buffers, with an error and a
+   * byte count of zero.
+   */
+  template <typename WaitHandler>
+  void async_wait_pending(implementation_type& impl, WaitHandler handler)
+  {
+    typedef boost::asio::detail::reactive_null_buffers_op<WaitHandler> op;
+    typename op::ptr p = { boost::addressof(handler),
+      boost_asio_handler_alloc_helpers::allocate(
+        sizeof(op), handler), 0 };
+    p.p = new (p.v) op(handler);
+
+    if (!(impl.state_ & boost::asio::detail::socket_ops::internal_non_blocking)
+        && !boost::asio::detail::socket_ops::set_internal_non_blocking(
+          impl.socket_, impl.state_, true, p.p->ec_))
+    {
+      reactor_.post_immediate_completion(p.p);
+    }
+    else
+    {
+      reactor_.start_op(boost::asio::detail::reactor::read_op, impl.socket_,
+          impl.reactor_data_, p.p, false);
+    }
+    p.v = p.p = 0;
+  }
+
+  /// Accept one waiting association without blocking.
+  /**
+   * @returns The new association's descriptor, or invalid_socket with ec set
+   * to would_block when none is waiting.
+   */
+  boost::asio::detail::socket_type accept_pending(implementation_type& impl,
+      endpoint_type& peer_endpoint, boost::system::error_code& ec)
+  {
+    if (!(impl.state_ & boost::asio::detail::socket_ops::internal_non_blocking)
+        && !boost::asio::detail::socket_ops::set_internal_non_blocking(
+          impl.socket_, impl.state_, true, ec))
+      return boost::asio::detail::invalid_socket;
+
+    std::size_t addr_len = peer_endpoint.capacity();
+    boost::asio::detail::socket_type s = boost::asio::detail::socket_ops::accept(
+        impl.socket_, peer_endpoint.data(), &addr_len, ec);
+    if (s == boost::asio::detail::invalid_socket)
+    {
+      if (ec == boost::asio::error::try_again)
+        ec = boost::asio::error::would_block;
+      return s;
+    }
+
+    if (!detail::sctp_socket_ops::bridged())
+    {
+      peer_endpoint.resize(addr_len);
+      return s;
+    }
+
+    sockaddr_storage local, remote;
+    if (detail::sctp_socket_ops::bridge_endpoints(s, local, remote, ec) == 0)
+      std::memcpy(peer_endpoint.data(), &remote, peer_endpoint.capacity());
+    else
+    {
+      peer_endpoint = endpoint_type();
+      ec = boost::system::error_code();  // the peer address is informational only
+    }
+    return s;
+  }
+
+  /// Close this process's descriptor of an acceptor passed to another process.
+  boost::system::error_code close_handed_over(implementation_type& impl,
+      boost::system::error_code& ec)
+  {
+    // The listening socket outlives the descriptor, so the reactor must remove
+    // it from its set explicitly rather than rely on close() doing so.
+    impl.state_ |= boost::asio::detail::socket_ops::possible_dup;
+    return base_type::close(impl, ec);
+  }
+
+private:
+  typedef boost::asio::socket_acceptor_service<Protocol> base_type;
+
+  // The reactor which waits for pending associations.
+  boost::asio::detail::reactor& reactor_;
 };
 
 } // namespace asio_sctp
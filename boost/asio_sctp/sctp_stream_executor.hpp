@@ -0,0 +1,339 @@
+//
+// sctp_stream_executor.hpp
+// ~~~~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_STREAM_EXECUTOR_HPP
+#define BOOST_ASIO_SCTP_SCTP_STREAM_EXECUTOR_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+#include <boost/asio_sctp/detail/parked_message.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Processes received messages on a pool of threads, in order within each stream.
+/**
+ * SCTP only orders the messages of one stream, so a busy association's
+ * streams may as well be processed side by side. Each message is posted with
+ * a key, by default its association and stream; messages with the same key
+ * are handled one at a time in the order they were posted, while those with
+ * different keys are handled in parallel by the worker threads. A key is never
+ * bound to a thread: whichever worker is free takes the next key with messages
+ * waiting, and keys take turns, so one busy stream neither holds up the others
+ * nor leaves workers idle.
+ *
+ * Messages are copied, into buffers which are recycled, so the receive buffer
+ * may be reused as soon as post() returns. At most max_queued messages may
+ * wait per key. Beyond that post() drops the message and counts it, while
+ * post_wait() blocks until there is room: the reader then stops reading, the
+ * socket's receive window fills, and the peer is slowed down rather than
+ * messages being lost.
+ *
+ * @par Example
+ * @code
+ * void handle(const std::pair<sctp_assoc_t, boost::uint16_t>& key, const sctp_message& msg);
+ *
+ * typedef void (*handler_type)(const std::pair<sctp_assoc_t, boost::uint16_t>&, const sctp_message&);
+ * boost::asio_sctp::sctp_stream_executor<handler_type> executor(&handle, 4);
+ * executor.start();
+ * ...
+ * batch.fill(socket, ec);
+ * for (std::size_t i = 0; i < batch.size(); ++i)
+ *   executor.post_wait(batch[i]);
+ * @endcode
+ *
+ * @par Thread Safety
+ * Messages may be posted from any thread. The handler is called as
+ * @code void handler(const Key& key, const sctp_message& msg); @endcode
+ * on a worker thread, possibly at the same time as for other keys; the message
+ * data is only valid for the duration of the call. The handler must not call
+ * post_wait() for its own key while the key's queue may be full.
+ */
+template <typename Handler, typename Key = std::pair<sctp_assoc_t, boost::uint16_t> >
+class sctp_stream_executor
+	: private boost::noncopyable
+{
+public:
+	/// Construct with the number of worker threads and the most messages waiting per key.
+	sctp_stream_executor(Handler handler, std::size_t threads, std::size_t max_queued = 256)
+		: handler_(handler),
+			threads_count_(threads ? threads : 1),
+			max_queued_(max_queued ? max_queued : 1),
+			stopped_(false),
+			queued_(0),
+			dropped_(0),
+			waiting_(0),
+			idle_waiting_(0)
+	{
+	}
+
+	~sctp_stream_executor()
+	{
+		stop();
+		for (typename flow_map::iterator i = flows_.begin(); i != flows_.end(); ++i)
+			for (std::size_t j = 0; j < i->second.messages.size(); ++j)
+				pool_.release(i->second.messages[j]);
+	}
+
+	/// Start the worker threads; optionally pin worker i to CPU first_cpu + i.
+	void start(bool pin_threads = false, std::size_t first_cpu = 0)
+	{
+		for (std::size_t i = 0; i < threads_count_; ++i)
+		{
+			thread_ptr thread(new boost::thread(boost::bind(&sctp_stream_executor::run, this)));
+			if (pin_threads)
+			{
+				cpu_set_t cpus;
+				CPU_ZERO(&cpus);
+				CPU_SET((first_cpu + i) % CPU_SETSIZE, &cpus);
+				::pthread_setaffinity_np(thread->native_handle(), sizeof(cpus), &cpus);
+			}
+			threads_.push_back(thread);
+		}
+	}
+
+	/// Stop the workers once they finish their current messages; the rest are not handled.
+	void stop()
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+			stopped_ = true;
+		}
+		work_ready_.notify_all();
+		space_ready_.notify_all();
+		key_idle_.notify_all();
+		for (std::size_t i = 0; i < threads_.size(); ++i)
+			threads_[i]->join();
+		threads_.clear();
+	}
+
+	/// Queue a copy of a message for key.
+	/**
+	 * @returns false if the message was dropped because key already has
+	 * max_queued messages waiting, or the executor has been stopped.
+	 */
+	bool post(const Key& key, const sctp_message& msg)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (stopped_)
+			return false;
+		flow& f = flows_[key];
+		if (f.messages.size() >= max_queued_)
+		{
+			++dropped_;
+			return false;
+		}
+		enqueue(key, f, msg);
+		return true;
+	}
+
+	/// Queue a copy of a message, keyed by its association and stream.
+	bool post(const sctp_message& msg)
+	{
+		return post(Key(msg.assoc_id, msg.stream), msg);
+	}
+
+	/// Queue a copy of a message for key, waiting while key has max_queued messages waiting.
+	/**
+	 * @returns false if the executor has been stopped.
+	 */
+	bool post_wait(const Key& key, const sctp_message& msg)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		for (;;)
+		{
+			if (stopped_)
+				return false;
+			flow& f = flows_[key];
+			if (f.messages.size() < max_queued_)
+			{
+				enqueue(key, f, msg);
+				return true;
+			}
+			++waiting_;
+			space_ready_.wait(lock);
+			--waiting_;
+		}
+	}
+
+	/// Queue a copy of a message, keyed by its association and stream, waiting for room.
+	bool post_wait(const sctp_message& msg)
+	{
+		return post_wait(Key(msg.assoc_id, msg.stream), msg);
+	}
+
+	/// Wait until no key from first to last has messages waiting or being handled.
+	/**
+	 * Used before acting on the end of a flow, e.g. closing an association only
+	 * once the messages read ahead of its shutdown have been handled. Must not
+	 * be called by the handler for a key in the range.
+	 *
+	 * @returns false if the executor has been stopped.
+	 */
+	bool wait_idle(const Key& first, const Key& last)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		for (;;)
+		{
+			if (stopped_)
+				return false;
+			typename flow_map::const_iterator i = flows_.lower_bound(first);
+			if (i == flows_.end() || last < i->first)
+				return true;
+			++idle_waiting_;
+			key_idle_.wait(lock);
+			--idle_waiting_;
+		}
+	}
+
+	/// Number of messages waiting.
+	std::size_t queued()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return queued_;
+	}
+
+	/// Number of messages waiting for one key.
+	std::size_t queued(const Key& key)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		typename flow_map::const_iterator i = flows_.find(key);
+		return i == flows_.end() ? 0 : i->second.messages.size();
+	}
+
+	/// Number of messages dropped by post() because their key's queue was full.
+	std::size_t dropped()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return dropped_;
+	}
+
+	/// Number of worker threads.
+	std::size_t size() const
+	{
+		return threads_count_;
+	}
+
+private:
+	struct flow
+	{
+		flow()
+			: scheduled(false)
+		{
+		}
+
+		std::deque<detail::parked_message> messages;
+		bool scheduled;  // in ready_, or being handled by a worker
+	};
+
+	typedef std::map<Key, flow> flow_map;
+	typedef boost::shared_ptr<boost::thread> thread_ptr;
+
+	// Called with mutex_ held.
+	void enqueue(const Key& key, flow& f, const sctp_message& msg)
+	{
+		f.messages.push_back(pool_.park(msg));
+		++queued_;
+		if (!f.scheduled)
+		{
+			f.scheduled = true;
+			ready_.push_back(key);
+			work_ready_.notify_one();
+		}
+	}
+
+	void run()
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		for (;;)
+		{
+			while (ready_.empty() && !stopped_)
+				work_ready_.wait(lock);
+			if (stopped_)
+				return;
+
+			Key key = ready_.front();
+			ready_.pop_front();
+			typename flow_map::iterator i = flows_.find(key);
+			for (;;)
+			{
+				detail::parked_message p = i->second.messages.front();
+				i->second.messages.pop_front();
+				--queued_;
+				if (waiting_)
+					space_ready_.notify_all();
+
+				lock.unlock();
+				handler_(key, p.view());
+				lock.lock();
+
+				pool_.release(p);
+				// Only this worker erases the flow while it is scheduled, so i is still valid.
+				if (i->second.messages.empty())
+				{
+					flows_.erase(i);
+					if (idle_waiting_)
+						key_idle_.notify_all();
+					break;
+				}
+				if (!ready_.empty() || stopped_)
+				{
+					ready_.push_back(key);  // let the other keys have a turn
+					break;
+				}
+				// Nothing else is waiting; carry on with this key without a handoff.
+			}
+		}
+	}
+
+	Handler handler_;
+	const std::size_t threads_count_;
+	const std::size_t max_queued_;
+	boost::mutex mutex_;  // guards the members below
+	boost::condition_variable work_ready_;  // a key has been added to ready_, or stopped_ set
+	boost::condition_variable space_ready_;  // a message has been taken off a queue, or stopped_ set
+	boost::condition_variable key_idle_;  // a key's last message has been handled, or stopped_ set
+	bool stopped_;
+	flow_map flows_;
+	std::deque<Key> ready_;  // keys with messages waiting and no worker, in service order
+	detail::parked_message_pool pool_;
+	std::size_t queued_;
+	std::size_t dropped_;
+	std::size_t waiting_;  // callers blocked in post_wait
+	std::size_t idle_waiting_;  // callers blocked in wait_idle
+	std::vector<thread_ptr> threads_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_STREAM_EXECUTOR_HPP
@@ -164,6 +164,49 @@ namespace boost {
 				this->service.remote_endpoints(this->implementation, endpoints, ec);
 			}
 
+			/// Add a local endpoint to the association.
+			/**
+			* This function adds an address of the local machine to those the
+			* association uses. On an established association the peer is told with
+			* an ASCONF chunk, so it may start sending to the address at once; it
+			* must have negotiated address reconfiguration.
+			*
+			* @param endpoint The local endpoint to add. Its port must be zero or the
+			* port the socket is bound to.
+			*
+			* @param ec Set to indicate what error occurred, if any.
+			*
+			* @par Example
+			* @code
+			* boost::asio::ip::sctp::socket socket(io_service);
+			* ...
+			* boost::system::error_code ec;
+			* socket.bind_add(boost::asio::ip::sctp::endpoint(
+			*     boost::asio::ip::address::from_string("10.0.1.2"), 0), ec);
+			* @endcode
+			*/
+			boost::system::error_code bind_add(const endpoint_type& endpoint,
+				boost::system::error_code& ec)
+			{
+				return this->service.bind_add(this->implementation, endpoint, ec);
+			}
+
+			/// Remove a local endpoint from the association.
+			/**
+			* This function removes an address of the local machine from those the
+			* association uses, telling the peer with an ASCONF chunk. The last
+			* address cannot be removed.
+			*
+			* @param endpoint The local endpoint to remove.
+			*
+			* @param ec Set to indicate what error occurred, if any.
+			*/
+			boost::system::error_code bind_remove(const endpoint_type& endpoint,
+				boost::system::error_code& ec)
+			{
+				return this->service.bind_remove(this->implementation, endpoint, ec);
+			}
+
 			/// Send some data on the socket.
 			/**
 			* This function is used to send data on the stream socket. The function
@@ -215,6 +258,171 @@ namespace boost {
 				boost::asio::detail::throw_error(ec, "send");
 				return s;
 			}
+
+			/// Receive all or part of one message, with its SCTP metadata.
+			/**
+			* This function reads up to the end of the next user message on the socket
+			* and reports its stream number, payload protocol ID and association. A
+			* message larger than the buffers is returned over several calls; the call
+			* which completes it sets MSG_EOR in @c info.msg_flags. With fragment
+			* interleaving enabled, consecutive calls may return parts of messages from
+			* different streams; sctp_reassembler puts them back together.
+			*
+			* @param buffers One or more buffers into which the data will be received.
+			* @param info Receives the stream, PPID, association and flags of the data.
+			*
+			* @returns The number of bytes received.
+			*
+			* @throws boost::system::system_error Thrown on failure.
+			*/
+			template <typename MutableBufferSequence>
+			std::size_t receive_message(const MutableBufferSequence& buffers,
+				sctp_receive_info& info)
+			{
+				boost::system::error_code ec;
+				std::size_t s = this->get_service().receive_message(
+					this->get_implementation(), buffers, 0, info, ec);
+				boost::asio::detail::throw_error(ec, "receive_message");
+				return s;
+			}
+
+			/// Receive all or part of one message, with its SCTP metadata.
+			/**
+			* @param buffers One or more buffers into which the data will be received.
+			* @param flags Flags specifying how the receive call is to be made.
+			* @param info Receives the stream, PPID, association and flags of the data.
+			* @param ec Set to indicate what error occurred, if any.
+			*
+			* @returns The number of bytes received.
+			*/
+			template <typename MutableBufferSequence>
+			std::size_t receive_message(const MutableBufferSequence& buffers,
+				boost::asio::socket_base::message_flags flags,
+				sctp_receive_info& info, boost::system::error_code& ec)
+			{
+				return this->get_service().receive_message(
+					this->get_implementation(), buffers, flags, info, ec);
+			}
+
+			/// Move one association of a one-to-many socket onto its own socket.
+			/**
+			* This function branches an association off a socket opened with
+			* ip::sctp::v4_one_to_many() or v6_one_to_many(). The kernel moves the
+			* association, together with the socket options it inherited and any data
+			* already queued for it, onto a new descriptor which is then assigned to
+			* @c peer. The peer need not use the same io_service, so a busy association
+			* can be handed to another thread without the remote end reconnecting.
+			*
+			* Any partially read message of the association left on this socket is
+			* not moved; use sctp_reassembler::discard() to drop it.
+			*
+			* @param assoc_id The association to move.
+			* @param peer A closed socket which takes ownership of the association.
+			*
+			* @throws boost::system::system_error Thrown on failure.
+			*
+			* @par Example
+			* @code
+			* boost::asio_sctp::ip::sctp::socket hot(pool.get_io_service());
+			* one_to_many.peeloff(msg.assoc_id, hot);
+			* @endcode
+			*/
+			void peeloff(sctp_assoc_t assoc_id, sctp_stream_socket& peer)
+			{
+				boost::system::error_code ec;
+				peeloff(assoc_id, peer, ec);
+				boost::asio::detail::throw_error(ec, "peeloff");
+			}
+
+			/// Move one association of a one-to-many socket onto its own socket.
+			/**
+			* @param assoc_id The association to move.
+			* @param peer A closed socket which takes ownership of the association.
+			* @param ec Set to indicate what error occurred, if any.
+			*/
+			boost::system::error_code peeloff(sctp_assoc_t assoc_id,
+				sctp_stream_socket& peer, boost::system::error_code& ec)
+			{
+				if (peer.is_open())
+				{
+					ec = boost::asio::error::already_open;
+					return ec;
+				}
+				// The peeled socket behaves as one-to-one, which is the protocol
+				// an endpoint reports.
+				protocol_type protocol = this->local_endpoint(ec).protocol();
+				if (ec)
+					return ec;
+				native_type s = this->get_service().peeloff(this->get_implementation(), assoc_id, ec);
+				if (ec)
+					return ec;
+				peer.assign(protocol, s, ec);
+				if (ec)
+					::close(s);
+				return ec;
+			}
+
+			/// Send a burst of messages, bundling them into as few packets as possible.
+			/**
+			* This function sends each message with its own stream number and payload
+			* protocol ID. All but the last are sent with MSG_MORE, so the kernel holds
+			* their DATA chunks back and bundles them into full packets; the last message
+			* releases them. Where the kernel does not support MSG_MORE on SCTP sockets the
+			* messages are sent individually.
+			*
+			* @param first Iterator to the first sctp_outbound_message.
+			* @param last Iterator past the last message.
+			*
+			* @returns The number of messages sent.
+			*
+			* @throws boost::system::system_error Thrown on failure.
+			*/
+			template <typename Iterator>
+			std::size_t send_batch(Iterator first, Iterator last)
+			{
+				boost::system::error_code ec;
+				std::size_t s = this->get_service().send_batch(
+					this->get_implementation(), first, last, 0, ec);
+				boost::asio::detail::throw_error(ec, "send_batch");
+				return s;
+			}
+
+			/// Send a burst of messages, bundling them into as few packets as possible.
+			/**
+			* @param first Iterator to the first sctp_outbound_message.
+			* @param last Iterator past the last message.
+			* @param ec Set to indicate what error occurred, if any. Messages from the
+			* one that failed onwards have not been sent.
+			*
+			* @returns The number of messages sent.
+			*/
+			template <typename Iterator>
+			std::size_t send_batch(Iterator first, Iterator last,
+				boost::system::error_code& ec)
+			{
+				return this->get_service().send_batch(
+					this->get_implementation(), first, last, 0, ec);
+			}
+
+			/// Send a burst of messages, bundling them into as few packets as possible.
+			/**
+			* @param first Iterator to the first sctp_outbound_message.
+			* @param last Iterator past the last message.
+			* @param flags Flags specifying how the messages are sent, e.g. MSG_DONTWAIT
+			* to stop at the first message the kernel has no room for.
+			* @param ec Set to indicate what error occurred, if any. Messages from the
+			* one that failed onwards have not been sent.
+			*
+			* @returns The number of messages sent.
+			*/
+			template <typename Iterator>
+			std::size_t send_batch(Iterator first, Iterator last,
+				boost::asio::socket_base::message_flags flags,
+				boost::system::error_code& ec)
+			{
+				return this->get_service().send_batch(
+					this->get_implementation(), first, last, flags, ec);
+			}
 		};
 
 	} // namespace asio_sctp
@@ -21,6 +21,9 @@
 #include <boost/asio/stream_socket_service.hpp>
 #include <boost/asio_sctp/detail/sctp_socket_types.hpp>
 #include <boost/asio_sctp/detail/sctp_socket_ops.hpp>
+#include <boost/asio_sctp/detail/bridge_transport.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+#include <cstring>
 #include <vector>
 
 #include <boost/asio/detail/push_options.hpp>
@@ -36,6 +39,8 @@ public:
 			implementation_type;
 	typedef typename boost::asio::stream_socket_service<Protocol>::endpoint_type
 			endpoint_type;
+	typedef typename boost::asio::stream_socket_service<Protocol>::protocol_type
+			protocol_type;
 
 	/// Construct a new stream socket service for the specified io_service.
 	explicit sctp_stream_socket_service(boost::asio::io_service& io_service) :
@@ -43,6 +48,96 @@ public:
 	{
 	}
 
+	/// Open a new socket; with the user-space transport, an unconnected bridge.
+	boost::system::error_code open(implementation_type& impl,
+			const protocol_type& protocol, boost::system::error_code& ec)
+	{
+		if (!detail::sctp_socket_ops::bridged())
+			return base_type::open(impl, protocol, ec);
+		return assign_bridge(impl, protocol,
+				::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0), ec);
+	}
+
+	/// Connect to the specified endpoint.
+	boost::system::error_code connect(implementation_type& impl,
+			const endpoint_type& peer_endpoint, boost::system::error_code& ec)
+	{
+		if (!detail::sctp_socket_ops::bridged())
+			return base_type::connect(impl, peer_endpoint, ec);
+		if (!is_open(impl))
+			return ec = boost::asio::error::bad_descriptor;
+
+		int fd = detail::bridge_transport::active()->connect(
+				peer_endpoint.data(), peer_endpoint.size(), ec);
+		if (ec)
+			return ec;
+		return replace_bridge(impl, fd, ec);
+	}
+
+	/// Start an asynchronous connect.
+	/**
+	 * With the user-space transport the connect cannot be cancelled, and the
+	 * socket must outlive it.
+	 */
+	template <typename ConnectHandler>
+	void async_connect(implementation_type& impl,
+			const endpoint_type& peer_endpoint,
+			BOOST_ASIO_MOVE_ARG(ConnectHandler) handler)
+	{
+		if (!detail::sctp_socket_ops::bridged())
+		{
+			base_type::async_connect(impl, peer_endpoint,
+					BOOST_ASIO_MOVE_CAST(ConnectHandler)(handler));
+			return;
+		}
+		detail::bridge_transport::active()->async_connect(
+				peer_endpoint.data(), peer_endpoint.size(),
+				bridge_connect_op<ConnectHandler>(*this, impl, handler));
+	}
+
+	/// Set a socket option; SCTP-level options do not apply to a bridge.
+	template <typename SettableSocketOption>
+	boost::system::error_code set_option(implementation_type& impl,
+			const SettableSocketOption& option, boost::system::error_code& ec)
+	{
+		if (detail::sctp_socket_ops::bridged()
+				&& option.level(impl.protocol_) == IPPROTO_SCTP)
+			return ec = boost::system::error_code();
+		return base_type::set_option(impl, option, ec);
+	}
+
+	/// Get a socket option; SCTP-level options read as zero on a bridge.
+	template <typename GettableSocketOption>
+	boost::system::error_code get_option(const implementation_type& impl,
+			GettableSocketOption& option, boost::system::error_code& ec) const
+	{
+		if (detail::sctp_socket_ops::bridged()
+				&& option.level(impl.protocol_) == IPPROTO_SCTP)
+		{
+			std::memset(option.data(impl.protocol_), 0, option.size(impl.protocol_));
+			return ec = boost::system::error_code();
+		}
+		return base_type::get_option(impl, option, ec);
+	}
+
+	/// Get the local endpoint.
+	endpoint_type local_endpoint(const implementation_type& impl,
+			boost::system::error_code& ec) const
+	{
+		if (!detail::sctp_socket_ops::bridged())
+			return base_type::local_endpoint(impl, ec);
+		return bridge_endpoint(impl, true, ec);
+	}
+
+	/// Get the remote endpoint.
+	endpoint_type remote_endpoint(const implementation_type& impl,
+			boost::system::error_code& ec) const
+	{
+		if (!detail::sctp_socket_ops::bridged())
+			return base_type::remote_endpoint(impl, ec);
+		return bridge_endpoint(impl, false, ec);
+	}
+
 	/// Get the local endpoints.
 	void local_endpoints(const implementation_type& impl, std::vector<
 			endpoint_type>& endpoints, boost::system::error_code& ec) const
@@ -99,6 +194,34 @@ public:
 		detail::sctp_socket_ops::freepaddrs(addrs);
 	}
 
+	/// Add a local endpoint to the association; sent to the peer as an ASCONF.
+	boost::system::error_code bind_add(implementation_type& impl,
+			const endpoint_type& endpoint, boost::system::error_code& ec)
+	{
+		if (!is_open(impl))
+		{
+			ec = boost::asio::error::bad_descriptor;
+			return ec;
+		}
+
+		detail::sctp_socket_ops::bind_add(native(impl), endpoint.data(), endpoint.size(), ec);
+		return ec;
+	}
+
+	/// Remove a local endpoint from the association; sent to the peer as an ASCONF.
+	boost::system::error_code bind_remove(implementation_type& impl,
+			const endpoint_type& endpoint, boost::system::error_code& ec)
+	{
+		if (!is_open(impl))
+		{
+			ec = boost::asio::error::bad_descriptor;
+			return ec;
+		}
+
+		detail::sctp_socket_ops::bind_remove(native(impl), endpoint.data(), endpoint.size(), ec);
+		return ec;
+	}
+
 	size_t send_by_sctp(const implementation_type& impl,
 			boost::asio::const_buffer* buf,
 			const boost::asio::detail::socket_addr_type* pAddr,
@@ -119,6 +242,144 @@ public:
 				stream_no, ppid, flags, ec);
 	}
 
+	/// Branch an association off a one-to-many socket onto a new descriptor.
+	boost::asio::detail::socket_type peeloff(const implementation_type& impl,
+			sctp_assoc_t assoc_id, boost::system::error_code& ec)
+	{
+		return detail::sctp_socket_ops::peeloff(native(impl), assoc_id, ec);
+	}
+
+	/// Read all or part of one message, with its SCTP metadata.
+	template <typename MutableBufferSequence>
+	std::size_t receive_message(const implementation_type& impl,
+			const MutableBufferSequence& buffers,
+			boost::asio::socket_base::message_flags flags,
+			sctp_receive_info& info, boost::system::error_code& ec)
+	{
+		boost::asio::detail::buffer_sequence_adapter<boost::asio::mutable_buffer,
+			MutableBufferSequence> bufs(buffers);
+		int result = detail::sctp_socket_ops::recv_one(native(impl),
+				bufs.buffers(), bufs.count(), flags, info, ec);
+		return result < 0 ? 0 : result;
+	}
+
+	/// Send a single message; more indicates that further messages follow.
+	int send_message(const implementation_type& impl,
+			const sctp_outbound_message& msg, int msg_flags, bool more,
+			boost::system::error_code& ec)
+	{
+		detail::sctp_socket_ops::buf b;
+		b.iov_base = const_cast<void*>(boost::asio::buffer_cast<const void*>(msg.buffer));
+		b.iov_len = boost::asio::buffer_size(msg.buffer);
+#if defined(MSG_MORE)
+		if (more)
+			msg_flags |= MSG_MORE;
+#endif
+		return detail::sctp_socket_ops::send_one(native(impl), &b, 1,
+				msg.stream, msg.ppid, msg.flags, msg.time_to_live, msg_flags, ec);
+	}
+
+	/// Send a sequence of messages, corking all but the last.
+	template <typename Iterator>
+	std::size_t send_batch(const implementation_type& impl,
+			Iterator first, Iterator last,
+			boost::asio::socket_base::message_flags msg_flags,
+			boost::system::error_code& ec)
+	{
+		ec = boost::system::error_code();
+		std::size_t sent = 0;
+		for (Iterator it = first; it != last; ++sent)
+		{
+			Iterator next = it;
+			++next;
+			bool more = next != last
+					&& detail::sctp_socket_ops::msg_more_supported();
+			if (send_message(impl, *it, msg_flags, more, ec) < 0)
+			{
+				if (!more || (ec != boost::asio::error::invalid_argument
+						&& ec != boost::asio::error::operation_not_supported))
+					break;
+
+				// Retry uncorked; only if that works was MSG_MORE the problem.
+				if (send_message(impl, *it, msg_flags, false, ec) < 0)
+					break;
+				detail::sctp_socket_ops::set_msg_more_supported(false);
+			}
+			it = next;
+		}
+		return sent;
+	}
+
+private:
+	typedef boost::asio::stream_socket_service<Protocol> base_type;
+
+	boost::system::error_code assign_bridge(implementation_type& impl,
+			const protocol_type& protocol, int fd, boost::system::error_code& ec)
+	{
+		if (fd < 0)
+			return ec = boost::system::error_code(errno,
+					boost::asio::error::get_system_category());
+		if (base_type::assign(impl, protocol, fd, ec))
+			::close(fd);
+		return ec;
+	}
+
+	// Swap the unconnected bridge for the engine's connected one.
+	boost::system::error_code replace_bridge(implementation_type& impl, int fd,
+			boost::system::error_code& ec)
+	{
+		protocol_type protocol = impl.protocol_;
+		boost::system::error_code ignored_ec;
+		base_type::close(impl, ignored_ec);
+		return assign_bridge(impl, protocol, fd, ec);
+	}
+
+	endpoint_type bridge_endpoint(const implementation_type& impl, bool local,
+			boost::system::error_code& ec) const
+	{
+		endpoint_type endpoint;
+		sockaddr_storage local_addr, remote_addr;
+		if (detail::sctp_socket_ops::bridge_endpoints(impl.socket_,
+				local_addr, remote_addr, ec) == 0)
+			std::memcpy(endpoint.data(), local ? &local_addr : &remote_addr,
+					endpoint.capacity());
+		return endpoint;
+	}
+
+	// Called on the engine thread; completes the connect on the io_service.
+	template <typename Handler>
+	class bridge_connect_op
+	{
+	public:
+		bridge_connect_op(sctp_stream_socket_service& service,
+				implementation_type& impl, const Handler& handler)
+			: service_(service), impl_(impl), work_(service.get_io_service()),
+				handler_(handler), fd_(-1)
+		{
+		}
+
+		void operator()(const boost::system::error_code& ec, int fd)
+		{
+			ec_ = ec;
+			fd_ = fd;
+			service_.get_io_service().post(*this);
+		}
+
+		void operator()()
+		{
+			if (!ec_)
+				service_.replace_bridge(impl_, fd_, ec_);
+			handler_(ec_);
+		}
+
+	private:
+		sctp_stream_socket_service& service_;
+		implementation_type& impl_;
+		boost::asio::io_service::work work_;
+		Handler handler_;
+		boost::system::error_code ec_;
+		int fd_;
+	};
 };
 
 } // namespace asio_sctp
@@ -0,0 +1,284 @@
+//
+// sctp_tuner.hpp
+// ~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_SCTP_TUNER_HPP
+#define BOOST_ASIO_SCTP_SCTP_TUNER_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <algorithm>
+#include <cstddef>
+#include <boost/asio/socket_base.hpp>
+#include <boost/asio/detail/throw_error.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/asio_sctp/ip/sctp.hpp>
+#include <boost/asio_sctp/sctp_clock.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+/// Bounds within which sctp_tuner may move an association's settings.
+struct sctp_tuning_profile
+{
+	/// Lowest and highest RTO the tuner will set, in milliseconds.
+	boost::uint32_t rto_floor_ms;
+	boost::uint32_t rto_ceiling_ms;
+
+	/// Association.Max.Retrans on a clean path, and once retransmissions exceed lossy_percent of DATA chunks sent.
+	boost::uint16_t max_retrans_clean;
+	boost::uint16_t max_retrans_lossy;
+	unsigned int lossy_percent;
+
+	/// Smallest and largest socket buffer size the tuner will set, in bytes.
+	std::size_t buffer_min;
+	std::size_t buffer_max;
+
+	/// Short, fast paths: recover quickly, give up on a dead peer early.
+	static sctp_tuning_profile lan()
+	{
+		sctp_tuning_profile p;
+		p.rto_floor_ms = 50;
+		p.rto_ceiling_ms = 3000;
+		p.max_retrans_clean = 5;
+		p.max_retrans_lossy = 8;
+		p.lossy_percent = 2;
+		p.buffer_min = 64 * 1024;
+		p.buffer_max = 1024 * 1024;
+		return p;
+	}
+
+	/// Long or congested paths (DSL, satellite, mobile backhaul): the RFC 4960
+	/// defaults as the limits, and more patience before declaring the peer dead.
+	static sctp_tuning_profile backhaul()
+	{
+		sctp_tuning_profile p;
+		p.rto_floor_ms = 300;
+		p.rto_ceiling_ms = 60000;
+		p.max_retrans_clean = 10;
+		p.max_retrans_lossy = 15;
+		p.lossy_percent = 5;
+		p.buffer_min = 128 * 1024;
+		p.buffer_max = 8 * 1024 * 1024;
+		return p;
+	}
+};
+
+/// What sctp_tuner measured and last applied to one association.
+struct sctp_tuning_state
+{
+	sctp_tuning_state()
+		: sampled(false),
+			last_ms(0),
+			last_packets(0),
+			last_data_chunks(0),
+			last_retransmissions(0),
+			srtt_ms(0),
+			bytes_per_second(0),
+			bdp(0),
+			rto_min_ms(0),
+			rto_initial_ms(0),
+			rto_max_ms(0),
+			max_retrans(0),
+			buffer_size(0)
+	{
+	}
+
+	// Counters at the previous call.
+	bool sampled;
+	boost::uint64_t last_ms;
+	boost::uint64_t last_packets;
+	boost::uint64_t last_data_chunks;
+	boost::uint64_t last_retransmissions;
+
+	// Latest measurements.
+	boost::uint32_t srtt_ms;
+	boost::uint64_t bytes_per_second;  // zero where the kernel has no association statistics
+	std::size_t bdp;
+
+	// Values last applied; zero until first set.
+	boost::uint32_t rto_min_ms;
+	boost::uint32_t rto_initial_ms;
+	boost::uint32_t rto_max_ms;
+	boost::uint16_t max_retrans;
+	std::size_t buffer_size;
+};
+
+/// Periodically fits an association's RTO, retransmission limit and socket buffers to the measured path.
+/**
+ * Each call to tune() reads the association's smoothed RTT and congestion
+ * window and, where the kernel provides them (SCTP_GET_ASSOC_STATS), the
+ * packets sent and chunks retransmitted since the previous call. From these:
+ *
+ * @li RTO.Min is twice the SRTT, RTO.Initial three times and RTO.Max eight
+ * times (and at least twice RTO.Initial), all within the profile's RTO bounds;
+ * @li Association.Max.Retrans is the profile's lossy value while the
+ * retransmitted fraction is above its threshold, otherwise the clean value;
+ * @li SO_SNDBUF and SO_RCVBUF are set to twice the bandwidth-delay product,
+ * within the profile's buffer bounds. Linux doubles the value it is given for
+ * its own bookkeeping, so getsockopt reports twice what was set.
+ *
+ * Small changes are ignored, so a steady path leaves the socket alone. Nothing
+ * is changed before the first RTT measurement, nor with the user-space
+ * transport, which has no SCTP socket options.
+ *
+ * @par Thread Safety
+ * The tuner itself may be shared. Calls for one association, and its state,
+ * must not be concurrent.
+ */
+class sctp_tuner
+{
+public:
+	/// Construct with the bounds to tune within.
+	explicit sctp_tuner(const sctp_tuning_profile& profile = sctp_tuning_profile::backhaul())
+		: profile_(profile)
+	{
+	}
+
+	/// The bounds in use.
+	const sctp_tuning_profile& profile() const
+	{
+		return profile_;
+	}
+
+	/// Measure the association of a one-to-one socket and adjust its settings.
+	/**
+	 * @returns true if any setting was changed; state records the new values.
+	 */
+	template <typename Socket>
+	bool tune(Socket& socket, sctp_tuning_state& state, boost::system::error_code& ec) const
+	{
+		socket_option::sctp_status status;
+		if (socket.get_option(status, ec))
+			return false;
+		if (status.srtt_ms() == 0)
+			return false;  // no measurement yet
+
+		boost::uint64_t now = sctp_clock::now_ms();
+		boost::uint32_t srtt = status.srtt_ms();
+		state.srtt_ms = srtt;
+
+		// Throughput and loss over the interval since the previous call.
+		int loss = -1;  // percent, unknown
+#if defined(SCTP_GET_ASSOC_STATS)
+		socket_option::sctp_assoc_stats stats;
+		boost::system::error_code stats_ec;
+		if (!socket.get_option(stats, stats_ec))
+		{
+			if (state.sampled && now > state.last_ms)
+			{
+				boost::uint64_t packets = stats.packets_sent() - state.last_packets;
+				boost::uint64_t chunks = stats.data_chunks_sent() - state.last_data_chunks;
+				boost::uint64_t rtx = stats.retransmitted_chunks() - state.last_retransmissions;
+				state.bytes_per_second = packets * status.mtu() * 1000 / (now - state.last_ms);
+				if (chunks >= min_chunks_for_loss)
+					loss = static_cast<int>(rtx * 100 / chunks);
+			}
+			state.last_packets = stats.packets_sent();
+			state.last_data_chunks = stats.data_chunks_sent();
+			state.last_retransmissions = stats.retransmitted_chunks();
+		}
+#endif // defined(SCTP_GET_ASSOC_STATS)
+		state.last_ms = now;
+		state.sampled = true;
+
+		// Bandwidth-delay product: what is actually in flight, or what the
+		// measured rate needs over one round trip.
+		std::size_t bdp = status.cwnd();
+		boost::uint64_t rate_bdp = state.bytes_per_second * srtt / 1000;
+		if (rate_bdp > bdp)
+			bdp = static_cast<std::size_t>(rate_bdp);
+		state.bdp = bdp;
+
+		bool changed = false;
+
+		boost::uint32_t rto_min = clamp_rto(2 * srtt);
+		boost::uint32_t rto_initial = clamp_rto(std::max(3 * srtt, rto_min));
+		boost::uint32_t rto_max = clamp_rto(std::max(8 * srtt, 2 * rto_initial));
+		if (differs(rto_min, state.rto_min_ms, boost::uint32_t(8))
+			|| differs(rto_initial, state.rto_initial_ms, boost::uint32_t(8))
+			|| differs(rto_max, state.rto_max_ms, boost::uint32_t(8)))
+		{
+			if (socket.set_option(socket_option::sctp_rto_info(rto_initial, rto_min, rto_max), ec))
+				return changed;
+			state.rto_min_ms = rto_min;
+			state.rto_initial_ms = rto_initial;
+			state.rto_max_ms = rto_max;
+			changed = true;
+		}
+
+		boost::uint16_t max_retrans = state.max_retrans ? state.max_retrans : profile_.max_retrans_clean;
+		if (loss >= 0)
+			max_retrans = (static_cast<unsigned int>(loss) > profile_.lossy_percent)
+				? profile_.max_retrans_lossy : profile_.max_retrans_clean;
+		if (max_retrans != state.max_retrans)
+		{
+			if (socket.set_option(socket_option::sctp_assoc_info(max_retrans), ec))
+				return changed;
+			state.max_retrans = max_retrans;
+			changed = true;
+		}
+
+		std::size_t buffer = 2 * bdp;
+		buffer = std::max(profile_.buffer_min, std::min(profile_.buffer_max, buffer));
+		buffer = (buffer + 4095) & ~std::size_t(4095);
+		if (differs(buffer, state.buffer_size, std::size_t(4)))
+		{
+			if (socket.set_option(boost::asio::socket_base::send_buffer_size(static_cast<int>(buffer)), ec)
+				|| socket.set_option(boost::asio::socket_base::receive_buffer_size(static_cast<int>(buffer)), ec))
+				return changed;
+			state.buffer_size = buffer;
+			changed = true;
+		}
+		return changed;
+	}
+
+	/// Measure and adjust; throws boost::system::system_error on failure.
+	template <typename Socket>
+	bool tune(Socket& socket, sctp_tuning_state& state) const
+	{
+		boost::system::error_code ec;
+		bool changed = tune(socket, state, ec);
+		boost::asio::detail::throw_error(ec, "tune");
+		return changed;
+	}
+
+private:
+	// Fewer DATA chunks than this in an interval say nothing about loss.
+	enum { min_chunks_for_loss = 100 };
+
+	boost::uint32_t clamp_rto(boost::uint32_t ms) const
+	{
+		return std::max(profile_.rto_floor_ms, std::min(profile_.rto_ceiling_ms, ms));
+	}
+
+	// True if value has moved from current by more than 1/divisor of it.
+	template <typename T>
+	static bool differs(T value, T current, T divisor)
+	{
+		if (current == 0)
+			return true;
+		T delta = value > current ? value - current : current - value;
+		return delta > current / divisor;
+	}
+
+	sctp_tuning_profile profile_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_SCTP_TUNER_HPP
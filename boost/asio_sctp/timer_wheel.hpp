@@ -0,0 +1,279 @@
+//
+// timer_wheel.hpp
+// ~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_TIMER_WHEEL_HPP
+#define BOOST_ASIO_SCTP_TIMER_WHEEL_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/placeholders.hpp>
+#include <boost/asio_sctp/sctp_clock.hpp>
+#include <boost/asio_sctp/sctp_handler_allocator.hpp>
+#include <boost/asio_sctp/detail/atomic.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+namespace boost {
+namespace asio_sctp {
+
+class timer_wheel;
+
+/// A timer owned by its user and linked into a timer_wheel while armed.
+/**
+ * The handler is fixed at construction, so arming and cancelling never
+ * allocate. An entry cancels itself on destruction.
+ */
+class timer_wheel_entry
+	: private boost::noncopyable
+{
+public:
+	typedef boost::function<void ()> handler_type;
+
+	explicit timer_wheel_entry(const handler_type& handler)
+		: handler_(handler), prev_(0), next_(0), expiry_(0)
+	{
+	}
+
+	~timer_wheel_entry()
+	{
+		unlink();
+	}
+
+	/// Whether the entry is waiting to expire.
+	bool armed() const
+	{
+		return prev_ != 0;
+	}
+
+private:
+	friend class timer_wheel;
+
+	void unlink()
+	{
+		if (prev_)
+		{
+			prev_->next_ = next_;
+			if (next_)
+				next_->prev_ = prev_;
+			prev_ = next_ = 0;
+		}
+	}
+
+	void link_after(timer_wheel_entry* head)
+	{
+		prev_ = head;
+		next_ = head->next_;
+		if (next_)
+			next_->prev_ = this;
+		head->next_ = this;
+	}
+
+	timer_wheel_entry()
+		: prev_(0), next_(0), expiry_(0)
+	{
+	}
+
+	handler_type handler_;
+	timer_wheel_entry* prev_;
+	timer_wheel_entry* next_;
+	boost::uint64_t expiry_;
+};
+
+/// Hierarchical timing wheel for large numbers of coarse timers.
+/**
+ * Four levels of 64 slots each cover 2^24 ticks. Arming and cancelling are
+ * O(1); expiry walks one slot per tick and occasionally cascades a higher-level
+ * slot down. The wheel is driven by a single deadline timer, so an io_service
+ * holding tens of thousands of association timers has only one entry in its
+ * own timer queue. Ticks follow sctp_clock, so an emulator's virtual time
+ * drives the wheel too.
+ *
+ * @par Thread Safety
+ * A wheel and its entries must only be used from the thread(s) running its
+ * io_service, e.g. one wheel per io_service shard. now() may be read from
+ * any thread.
+ */
+class timer_wheel
+	: private boost::noncopyable
+{
+public:
+	enum { slot_bits = 6, slots = 1 << slot_bits, levels = 4 };
+
+	timer_wheel(boost::asio::io_service& io_service,
+		const boost::posix_time::time_duration& tick)
+		: timer_(io_service), tick_(tick), now_(0), running_(false)
+	{
+	}
+
+	~timer_wheel()
+	{
+		stop();
+		for (int level = 0; level < levels; ++level)
+			for (int slot = 0; slot < slots; ++slot)
+				while (timer_wheel_entry* e = slots_[level][slot].next_)
+					e->unlink();
+	}
+
+	/// Start ticking.
+	void start()
+	{
+		if (!running_)
+		{
+			running_ = true;
+			timer_.expires_from_now(tick_);
+			schedule();
+		}
+	}
+
+	/// Stop ticking; armed entries stay armed.
+	void stop()
+	{
+		running_ = false;
+		boost::system::error_code ec;
+		timer_.cancel(ec);
+	}
+
+	/// The tick duration.
+	boost::posix_time::time_duration tick() const
+	{
+		return tick_;
+	}
+
+	/// Ticks elapsed since the wheel was created.
+	boost::uint64_t now() const
+	{
+		return detail::atomic::load_acquire(now_);
+	}
+
+	/// Convert a duration to a whole number of ticks, rounding up.
+	boost::uint64_t to_ticks(const boost::posix_time::time_duration& d) const
+	{
+		boost::int64_t t = tick_.total_microseconds();
+		return (d.total_microseconds() + t - 1) / t;
+	}
+
+	/// Arm (or re-arm) an entry to expire after the given number of ticks.
+	void arm(timer_wheel_entry& entry, boost::uint64_t ticks)
+	{
+		entry.unlink();
+		entry.expiry_ = now_ + (ticks ? ticks : 1);
+		insert(entry);
+	}
+
+	/// Arm (or re-arm) an entry to expire after at least the given duration.
+	void arm(timer_wheel_entry& entry, const boost::posix_time::time_duration& d)
+	{
+		arm(entry, to_ticks(d));
+	}
+
+	/// Disarm an entry; its handler will not be called.
+	void cancel(timer_wheel_entry& entry)
+	{
+		entry.unlink();
+	}
+
+private:
+	void insert(timer_wheel_entry& entry)
+	{
+		boost::uint64_t delta = entry.expiry_ - now_;
+		int level = 0;
+		while (level < levels - 1 && delta >= (boost::uint64_t(1) << (slot_bits * (level + 1))))
+			++level;
+		if (level == levels - 1 && delta >= (boost::uint64_t(1) << (slot_bits * levels)))
+			entry.expiry_ = now_ + (boost::uint64_t(1) << (slot_bits * levels)) - 1;  // clamp to the wheel's range
+		std::size_t slot = (entry.expiry_ >> (slot_bits * level)) & (slots - 1);
+		entry.link_after(&slots_[level][slot]);
+	}
+
+	void schedule()
+	{
+		timer_.async_wait(handler_memory_.wrap(boost::bind(&timer_wheel::on_tick, this,
+			boost::asio::placeholders::error)));
+	}
+
+	void on_tick(const boost::system::error_code& ec)
+	{
+		if (ec || !running_)
+			return;
+
+		// Catch up on any ticks missed while the io_service was busy.
+		boost::posix_time::ptime due = timer_.expires_at();
+		boost::posix_time::ptime now = sctp_clock_time_traits::now();
+		do
+		{
+			advance();
+			due += tick_;
+		}
+		while (due <= now);
+
+		timer_.expires_at(due);
+		schedule();
+	}
+
+	// Move forward one tick and run everything that has expired.
+	void advance()
+	{
+		detail::atomic::store_release(now_, now_ + 1);
+
+		// Re-distribute the next higher-level slot each time a level wraps.
+		for (int level = 1; level < levels; ++level)
+		{
+			if ((now_ & ((boost::uint64_t(1) << (slot_bits * level)) - 1)) != 0)
+				break;
+			std::size_t slot = (now_ >> (slot_bits * level)) & (slots - 1);
+			timer_wheel_entry pending;
+			take(slots_[level][slot], pending);
+			while (timer_wheel_entry* e = pending.next_)
+			{
+				e->unlink();
+				insert(*e);
+			}
+		}
+
+		// Detach the due slot first, so handlers may freely arm or cancel.
+		timer_wheel_entry expired;
+		take(slots_[0][now_ & (slots - 1)], expired);
+		while (timer_wheel_entry* e = expired.next_)
+		{
+			e->unlink();
+			e->handler_();
+		}
+	}
+
+	static void take(timer_wheel_entry& from, timer_wheel_entry& to)
+	{
+		to.next_ = from.next_;
+		if (to.next_)
+			to.next_->prev_ = &to;
+		from.next_ = 0;
+	}
+
+	sctp_deadline_timer timer_;
+	sctp_handler_allocator handler_memory_;  // for the tick wait
+	boost::posix_time::time_duration tick_;
+	volatile boost::uint64_t now_;
+	bool running_;
+	timer_wheel_entry slots_[levels][slots];
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_TIMER_WHEEL_HPP
@@ -0,0 +1,367 @@
+//
+// trace_file.hpp
+// ~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2008 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+// Copyright (c) 2009 Hal's Software, Inc. (info at halssoftware dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+#ifndef BOOST_ASIO_SCTP_TRACE_FILE_HPP
+#define BOOST_ASIO_SCTP_TRACE_FILE_HPP
+
+#if defined(_MSC_VER) && (_MSC_VER >= 1200)
+#pragma once
+#endif // defined(_MSC_VER) && (_MSC_VER >= 1200)
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/system/error_code.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/asio/error.hpp>
+#include <boost/asio/detail/throw_error.hpp>
+#include <boost/asio_sctp/sctp_message.hpp>
+
+#include <boost/asio/detail/push_options.hpp>
+
+/// Size by which a trace file is extended each time it fills up.
+#ifndef BOOST_ASIO_SCTP_TRACE_CHUNK_SIZE
+#define BOOST_ASIO_SCTP_TRACE_CHUNK_SIZE (64 * 1024 * 1024)
+#endif
+
+namespace boost {
+namespace asio_sctp {
+
+/// Header at the start of every record in a trace file.
+/**
+ * A trace file is a 16-byte file header followed by records, each a
+ * trace_record_header and its payload padded to a multiple of 8 bytes. Fields
+ * are in host byte order; the stream and PPID are as seen by the library,
+ * i.e. as passed to or returned from the socket.
+ */
+struct trace_record_header
+{
+	enum { inbound = 0x1, outbound = 0x2 };
+
+	boost::uint64_t timestamp_ns;  // CLOCK_REALTIME; never 0 for a valid record
+	boost::int32_t assoc_id;
+	boost::uint32_t ppid;
+	boost::uint32_t size;
+	boost::uint16_t stream;
+	boost::uint16_t direction;
+};
+
+namespace detail {
+
+struct trace_file_header
+{
+	char magic[8];
+	boost::uint32_t version;
+	boost::uint32_t record_header_size;
+};
+
+inline const char* trace_file_magic()
+{
+	return "SCTPTRC";
+}
+
+inline std::size_t trace_record_size(std::size_t payload)
+{
+	return (sizeof(trace_record_header) + payload + 7) & ~std::size_t(7);
+}
+
+} // namespace detail
+
+/// Appends message records to a memory-mapped trace file.
+/**
+ * The file is grown in chunks of BOOST_ASIO_SCTP_TRACE_CHUNK_SIZE and records
+ * are copied straight into the mapping, so recording costs a memcpy and a
+ * short critical section; the kernel writes the pages back in its own time.
+ * close() trims the unused tail. A trace cut short by a crash is still
+ * readable up to the last complete record.
+ *
+ * @par Thread Safety
+ * record() may be called from any number of threads.
+ */
+class trace_writer
+	: private boost::noncopyable
+{
+public:
+	trace_writer()
+		: fd_(-1), base_(0), capacity_(0), used_(0), records_(0)
+	{
+	}
+
+	~trace_writer()
+	{
+		boost::system::error_code ec;
+		close(ec);
+	}
+
+	/// Create (or truncate) a trace file.
+	void open(const char* path)
+	{
+		boost::system::error_code ec;
+		open(path, ec);
+		boost::asio::detail::throw_error(ec, "trace_writer::open");
+	}
+
+	/// Create (or truncate) a trace file.
+	boost::system::error_code open(const char* path, boost::system::error_code& ec)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		if (fd_ != -1)
+		{
+			ec = boost::asio::error::already_open;
+			return ec;
+		}
+		fd_ = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd_ == -1)
+			return ec = last_error();
+		used_ = 0;
+		records_ = 0;
+		if (!grow(sizeof(detail::trace_file_header), ec))
+		{
+			::close(fd_);
+			fd_ = -1;
+			return ec;
+		}
+		detail::trace_file_header* header = static_cast<detail::trace_file_header*>(base_);
+		std::memset(header, 0, sizeof(*header));
+		std::strcpy(header->magic, detail::trace_file_magic());
+		header->version = 1;
+		header->record_header_size = sizeof(trace_record_header);
+		used_ = sizeof(detail::trace_file_header);
+		return ec = boost::system::error_code();
+	}
+
+	/// Whether a trace file is open.
+	bool is_open() const
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return fd_ != -1;
+	}
+
+	/// Append a message; returns false if there is no open file or it could not be extended.
+	bool record(const void* data, std::size_t size, uint16_t stream,
+		uint32_t ppid, sctp_assoc_t assoc_id, int direction)
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+
+		boost::mutex::scoped_lock lock(mutex_);
+		if (fd_ == -1)
+			return false;
+		std::size_t length = detail::trace_record_size(size);
+		boost::system::error_code ec;
+		if (used_ + length > capacity_ && !grow(used_ + length, ec))
+			return false;
+
+		unsigned char* p = static_cast<unsigned char*>(base_) + used_;
+		trace_record_header header;
+		header.timestamp_ns = boost::uint64_t(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+		header.assoc_id = assoc_id;
+		header.ppid = ppid;
+		header.size = static_cast<boost::uint32_t>(size);
+		header.stream = stream;
+		header.direction = static_cast<boost::uint16_t>(direction);
+		std::memcpy(p, &header, sizeof(header));
+		std::memcpy(p + sizeof(header), data, size);
+		used_ += length;
+		++records_;
+		return true;
+	}
+
+	/// Append a received message.
+	bool record(const sctp_message& msg)
+	{
+		return record(msg.data, msg.size, msg.stream, msg.ppid,
+			msg.assoc_id, trace_record_header::inbound);
+	}
+
+	/// Number of records written since the file was opened.
+	std::size_t records() const
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		return records_;
+	}
+
+	/// Unmap the file and trim it to the records written.
+	boost::system::error_code close(boost::system::error_code& ec)
+	{
+		boost::mutex::scoped_lock lock(mutex_);
+		ec = boost::system::error_code();
+		if (fd_ == -1)
+			return ec;
+		if (base_ && ::munmap(base_, capacity_) != 0)
+			ec = last_error();
+		if (::ftruncate(fd_, used_) != 0 && !ec)
+			ec = last_error();
+		if (::close(fd_) != 0 && !ec)
+			ec = last_error();
+		fd_ = -1;
+		base_ = 0;
+		capacity_ = 0;
+		return ec;
+	}
+
+private:
+	static boost::system::error_code last_error()
+	{
+		return boost::system::error_code(errno, boost::asio::error::get_system_category());
+	}
+
+	// Extend the file and its mapping to hold at least the given number of bytes.
+	bool grow(std::size_t needed, boost::system::error_code& ec)
+	{
+		std::size_t capacity = capacity_;
+		while (capacity < needed)
+			capacity += BOOST_ASIO_SCTP_TRACE_CHUNK_SIZE;
+		if (::ftruncate(fd_, capacity) != 0)
+		{
+			ec = last_error();
+			return false;
+		}
+		void* base = ::mmap(0, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+		if (base == MAP_FAILED)
+		{
+			ec = last_error();
+			return false;
+		}
+		if (base_)
+			::munmap(base_, capacity_);
+		base_ = base;
+		capacity_ = capacity;
+		return true;
+	}
+
+	mutable boost::mutex mutex_;
+	int fd_;
+	void* base_;
+	std::size_t capacity_;
+	std::size_t used_;
+	std::size_t records_;
+};
+
+/// Reads the records of a trace file through a read-only mapping.
+/**
+ * @par Example
+ * @code
+ * boost::asio_sctp::trace_reader reader;
+ * reader.open("capture.trace");
+ * const boost::asio_sctp::trace_record_header* header;
+ * const unsigned char* payload;
+ * while (reader.next(header, payload))
+ *   process(*header, payload);
+ * @endcode
+ */
+class trace_reader
+	: private boost::noncopyable
+{
+public:
+	trace_reader()
+		: base_(0), size_(0), offset_(0)
+	{
+	}
+
+	~trace_reader()
+	{
+		close();
+	}
+
+	/// Map a trace file.
+	void open(const char* path)
+	{
+		boost::system::error_code ec;
+		open(path, ec);
+		boost::asio::detail::throw_error(ec, "trace_reader::open");
+	}
+
+	/// Map a trace file.
+	boost::system::error_code open(const char* path, boost::system::error_code& ec)
+	{
+		close();
+		int fd = ::open(path, O_RDONLY);
+		if (fd == -1)
+			return ec = boost::system::error_code(errno, boost::asio::error::get_system_category());
+		struct stat st;
+		void* base = MAP_FAILED;
+		if (::fstat(fd, &st) == 0 && st.st_size >= static_cast<off_t>(sizeof(detail::trace_file_header)))
+			base = ::mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		int error = errno;
+		::close(fd);
+		if (base == MAP_FAILED)
+			return ec = boost::system::error_code(error ? error : EINVAL, boost::asio::error::get_system_category());
+
+		const detail::trace_file_header* header = static_cast<const detail::trace_file_header*>(base);
+		if (std::strncmp(header->magic, detail::trace_file_magic(), sizeof(header->magic)) != 0
+			|| header->version != 1 || header->record_header_size != sizeof(trace_record_header))
+		{
+			::munmap(base, st.st_size);
+			return ec = boost::system::error_code(EINVAL, boost::asio::error::get_system_category());
+		}
+		::madvise(base, st.st_size, MADV_SEQUENTIAL);
+		base_ = static_cast<const unsigned char*>(base);
+		size_ = st.st_size;
+		offset_ = sizeof(detail::trace_file_header);
+		return ec = boost::system::error_code();
+	}
+
+	/// Unmap the file.
+	void close()
+	{
+		if (base_)
+			::munmap(const_cast<unsigned char*>(base_), size_);
+		base_ = 0;
+		size_ = 0;
+		offset_ = 0;
+	}
+
+	/// Fetch the next record; returns false at the end of the trace.
+	/**
+	 * The header and payload point into the mapping and remain valid until
+	 * the reader is closed.
+	 */
+	bool next(const trace_record_header*& header, const unsigned char*& payload)
+	{
+		if (offset_ + sizeof(trace_record_header) > size_)
+			return false;
+		const trace_record_header* h = reinterpret_cast<const trace_record_header*>(base_ + offset_);
+		std::size_t length = detail::trace_record_size(h->size);
+		if (h->timestamp_ns == 0 || offset_ + length > size_)
+			return false;  // unused tail of a trace which was not closed cleanly
+		header = h;
+		payload = base_ + offset_ + sizeof(trace_record_header);
+		offset_ += length;
+		return true;
+	}
+
+	/// Go back to the first record.
+	void rewind()
+	{
+		if (base_)
+			offset_ = sizeof(detail::trace_file_header);
+	}
+
+private:
+	const unsigned char* base_;
+	std::size_t size_;
+	std::size_t offset_;
+};
+
+} // namespace asio_sctp
+} // namespace boost
+
+#include <boost/asio/detail/pop_options.hpp>
+
+#endif // BOOST_ASIO_SCTP_TRACE_FILE_HPP
@@ -0,0 +1,419 @@
+/**
+*	@file
+*
+*	@section Purpose
+*
+*	Replays the inbound messages of a trace recorded by sctp_asio --trace against
+*	an SCTP server, keeping the recorded timing (optionally sped up), streams and
+*	PPIDs.  Each recorded association is replayed on its own client association;
+*	--clones multiplies the number of associations to scale the load up.
+*
+*	Unless --target is given the messages are sent to a sink server running in
+*	the same process over loopback, which reports the latency from send to
+*	complete receipt of each message, and how many messages never arrived.
+*
+*	A --target server reports nothing back per message, so against it there is
+*	no latency measurement and no count of dropped messages: only the send rate,
+*	the lag behind the recorded schedule and the transport's acknowledgement are
+*	reported.  Once everything is sent the replay waits for the target's SCTP
+*	stack to acknowledge every DATA chunk, and reports how long that took after
+*	the last send, or how many chunks were still unacknowledged when it gave up.
+*
+*	--udp uses SCTP over UDP (RFC 6951) instead of the kernel's SCTP; the target
+*	must then be running with --udp too.
+*
+*	Usage: sctp_replay [--speed N | --max] [--clones N] [--target address[:port]] [--udp] trace-file
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include <boost/asio_sctp/ip/sctp.hpp>
+#include <boost/asio_sctp/latency_histogram.hpp>
+#include <boost/asio_sctp/sctp_backend.hpp>
+#include <boost/asio_sctp/sctp_reassembler.hpp>
+#include <boost/asio_sctp/trace_file.hpp>
+
+#define SINK_PORT			54323
+#define RX_BUFFER_SIZE		65536
+#define DRAIN_TIMEOUT_MS	2000
+#define SPIN_THRESHOLD_NS	200000	// sleep until this close to the next message, then spin
+
+using boost::asio_sctp::ip::sctp;
+
+/**
+*	@struct SSinkAssociation
+*	Server end of one replayed association.  The sender queues the send time of
+*	each message per stream, and the receiver matches them off in order.
+*/
+struct SSinkAssociation
+{
+	explicit SSinkAssociation(boost::asio::io_service& IO_Service)
+		: socket(IO_Service)
+	{
+	}
+
+	sctp::socket socket;
+	boost::asio_sctp::sctp_reassembler reassembler;
+	boost::mutex mutex;
+	std::map<boost::uint16_t, std::deque<boost::uint64_t> > sendTimes;
+};
+
+static volatile bool g_Receiving = true;
+static volatile unsigned long g_Received = 0;
+static boost::asio_sctp::latency_histogram g_Latency;
+static boost::asio_sctp::latency_histogram g_Lag;
+
+static boost::uint64_t NowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (boost::uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void WaitUntil(boost::uint64_t due)
+{
+	boost::uint64_t now = NowNs();
+	if(due > now + SPIN_THRESHOLD_NS)
+	{
+		boost::uint64_t sleepNs = due - now - SPIN_THRESHOLD_NS / 2;
+		struct timespec ts = { (time_t)(sleepNs / 1000000000ull), (long)(sleepNs % 1000000000ull) };
+		nanosleep(&ts, NULL);
+	}
+	while(NowNs() < due)
+	{
+	}
+}
+
+/**
+ * Asks the kernel to report each received message's stream and PPID
+ */
+static void SubscribeDataIo(sctp::socket& rSocket)
+{
+	struct sctp_event_subscribe subs;
+	std::memset(&subs, 0, sizeof(subs));
+	subs.sctp_data_io_event = 1;
+	rSocket.set_option(boost::asio_sctp::socket_option::sctp_event_subscribe(subs));
+}
+
+/**
+ * Sink receive loop: polls every server-side association and records the latency
+ * of each complete message
+ */
+static void SinkReceiver(std::vector<SSinkAssociation*>* pAssociations)
+{
+	std::vector<SSinkAssociation*>& associations = *pAssociations;
+	std::vector<struct pollfd> fds(associations.size());
+	for(size_t i = 0; i < associations.size(); ++i)
+	{
+		fds[i].fd = associations[i]->socket.native_handle();
+		fds[i].events = POLLIN;
+	}
+	std::vector<unsigned char> buffer(RX_BUFFER_SIZE);
+
+	while(g_Receiving)
+	{
+		if(::poll(&fds[0], fds.size(), 10) <= 0)
+		{
+			continue;
+		}
+		for(size_t i = 0; i < fds.size(); ++i)
+		{
+			if(!(fds[i].revents & POLLIN))
+			{
+				continue;
+			}
+			SSinkAssociation& assoc = *associations[i];
+			boost::asio_sctp::sctp_receive_info info;
+			boost::system::error_code ec;
+			size_t numBytes = assoc.socket.receive_message(boost::asio::buffer(buffer), MSG_DONTWAIT, info, ec);
+			boost::asio_sctp::sctp_message msg;
+			if(ec || numBytes == 0 || !assoc.reassembler.add(&buffer[0], numBytes, info, msg)
+				|| (info.msg_flags & MSG_NOTIFICATION))
+			{
+				continue;
+			}
+
+			boost::uint64_t sentAt = 0;
+			{
+				boost::mutex::scoped_lock lock(assoc.mutex);
+				std::deque<boost::uint64_t>& pending = assoc.sendTimes[msg.stream];
+				if(!pending.empty())
+				{
+					sentAt = pending.front();
+					pending.pop_front();
+				}
+			}
+			if(sentAt)
+			{
+				g_Latency.record(NowNs() - sentAt);
+			}
+			++g_Received;
+		}
+	}
+}
+
+/**
+ * DATA chunks the peers have yet to acknowledge, queued or in flight, over every client
+ * association
+ */
+static unsigned long Unacknowledged(const std::vector<sctp::socket*>& clients)
+{
+	unsigned long numChunks = 0;
+	for(size_t i = 0; i < clients.size(); ++i)
+	{
+		boost::asio_sctp::socket_option::sctp_status status;
+		boost::system::error_code ec;
+		clients[i]->get_option(status, ec);
+		if(!ec)
+		{
+			numChunks += status.pending_chunks() + status.unacked_chunks();
+		}
+	}
+	return numChunks;
+}
+
+static void Usage(void)
+{
+	std::fprintf(stderr, "usage: sctp_replay [--speed N | --max] [--clones N] [--target address[:port]] [--udp] trace-file\n");
+	std::exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+	double speed = 1.0;  // 0 replays as fast as possible
+	int clones = 1;
+	std::string target;
+	const char* pTraceFile = NULL;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--max") == 0)
+		{
+			speed = 0;
+		}
+		else if(std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc)
+		{
+			speed = std::atof(argv[++i]);
+		}
+		else if(std::strcmp(argv[i], "--clones") == 0 && i + 1 < argc)
+		{
+			clones = std::atoi(argv[++i]);
+		}
+		else if(std::strcmp(argv[i], "--target") == 0 && i + 1 < argc)
+		{
+			target = argv[++i];
+		}
+		else if(std::strcmp(argv[i], "--udp") == 0)
+		{
+			boost::asio_sctp::sctp_backend::use_udp_encapsulation();
+		}
+		else if(argv[i][0] != '-' && !pTraceFile)
+		{
+			pTraceFile = argv[i];
+		}
+		else
+		{
+			Usage();
+		}
+	}
+	if(!pTraceFile || clones < 1 || speed < 0)
+	{
+		Usage();
+	}
+
+	// Number the recorded associations which have inbound traffic
+	boost::asio_sctp::trace_reader reader;
+	reader.open(pTraceFile);
+	std::map<boost::int32_t, size_t> recordedAssociations;
+	size_t numRecords = 0;
+	const boost::asio_sctp::trace_record_header* pHeader;
+	const unsigned char* pPayload;
+	while(reader.next(pHeader, pPayload))
+	{
+		if(pHeader->direction == boost::asio_sctp::trace_record_header::inbound)
+		{
+			recordedAssociations.insert(std::make_pair(pHeader->assoc_id, recordedAssociations.size()));
+			++numRecords;
+		}
+	}
+	if(numRecords == 0)
+	{
+		std::fprintf(stderr, "%s: no inbound messages\n", pTraceFile);
+		return 1;
+	}
+	const size_t numAssociations = recordedAssociations.size() * clones;
+
+	boost::asio::io_service ioService;
+	sctp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), SINK_PORT);
+	if(!target.empty())
+	{
+		std::string::size_type colon = target.rfind(':');
+		endpoint.address(boost::asio::ip::address::from_string(target.substr(0, colon)));
+		endpoint.port(colon == std::string::npos ? SINK_PORT : std::atoi(target.substr(colon + 1).c_str()));
+	}
+
+	boost::scoped_ptr<sctp::acceptor> pAcceptor;
+	if(target.empty())
+	{
+		pAcceptor.reset(new sctp::acceptor(ioService, endpoint, true));
+	}
+
+	// Connect one at a time so that client and sink associations pair up by index
+	std::vector<sctp::socket*> clients;
+	std::vector<SSinkAssociation*> sinks;
+	for(size_t i = 0; i < numAssociations; ++i)
+	{
+		clients.push_back(new sctp::socket(ioService));
+		clients.back()->connect(endpoint);
+		clients.back()->set_option(sctp::no_delay(true));
+		if(pAcceptor.get())
+		{
+			sinks.push_back(new SSinkAssociation(ioService));
+			pAcceptor->accept(sinks.back()->socket);
+			SubscribeDataIo(sinks.back()->socket);  // so that each message's stream is reported
+		}
+	}
+	boost::thread receiver;
+	if(!sinks.empty())
+	{
+		receiver = boost::thread(boost::bind(SinkReceiver, &sinks));
+	}
+
+	if(speed == 0)
+	{
+		std::printf("replaying %lu messages on %lu associations at maximum rate\n",
+				(unsigned long)numRecords, (unsigned long)numAssociations);
+	}
+	else
+	{
+		std::printf("replaying %lu messages on %lu associations at %gx recorded rate\n",
+				(unsigned long)numRecords, (unsigned long)numAssociations, speed);
+	}
+
+	unsigned long numSent = 0;
+	unsigned long numFailed = 0;
+	boost::uint64_t numBytes = 0;
+	boost::uint64_t firstRecordNs = 0;
+	boost::uint64_t startNs = NowNs();
+	reader.rewind();
+	while(reader.next(pHeader, pPayload))
+	{
+		if(pHeader->direction != boost::asio_sctp::trace_record_header::inbound)
+		{
+			continue;
+		}
+		if(firstRecordNs == 0)
+		{
+			firstRecordNs = pHeader->timestamp_ns;
+		}
+		if(speed != 0)
+		{
+			boost::uint64_t due = startNs + (boost::uint64_t)((pHeader->timestamp_ns - firstRecordNs) / speed);
+			WaitUntil(due);
+			g_Lag.record(NowNs() - due);
+		}
+
+		boost::asio_sctp::sctp_outbound_message msg;
+		msg.buffer = boost::asio::const_buffer(pPayload, pHeader->size);
+		msg.stream = htons(pHeader->stream);
+		msg.ppid = htonl(pHeader->ppid);
+		msg.flags = 0;
+		msg.time_to_live = 0;
+
+		size_t first = recordedAssociations[pHeader->assoc_id];
+		for(size_t i = first; i < numAssociations; i += recordedAssociations.size())
+		{
+			if(!sinks.empty())
+			{
+				boost::mutex::scoped_lock lock(sinks[i]->mutex);
+				sinks[i]->sendTimes[htons(pHeader->stream)].push_back(NowNs());
+			}
+			boost::system::error_code ec;
+			if(clients[i]->send_batch(&msg, &msg + 1, ec) == 1)
+			{
+				++numSent;
+				numBytes += pHeader->size;
+			}
+			else
+			{
+				++numFailed;
+				if(!sinks.empty())
+				{
+					boost::mutex::scoped_lock lock(sinks[i]->mutex);
+					sinks[i]->sendTimes[htons(pHeader->stream)].pop_back();
+				}
+			}
+		}
+	}
+	double elapsed = (NowNs() - startNs) / 1e9;
+
+	// Give the sink time to receive whatever is still in flight
+	boost::uint64_t drainUntil = NowNs() + DRAIN_TIMEOUT_MS * 1000000ull;
+	while(!sinks.empty() && g_Received < numSent && NowNs() < drainUntil)
+	{
+		boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+	}
+	g_Receiving = false;
+	receiver.join();
+
+	// Without a sink, all there is to wait for is the target's acknowledgement
+	unsigned long numUnacked = 0;
+	boost::uint64_t sentNs = NowNs();
+	if(sinks.empty())
+	{
+		while((numUnacked = Unacknowledged(clients)) != 0 && NowNs() < drainUntil)
+		{
+			boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+		}
+	}
+	double ackDelay = (NowNs() - sentNs) / 1e6;
+
+	std::printf("sent %lu messages (%.1f MB) in %.2f s: %.0f msg/s, %lu send failures\n",
+			numSent, numBytes / 1e6, elapsed, numSent / elapsed, numFailed);
+	if(speed != 0)
+	{
+		std::printf("send lag behind schedule (us): p50=%.1f p99=%.1f max=%.1f\n",
+				g_Lag.percentile(50) / 1000.0, g_Lag.percentile(99) / 1000.0, g_Lag.max() / 1000.0);
+	}
+	if(sinks.empty() && numUnacked == 0)
+	{
+		std::printf("target acknowledged every DATA chunk %.1f ms after the last send (no per-message latency or drops against --target)\n",
+				ackDelay);
+	}
+	else if(sinks.empty())
+	{
+		std::printf("%lu DATA chunks still unacknowledged by the target after %d ms (no per-message latency or drops against --target)\n",
+				numUnacked, DRAIN_TIMEOUT_MS);
+	}
+	else
+	{
+		std::printf("received %lu messages, %lu dropped\n", (unsigned long)g_Received, numSent - g_Received);
+		std::printf("server latency (us): p50=%.1f p90=%.1f p99=%.1f p99.9=%.1f max=%.1f\n",
+				g_Latency.percentile(50) / 1000.0,
+				g_Latency.percentile(90) / 1000.0,
+				g_Latency.percentile(99) / 1000.0,
+				g_Latency.percentile(99.9) / 1000.0,
+				g_Latency.max() / 1000.0);
+	}
+
+	for(size_t i = 0; i < clients.size(); ++i)
+	{
+		clients[i]->close();
+		delete clients[i];
+	}
+	for(size_t i = 0; i < sinks.size(); ++i)
+	{
+		delete sinks[i];
+	}
+	return 0;
+}
@@ -1,4 +1,7 @@
+#include <cstdlib>
+#include <cstring>
 #include <boost/thread.hpp>
+#include <boost/asio_sctp/sctp_backend.hpp>
 
 #include "SctpServer.h"
 
@@ -16,16 +19,86 @@ void RunIoService(void)
 
 int main(int argc, char* argv[])
 {
+	const char* pTraceFile = NULL;
+	const char* pTuneProfile = NULL;
+	const char* pHandoverPath = NULL;
+	const char* pBindAddress = NULL;
+	const char* pPromoteMbps = NULL;
+	const char* pNumWorkers = NULL;
+	for(int i = 1; i < argc; ++i)
+	{
+		if((std::strcmp(argv[i], "--trace") == 0) && (i + 1 < argc))
+		{
+			pTraceFile = argv[++i];
+		}
+		else if((std::strcmp(argv[i], "--tune") == 0) && (i + 1 < argc))
+		{
+			pTuneProfile = argv[++i];  // "lan" or "backhaul"
+		}
+		else if((std::strcmp(argv[i], "--handover") == 0) && (i + 1 < argc))
+		{
+			pHandoverPath = argv[++i];  // take over from the server running there, and let the next one take over from us
+		}
+		else if((std::strcmp(argv[i], "--bind") == 0) && (i + 1 < argc))
+		{
+			pBindAddress = argv[++i];  // listen on one address rather than all of them
+		}
+		else if((std::strcmp(argv[i], "--asconf") == 0) && (i + 1 < argc))
+		{
+			pPromoteMbps = argv[++i];  // follow local address changes; promote new links of at least this many Mb/s, 0 for none
+		}
+		else if((std::strcmp(argv[i], "--workers") == 0) && (i + 1 < argc))
+		{
+			pNumWorkers = argv[++i];  // process received messages on this many threads, in order within each stream
+		}
+		else if(std::strcmp(argv[i], "--udp") == 0)
+		{
+			boost::asio_sctp::sctp_backend::use_udp_encapsulation();  // SCTP over UDP, for hosts without kernel SCTP
+		}
+	}
+
 	boost::thread IoServiceThread(RunIoService);
 
-	CSctpServer myServer(g_IO_Service, boost::asio::ip::address_v4::any() );
+	CSctpServer myServer(g_IO_Service, pBindAddress ? boost::asio::ip::address::from_string(pBindAddress)
+			: boost::asio::ip::address(boost::asio::ip::address_v4::any()), pHandoverPath);
+
+	if(pTraceFile)
+	{
+		myServer.StartTrace(pTraceFile);  // capture traffic for later replay with sctp_replay
+	}
+
+	if(pTuneProfile)
+	{
+		myServer.SetTuningProfile((std::strcmp(pTuneProfile, "lan") == 0)
+				? boost::asio_sctp::sctp_tuning_profile::lan()
+				: boost::asio_sctp::sctp_tuning_profile::backhaul());
+	}
+
+	if(pNumWorkers)
+	{
+		myServer.SetReceiveWorkers(std::strtoul(pNumWorkers, NULL, 10));
+	}
+
+	if(pPromoteMbps)
+	{
+		myServer.WatchAddresses(std::strtoul(pPromoteMbps, NULL, 10));
+	}
 
 	myServer.StartAccept();
 
+	if(pHandoverPath)
+	{
+		myServer.ListenForHandover(pHandoverPath);
+	}
+
 	do
 	{
 		boost::this_thread::sleep(boost::posix_time::milliseconds(200));
 	}
-	while(1);
+	while(!myServer.IsRetired());  // a successor has taken over and every connection has drained
+
+	g_IO_Service.stop();
+	IoServiceThread.join();
+	return 0;
 }
 
@@ -0,0 +1,341 @@
+/**
+*	@file
+*
+*	@section Purpose
+*
+*	Checks that an sctp_emulator's virtual time is the library's clock: a
+*	timer_wheel ticks only as the emulator's clock is advanced, and an
+*	sctp_send_queue drops a message whose deadline has passed on that clock
+*	while the one queued behind it is delivered over an emulated association
+*	after the link's delay.  Then, with the generator's seed fixed, each of
+*	the emulator's link conditions and events gives exactly the counts it did
+*	when the test was written: retransmissions under loss, arrivals spread by
+*	jitter with ordered messages held back, messages passed on in pieces of
+*	fragment_size, path change notifications to every end, and aborts, both
+*	after too many losses and on request.  Nothing here waits in real time, so
+*	every run gives the same result on any Linux box.
+*
+*	Usage: test_emulator
+*
+*	Exits with 0 if every check passed.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <boost/bind.hpp>
+
+#include <boost/asio_sctp/ip/sctp.hpp>
+#include <boost/asio_sctp/sctp_backend.hpp>
+#include <boost/asio_sctp/sctp_clock.hpp>
+#include <boost/asio_sctp/sctp_emulator.hpp>
+#include <boost/asio_sctp/sctp_send_queue.hpp>
+#include <boost/asio_sctp/timer_wheel.hpp>
+
+#define TEST_PORT			54330
+#define LINK_DELAY_MS		20
+#define TICK_MS				10
+#define TIMER_TICKS			5
+#define DEADLINE_MS			30
+#define MESSAGE_STREAM		3
+#define MESSAGE_PPID		42
+
+#define SEED				42
+#define LOSS_PORT			54331
+#define JITTER_PORT			54332
+#define FRAGMENT_PORT		54333
+#define ABORT_PORT			54334
+#define LOSS_RATE			0.2
+#define RTO_MS				100
+#define MAX_RETRANSMITS		10
+#define LOSS_MESSAGES		100
+#define LOSS_RETRANSMISSIONS	26	// drawn by the generator seeded with SEED
+#define JITTER_DELAY_MS		10
+#define JITTER_MS			40
+#define JITTER_MESSAGES		20	// per stream
+#define JITTER_UNORDERED_STREAM	1
+#define JITTER_ORDERED_STREAM	2
+#define JITTER_CHECK_MS		30	// after sending, when the arrivals so far are counted...
+#define JITTER_UNORDERED_BY_CHECK	9	// ...giving this many unordered messages for SEED...
+#define JITTER_ORDERED_BY_CHECK	0	// ...and ordered ones, held behind the latest before them
+#define FRAGMENT_SIZE		100
+#define BIG_MESSAGE_SIZE	1000
+#define ABORT_RETRANSMITS	3
+
+using boost::asio_sctp::ip::sctp;
+
+static int g_Failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+	std::printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+	if(!ok)
+	{
+		++g_Failures;
+	}
+}
+
+static void OnTimer(bool* pFired)
+{
+	*pFired = true;
+}
+
+/* Connects client to an acceptor on port, accepting the association as server */
+static void Connect(boost::asio::io_service& ioService, unsigned short port, sctp::socket& client, sctp::socket& server)
+{
+	sctp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port);
+	sctp::acceptor acceptor(ioService, endpoint);
+	client.connect(endpoint);
+	acceptor.accept(server);
+}
+
+static void SendSeq(sctp::socket& rSocket, boost::uint16_t stream, boost::uint16_t flags, const boost::uint32_t& seq)
+{
+	boost::asio_sctp::sctp_outbound_message msg;
+	msg.buffer = boost::asio::const_buffer(&seq, sizeof(seq));
+	msg.stream = stream;
+	msg.ppid = MESSAGE_PPID;
+	msg.flags = flags;
+	msg.time_to_live = 0;
+	rSocket.send_batch(&msg, &msg + 1);
+}
+
+/* Reads one message or piece without waiting; returns false if nothing was waiting */
+static bool Receive(sctp::socket& rSocket, std::vector<unsigned char>& rData, boost::asio_sctp::sctp_receive_info& rInfo)
+{
+	rData.resize(BIG_MESSAGE_SIZE);
+	boost::system::error_code ec;
+	size_t numBytes = rSocket.receive_message(boost::asio::buffer(rData), MSG_DONTWAIT, rInfo, ec);
+	rData.resize(ec ? 0 : numBytes);
+	return !ec;
+}
+
+/* Reads the sequence numbers waiting on a socket, counting them per stream and noting the streams which arrived out of order */
+static void ReceiveSeqs(sctp::socket& rSocket, std::vector<boost::uint32_t>& rCounts, std::vector<bool>& rReordered)
+{
+	std::vector<unsigned char> data;
+	boost::asio_sctp::sctp_receive_info info;
+	while(Receive(rSocket, data, info) && data.size() == sizeof(boost::uint32_t))
+	{
+		boost::uint32_t seq;
+		std::memcpy(&seq, &data[0], sizeof(seq));
+		if(info.stream >= rCounts.size())
+		{
+			rCounts.resize(info.stream + 1, 0);
+			rReordered.resize(info.stream + 1, false);
+		}
+		if(seq != rCounts[info.stream]++)
+		{
+			rReordered[info.stream] = true;
+		}
+	}
+}
+
+/* Whether the next message waiting on a socket is a peer address change to SCTP_ADDR_UNREACHABLE */
+static bool ReceiveUnreachable(sctp::socket& rSocket)
+{
+	std::vector<unsigned char> data;
+	boost::asio_sctp::sctp_receive_info info;
+	if(!Receive(rSocket, data, info) || !(info.msg_flags & MSG_NOTIFICATION) || (data.size() < sizeof(struct sctp_paddr_change)))
+	{
+		return false;
+	}
+	const struct sctp_paddr_change* pChange = reinterpret_cast<const struct sctp_paddr_change*>(&data[0]);
+	return (pChange->spc_type == SCTP_PEER_ADDR_CHANGE) && (pChange->spc_state == SCTP_ADDR_UNREACHABLE);
+}
+
+/* Whether the next message waiting on a socket is an association change to SCTP_COMM_LOST, followed by end of file */
+static bool ReceiveCommLost(sctp::socket& rSocket)
+{
+	std::vector<unsigned char> data;
+	boost::asio_sctp::sctp_receive_info info;
+	bool lost = Receive(rSocket, data, info) && (info.msg_flags & MSG_NOTIFICATION)
+		&& (data.size() >= sizeof(struct sctp_assoc_change))
+		&& (reinterpret_cast<const struct sctp_assoc_change*>(&data[0])->sac_state == SCTP_COMM_LOST);
+	return lost && Receive(rSocket, data, info) && data.empty();
+}
+
+int main()
+{
+	boost::asio_sctp::sctp_emulator emulator(SEED);
+	boost::asio_sctp::sctp_link_conditions link;
+	link.delay_ms = LINK_DELAY_MS;
+	emulator.set_conditions(link);
+	boost::asio_sctp::sctp_backend::use_emulator(emulator);
+
+	Check(boost::asio_sctp::sctp_clock::now_ms() == 0, "the clock starts at the emulator's time");
+	emulator.advance(5);
+	Check(boost::asio_sctp::sctp_clock::now_ms() == 5, "the clock moves only with the emulator");
+
+	// The timer wheel ticks on the virtual clock.
+	boost::asio::io_service ioService;
+	bool fired = false;
+	boost::asio_sctp::timer_wheel wheel(ioService, boost::posix_time::milliseconds(TICK_MS));
+	boost::asio_sctp::timer_wheel_entry entry(boost::bind(OnTimer, &fired));
+	wheel.arm(entry, TIMER_TICKS);
+	wheel.start();
+	ioService.poll();
+	Check(!fired && wheel.now() == 0, "the wheel does not tick in real time");
+	emulator.advance((TIMER_TICKS - 1) * TICK_MS);
+	ioService.poll();
+	Check(!fired && wheel.now() == TIMER_TICKS - 1, "the wheel follows the virtual clock");
+	emulator.advance(TICK_MS);
+	ioService.poll();
+	Check(fired, "an entry expires once the virtual clock has passed it");
+	wheel.stop();
+
+	// Send queue deadlines are measured on the virtual clock too.
+	sctp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), TEST_PORT);
+	sctp::acceptor acceptor(ioService, endpoint);
+	sctp::socket client(ioService);
+	sctp::socket server(ioService);
+	client.connect(endpoint);
+	acceptor.accept(server);
+
+	boost::asio_sctp::sctp_send_queue<sctp::socket> queue(client);
+	Check(queue.now_ms() == emulator.now(), "the send queue reads the virtual clock");
+	const char late[] = "late";
+	const char onTime[] = "on time";
+	queue.push_until(queue.now_ms() + DEADLINE_MS, late, sizeof(late), MESSAGE_STREAM, MESSAGE_PPID);
+	queue.push(onTime, sizeof(onTime), MESSAGE_STREAM, MESSAGE_PPID);
+	emulator.advance(DEADLINE_MS + 1);  // before the queue has had a chance to flush
+	ioService.poll();
+	Check(queue.expired() == 1, "a message past its deadline on the virtual clock is dropped");
+
+	emulator.advance(LINK_DELAY_MS - 1);
+	char buffer[64];
+	boost::asio_sctp::sctp_receive_info info;
+	boost::system::error_code ec;
+	server.receive_message(boost::asio::buffer(buffer), MSG_DONTWAIT, info, ec);
+	Check(ec == boost::asio::error::would_block, "nothing arrives before the link delay");
+	emulator.advance(1);
+	size_t numBytes = server.receive_message(boost::asio::buffer(buffer), MSG_DONTWAIT, info, ec);
+	Check(!ec && numBytes == sizeof(onTime) && std::memcmp(buffer, onTime, sizeof(onTime)) == 0
+		&& info.stream == MESSAGE_STREAM && info.ppid == MESSAGE_PPID,
+		"the message behind it arrives after the link delay, with its stream and PPID");
+	Check(emulator.statistics().messages_delivered == 1, "only that message was sent");
+
+	// Loss: each loss delays the message by the RTO, and the stream waits behind it.
+	boost::asio_sctp::sctp_link_conditions lossy;
+	lossy.delay_ms = LINK_DELAY_MS;
+	lossy.loss = LOSS_RATE;
+	lossy.rto_ms = RTO_MS;
+	lossy.max_retransmits = MAX_RETRANSMITS;
+	emulator.set_conditions(LOSS_PORT, lossy);
+	sctp::socket lossClient(ioService);
+	sctp::socket lossServer(ioService);
+	Connect(ioService, LOSS_PORT, lossClient, lossServer);
+	for(boost::uint32_t seq = 0; seq < LOSS_MESSAGES; ++seq)
+	{
+		SendSeq(lossClient, 0, 0, seq);
+	}
+	boost::asio_sctp::sctp_emulator_statistics before = emulator.statistics();
+	emulator.settle();
+	std::vector<boost::uint32_t> counts;
+	std::vector<bool> reordered;
+	ReceiveSeqs(lossServer, counts, reordered);
+	boost::asio_sctp::sctp_emulator_statistics after = emulator.statistics();
+	Check(after.retransmissions - before.retransmissions == LOSS_RETRANSMISSIONS,
+		"the seeded generator loses the same transmissions on every run");
+	Check(counts.size() == 1 && counts[0] == LOSS_MESSAGES && !reordered[0]
+		&& after.messages_delivered - before.messages_delivered == LOSS_MESSAGES && after.aborted == 0,
+		"every message arrives once, in order, despite the losses");
+
+	// Jitter: unordered messages overtake each other, ordered ones never do.
+	boost::asio_sctp::sctp_link_conditions jittery;
+	jittery.delay_ms = JITTER_DELAY_MS;
+	jittery.jitter_ms = JITTER_MS;
+	emulator.set_conditions(JITTER_PORT, jittery);
+	sctp::socket jitterClient(ioService);
+	sctp::socket jitterServer(ioService);
+	Connect(ioService, JITTER_PORT, jitterClient, jitterServer);
+	for(boost::uint32_t seq = 0; seq < JITTER_MESSAGES; ++seq)
+	{
+		SendSeq(jitterClient, JITTER_UNORDERED_STREAM, SCTP_UNORDERED, seq);
+		SendSeq(jitterClient, JITTER_ORDERED_STREAM, 0, seq);
+	}
+	emulator.poll();
+	emulator.advance(JITTER_DELAY_MS - 1);
+	counts.assign(JITTER_ORDERED_STREAM + 1, 0);
+	reordered.assign(JITTER_ORDERED_STREAM + 1, false);
+	ReceiveSeqs(jitterServer, counts, reordered);
+	Check(counts[JITTER_UNORDERED_STREAM] == 0 && counts[JITTER_ORDERED_STREAM] == 0,
+		"nothing arrives before the delay, whatever the jitter");
+	emulator.advance(JITTER_CHECK_MS - (JITTER_DELAY_MS - 1));
+	ReceiveSeqs(jitterServer, counts, reordered);
+	Check(counts[JITTER_UNORDERED_STREAM] == JITTER_UNORDERED_BY_CHECK && counts[JITTER_ORDERED_STREAM] == JITTER_ORDERED_BY_CHECK,
+		"the seeded jitter delivers the same messages by a given time on every run");
+	emulator.advance(JITTER_DELAY_MS + JITTER_MS - JITTER_CHECK_MS);
+	ReceiveSeqs(jitterServer, counts, reordered);
+	Check(counts[JITTER_UNORDERED_STREAM] == JITTER_MESSAGES && counts[JITTER_ORDERED_STREAM] == JITTER_MESSAGES,
+		"everything arrives within the delay plus the jitter");
+	Check(reordered[JITTER_UNORDERED_STREAM] && !reordered[JITTER_ORDERED_STREAM],
+		"unordered messages overtake each other while ordered ones keep their order");
+
+	// Fragment size: a message is passed on in pieces, the last marked as its end.
+	boost::asio_sctp::sctp_link_conditions fragmenting;
+	fragmenting.fragment_size = FRAGMENT_SIZE;
+	emulator.set_conditions(FRAGMENT_PORT, fragmenting);
+	sctp::socket fragmentClient(ioService);
+	sctp::socket fragmentServer(ioService);
+	Connect(ioService, FRAGMENT_PORT, fragmentClient, fragmentServer);
+	std::vector<unsigned char> big(BIG_MESSAGE_SIZE);
+	for(size_t i = 0; i < big.size(); ++i)
+	{
+		big[i] = (unsigned char)(i * 7);
+	}
+	boost::asio_sctp::sctp_outbound_message bigMessage;
+	bigMessage.buffer = boost::asio::const_buffer(&big[0], big.size());
+	bigMessage.stream = MESSAGE_STREAM;
+	bigMessage.ppid = MESSAGE_PPID;
+	bigMessage.flags = 0;
+	bigMessage.time_to_live = 0;
+	fragmentClient.send_batch(&bigMessage, &bigMessage + 1);
+	emulator.poll();
+	{
+		std::vector<unsigned char> data;
+		std::vector<unsigned char> whole;
+		boost::asio_sctp::sctp_receive_info info;
+		size_t numPieces = 0;
+		size_t numEnds = 0;
+		bool small = true;
+		while(Receive(fragmentServer, data, info))
+		{
+			++numPieces;
+			small = small && (data.size() <= FRAGMENT_SIZE);
+			numEnds += (info.msg_flags & MSG_EOR) ? 1 : 0;
+			whole.insert(whole.end(), data.begin(), data.end());
+		}
+		Check(numPieces == BIG_MESSAGE_SIZE / FRAGMENT_SIZE && small && numEnds == 1 && (info.msg_flags & MSG_EOR),
+			"a message arrives in pieces of fragment_size, only the last marked as the end");
+		Check(whole == big, "the pieces make up the message");
+	}
+
+	// Path change: every end whose peer is at the address is told.
+	size_t numOpen = emulator.associations();
+	Check(emulator.notify_path_change(boost::asio::ip::address_v4::loopback(), SCTP_ADDR_UNREACHABLE) == 2 * numOpen
+		&& numOpen == 4, "a path change is queued for both ends of every association with the peer");
+	Check(ReceiveUnreachable(fragmentServer) && ReceiveUnreachable(fragmentClient),
+		"each end reads it as an SCTP_PEER_ADDR_CHANGE notification");
+
+	// Abort after too many losses of one message.
+	boost::asio_sctp::sctp_link_conditions dead;
+	dead.loss = 1.0;
+	dead.max_retransmits = ABORT_RETRANSMITS;
+	emulator.set_conditions(ABORT_PORT, dead);
+	sctp::socket abortClient(ioService);
+	sctp::socket abortServer(ioService);
+	Connect(ioService, ABORT_PORT, abortClient, abortServer);
+	SendSeq(abortClient, 0, 0, 0);
+	emulator.poll();
+	Check(ReceiveCommLost(abortClient), "after max_retransmits losses the sender is told SCTP_COMM_LOST, then sees end of file");
+	Check(emulator.statistics().aborted == 1 && emulator.associations() == numOpen, "the association is aborted and counted");
+
+	// Abort on request, as when every path to the peer fails.
+	Check(emulator.abort(boost::asio::ip::address_v4::loopback()) == numOpen && emulator.associations() == 0
+		&& emulator.statistics().aborted == numOpen + 1, "abort() ends every association with the peer");
+	Check(ReceiveCommLost(fragmentServer) && ReceiveCommLost(fragmentClient), "both ends are told SCTP_COMM_LOST, then see end of file");
+
+	std::printf("%s\n", g_Failures ? "FAILED" : "passed");
+	return g_Failures ? 1 : 0;
+}
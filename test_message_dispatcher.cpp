@@ -0,0 +1,142 @@
+/**
+*	@file
+*
+*	@section Purpose
+*
+*	Checks how message_dispatcher routes received messages: by message type and
+*	class, by PPID and by stream range, the first matching rule winning; and
+*	that messages no rule matches, of a type no rule names, or too short to
+*	carry a header go to the fallback, with dispatch() returning false.
+*
+*	Usage: test_message_dispatcher
+*
+*	Exits with 0 if every check passed.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <boost/cstdint.hpp>
+#include <boost/mpl/vector.hpp>
+
+#include <boost/asio_sctp/message_dispatcher.hpp>
+
+#define TYPE_ATTACH			0x01
+#define TYPE_DETACH			0x05
+#define TYPE_UNKNOWN		0x7F
+#define CLASS_MOBILITY		0x02
+#define CLASS_OTHER			0x03
+#define PPID_S1AP			46
+#define PPID_X2AP			27
+#define PPID_OTHER			99
+#define FIRST_STREAM		1
+#define LAST_STREAM			3
+
+/* Which handler a message reached */
+enum EHandled
+{
+	HANDLED_NONE,
+	HANDLED_ATTACH_MOBILITY,
+	HANDLED_ATTACH_STREAMS,
+	HANDLED_ATTACH_ANY,
+	HANDLED_DETACH_X2AP,
+	HANDLED_FALLBACK
+};
+
+struct SContext
+{
+	EHandled handled;
+	int calls;
+};
+
+template <EHandled Which>
+struct Record
+{
+	static void handle(SContext& ctx, const boost::asio_sctp::sctp_message&)
+	{
+		ctx.handled = Which;
+		++ctx.calls;
+	}
+};
+
+typedef boost::mpl::vector<
+	boost::asio_sctp::dispatch_rule<Record<HANDLED_ATTACH_MOBILITY>, TYPE_ATTACH, CLASS_MOBILITY, PPID_S1AP>,
+	boost::asio_sctp::dispatch_rule<Record<HANDLED_ATTACH_STREAMS>, TYPE_ATTACH,
+		boost::asio_sctp::any_message_class, PPID_S1AP, FIRST_STREAM, LAST_STREAM>,
+	boost::asio_sctp::dispatch_rule<Record<HANDLED_ATTACH_ANY>, TYPE_ATTACH>,
+	boost::asio_sctp::dispatch_rule<Record<HANDLED_DETACH_X2AP>, TYPE_DETACH,
+		boost::asio_sctp::any_message_class, PPID_X2AP>
+> Rules;
+
+typedef boost::asio_sctp::message_dispatcher<SContext, Rules,
+		boost::asio_sctp::default_header_layout, Record<HANDLED_FALLBACK> > Dispatcher;
+typedef boost::asio_sctp::message_dispatcher<SContext, Rules> SilentDispatcher;
+
+static int g_Failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+	std::printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+	if(!ok)
+	{
+		++g_Failures;
+	}
+}
+
+/* Dispatches a message with a default_header_layout header and reports which handler took it */
+template <typename D>
+static EHandled Dispatch(unsigned type, unsigned msgClass, boost::uint32_t ppid, boost::uint16_t stream,
+		bool* pMatched = NULL, size_t size = 4)
+{
+	unsigned char header[4] = { 1, 0, (unsigned char)msgClass, (unsigned char)type };
+	boost::asio_sctp::sctp_message msg;
+	std::memset(&msg, 0, sizeof(msg));
+	msg.data = header;
+	msg.size = size;
+	msg.stream = stream;
+	msg.ppid = ppid;
+
+	SContext ctx = { HANDLED_NONE, 0 };
+	bool matched = D::dispatch(ctx, msg);
+	if(pMatched)
+	{
+		*pMatched = matched;
+	}
+	return ctx.calls <= 1 ? ctx.handled : HANDLED_NONE;  // no message is handled twice
+}
+
+int main()
+{
+	bool matched = false;
+
+	Check(Dispatch<Dispatcher>(TYPE_ATTACH, CLASS_MOBILITY, PPID_S1AP, 0, &matched) == HANDLED_ATTACH_MOBILITY && matched,
+		"type, class and PPID select a rule");
+	Check(Dispatch<Dispatcher>(TYPE_ATTACH, CLASS_MOBILITY, PPID_S1AP, FIRST_STREAM) == HANDLED_ATTACH_MOBILITY,
+		"the first matching rule wins");
+	Check(Dispatch<Dispatcher>(TYPE_ATTACH, CLASS_OTHER, PPID_S1AP, FIRST_STREAM) == HANDLED_ATTACH_STREAMS
+		&& Dispatch<Dispatcher>(TYPE_ATTACH, CLASS_OTHER, PPID_S1AP, LAST_STREAM) == HANDLED_ATTACH_STREAMS,
+		"a stream range includes both its ends");
+	Check(Dispatch<Dispatcher>(TYPE_ATTACH, CLASS_OTHER, PPID_S1AP, LAST_STREAM + 1) == HANDLED_ATTACH_ANY
+		&& Dispatch<Dispatcher>(TYPE_ATTACH, CLASS_OTHER, PPID_S1AP, 0) == HANDLED_ATTACH_ANY,
+		"a stream outside the range falls through to the next rule");
+	Check(Dispatch<Dispatcher>(TYPE_ATTACH, CLASS_MOBILITY, PPID_OTHER, 0) == HANDLED_ATTACH_ANY,
+		"another PPID falls through to the next rule");
+	Check(Dispatch<Dispatcher>(TYPE_DETACH, CLASS_OTHER, PPID_X2AP, 0xffff, &matched) == HANDLED_DETACH_X2AP && matched,
+		"a rule with only a type and PPID takes any class and stream");
+
+	Check(Dispatch<Dispatcher>(TYPE_DETACH, CLASS_OTHER, PPID_S1AP, 0, &matched) == HANDLED_FALLBACK && !matched,
+		"a message matching no rule for its type goes to the fallback");
+	Check(Dispatch<Dispatcher>(TYPE_UNKNOWN, CLASS_MOBILITY, PPID_S1AP, 0, &matched) == HANDLED_FALLBACK && !matched,
+		"a type no rule names goes to the fallback");
+	Check(Dispatch<Dispatcher>(0xFF, CLASS_MOBILITY, PPID_S1AP, 0, &matched) == HANDLED_FALLBACK && !matched,
+		"the last slot of the table goes to the fallback");
+	Check(Dispatch<Dispatcher>(TYPE_ATTACH, CLASS_MOBILITY, PPID_S1AP, 0, &matched, 3) == HANDLED_FALLBACK && !matched,
+		"a message shorter than the header goes to the fallback");
+
+	Check(Dispatch<SilentDispatcher>(TYPE_UNKNOWN, CLASS_MOBILITY, PPID_S1AP, 0, &matched) == HANDLED_NONE && !matched,
+		"ignore_unhandled discards an unmatched message");
+	Check(Dispatch<SilentDispatcher>(TYPE_ATTACH, CLASS_MOBILITY, PPID_S1AP, 0, &matched) == HANDLED_ATTACH_MOBILITY && matched,
+		"the fallback does not change how matched messages are routed");
+
+	std::printf("%s\n", g_Failures ? "FAILED" : "passed");
+	return g_Failures ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+/**
+*	@file
+*
+*	@section Purpose
+*
+*	Checks the behaviour of sctp_receive_scheduler with one association
+*	flooding and others sending a message now and then, as femtocells do:
+*	messages within an association's allowance are handled as they are
+*	offered, without being parked; the flood's excess is parked and handed
+*	out in order; a full queue makes offer() hand out parked messages rather
+*	than drop any; and dispatch() shares its budget fairly.
+*
+*	Usage: test_receive_scheduler
+*
+*	Exits with 0 if every check passed.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <boost/cstdint.hpp>
+
+#include <boost/asio_sctp/sctp_receive_scheduler.hpp>
+
+#define QUANTUM				1024
+#define MAX_PER_ROUND		4
+#define MAX_QUEUED			8
+#define MESSAGE_SIZE		100
+#define FLOODER				1
+#define QUIET				2
+
+typedef boost::asio_sctp::sctp_receive_scheduler<sctp_assoc_t> Scheduler;
+
+static int g_Failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+	std::printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+	if(!ok)
+	{
+		++g_Failures;
+	}
+}
+
+/* Records what the handler was given, in order */
+struct SHandled
+{
+	sctp_assoc_t assocId;
+	boost::uint32_t seq;
+};
+
+static std::vector<SHandled> g_Handled;
+
+static void Handle(const sctp_assoc_t& key, const boost::asio_sctp::sctp_message& msg)
+{
+	SHandled h;
+	h.assocId = key;
+	std::memcpy(&h.seq, msg.data, sizeof(h.seq));
+	g_Handled.push_back(h);
+}
+
+static void Offer(Scheduler& scheduler, sctp_assoc_t assocId, boost::uint32_t seq)
+{
+	unsigned char data[MESSAGE_SIZE] = {0};
+	std::memcpy(data, &seq, sizeof(seq));
+	boost::asio_sctp::sctp_message msg;
+	msg.data = data;
+	msg.size = sizeof(data);
+	msg.stream = 0;
+	msg.ppid = 0;
+	msg.assoc_id = assocId;
+	msg.flags = 0;
+	msg.timestamp_ns = 0;
+	scheduler.offer(msg, Handle);
+}
+
+/* Whether the messages handled for assocId came in sequence, starting at 0 */
+static bool InOrder(sctp_assoc_t assocId, size_t count)
+{
+	boost::uint32_t next = 0;
+	for(size_t i = 0; i < g_Handled.size(); ++i)
+	{
+		if(g_Handled[i].assocId == assocId && g_Handled[i].seq != next++)
+		{
+			return false;
+		}
+	}
+	return next == count;
+}
+
+int main()
+{
+	Scheduler scheduler(QUANTUM, MAX_PER_ROUND, MAX_QUEUED);
+
+	// One read burst: the flooder's first MAX_PER_ROUND go straight through, the rest park.
+	Offer(scheduler, FLOODER, 0);
+	Offer(scheduler, FLOODER, 1);
+	Offer(scheduler, FLOODER, 2);
+	Offer(scheduler, FLOODER, 3);
+	Offer(scheduler, FLOODER, 4);
+	Offer(scheduler, FLOODER, 5);
+	Check(g_Handled.size() == MAX_PER_ROUND, "messages within the allowance are handled as offered");
+	Check(scheduler.queued(FLOODER) == 2, "the excess is parked");
+
+	// The quiet association is not held up behind the flood.
+	Offer(scheduler, QUIET, 0);
+	Check(g_Handled.size() == MAX_PER_ROUND + 1 && g_Handled.back().assocId == QUIET,
+		"a quiet association's message is handled at once during a flood");
+	Check(scheduler.queued(QUIET) == 0, "nothing of the quiet association is parked");
+
+	// Keep flooding: the queue fills, and offer() hands parked messages out instead of dropping.
+	boost::uint32_t seq = 6;
+	for(; seq < 6 + 3 * MAX_QUEUED; ++seq)
+	{
+		Offer(scheduler, FLOODER, seq);
+	}
+	Check(scheduler.queued(FLOODER) <= MAX_QUEUED, "the parked queue stays bounded");
+	size_t handedOut = scheduler.dispatch(Handle, 1000);
+	Check(scheduler.empty() && handedOut > 0, "dispatch hands out everything parked");
+	Check(InOrder(FLOODER, seq), "nothing is dropped and order is kept within an association");
+	Check(InOrder(QUIET, 1), "the quiet association's message is handled once");
+
+	// A new round: two backlogged associations share a small dispatch budget evenly.
+	g_Handled.clear();
+	for(boost::uint32_t i = 0; i < MAX_PER_ROUND + MAX_QUEUED; ++i)
+	{
+		Offer(scheduler, FLOODER, i);
+		Offer(scheduler, QUIET, i);
+	}
+	g_Handled.clear();
+	scheduler.dispatch(Handle, 2 * MAX_PER_ROUND);
+	size_t flooder = 0;
+	for(size_t i = 0; i < g_Handled.size(); ++i)
+	{
+		flooder += (g_Handled[i].assocId == FLOODER);
+	}
+	Check(g_Handled.size() == 2 * MAX_PER_ROUND && flooder == MAX_PER_ROUND,
+		"backlogged associations get equal shares of a dispatch");
+	scheduler.dispatch(Handle, 1000);
+	Check(scheduler.empty(), "everything parked is handed out in the end");
+
+	std::printf("%s\n", g_Failures ? "FAILED" : "passed");
+	return g_Failures ? 1 : 0;
+}
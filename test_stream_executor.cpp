@@ -0,0 +1,231 @@
+/**
+*	@file
+*
+*	@section Purpose
+*
+*	Checks the behaviour of sctp_stream_executor as the receive loop uses it:
+*	each stream's messages are handled in the order they were posted while
+*	other streams are handled at the same time; at most max_queued messages
+*	wait per stream, beyond which post() drops and post_wait() waits for
+*	room; and wait_idle() returns only once every message of an association
+*	has been handled, so the association can then be closed behind them.
+*
+*	Usage: test_stream_executor
+*
+*	Exits with 0 if every check passed.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+
+#include <boost/asio_sctp/sctp_stream_executor.hpp>
+
+#define WORKERS				4
+#define MAX_QUEUED			8
+#define STREAMS				6
+#define MESSAGES			2000
+#define ASSOC				1
+#define OTHER_ASSOC			2
+#define SLOW_STREAM			0
+#define FAST_STREAM			1
+#define SLOW_MS				2
+#define WAIT_MS				2000
+
+typedef std::pair<sctp_assoc_t, boost::uint16_t> Key;
+typedef void (*Handler)(const Key&, const boost::asio_sctp::sctp_message&);
+typedef boost::asio_sctp::sctp_stream_executor<Handler> Executor;
+
+static int g_Failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+	std::printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+	if(!ok)
+	{
+		++g_Failures;
+	}
+}
+
+static boost::mutex g_Mutex;  // guards the members below
+static boost::condition_variable g_Changed;
+static std::map<Key, std::vector<boost::uint32_t> > g_Handled;
+static bool g_SlowStarted = false;
+static bool g_FastHandled = false;
+static bool g_Release = false;
+
+/* Records the sequence number each message carries, per key */
+static void Record(const Key& key, const boost::asio_sctp::sctp_message& msg)
+{
+	boost::uint32_t seq;
+	std::memcpy(&seq, msg.data, sizeof(seq));
+	boost::mutex::scoped_lock lock(g_Mutex);
+	g_Handled[key].push_back(seq);
+	g_Changed.notify_all();
+}
+
+/* Holds the slow stream's first message until the fast stream has been handled, or released */
+static void Overlap(const Key& key, const boost::asio_sctp::sctp_message& msg)
+{
+	boost::mutex::scoped_lock lock(g_Mutex);
+	if(key.second == SLOW_STREAM)
+	{
+		g_SlowStarted = true;
+		g_Changed.notify_all();
+		boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(WAIT_MS);
+		while(!g_FastHandled && !g_Release && g_Changed.timed_wait(lock, deadline))
+		{
+		}
+	}
+	else
+	{
+		g_FastHandled = true;
+		g_Changed.notify_all();
+	}
+}
+
+/* Handles each message slowly, so that a close would overtake them */
+static void Slow(const Key& key, const boost::asio_sctp::sctp_message& msg)
+{
+	boost::this_thread::sleep(boost::posix_time::milliseconds(SLOW_MS));
+	Record(key, msg);
+}
+
+static boost::asio_sctp::sctp_message Message(sctp_assoc_t assocId, boost::uint16_t stream, const boost::uint32_t& seq)
+{
+	boost::asio_sctp::sctp_message msg;
+	msg.data = reinterpret_cast<const unsigned char*>(&seq);
+	msg.size = sizeof(seq);
+	msg.stream = stream;
+	msg.ppid = 0;
+	msg.assoc_id = assocId;
+	msg.flags = 0;
+	msg.timestamp_ns = 0;
+	return msg;
+}
+
+static size_t Handled(const Key& key)
+{
+	boost::mutex::scoped_lock lock(g_Mutex);
+	return g_Handled[key].size();
+}
+
+/* Whether key's messages were handled in sequence, starting at 0 */
+static bool InOrder(const Key& key, size_t count)
+{
+	boost::mutex::scoped_lock lock(g_Mutex);
+	const std::vector<boost::uint32_t>& handled = g_Handled[key];
+	for(size_t i = 0; i < handled.size(); ++i)
+	{
+		if(handled[i] != i)
+		{
+			return false;
+		}
+	}
+	return handled.size() == count;
+}
+
+static void PostWait(Executor* pExecutor, Key key, boost::uint32_t seq, bool* pPosted)
+{
+	*pPosted = pExecutor->post_wait(key, Message(key.first, key.second, seq));
+}
+
+int main()
+{
+	// Order within each stream, with every worker busy.
+	{
+		Executor executor(Record, WORKERS, MAX_QUEUED);
+		executor.start();
+		for(boost::uint32_t seq = 0; seq < MESSAGES; ++seq)
+		{
+			for(boost::uint16_t stream = 0; stream < STREAMS; ++stream)
+			{
+				executor.post_wait(Message(ASSOC, stream, seq));
+			}
+		}
+		executor.wait_idle(Key(ASSOC, 0), Key(ASSOC, STREAMS - 1));
+		bool inOrder = true;
+		for(boost::uint16_t stream = 0; stream < STREAMS; ++stream)
+		{
+			inOrder = inOrder && InOrder(Key(ASSOC, stream), MESSAGES);
+		}
+		Check(inOrder, "each stream's messages are handled once each, in the order posted");
+		Check(executor.queued() == 0 && executor.dropped() == 0, "post_wait never drops");
+	}
+
+	// Different streams are handled at the same time.
+	{
+		Executor executor(Overlap, 2, MAX_QUEUED);
+		executor.start();
+		boost::uint32_t seq = 0;
+		executor.post(Message(ASSOC, SLOW_STREAM, seq));
+		{
+			boost::mutex::scoped_lock lock(g_Mutex);
+			while(!g_SlowStarted)
+			{
+				g_Changed.wait(lock);
+			}
+		}
+		executor.post(Message(ASSOC, FAST_STREAM, seq));
+		executor.wait_idle(Key(ASSOC, SLOW_STREAM), Key(ASSOC, FAST_STREAM));
+		boost::mutex::scoped_lock lock(g_Mutex);
+		Check(g_FastHandled, "a stream is handled while another stream's handler is still running");
+	}
+
+	// The queue per stream is bounded.
+	{
+		g_Handled.clear();
+		Executor executor(Record, 1, MAX_QUEUED);  // not started yet, so nothing is taken off
+		std::vector<boost::uint32_t> seqs(MAX_QUEUED + 2);
+		for(boost::uint32_t seq = 0; seq < seqs.size(); ++seq)
+		{
+			seqs[seq] = seq;
+		}
+		bool accepted = true;
+		for(size_t i = 0; i < MAX_QUEUED; ++i)
+		{
+			accepted = accepted && executor.post(Message(ASSOC, 0, seqs[i]));
+		}
+		Check(accepted && executor.queued(Key(ASSOC, 0)) == MAX_QUEUED, "max_queued messages may wait per stream");
+		Check(!executor.post(Message(ASSOC, 0, seqs[MAX_QUEUED])) && executor.dropped() == 1,
+			"post drops a message beyond max_queued and counts it");
+		Check(executor.post(Message(ASSOC, 1, seqs[0])), "another stream's queue is not affected");
+
+		bool posted = false;
+		boost::thread poster(boost::bind(PostWait, &executor, Key(ASSOC, 0), seqs[MAX_QUEUED + 1], &posted));
+		bool blocked = !poster.timed_join(boost::posix_time::milliseconds(50));
+		Check(blocked && executor.queued(Key(ASSOC, 0)) == MAX_QUEUED, "post_wait waits while the stream's queue is full");
+		executor.start();
+		poster.join();
+		executor.wait_idle(Key(ASSOC, 0), Key(ASSOC, 1));
+		Check(posted && Handled(Key(ASSOC, 0)) == MAX_QUEUED + 1 && Handled(Key(ASSOC, 1)) == 1,
+			"post_wait's message is queued once there is room");
+	}
+
+	// wait_idle lets an association be closed only behind its last message.
+	{
+		g_Handled.clear();
+		Executor executor(Slow, WORKERS, MAX_QUEUED);
+		executor.start();
+		for(boost::uint32_t seq = 0; seq < MAX_QUEUED; ++seq)
+		{
+			executor.post_wait(Message(ASSOC, 0, seq));
+			executor.post_wait(Message(ASSOC, 1, seq));
+		}
+		Check(executor.wait_idle(Key(OTHER_ASSOC, 0), Key(OTHER_ASSOC, 0xFFFF)), "wait_idle returns at once for an idle association");
+		Check(executor.wait_idle(Key(ASSOC, 0), Key(ASSOC, 0xFFFF))
+			&& InOrder(Key(ASSOC, 0), MAX_QUEUED) && InOrder(Key(ASSOC, 1), MAX_QUEUED)
+			&& executor.queued() == 0,
+			"wait_idle returns once every message of the association has been handled");
+		executor.stop();
+		Check(!executor.wait_idle(Key(ASSOC, 0), Key(ASSOC, 0xFFFF)), "wait_idle reports a stopped executor");
+	}
+
+	std::printf("%s\n", g_Failures ? "FAILED" : "passed");
+	return g_Failures ? 1 : 0;
+}
@@ -0,0 +1,335 @@
+/**
+*	@file
+*
+*	@section Purpose
+*
+*	Checks the SCTP over UDP engine end to end, with two engines in this
+*	process talking over loopback: the handshake, a message with its stream
+*	and PPID, several windows of data, which only flow if SACKs open the
+*	window, and a graceful shutdown.  A probe then speaks SCTP over UDP to
+*	one engine by hand: a cookie which has been altered, and a valid cookie
+*	echoed from another address or port, must be ignored, while the valid
+*	cookie from the address it was issued to is accepted, and accepted once
+*	only when it is echoed again.  Last the probe restarts, as RFC 4960
+*	section 5.2.4 case A: its new cookie replaces the old association, and
+*	the old cookie is then worthless.
+*
+*	Usage: test_udp_engine
+*
+*	Exits with 0 if every check passed.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <boost/asio_sctp/detail/udp_sctp_engine.hpp>
+
+#define SERVER_UDP_PORT		54340
+#define CLIENT_UDP_PORT		54341
+#define PROBE_UDP_PORT		54342
+#define SCTP_PORT			54343
+#define PROBE_SCTP_PORT		5000
+#define PROBE_TAG			0x12345678
+#define MESSAGE_STREAM		3
+#define MESSAGE_PPID		42
+#define BULK_MESSAGES		50
+#define BULK_MESSAGE_SIZE	60000		// 3 MB in all, three times the window
+#define WAIT_MS				5000
+#define SILENCE_MS			300
+
+using boost::asio_sctp::detail::bridge_header;
+using boost::asio_sctp::detail::udp_sctp_engine;
+namespace sctp_wire = boost::asio_sctp::detail::sctp_wire;
+
+static int g_Failures = 0;
+
+static void Check(bool ok, const char* what)
+{
+	std::printf("%s: %s\n", ok ? "ok" : "FAIL", what);
+	if(!ok)
+	{
+		++g_Failures;
+	}
+}
+
+static sockaddr_in Address(const char* pAddress, unsigned short port)
+{
+	sockaddr_in address = sockaddr_in();
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	::inet_pton(AF_INET, pAddress, &address.sin_addr);
+	return address;
+}
+
+static bool Readable(int fd, int timeoutMs)
+{
+	pollfd p = { fd, POLLIN, 0 };
+	return ::poll(&p, 1, timeoutMs) == 1;
+}
+
+/* Sends one message across the bridge, as the socket calls do */
+static bool SendRecord(int fd, const unsigned char* pData, size_t numBytes, unsigned short stream, unsigned int ppid)
+{
+	bridge_header header = bridge_header();
+	header.stream = stream;
+	header.ppid = ppid;
+	header.flags = bridge_header::end_of_record;
+	iovec iov[2];
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = const_cast<unsigned char*>(pData);
+	iov[1].iov_len = numBytes;
+	msghdr msg = msghdr();
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+	return ::sendmsg(fd, &msg, MSG_NOSIGNAL) == (ssize_t)(sizeof(header) + numBytes);
+}
+
+/* Reads one record from the bridge; returns the payload size, 0 at end of file, -1 on timeout */
+static ssize_t ReceiveRecord(int fd, bridge_header& header, unsigned char* pData, size_t numBytes)
+{
+	if(!Readable(fd, WAIT_MS))
+	{
+		return -1;
+	}
+	iovec iov[2];
+	iov[0].iov_base = &header;
+	iov[0].iov_len = sizeof(header);
+	iov[1].iov_base = pData;
+	iov[1].iov_len = numBytes;
+	msghdr msg = msghdr();
+	msg.msg_iov = iov;
+	msg.msg_iovlen = 2;
+	ssize_t result = ::recvmsg(fd, &msg, 0);
+	return (result <= 0) ? 0 : result - (ssize_t)sizeof(header);
+}
+
+static unsigned char Pattern(size_t offset)
+{
+	return (unsigned char)(offset % 251);
+}
+
+static void BulkSender(int fd, bool* pSent)
+{
+	std::vector<unsigned char> message(BULK_MESSAGE_SIZE);
+	size_t offset = 0;
+	*pSent = true;
+	for(int i = 0; i < BULK_MESSAGES; ++i)
+	{
+		for(size_t j = 0; j < message.size(); ++j)
+		{
+			message[j] = Pattern(offset++);
+		}
+		*pSent = *pSent && SendRecord(fd, &message[0], message.size(), MESSAGE_STREAM, MESSAGE_PPID);
+	}
+	::close(fd);  // all sent: shut the association down
+}
+
+/* Sends a packet of one chunk from the probe to the server engine */
+static void SendProbe(int udp, boost::uint32_t tag, const unsigned char* pChunk, size_t numBytes)
+{
+	std::vector<unsigned char> packet(sctp_wire::common_header_size + numBytes);
+	sctp_wire::put16(&packet[0], PROBE_SCTP_PORT);
+	sctp_wire::put16(&packet[2], SCTP_PORT);
+	sctp_wire::put32(&packet[4], tag);
+	std::memcpy(&packet[sctp_wire::common_header_size], pChunk, numBytes);
+	sctp_wire::seal(&packet[0], packet.size());
+	sockaddr_in server = Address("127.0.0.1", SERVER_UDP_PORT);
+	::sendto(udp, &packet[0], packet.size(), 0, (sockaddr*)&server, sizeof(server));
+}
+
+/* The type of the first chunk of the next packet to the probe, or -1 if none arrives */
+static int ProbeReply(int udp, std::vector<unsigned char>& packet, int timeoutMs)
+{
+	packet.resize(2048);
+	if(!Readable(udp, timeoutMs))
+	{
+		return -1;
+	}
+	ssize_t n = ::recv(udp, &packet[0], packet.size(), 0);
+	if(n < sctp_wire::common_header_size + sctp_wire::chunk_header_size)
+	{
+		return -1;
+	}
+	packet.resize(n);
+	return packet[sctp_wire::common_header_size];
+}
+
+static void SendCookieEcho(int udp, const std::vector<unsigned char>& cookie)
+{
+	std::vector<unsigned char> chunk(sctp_wire::chunk_header_size + cookie.size());
+	chunk[0] = sctp_wire::cookie_echo;
+	sctp_wire::put16(&chunk[2], (boost::uint16_t)chunk.size());
+	std::memcpy(&chunk[sctp_wire::chunk_header_size], &cookie[0], cookie.size());
+	SendProbe(udp, sctp_wire::get32(&cookie[0]), &chunk[0], chunk.size());  // its first field is the engine's tag
+}
+
+/* Sends an INIT with the tag given; returns the cookie in the INIT ACK, empty if none came */
+static std::vector<unsigned char> FetchCookie(int udp, boost::uint32_t tag)
+{
+	unsigned char init[sctp_wire::init_size] = {0};
+	init[0] = sctp_wire::init;
+	sctp_wire::put16(init + 2, sctp_wire::init_size);
+	sctp_wire::put32(init + 4, tag);
+	sctp_wire::put32(init + 8, 65536);
+	sctp_wire::put16(init + 12, 1);
+	sctp_wire::put16(init + 14, 1);
+	sctp_wire::put32(init + 16, 1);
+	SendProbe(udp, 0, init, sizeof(init));
+	std::vector<unsigned char> reply;
+	std::vector<unsigned char> cookie;
+	if(ProbeReply(udp, reply, WAIT_MS) == sctp_wire::init_ack
+		&& reply.size() >= sctp_wire::common_header_size + sctp_wire::init_size + 4)
+	{
+		const unsigned char* pParameter = &reply[sctp_wire::common_header_size + sctp_wire::init_size];
+		size_t length = sctp_wire::get16(pParameter + 2);
+		if(sctp_wire::get16(pParameter) == sctp_wire::state_cookie_param && length > 4
+			&& pParameter + length <= &reply[0] + reply.size())
+		{
+			cookie.assign(pParameter + 4, pParameter + length);
+		}
+	}
+	return cookie;
+}
+
+static int ProbeSocket(const char* pAddress, unsigned short port)
+{
+	int udp = ::socket(AF_INET, SOCK_DGRAM, 0);
+	sockaddr_in local = Address(pAddress, port);
+	if(::bind(udp, (sockaddr*)&local, sizeof(local)) != 0)
+	{
+		::close(udp);
+		return -1;
+	}
+	return udp;
+}
+
+int main()
+{
+	sockaddr_un name;
+	socklen_t nameLength = udp_sctp_engine::listener_name(SCTP_PORT, name);
+	int listener = ::socket(AF_UNIX, SOCK_SEQPACKET, 0);
+	::bind(listener, (sockaddr*)&name, nameLength);
+	::listen(listener, 8);
+
+	udp_sctp_engine server;
+	udp_sctp_engine client;
+	boost::system::error_code serverEc;
+	boost::system::error_code clientEc;
+	server.start(SERVER_UDP_PORT, CLIENT_UDP_PORT, serverEc);
+	client.start(CLIENT_UDP_PORT, SERVER_UDP_PORT, clientEc);
+	Check(!serverEc && !clientEc, "both engines start");
+
+	// Handshake.
+	sockaddr_in remote = Address("127.0.0.1", SCTP_PORT);
+	boost::system::error_code ec;
+	int clientFd = client.connect((sockaddr*)&remote, sizeof(remote), ec);
+	Check(!ec && clientFd >= 0, "the client's association is established");
+	int serverFd = Readable(listener, WAIT_MS) ? ::accept(listener, NULL, NULL) : -1;
+	Check(serverFd >= 0, "the server's association is handed to the listener");
+
+	// One message, with its stream and PPID.
+	const unsigned char hello[] = "hello";
+	unsigned char buffer[BOOST_ASIO_SCTP_BRIDGE_PIECE_SIZE];
+	bridge_header header;
+	SendRecord(clientFd, hello, sizeof(hello), MESSAGE_STREAM, MESSAGE_PPID);
+	ssize_t n = ReceiveRecord(serverFd, header, buffer, sizeof(buffer));
+	Check(n == sizeof(hello) && std::memcmp(buffer, hello, sizeof(hello)) == 0
+		&& header.stream == MESSAGE_STREAM && header.ppid == MESSAGE_PPID
+		&& (header.flags & bridge_header::end_of_record),
+		"a message arrives whole, with its stream and PPID");
+
+	// Several windows of data, then a graceful shutdown.
+	bool sent = false;
+	boost::thread sender(boost::bind(BulkSender, clientFd, &sent));
+	size_t received = 0;
+	bool intact = true;
+	while(received < (size_t)BULK_MESSAGES * BULK_MESSAGE_SIZE
+		&& (n = ReceiveRecord(serverFd, header, buffer, sizeof(buffer))) > 0)
+	{
+		for(ssize_t i = 0; i < n; ++i)
+		{
+			intact = intact && (buffer[i] == Pattern(received + i));
+		}
+		received += n;
+	}
+	sender.join();
+	Check(sent && intact && received == (size_t)BULK_MESSAGES * BULK_MESSAGE_SIZE,
+		"three windows of data arrive in order, so SACKs opened the window");
+	Check(ReceiveRecord(serverFd, header, buffer, sizeof(buffer)) == 0,
+		"closing the client shuts the association down, and the server sees end of file");
+	::close(serverFd);
+
+	// A probe fetches a cookie by hand.
+	int probe = ProbeSocket("127.0.0.1", PROBE_UDP_PORT);
+	std::vector<unsigned char> reply;
+	std::vector<unsigned char> cookie = FetchCookie(probe, PROBE_TAG);
+	Check(!cookie.empty(), "an INIT is answered with a cookie");
+	if(cookie.empty())
+	{
+		std::printf("FAILED\n");
+		return 1;
+	}
+
+	// Altering any byte of the cookie makes it worthless.
+	std::vector<unsigned char> forged(cookie);
+	forged[12] ^= 0x01;  // the probe's initial TSN
+	SendCookieEcho(probe, forged);
+	Check(ProbeReply(probe, reply, SILENCE_MS) < 0 && !Readable(listener, 0), "a forged cookie is ignored");
+
+	// A valid cookie is only good from the address and port it was issued to.
+	int elsewhere = ProbeSocket("127.0.0.2", PROBE_UDP_PORT);
+	SendCookieEcho(elsewhere, cookie);
+	Check(elsewhere >= 0 && ProbeReply(elsewhere, reply, SILENCE_MS) < 0 && !Readable(listener, 0),
+		"a cookie echoed from another address is ignored");
+	int otherPort = ProbeSocket("127.0.0.1", PROBE_UDP_PORT + 1);
+	SendCookieEcho(otherPort, cookie);
+	Check(ProbeReply(otherPort, reply, SILENCE_MS) < 0 && !Readable(listener, 0),
+		"a cookie echoed from another port is ignored");
+
+	SendCookieEcho(probe, cookie);
+	Check(ProbeReply(probe, reply, WAIT_MS) == sctp_wire::cookie_ack && sctp_wire::get32(&reply[4]) == PROBE_TAG,
+		"the cookie is accepted from the address it was issued to");
+	int probeFd = Readable(listener, WAIT_MS) ? ::accept(listener, NULL, NULL) : -1;
+	Check(probeFd >= 0, "and the association is handed to the listener");
+
+	SendCookieEcho(probe, cookie);
+	Check(ProbeReply(probe, reply, WAIT_MS) == sctp_wire::cookie_ack && !Readable(listener, SILENCE_MS),
+		"the cookie echoed again is acknowledged, without a second association");
+
+	// The probe restarts: a new INIT and cookie, carrying the old association's tags as tie-tags.
+	std::vector<unsigned char> restart = FetchCookie(probe, PROBE_TAG + 1);
+	SendCookieEcho(probe, restart);
+	Check(!restart.empty() && ProbeReply(probe, reply, WAIT_MS) == sctp_wire::cookie_ack
+		&& sctp_wire::get32(&reply[4]) == PROBE_TAG + 1,
+		"a restarted peer's cookie is accepted");
+	bridge_header ignored;
+	Check(probeFd >= 0 && ReceiveRecord(probeFd, ignored, buffer, sizeof(buffer)) == 0,
+		"and the association it replaces is closed");
+	int restartFd = Readable(listener, WAIT_MS) ? ::accept(listener, NULL, NULL) : -1;
+	Check(restartFd >= 0, "and the new association is handed to the listener");
+	SendCookieEcho(probe, cookie);
+	Check(ProbeReply(probe, reply, SILENCE_MS) < 0 && !Readable(listener, 0),
+		"the cookie from before the restart, which matches neither tag, is ignored");
+
+	server.stop();
+	client.stop();
+	::close(probeFd);
+	::close(restartFd);
+	::close(probe);
+	::close(elsewhere);
+	::close(otherPort);
+	::close(listener);
+
+	std::printf("%s\n", g_Failures ? "FAILED" : "passed");
+	return g_Failures ? 1 : 0;
+}